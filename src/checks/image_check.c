@@ -0,0 +1,316 @@
+/*
+ * image_check.c - the drawing kernels against the temporary-bitmap path routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+   A standalone program (it builds imagekernel.c against
+   the small Allegro replacement in shim/):
+
+       make image_check && ./image_check
+
+   image_draw_scaled() and image_draw_trans() used to stretch
+   or flip the source into a temporary bitmap, then draw it as
+   a (translucent) sprite. The kernels of imagekernel.c must
+   give the same output, pixel by pixel, for every IF_* flag,
+   color depth, scale, position and clipping rectangle here.
+
+   The same goes for the tinted glyphs of font.c, which used
+   to be drawn pixel by pixel. Pixels that were drawn in the
+   mask color can't be kept in a tinted glyph: these must be
+   one step away from it.
+
+   Exits with 0 if they do.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <allegro.h>
+#include "../core/imagekernel.h"
+
+static const int depth[] = { 8, 15, 16, 24, 32 };
+static const float scale[] = { 0.3, 0.5, 1.0, 1.7, 2.0, 3.3 };
+static const int position[][2] = { { 0, 0 }, { 10, 7 }, { -13, -5 }, { 70, 50 }, { -200, 0 } };
+static const int clip[][4] = { { 0, 0, 96, 64 }, { 5, 3, 80, 60 }, { 40, 20, 41, 50 } }; /* cl, ct, cr, cb */
+static const int alpha[] = { 0, 1, 64, 128, 200, 255 };
+static const int tint[][3] = { { 255, 255, 255 }, { 0, 0, 0 }, { 255, 0, 255 }, { 255, 255, 0 }, { 128, 200, 17 }, { 3, 90, 250 } };
+
+static unsigned seed = 4321;
+static int failures = 0;
+
+static unsigned rnd();
+static void fill(BITMAP *bmp, int mask);
+static int same(BITMAP *a, BITMAP *b);
+static void copy(BITMAP *src, BITMAP *dest);
+static void set_clip(BITMAP *bmp, const int rect[4]);
+static void old_scaled(BITMAP *src, BITMAP *dest, int x, int y, int w, int h, int mask, int hflip, int vflip);
+static void old_trans(BITMAP *src, BITMAP *dest, int x, int y, int mask, int alpha, int hflip, int vflip);
+static void old_sprite(BITMAP *src, BITMAP *dest, int x, int y, int mask, int hflip, int vflip);
+static void old_tinted_char(BITMAP *ch, BITMAP *dest, int x, int y, int mask, int color);
+static int same_tint(BITMAP *expected, BITMAP *got, int mask);
+static void whiten(BITMAP *bmp, int mask);
+static void expect(int ok, const char *what, int d, int flags, int x, int y);
+
+
+
+int main()
+{
+    int d, f, s, p, c, a, t, w, h, mask, color, checks = 0;
+    BITMAP *src, *dest, *expected, *got, *glyph;
+
+    for(d=0; d<(int)(sizeof(depth)/sizeof(depth[0])); d++) {
+        set_color_depth(depth[d]);
+        mask = (depth[d] == 8) ? 0 : makecol_depth(depth[d], 255, 0, 255);
+        src = create_bitmap_ex(depth[d], 37, 23);
+        dest = create_bitmap_ex(depth[d], 96, 64);
+        expected = create_bitmap_ex(depth[d], 96, 64);
+        got = create_bitmap_ex(depth[d], 96, 64);
+        fill(src, mask);
+        fill(dest, -1);
+
+        for(f=0; f<4; f++) {
+            for(p=0; p<(int)(sizeof(position)/sizeof(position[0])); p++) {
+                for(c=0; c<(int)(sizeof(clip)/sizeof(clip[0])); c++) {
+                    for(s=0; s<(int)(sizeof(scale)/sizeof(scale[0])); s++) {
+                        w = (int)(scale[s] * src->w);
+                        h = (int)(scale[s] * src->h);
+                        copy(dest, expected);
+                        copy(dest, got);
+                        set_clip(expected, clip[c]);
+                        set_clip(got, clip[c]);
+                        old_scaled(src, expected, position[p][0], position[p][1], w, h, mask, f & 1, f & 2);
+                        imagekernel_draw_scaled(src, got, position[p][0], position[p][1], w, h, mask, f & 1, f & 2);
+                        expect(same(expected, got), "imagekernel_draw_scaled", depth[d], f, position[p][0], position[p][1]);
+                        checks++;
+                    }
+
+                    for(a=0; a<(int)(sizeof(alpha)/sizeof(alpha[0])) && depth[d]>8; a++) {
+                        copy(dest, expected);
+                        copy(dest, got);
+                        set_clip(expected, clip[c]);
+                        set_clip(got, clip[c]);
+                        old_trans(src, expected, position[p][0], position[p][1], mask, alpha[a], f & 1, f & 2);
+                        imagekernel_draw_trans(src, got, position[p][0], position[p][1], mask, alpha[a], f & 1, f & 2);
+                        expect(same(expected, got), "imagekernel_draw_trans", depth[d], f, position[p][0], position[p][1]);
+                        checks++;
+                    }
+                }
+            }
+        }
+
+        /* tinted glyphs (true color only) */
+        for(t=0; t<(int)(sizeof(tint)/sizeof(tint[0])) && depth[d]>8; t++) {
+            color = makecol_depth(depth[d], tint[t][0], tint[t][1], tint[t][2]);
+            glyph = create_bitmap_ex(depth[d], src->w, src->h);
+            whiten(src, mask);
+            imagekernel_tint(src, glyph, mask, color);
+            for(p=0; p<(int)(sizeof(position)/sizeof(position[0])); p++) {
+                copy(dest, expected);
+                copy(dest, got);
+                set_clip(expected, clip[0]);
+                set_clip(got, clip[0]);
+                old_tinted_char(src, expected, position[p][0], position[p][1], mask, color);
+                old_sprite(glyph, got, position[p][0], position[p][1], mask, 0, 0);
+                expect(same_tint(expected, got, mask), "imagekernel_tint", depth[d], 0, position[p][0], position[p][1]);
+                checks++;
+            }
+            destroy_bitmap(glyph);
+        }
+
+        destroy_bitmap(got);
+        destroy_bitmap(expected);
+        destroy_bitmap(dest);
+        destroy_bitmap(src);
+    }
+
+    printf("%s: %d drawings compared\n", failures ? "FAILED" : "OK", checks);
+    return failures ? 1 : 0;
+}
+
+/* pseudo-random numbers */
+unsigned rnd()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+/* random pixels; about 1/4 of them are mask (if mask >= 0) */
+void fill(BITMAP *bmp, int mask)
+{
+    int x, y, d = bitmap_color_depth(bmp);
+
+    for(y=0; y<bmp->h; y++) {
+        for(x=0; x<bmp->w; x++) {
+            if(mask >= 0 && rnd() % 4 == 0)
+                putpixel(bmp, x, y, mask);
+            else if(d == 8)
+                putpixel(bmp, x, y, 1 + rnd() % 255);
+            else
+                putpixel(bmp, x, y, makecol_depth(d, rnd() & 255, rnd() & 255, rnd() & 255));
+        }
+    }
+}
+
+/* glyphs are mostly white: about 1/4 of the pixels that
+ * aren't mask become white */
+void whiten(BITMAP *bmp, int mask)
+{
+    int x, y, white = makecol_depth(bitmap_color_depth(bmp), 255, 255, 255);
+
+    for(y=0; y<bmp->h; y++) {
+        for(x=0; x<bmp->w; x++) {
+            if(getpixel(bmp, x, y) != mask && rnd() % 4 == 0)
+                putpixel(bmp, x, y, white);
+        }
+    }
+}
+
+/* are these bitmaps equal? */
+int same(BITMAP *a, BITMAP *b)
+{
+    int y, pitch = a->w * BYTES_PER_PIXEL(bitmap_color_depth(a));
+
+    for(y=0; y<a->h; y++) {
+        if(memcmp(a->line[y], b->line[y], pitch) != 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* like same(), but a pixel of the mask color in
+ * expected may be one step away from it in got */
+int same_tint(BITMAP *expected, BITMAP *got, int mask)
+{
+    int x, y, e, g;
+
+    for(y=0; y<expected->h; y++) {
+        for(x=0; x<expected->w; x++) {
+            e = getpixel(expected, x, y);
+            g = getpixel(got, x, y);
+            if(e != g && !(e == mask && g == (mask ^ 1)))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* copies src to dest, a bitmap of the same size */
+void copy(BITMAP *src, BITMAP *dest)
+{
+    int y, pitch = src->w * BYTES_PER_PIXEL(bitmap_color_depth(src));
+
+    for(y=0; y<src->h; y++)
+        memcpy(dest->line[y], src->line[y], pitch);
+}
+
+/* sets the clipping rectangle */
+void set_clip(BITMAP *bmp, const int rect[4])
+{
+    bmp->cl = rect[0];
+    bmp->ct = rect[1];
+    bmp->cr = rect[2];
+    bmp->cb = rect[3];
+}
+
+/* the old image_draw_scaled(): stretch_blit() into a
+ * temporary bitmap, then draw it as a (flipped) sprite */
+void old_scaled(BITMAP *src, BITMAP *dest, int x, int y, int w, int h, int mask, int hflip, int vflip)
+{
+    BITMAP *tmp;
+
+    if(w <= 0 || h <= 0)
+        return;
+
+    tmp = create_bitmap_ex(bitmap_color_depth(src), w, h);
+    stretch_blit(src, tmp, 0, 0, src->w, src->h, 0, 0, w, h);
+    old_sprite(tmp, dest, x, y, mask, hflip, vflip);
+    destroy_bitmap(tmp);
+}
+
+/* the old image_draw_trans(): draw src into a temporary
+ * bitmap cleared to the mask color, then draw_trans_sprite() */
+void old_trans(BITMAP *src, BITMAP *dest, int x, int y, int mask, int alpha, int hflip, int vflip)
+{
+    BITMAP *tmp = create_bitmap_ex(bitmap_color_depth(src), src->w, src->h);
+    int i, j, c, d = bitmap_color_depth(dest);
+
+    for(j=0; j<tmp->h; j++) {
+        for(i=0; i<tmp->w; i++)
+            putpixel(tmp, i, j, mask);
+    }
+    old_sprite(src, tmp, 0, 0, mask, hflip, vflip);
+
+    for(j=MAX(y, dest->ct); j<y+tmp->h && j<dest->cb; j++) {
+        for(i=MAX(x, dest->cl); i<x+tmp->w && i<dest->cr; i++) {
+            if((c = getpixel(tmp, i-x, j-y)) != mask) {
+                switch(d) {
+                    case 15: c = (int)_blender_trans15(c, getpixel(dest, i, j), alpha); break;
+                    case 16: c = (int)_blender_trans16(c, getpixel(dest, i, j), alpha); break;
+                    default: c = (int)_blender_trans24(c, getpixel(dest, i, j), alpha); break;
+                }
+                putpixel(dest, i, j, c);
+            }
+        }
+    }
+
+    destroy_bitmap(tmp);
+}
+
+/* draw_sprite(), draw_sprite_h_flip(), ..._v_flip(), ..._vh_flip() */
+void old_sprite(BITMAP *src, BITMAP *dest, int x, int y, int mask, int hflip, int vflip)
+{
+    int i, j, c;
+
+    for(j=MAX(y, dest->ct); j<y+src->h && j<dest->cb; j++) {
+        for(i=MAX(x, dest->cl); i<x+src->w && i<dest->cr; i++) {
+            c = getpixel(src, hflip ? src->w-1-(i-x) : i-x, vflip ? src->h-1-(j-y) : j-y);
+            if(c != mask)
+                putpixel(dest, i, j, c);
+        }
+    }
+}
+
+/* the old render_char() of font.c: the pixels of ch that
+ * aren't the mask color are multiplied (AND) by color and
+ * put on dest, one by one */
+void old_tinted_char(BITMAP *ch, BITMAP *dest, int x, int y, int mask, int color)
+{
+    int i, j, px, d = bitmap_color_depth(ch);
+
+    for(j=0; j<ch->h; j++) {
+        for(i=0; i<ch->w; i++) {
+            px = getpixel(ch, i, j);
+            if(px != mask && x+i >= dest->cl && x+i < dest->cr && y+j >= dest->ct && y+j < dest->cb) {
+                px = makecol_depth(d,
+                    getr_depth(d, px) & getr_depth(d, color),
+                    getg_depth(d, px) & getg_depth(d, color),
+                    getb_depth(d, px) & getb_depth(d, color)
+                );
+                putpixel(dest, x+i, y+j, px);
+            }
+        }
+    }
+}
+
+/* reports a failure */
+void expect(int ok, const char *what, int d, int flags, int x, int y)
+{
+    if(!ok && failures++ < 10)
+        printf("%s differs: %d bpp, flags %d, at (%d,%d)\n", what, d, flags, x, y);
+}
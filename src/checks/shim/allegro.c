@@ -0,0 +1,216 @@
+/*
+ * allegro.c - the few parts of Allegro that the checks need routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "allegro.h"
+
+static int color_depth = 16;
+
+void set_color_depth(int depth)
+{
+    color_depth = depth;
+}
+
+int makecol(int r, int g, int b)
+{
+    return makecol_depth(color_depth, r, g, b);
+}
+
+int makecol_depth(int depth, int r, int g, int b)
+{
+    switch(depth) {
+        case 15: return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+        case 16: return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        default: return (r << 16) | (g << 8) | b;
+    }
+}
+
+/* 5 and 6 bit components are scaled to 8 bits as Allegro does */
+int getr_depth(int depth, int c)
+{
+    switch(depth) {
+        case 15: c = (c >> 10) & 0x1F; return (c << 3) | (c >> 2);
+        case 16: c = (c >> 11) & 0x1F; return (c << 3) | (c >> 2);
+        default: return (c >> 16) & 0xFF;
+    }
+}
+
+int getg_depth(int depth, int c)
+{
+    switch(depth) {
+        case 15: c = (c >> 5) & 0x1F; return (c << 3) | (c >> 2);
+        case 16: c = (c >> 5) & 0x3F; return (c << 2) | (c >> 4);
+        default: return (c >> 8) & 0xFF;
+    }
+}
+
+int getb_depth(int depth, int c)
+{
+    switch(depth) {
+        case 15:
+        case 16: c = c & 0x1F; return (c << 3) | (c >> 2);
+        default: return c & 0xFF;
+    }
+}
+
+BITMAP *create_bitmap_ex(int depth, int width, int height)
+{
+    BITMAP *bmp = malloc(sizeof *bmp);
+    int j, pitch = width * BYTES_PER_PIXEL(depth);
+
+    bmp->w = bmp->cr = width;
+    bmp->h = bmp->cb = height;
+    bmp->cl = bmp->ct = 0;
+    bmp->depth = depth;
+    bmp->dat = calloc(height, pitch);
+    bmp->line = malloc(height * sizeof *(bmp->line));
+    for(j=0; j<height; j++)
+        bmp->line[j] = bmp->dat + j * pitch;
+
+    return bmp;
+}
+
+BITMAP *create_sub_bitmap(BITMAP *parent, int x, int y, int width, int height)
+{
+    BITMAP *bmp = malloc(sizeof *bmp);
+    int j;
+
+    bmp->w = bmp->cr = width;
+    bmp->h = bmp->cb = height;
+    bmp->cl = bmp->ct = 0;
+    bmp->depth = parent->depth;
+    bmp->dat = NULL;
+    bmp->line = malloc(height * sizeof *(bmp->line));
+    for(j=0; j<height; j++)
+        bmp->line[j] = parent->line[y + j] + x * BYTES_PER_PIXEL(parent->depth);
+
+    return bmp;
+}
+
+void destroy_bitmap(BITMAP *bmp)
+{
+    if(bmp != NULL) {
+        free(bmp->dat);
+        free(bmp->line);
+        free(bmp);
+    }
+}
+
+void clear_bitmap(BITMAP *bmp)
+{
+    int j;
+
+    for(j=0; j<bmp->h; j++)
+        memset(bmp->line[j], 0, bmp->w * BYTES_PER_PIXEL(bmp->depth));
+}
+
+int _getpixel24(BITMAP *bmp, int x, int y)
+{
+    unsigned char *p = bmp->line[y] + x * 3;
+    return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+void _putpixel24(BITMAP *bmp, int x, int y, int color)
+{
+    unsigned char *p = bmp->line[y] + x * 3;
+    p[0] = color & 0xFF;
+    p[1] = (color >> 8) & 0xFF;
+    p[2] = (color >> 16) & 0xFF;
+}
+
+/* no clipping */
+int getpixel(BITMAP *bmp, int x, int y)
+{
+    switch(bmp->depth) {
+        case 8:  return bmp->line[y][x];
+        case 15:
+        case 16: return ((uint16_t*)bmp->line[y])[x];
+        case 24: return _getpixel24(bmp, x, y);
+        default: return (int)((uint32_t*)bmp->line[y])[x];
+    }
+}
+
+void putpixel(BITMAP *bmp, int x, int y, int color)
+{
+    switch(bmp->depth) {
+        case 8:  bmp->line[y][x] = (unsigned char)color; break;
+        case 15:
+        case 16: ((uint16_t*)bmp->line[y])[x] = (uint16_t)color; break;
+        case 24: _putpixel24(bmp, x, y, color); break;
+        default: ((uint32_t*)bmp->line[y])[x] = (uint32_t)color; break;
+    }
+}
+
+/* the blenders of set_trans_blender(), as in Allegro's colblend.c */
+unsigned long _blender_trans15(unsigned long x, unsigned long y, unsigned long n)
+{
+    unsigned long result;
+
+    if(n)
+        n = (n + 1) / 8;
+
+    x = ((x & 0xFFFF) | (x << 16)) & 0x3E07C1F;
+    y = ((y & 0xFFFF) | (y << 16)) & 0x3E07C1F;
+    result = ((x - y) * n / 32 + y) & 0x3E07C1F;
+
+    return ((result & 0xFFFF) | (result >> 16));
+}
+
+unsigned long _blender_trans16(unsigned long x, unsigned long y, unsigned long n)
+{
+    unsigned long result;
+
+    if(n)
+        n = (n + 1) / 8;
+
+    x = ((x & 0xFFFF) | (x << 16)) & 0x7E0F81F;
+    y = ((y & 0xFFFF) | (y << 16)) & 0x7E0F81F;
+    result = ((x - y) * n / 32 + y) & 0x7E0F81F;
+
+    return ((result & 0xFFFF) | (result >> 16));
+}
+
+unsigned long _blender_trans24(unsigned long x, unsigned long y, unsigned long n)
+{
+    unsigned long res, g;
+
+    if(n)
+        n++;
+
+    res = ((x & 0xFF00FF) - (y & 0xFF00FF)) * n / 256 + y;
+    y &= 0xFF00;
+    x &= 0xFF00;
+    g = (x - y) * n / 256 + y;
+
+    res &= 0xFF00FF;
+    g &= 0xFF00;
+
+    return res | g;
+}
+
+/* nearest neighbour */
+void stretch_blit(BITMAP *src, BITMAP *dest, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh)
+{
+    int i, j, bpp = BYTES_PER_PIXEL(src->depth);
+
+    for(j=0; j<dh; j++) {
+        for(i=0; i<dw; i++)
+            memcpy(dest->line[dy + j] + (dx + i) * bpp, src->line[sy + j * sh / dh] + (sx + i * sw / dw) * bpp, bpp);
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * allegro.h - the few parts of Allegro that the checks need routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _CHECKS_ALLEGRO_H
+#define _CHECKS_ALLEGRO_H
+
+/*
+   Not Allegro: memory bitmaps only, enough to build
+   2xsai.c in the checks (see xsai_check.c).
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct BITMAP {
+    int w, h;
+    int cl, ct, cr, cb; /* clipping rectangle */
+    int depth;
+    unsigned char *dat;
+    unsigned char **line;
+} BITMAP;
+
+#define MIN(x,y)                (((x) < (y)) ? (x) : (y))
+#define MAX(x,y)                (((x) > (y)) ? (x) : (y))
+#define MID(x,y,z)              MAX((x), MIN((y), (z)))
+#define BYTES_PER_PIXEL(bpp)    (((int)(bpp) + 7) / 8)
+
+#define bitmap_color_depth(bmp) ((bmp)->depth)
+#define is_memory_bitmap(bmp)   1
+#define is_video_bitmap(bmp)    0
+#define is_planar_bitmap(bmp)   0
+
+#define bmp_select(bmp)         ((void)(bmp))
+#define bmp_unwrite_line(bmp)   ((void)(bmp))
+#define bmp_write_line(bmp,y)   ((uintptr_t)((bmp)->line[(y)]))
+#define bmp_write32(addr,c)     (*((uint32_t*)(addr)) = (uint32_t)(c))
+
+void set_color_depth(int depth);
+int makecol(int r, int g, int b);
+int makecol_depth(int depth, int r, int g, int b);
+int getr_depth(int depth, int c);
+int getg_depth(int depth, int c);
+int getb_depth(int depth, int c);
+
+BITMAP *create_bitmap_ex(int depth, int width, int height);
+BITMAP *create_sub_bitmap(BITMAP *parent, int x, int y, int width, int height);
+void destroy_bitmap(BITMAP *bmp);
+void clear_bitmap(BITMAP *bmp);
+int _getpixel24(BITMAP *bmp, int x, int y);
+void _putpixel24(BITMAP *bmp, int x, int y, int color);
+int getpixel(BITMAP *bmp, int x, int y);
+void putpixel(BITMAP *bmp, int x, int y, int color);
+unsigned long _blender_trans15(unsigned long x, unsigned long y, unsigned long n);
+unsigned long _blender_trans16(unsigned long x, unsigned long y, unsigned long n);
+unsigned long _blender_trans24(unsigned long x, unsigned long y, unsigned long n);
+void stretch_blit(BITMAP *src, BITMAP *dest, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh);
+
+#endif
@@ -0,0 +1 @@
+/* nothing here: see ../../allegro.h */
@@ -0,0 +1,130 @@
+/*
+ * trig_check.c - the trigonometry tables against the math library routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+   A standalone program (it doesn't need Allegro):
+
+       make trig_check && ./trig_check
+
+   trig_rotate() and the sensor templates of the characters
+   must give the same points as v2d_rotate() does, within a
+   pixel, for every whole number of degrees in [-720,720].
+   Exits with 0 if they do.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "../core/global.h"
+#include "../core/v2d.h"
+#include "../core/trig.h"
+#include "../entities/sensor.h"
+
+#define MIN_DEGREES         -720
+#define MAX_DEGREES         720
+#define TOLERANCE           1.0     /* in pixels */
+
+/* the factors of sensor_factors() (player.c): top, middle, lateral */
+static const float factor[][3] = {
+    { 0.7, 0.5, 0.4 }, { 1.0, 0.8, 0.5 },   /* Surge */
+    { 0.7, 0.5, 0.25 }, { 1.0, 0.7, 0.25 }  /* Neon & Charge */
+};
+
+static double worst = 0.0;
+static int failures = 0;
+
+static void compare(const char *what, int degrees, v2d_t got, v2d_t expected);
+static void check_rotation();
+static void check_templates();
+
+
+
+int main()
+{
+    trig_init();
+
+    check_rotation();
+    check_templates();
+
+    printf("%s: largest difference: %f pixels\n", failures ? "FAILED" : "OK", worst);
+    return failures ? 1 : 0;
+}
+
+/* trig_rotate() vs v2d_rotate() */
+void check_rotation()
+{
+    static const float length[] = { 1, 16, 64, 256, 1024, 4096 };
+    int deg, i, k;
+    float angle;
+    v2d_t v;
+
+    for(deg=MIN_DEGREES; deg<=MAX_DEGREES; deg++) {
+        angle = deg * PI / 180.0;
+        for(i=0; i<(int)(sizeof(length)/sizeof(length[0])); i++) {
+            for(k=0; k<8; k++) {
+                v = v2d_new(length[i] * cos(k * PI / 4), length[i] * sin(k * PI / 4));
+                compare("trig_rotate", deg, trig_rotate(v, angle), v2d_rotate(v, angle));
+                compare("trig_rotate", deg, trig_rotate(v, -angle), v2d_rotate(v, -angle));
+            }
+        }
+    }
+}
+
+/* the cached layouts vs v2d_rotate(), as player.c gets
+ * them: act->angle is in radians and comes from a brick */
+void check_templates()
+{
+    int deg, w, h, f, k, degrees;
+    float angle;
+    const v2d_t *offset;
+    v2d_t base[8];
+
+    for(deg=MIN_DEGREES; deg<=MAX_DEGREES; deg++) {
+        angle = deg * PI / 180.0;
+        if((degrees = trig_degrees(angle)) < 0) {
+            printf("trig_degrees(%f) failed at %d degrees\n", angle, deg);
+            failures++;
+            continue;
+        }
+
+        for(w=8; w<=128; w+=24) {
+            for(h=8; h<=128; h+=24) {
+                for(f=0; f<(int)(sizeof(factor)/sizeof(factor[0])); f++) {
+                    sensor_layout(w, h, factor[f][0], factor[f][1], factor[f][2], 0, base);
+                    offset = sensor_template(w, h, degrees, factor[f][0], factor[f][1], factor[f][2]);
+                    for(k=0; k<8; k++)
+                        compare("sensor_template", deg, offset[k], v2d_rotate(base[k], -angle));
+                }
+            }
+        }
+    }
+}
+
+/* are these points the same, within TOLERANCE? */
+void compare(const char *what, int degrees, v2d_t got, v2d_t expected)
+{
+    double d = v2d_magnitude(v2d_subtract(got, expected));
+
+    if(d > worst)
+        worst = d;
+
+    if(!(d <= TOLERANCE)) {
+        if(failures++ < 10)
+            printf("%s at %d degrees: (%f,%f) instead of (%f,%f)\n", what, degrees, got.x, got.y, expected.x, expected.y);
+    }
+}
@@ -0,0 +1,172 @@
+/*
+ * xsai_check.c - the vectorized 2xSaI against the scalar code routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+   A standalone program (it builds 2xsai.c against the
+   small Allegro replacement in shim/):
+
+       make xsai_check && ./xsai_check
+
+   For several sizes, depths and kinds of images:
+   - Super2xSaI() must give the same output, bit by bit,
+     with SSE2 and without it (xsai_scalar.c);
+   - Super2xSaI_rows() and SuperEagle_rows() must give
+     the same output as the whole frame, however it's split.
+   Exits with 0 if they do.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <allegro.h>
+#include "../core/2xsai/2xsai.h"
+
+/* xsai_scalar.c */
+int scalar_Init_2xSaI(int depth);
+void scalar_Super2xSaI(BITMAP *src, BITMAP *dest, int s_x, int s_y, int d_x, int d_y, int w, int h);
+
+static const int size[][2] = {
+    { 4, 4 }, { 5, 4 }, { 9, 6 }, { 10, 10 }, { 11, 5 }, { 12, 12 }, { 13, 7 },
+    { 17, 9 }, { 18, 18 }, { 33, 20 }, { 64, 48 }, { 320, 240 }, { 400, 240 }
+};
+static const int depth[] = { 15, 16, 32 };
+static const int band[] = { 1, 2, 3, 7, 64 };
+enum { PAT_PALETTE, PAT_NOISE, PAT_STRIPES, PAT_GRADIENT, PAT_COUNT };
+static const char *pattern_name[] = { "palette", "noise", "stripes", "gradient" };
+
+static unsigned seed = 12345;
+static int failures = 0;
+
+static unsigned rnd();
+static void fill(BITMAP *bmp, int pattern);
+static int same(BITMAP *a, BITMAP *b);
+static void expect(int ok, const char *what, int w, int h, int d, int pattern);
+
+
+
+int main()
+{
+    int s, d, p, b, y, w, h;
+    BITMAP *src, *scalar, *full, *banded;
+
+    for(d=0; d<(int)(sizeof(depth)/sizeof(depth[0])); d++) {
+        set_color_depth(depth[d]);
+        for(s=0; s<(int)(sizeof(size)/sizeof(size[0])); s++) {
+            for(p=0; p<PAT_COUNT; p++) {
+                w = size[s][0];
+                h = size[s][1];
+                src = create_bitmap_ex(depth[d], w, h);
+                scalar = create_bitmap_ex(depth[d], 2*w, 2*h);
+                full = create_bitmap_ex(depth[d], 2*w, 2*h);
+                banded = create_bitmap_ex(depth[d], 2*w, 2*h);
+                fill(src, p);
+
+                /* SSE2 vs scalar */
+                scalar_Init_2xSaI(depth[d]);
+                scalar_Super2xSaI(src, scalar, 0, 0, 0, 0, w, h);
+                Init_2xSaI(depth[d]);
+                Super2xSaI(src, full, 0, 0, 0, 0, w, h);
+                expect(same(scalar, full), "Super2xSaI (SSE2 vs scalar)", w, h, depth[d], p);
+
+                /* bands vs the whole frame */
+                for(b=0; b<(int)(sizeof(band)/sizeof(band[0])); b++) {
+                    clear_bitmap(banded);
+                    for(y=0; y<h; y+=band[b])
+                        Super2xSaI_rows(src, banded, y, y + band[b]);
+                    expect(same(full, banded), "Super2xSaI_rows", w, h, depth[d], p);
+                }
+
+                SuperEagle(src, full, 0, 0, 0, 0, w, h);
+                for(b=0; b<(int)(sizeof(band)/sizeof(band[0])); b++) {
+                    clear_bitmap(banded);
+                    for(y=0; y<h; y+=band[b])
+                        SuperEagle_rows(src, banded, y, y + band[b]);
+                    expect(same(full, banded), "SuperEagle_rows", w, h, depth[d], p);
+                }
+
+                destroy_bitmap(banded);
+                destroy_bitmap(full);
+                destroy_bitmap(scalar);
+                destroy_bitmap(src);
+            }
+        }
+    }
+
+#if !defined(__SSE2__) && !defined(_M_X64) && !(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    printf("Warning: SSE2 isn't enabled, so only the scalar code has been checked\n");
+#endif
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
+
+/* pseudo-random numbers */
+unsigned rnd()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+/* fills the bitmap with a pattern. 2xSaI looks for pixels
+ * that are equal, so some patterns use few colors */
+void fill(BITMAP *bmp, int pattern)
+{
+    int x, y, c = 0, bpp = (bitmap_color_depth(bmp) + 7) / 8;
+    int palette[4];
+
+    palette[0] = makecol_depth(bitmap_color_depth(bmp), 0, 0, 0);
+    palette[1] = makecol_depth(bitmap_color_depth(bmp), 255, 255, 255);
+    palette[2] = makecol_depth(bitmap_color_depth(bmp), 255, 128, 0);
+    palette[3] = makecol_depth(bitmap_color_depth(bmp), 32, 64, 200);
+
+    for(y=0; y<bmp->h; y++) {
+        for(x=0; x<bmp->w; x++) {
+            switch(pattern) {
+                case PAT_PALETTE:  c = palette[rnd() % 4]; break;
+                case PAT_NOISE:    c = makecol_depth(bitmap_color_depth(bmp), rnd() & 255, rnd() & 255, rnd() & 255); break;
+                case PAT_STRIPES:  c = palette[((x + y) / 2 + (x * y) % 3) % 4]; break;
+                case PAT_GRADIENT: c = makecol_depth(bitmap_color_depth(bmp), x * 255 / bmp->w, y * 255 / bmp->h, (x + y) & 255); break;
+            }
+
+            if(bpp == 2)
+                ((uint16_t*)bmp->line[y])[x] = (uint16_t)c;
+            else
+                ((uint32_t*)bmp->line[y])[x] = (uint32_t)c;
+        }
+    }
+}
+
+/* are these bitmaps equal? */
+int same(BITMAP *a, BITMAP *b)
+{
+    int y, pitch = a->w * ((bitmap_color_depth(a) + 7) / 8);
+
+    for(y=0; y<a->h; y++) {
+        if(memcmp(a->line[y], b->line[y], pitch) != 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* reports a failure */
+void expect(int ok, const char *what, int w, int h, int d, int pattern)
+{
+    if(!ok && failures++ < 10)
+        printf("%s differs: %dx%d, %d bpp, %s\n", what, w, h, d, pattern_name[pattern]);
+}
@@ -1,5 +1,5 @@
 /*
- * gravity.h - This decorator makes the object capable of being affected by gravity
+ * xsai_scalar.c - 2xsai.c without SSE2, for xsai_check.c routines
  * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
  *
  * This program is free software; you can redistribute it and/or modify
@@ -17,12 +17,13 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifndef _OD_GRAVITY_H
-#define _OD_GRAVITY_H
-
-#include "base/objectdecorator.h"
-
-objectmachine_t* objectdecorator_gravity_new(objectmachine_t *decorated_machine);
-
-#endif
+#define XSAI_NO_SSE2
+#define Init_2xSaI          scalar_Init_2xSaI
+#define Super2xSaI          scalar_Super2xSaI
+#define Super2xSaI_ex       scalar_Super2xSaI_ex
+#define Super2xSaI_rows     scalar_Super2xSaI_rows
+#define SuperEagle          scalar_SuperEagle
+#define SuperEagle_ex       scalar_SuperEagle_ex
+#define SuperEagle_rows     scalar_SuperEagle_rows
 
+#include "../core/2xsai/2xsai.c"
@@ -33,6 +33,13 @@ that may arise by the use of this program.
 #include <allegro/internal/aintern.h>
 #include "2xsai.h"
 
+/* SSE2 is part of every x86-64 processor. XSAI_NO_SSE2 keeps
+ * the scalar code only (src/checks/xsai_check.c compares both) */
+#if !defined(XSAI_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define XSAI_SSE2
+#include <emmintrin.h>
+#endif
+
 
 
 static __UInt32 colorMask = 0xF7DEF7DE;
@@ -206,8 +213,139 @@ static int GetResult2(__UInt32 A, __UInt32 B, __UInt32 C, __UInt32 D, __UInt32 E
       return;
 
 
-static unsigned char *src_line[4];
-static unsigned char *dst_line[2];
+/* Can the rows of src be processed separately? */
+static int xsai_bandable(BITMAP *src, BITMAP *dest)
+{
+    int sbpp = bitmap_color_depth(src);
+
+    return !(sbpp != xsai_depth || sbpp != bitmap_color_depth(dest) || !is_memory_bitmap(dest) ||
+    src->w < 4 || src->h < 4 || dest->w < src->w * 2 || dest->h < src->h * 2 ||
+    src->cl > 0 || src->ct > 0 || src->cr < src->w || src->cb < src->h ||
+    dest->cl > 0 || dest->ct > 0 || dest->cr < src->w * 2 || dest->cb < src->h * 2);
+}
+
+/* Writes 2 lines of a non-memory bitmap */
+static void xsai_write_lines(BITMAP *dest, unsigned int y, unsigned char **dst_line, int sbpp)
+{
+    int j, k;
+    unsigned long dst_addr;
+
+    for (k = 0; k < 2; k++) {
+        dst_addr = bmp_write_line(dest, y * 2 + k);
+        for (j = 0; j < dest->w * sbpp; j += sizeof(__UInt32))
+            bmp_write32(dst_addr + j, *((__UInt32 *) (dst_line[k] + j)));
+    }
+}
+
+
+
+#ifdef XSAI_SSE2
+
+/* Vectorized Super2xSaI for 15/16 bpp: 8 pixels at a time. The
+ * conditions of the scalar code become masks and every product is
+ * computed for every pixel, then the right ones are selected. The
+ * results are the same, bit by bit. */
+
+#define V_EQ(a, b)          _mm_cmpeq_epi16(c[a], c[b])
+#define V_NE(a, b)          _mm_andnot_si128(_mm_cmpeq_epi16(c[a], c[b]), ones)
+#define V_AND(a, b)         _mm_and_si128(a, b)
+#define V_AND4(a, b, d, e)  _mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(d, e))
+#define V_SEL(m, a, b)      _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+
+static __m128i v_interpolate(__m128i a, __m128i b, __m128i cm, __m128i lm)
+{
+    return _mm_add_epi16(_mm_add_epi16(_mm_srli_epi16(_mm_and_si128(a, cm), 1), _mm_srli_epi16(_mm_and_si128(b, cm), 1)), _mm_and_si128(_mm_and_si128(a, b), lm));
+}
+
+static __m128i v_q_interpolate(__m128i a, __m128i b, __m128i c, __m128i d, __m128i qcm, __m128i qlm)
+{
+    __m128i hi = _mm_add_epi16(
+        _mm_add_epi16(_mm_srli_epi16(_mm_and_si128(a, qcm), 2), _mm_srli_epi16(_mm_and_si128(b, qcm), 2)),
+        _mm_add_epi16(_mm_srli_epi16(_mm_and_si128(c, qcm), 2), _mm_srli_epi16(_mm_and_si128(d, qcm), 2))
+    );
+    __m128i lo = _mm_add_epi16(
+        _mm_add_epi16(_mm_and_si128(a, qlm), _mm_and_si128(b, qlm)),
+        _mm_add_epi16(_mm_and_si128(c, qlm), _mm_and_si128(d, qlm))
+    );
+    return _mm_add_epi16(hi, _mm_and_si128(_mm_srli_epi16(lo, 2), qlm));
+}
+
+/* GET_RESULT(A, B, C, D): the masks are -1 where true */
+static __m128i v_get_result(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    return _mm_sub_epi16(
+        _mm_and_si128(_mm_cmpeq_epi16(a, c), _mm_cmpeq_epi16(a, d)),
+        _mm_and_si128(_mm_cmpeq_epi16(b, c), _mm_cmpeq_epi16(b, d))
+    );
+}
+
+/* Processes the pixels x, x+1, ... of a row, as long as the whole
+ * neighbourhood of 8 pixels fits in the row. Returns the first pixel
+ * that's left to the scalar code. */
+static unsigned int super2xsai_row_sse2(unsigned char **src_line, unsigned char **dst_line, unsigned int x, unsigned int width)
+{
+    int j;
+    __m128i c[16];
+    __m128i product1a, product1b, product2a, product2b, product3, r;
+    __m128i cm = _mm_set1_epi16((short)(colorMask & 0xFFFF));
+    __m128i lm = _mm_set1_epi16((short)(lowPixelMask & 0xFFFF));
+    __m128i qcm = _mm_set1_epi16((short)(qcolorMask & 0xFFFF));
+    __m128i qlm = _mm_set1_epi16((short)(qlowpixelMask & 0xFFFF));
+    __m128i ones = _mm_set1_epi16(-1);
+    __m128i zero = _mm_setzero_si128();
+    __m128i c1, c2, c3;
+
+    for (; x + 9 < width; x += 8) {
+        /* color[j] of the pixels x .. x+7 (same layout as the scalar matrix) */
+        for (j = 0; j < 16; j++)
+            c[j] = _mm_loadu_si128((const __m128i *) (((__UInt16 *) src_line[j >> 2]) + x + (j & 3) - 1));
+
+        c1 = V_AND(V_EQ(9, 6), V_NE(5, 10));
+        c2 = V_AND(V_EQ(5, 10), V_NE(9, 6));
+        c3 = V_AND(V_EQ(5, 10), V_EQ(9, 6));
+
+        r = _mm_add_epi16(
+            _mm_add_epi16(v_get_result(c[6], c[5], c[8], c[13]), v_get_result(c[6], c[5], c[4], c[1])),
+            _mm_add_epi16(v_get_result(c[6], c[5], c[14], c[11]), v_get_result(c[6], c[5], c[2], c[7]))
+        );
+        product3 = V_SEL(_mm_cmpgt_epi16(r, zero), c[6], V_SEL(_mm_cmplt_epi16(r, zero), c[5], v_interpolate(c[5], c[6], cm, lm)));
+
+        product2b = V_SEL(V_AND4(V_EQ(6, 10), V_EQ(10, 13), V_NE(9, 14), V_NE(10, 12)), v_q_interpolate(c[10], c[10], c[10], c[9], qcm, qlm),
+                    V_SEL(V_AND4(V_EQ(5, 9), V_EQ(9, 14), V_NE(13, 10), V_NE(9, 15)), v_q_interpolate(c[9], c[9], c[9], c[10], qcm, qlm),
+                    v_interpolate(c[9], c[10], cm, lm)));
+        product1b = V_SEL(V_AND4(V_EQ(6, 10), V_EQ(6, 1), V_NE(5, 2), V_NE(6, 0)), v_q_interpolate(c[6], c[6], c[6], c[5], qcm, qlm),
+                    V_SEL(V_AND4(V_EQ(5, 9), V_EQ(5, 2), V_NE(1, 6), V_NE(5, 3)), v_q_interpolate(c[6], c[5], c[5], c[5], qcm, qlm),
+                    v_interpolate(c[5], c[6], cm, lm)));
+
+        product2b = V_SEL(c1, c[9], V_SEL(c2, c[5], V_SEL(c3, product3, product2b)));
+        product1b = V_SEL(c1, c[9], V_SEL(c2, c[5], V_SEL(c3, product3, product1b)));
+
+        product2a = V_SEL(_mm_or_si128(V_AND4(V_EQ(5, 10), V_NE(9, 6), V_EQ(4, 5), V_NE(5, 14)), V_AND4(V_EQ(5, 8), V_EQ(6, 5), V_NE(4, 9), V_NE(5, 12))),
+                    v_interpolate(c[9], c[5], cm, lm), c[9]);
+        product1a = V_SEL(_mm_or_si128(V_AND4(V_EQ(9, 6), V_NE(5, 10), V_EQ(8, 9), V_NE(9, 2)), V_AND4(V_EQ(4, 9), V_EQ(10, 9), V_NE(8, 5), V_NE(9, 0))),
+                    v_interpolate(c[9], c[5], cm, lm), c[5]);
+
+        _mm_storeu_si128((__m128i *) (&dst_line[0][x * 4]), _mm_unpacklo_epi16(product1a, product1b));
+        _mm_storeu_si128((__m128i *) (&dst_line[0][x * 4 + 16]), _mm_unpackhi_epi16(product1a, product1b));
+        _mm_storeu_si128((__m128i *) (&dst_line[1][x * 4]), _mm_unpacklo_epi16(product2a, product2b));
+        _mm_storeu_si128((__m128i *) (&dst_line[1][x * 4 + 16]), _mm_unpackhi_epi16(product2a, product2b));
+    }
+
+    return x;
+}
+
+#undef V_EQ
+#undef V_NE
+#undef V_AND
+#undef V_AND4
+#undef V_SEL
+
+#endif
+
+
+
+static void super2xsai_rows(__UInt8 *src, __UInt32 src_pitch, BITMAP *dest, __UInt32 width, __UInt32 height, __UInt32 first_row, __UInt32 last_row);
+static void supereagle_rows(__UInt8 *src, __UInt32 src_pitch, BITMAP *dest, __UInt32 width, __UInt32 height, __UInt32 first_row, __UInt32 last_row);
 
 
 void Super2xSaI(BITMAP * src, BITMAP * dest, int s_x, int s_y, int d_x, int d_y, int w, int h)
@@ -245,62 +383,136 @@ void Super2xSaI(BITMAP * src, BITMAP * dest, int s_x, int s_y, int d_x, int d_y,
 }
 
 void Super2xSaI_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *dest, __UInt32 width, __UInt32 height) {
+    super2xsai_rows(src, src_pitch, dest, width, height, 0, height);
+}
+
+/* Same as Super2xSaI(src, dest, 0, 0, 0, 0, src->w, src->h), but only the
+ * source rows first_row .. last_row-1 are processed. Rows outside that
+ * range are still read as neighbours, so the output doesn't depend on how
+ * the frame is split: different ranges may be processed by different
+ * threads. Memory bitmaps only; other cases fall back to Super2xSaI(),
+ * which is then run by whoever gets first_row == 0. */
+void Super2xSaI_rows(BITMAP *src, BITMAP *dest, int first_row, int last_row)
+{
+    if (!src || !dest)
+        return;
+
+    if (!xsai_bandable(src, dest)) {
+        if (first_row == 0)
+            Super2xSaI(src, dest, 0, 0, 0, 0, src->w, src->h);
+        return;
+    }
+
+    first_row = MAX(first_row, 0);
+    last_row = MIN(last_row, src->h);
+    if (first_row >= last_row)
+        return;
+
+    super2xsai_rows(src->line[0], (unsigned int)(src->line[1] - src->line[0]), dest, src->w, src->h, first_row, last_row);
+}
+
+/* The 2xSaI engine. The state lives in local variables, so
+ * that this can run on several threads at the same time */
+static void super2xsai_rows(__UInt8 *src, __UInt32 src_pitch, BITMAP *dest, __UInt32 width, __UInt32 height, __UInt32 first_row, __UInt32 last_row) {
 
     int j, v;
     unsigned int x, y;
     int sbpp = BYTES_PER_PIXEL(bitmap_color_depth(dest));
-    unsigned long color[16];
+    __UInt32 color[16];
+    unsigned char *src_line[4];
+    unsigned char *dst_line[2];
 
-    /* Point to the first 3 lines. */
-    src_line[0] = src;
-    src_line[1] = src;
-    src_line[2] = src + src_pitch;
-    src_line[3] = src + src_pitch * 2;
+    /* Point to the first 3 lines (the edges are repeated) */
+    for (j = 0; j < 4; j++)
+        src_line[j] = src + src_pitch * MID(0, (int)first_row - 1 + j, (int)height - 1);
     
     /* Can we write the results directly? */
     if (is_video_bitmap(dest) || is_planar_bitmap(dest)) {
-        dst_line[0] = malloc(sizeof(char) * sbpp * width);
-        dst_line[1] = malloc(sizeof(char) * sbpp * width);
+        dst_line[0] = malloc(sizeof(char) * sbpp * dest->w);
+        dst_line[1] = malloc(sizeof(char) * sbpp * dest->w);
         v = 1;
     }
     else {
-        dst_line[0] = dest->line[0];
-        dst_line[1] = dest->line[1];
+        dst_line[0] = dest->line[first_row * 2];
+        dst_line[1] = dest->line[first_row * 2 + 1];
         v = 0;
     }
     
     /* Set destination */
     bmp_select(dest);
 
-    x = 0, y = 0;
+    x = 0, y = first_row;
     
-    if (PixelsPerMask == 2) {
-        unsigned short *sbp;
-        sbp = (unsigned short*)src_line[0];
-        color[0] = *sbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
-        color[4] = color[0];   color[5] = color[0];   color[6] = *(sbp + 1);  color[7] = *(sbp + 2);
-        sbp = (unsigned short*)src_line[2];
-        color[8] = *sbp;     color[9] = color[8];     color[10] = *(sbp + 1); color[11] = *(sbp + 2);
-        sbp = (unsigned short*)src_line[3];
-        color[12] = *sbp;    color[13] = color[12];   color[14] = *(sbp + 1); color[15] = *(sbp + 2);
+    if (y == 0) {
+        if (PixelsPerMask == 2) {
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
+            color[0] = *sbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
+            color[4] = color[0];   color[5] = color[0];   color[6] = *(sbp + 1);  color[7] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[2];
+            color[8] = *sbp;     color[9] = color[8];     color[10] = *(sbp + 1); color[11] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[3];
+            color[12] = *sbp;    color[13] = color[12];   color[14] = *(sbp + 1); color[15] = *(sbp + 2);
+        }
+        else {
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
+            color[0] = *lbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
+            color[4] = color[0];   color[5] = color[0];   color[6] = *(lbp + 1);  color[7] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[2];
+            color[8] = *lbp;     color[9] = color[8];     color[10] = *(lbp + 1); color[11] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[3];
+            color[12] = *lbp;    color[13] = color[12];   color[14] = *(lbp + 1); color[15] = *(lbp + 2);
+        }
     }
     else {
-        unsigned long *lbp;
-        lbp = (unsigned long*)src_line[0];
-        color[0] = *lbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
-        color[4] = color[0];   color[5] = color[0];   color[6] = *(lbp + 1);  color[7] = *(lbp + 2);
-        lbp = (unsigned long*)src_line[2];
-        color[8] = *lbp;     color[9] = color[8];     color[10] = *(lbp + 1); color[11] = *(lbp + 2);
-        lbp = (unsigned long*)src_line[3];
-        color[12] = *lbp;    color[13] = color[12];   color[14] = *(lbp + 1); color[15] = *(lbp + 2);
+        /* Same matrix the previous row leaves behind (see "shift the
+         * color matrix up" below). Its color[9] is the rightmost pixel
+         * of the line below the previous row, i.e., of this row. */
+        if (PixelsPerMask == 2) {
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
+            color[0] = *sbp;     color[1] = color[0];    color[2] = *(sbp + 1);  color[3] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[1];
+            color[4] = *sbp;     color[5] = color[4];    color[6] = *(sbp + 1);  color[7] = *(sbp + 2);
+            color[9] = *(sbp + width - 1);
+            sbp = (__UInt16*)src_line[2];
+            color[8] = *sbp;                             color[10] = *(sbp + 1); color[11] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[3];
+            color[12] = *sbp;    color[13] = color[12];  color[14] = *(sbp + 1); color[15] = *(sbp + 2);
+        }
+        else {
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
+            color[0] = *lbp;     color[1] = color[0];    color[2] = *(lbp + 1);  color[3] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[1];
+            color[4] = *lbp;     color[5] = color[4];    color[6] = *(lbp + 1);  color[7] = *(lbp + 2);
+            color[9] = *(lbp + width - 1);
+            lbp = (__UInt32*)src_line[2];
+            color[8] = *lbp;                             color[10] = *(lbp + 1); color[11] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[3];
+            color[12] = *lbp;    color[13] = color[12];  color[14] = *(lbp + 1); color[15] = *(lbp + 2);
+        }
     }
 
-    for (y = 0; y < height; y++) {
+    for (y = first_row; y < last_row; y++) {
     
         /* Todo: x = width - 2, x = width - 1 */
         
         for (x = 0; x < width; x++) {
-            unsigned long product1a, product1b, product2a, product2b;
+            __UInt32 product1a, product1b, product2a, product2b;
+
+#ifdef XSAI_SSE2
+            /* The first pixels of a row read leftovers of the previous
+             * one (see above), so they're left to the scalar code. In
+             * the middle of the row, the matrix is simply the
+             * neighbourhood of x, with the edges repeated. */
+            if (x == 4 && PixelsPerMask == 2) {
+                x = super2xsai_row_sse2(src_line, dst_line, x, width);
+                for (j = 0; j < 16; j++)
+                    color[j] = *(((__UInt16*)src_line[j >> 2]) + MIN((int)x + (j & 3) - 1, (int)width - 1));
+            }
+#endif
 
 /*
 ---------------------------------------  B0 B1 B2 B3    0  1  2  3
@@ -366,14 +578,14 @@ void Super2xSaI_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
                 product1a = color[5];
     
             if (PixelsPerMask == 2) {
-                *((unsigned long *) (&dst_line[0][x * 4])) = product1a | (product1b << 16);
-                *((unsigned long *) (&dst_line[1][x * 4])) = product2a | (product2b << 16);
+                *((__UInt32 *) (&dst_line[0][x * 4])) = product1a | (product1b << 16);
+                *((__UInt32 *) (&dst_line[1][x * 4])) = product2a | (product2b << 16);
             }
             else {
-                *((unsigned long *) (&dst_line[0][x * 8])) = product1a;
-                *((unsigned long *) (&dst_line[0][x * 8 + 4])) = product1b;
-                *((unsigned long *) (&dst_line[1][x * 8])) = product2a;
-                *((unsigned long *) (&dst_line[1][x * 8 + 4])) = product2b;
+                *((__UInt32 *) (&dst_line[0][x * 8])) = product1a;
+                *((__UInt32 *) (&dst_line[0][x * 8 + 4])) = product1b;
+                *((__UInt32 *) (&dst_line[1][x * 8])) = product2a;
+                *((__UInt32 *) (&dst_line[1][x * 8 + 4])) = product2b;
             }
             
             /* Move color matrix forward */
@@ -384,21 +596,29 @@ void Super2xSaI_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
             if (x < width - 3) {
                 x += 3;
                 if (PixelsPerMask == 2) {
-                    color[3] = *(((unsigned short*)src_line[0]) + x);                    
-                    color[7] = *(((unsigned short*)src_line[1]) + x);
-                    color[11] = *(((unsigned short*)src_line[2]) + x);
-                    color[15] = *(((unsigned short*)src_line[3]) + x);
+                    color[3] = *(((__UInt16*)src_line[0]) + x);                    
+                    color[7] = *(((__UInt16*)src_line[1]) + x);
+                    color[11] = *(((__UInt16*)src_line[2]) + x);
+                    color[15] = *(((__UInt16*)src_line[3]) + x);
                 }
                 else {
-                    color[3] = *(((unsigned long*)src_line[0]) + x);
-                    color[7] = *(((unsigned long*)src_line[1]) + x);
-                    color[11] = *(((unsigned long*)src_line[2]) + x);
-                    color[15] = *(((unsigned long*)src_line[3]) + x);
+                    color[3] = *(((__UInt32*)src_line[0]) + x);
+                    color[7] = *(((__UInt32*)src_line[1]) + x);
+                    color[11] = *(((__UInt32*)src_line[2]) + x);
+                    color[15] = *(((__UInt32*)src_line[3]) + x);
                 }
                 x -= 3;
             }
         }
 
+        /* The 2 leftmost columns are defective: repeat the third one */
+        for (j = 0; j < 2; j++) {
+            if (PixelsPerMask == 2)
+                ((__UInt16*)dst_line[j])[0] = ((__UInt16*)dst_line[j])[1] = ((__UInt16*)dst_line[j])[2];
+            else
+                ((__UInt32*)dst_line[j])[0] = ((__UInt32*)dst_line[j])[1] = ((__UInt32*)dst_line[j])[2];
+        }
+
         /* We're done with one line, so we shift the source lines up */
         src_line[0] = src_line[1];
         src_line[1] = src_line[2];
@@ -412,41 +632,32 @@ void Super2xSaI_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
             
         /* Then shift the color matrix up */
         if (PixelsPerMask == 2) {
-            unsigned short *sbp;
-            sbp = (unsigned short*)src_line[0];
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
             color[0] = *sbp;     color[1] = color[0];    color[2] = *(sbp + 1);  color[3] = *(sbp + 2);
-            sbp = (unsigned short*)src_line[1];
+            sbp = (__UInt16*)src_line[1];
             color[4] = *sbp;     color[5] = color[4];    color[6] = *(sbp + 1);  color[7] = *(sbp + 2);
-            sbp = (unsigned short*)src_line[2];
+            sbp = (__UInt16*)src_line[2];
             color[8] = *sbp;     color[9] = color[9];    color[10] = *(sbp + 1); color[11] = *(sbp + 2);
-            sbp = (unsigned short*)src_line[3];
+            sbp = (__UInt16*)src_line[3];
             color[12] = *sbp;    color[13] = color[12];  color[14] = *(sbp + 1); color[15] = *(sbp + 2);
         }
         else {
-            unsigned long *lbp;
-            lbp = (unsigned long*)src_line[0];
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
             color[0] = *lbp;     color[1] = color[0];    color[2] = *(lbp + 1);  color[3] = *(lbp + 2);
-            lbp = (unsigned long*)src_line[1];
+            lbp = (__UInt32*)src_line[1];
             color[4] = *lbp;     color[5] = color[4];    color[6] = *(lbp + 1);  color[7] = *(lbp + 2);
-            lbp = (unsigned long*)src_line[2];
+            lbp = (__UInt32*)src_line[2];
             color[8] = *lbp;     color[9] = color[9];    color[10] = *(lbp + 1); color[11] = *(lbp + 2);
-            lbp = (unsigned long*)src_line[3];
+            lbp = (__UInt32*)src_line[3];
             color[12] = *lbp;    color[13] = color[12];  color[14] = *(lbp + 1); color[15] = *(lbp + 2);
         }
         
         
         /* Write the 2 lines, if not already done so */
-        if (v) {
-            unsigned long dst_addr;
-        
-            dst_addr = bmp_write_line(dest, y * 2);
-            for (j = 0; j < dest->w * sbpp; j += sizeof(long))
-                bmp_write32(dst_addr + j, *((unsigned long *) (dst_line[0] + j)));
-                
-            dst_addr = bmp_write_line(dest, y * 2 + 1);
-            for (j = 0; j < dest->w * sbpp; j += sizeof(long))
-                bmp_write32(dst_addr + j, *((unsigned long *) (dst_line[1] + j)));
-        }
+        if (v)
+            xsai_write_lines(dest, y, dst_line, sbpp);
         else {
             if (y < height - 1) {
                 dst_line[0] = dest->line[y * 2 + 2];
@@ -499,62 +710,114 @@ void SuperEagle(BITMAP * src, BITMAP * dest, int s_x, int s_y, int d_x, int d_y,
 }
 
 void SuperEagle_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *dest, __UInt32 width, __UInt32 height) {
+    supereagle_rows(src, src_pitch, dest, width, height, 0, height);
+}
+
+/* Same as Super2xSaI_rows(), for SuperEagle */
+void SuperEagle_rows(BITMAP *src, BITMAP *dest, int first_row, int last_row)
+{
+    if (!src || !dest)
+        return;
+
+    if (!xsai_bandable(src, dest)) {
+        if (first_row == 0)
+            SuperEagle(src, dest, 0, 0, 0, 0, src->w, src->h);
+        return;
+    }
+
+    first_row = MAX(first_row, 0);
+    last_row = MIN(last_row, src->h);
+    if (first_row >= last_row)
+        return;
+
+    supereagle_rows(src->line[0], (unsigned int)(src->line[1] - src->line[0]), dest, src->w, src->h, first_row, last_row);
+}
+
+/* The SuperEagle engine (see super2xsai_rows()) */
+static void supereagle_rows(__UInt8 *src, __UInt32 src_pitch, BITMAP *dest, __UInt32 width, __UInt32 height, __UInt32 first_row, __UInt32 last_row) {
 
     int j, v;
     unsigned int x, y;
     int sbpp = BYTES_PER_PIXEL(bitmap_color_depth(dest));
-    unsigned long color[12];
+    __UInt32 color[12];
+    unsigned char *src_line[4];
+    unsigned char *dst_line[2];
 
-    /* Point to the first 3 lines. */
-    src_line[0] = src;
-    src_line[1] = src;
-    src_line[2] = src + src_pitch;
-    src_line[3] = src + src_pitch * 2;
+    /* Point to the first 3 lines (the edges are repeated) */
+    for (j = 0; j < 4; j++)
+        src_line[j] = src + src_pitch * MID(0, (int)first_row - 1 + j, (int)height - 1);
     
     /* Can we write the results directly? */
     if (is_video_bitmap(dest) || is_planar_bitmap(dest)) {
-        dst_line[0] = malloc(sizeof(char) * sbpp * width);
-        dst_line[1] = malloc(sizeof(char) * sbpp * width);
+        dst_line[0] = malloc(sizeof(char) * sbpp * dest->w);
+        dst_line[1] = malloc(sizeof(char) * sbpp * dest->w);
         v = 1;
     }
     else {
-        dst_line[0] = dest->line[0];
-        dst_line[1] = dest->line[1];
+        dst_line[0] = dest->line[first_row * 2];
+        dst_line[1] = dest->line[first_row * 2 + 1];
         v = 0;
     }
     
     /* Set destination */
     bmp_select(dest);
 
-    x = 0, y = 0;
+    x = 0, y = first_row;
     
-    if (PixelsPerMask == 2) {
-        unsigned short *sbp;
-        sbp = (unsigned short*)src_line[0];
-        color[0] = *sbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
-        color[4] = *(sbp + 1); color[5] = *(sbp + 2);
-        sbp = (unsigned short*)src_line[2];
-        color[6] = *sbp;     color[7] = color[6];     color[8] = *(sbp + 1); color[9] = *(sbp + 2);
-        sbp = (unsigned short*)src_line[3];
-        color[10] = *sbp;    color[11] = *(sbp + 1); 
+    if (y == 0) {
+        if (PixelsPerMask == 2) {
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
+            color[0] = *sbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
+            color[4] = *(sbp + 1); color[5] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[2];
+            color[6] = *sbp;     color[7] = color[6];     color[8] = *(sbp + 1); color[9] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[3];
+            color[10] = *sbp;    color[11] = *(sbp + 1); 
+        }
+        else {
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
+            color[0] = *lbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
+            color[4] = *(lbp + 1); color[5] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[2];
+            color[6] = *lbp;     color[7] = color[6];     color[8] = *(lbp + 1); color[9] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[3];
+            color[10] = *lbp;    color[11] = *(lbp + 1);
+        }
     }
     else {
-        unsigned long *lbp;
-        lbp = (unsigned long*)src_line[0];
-        color[0] = *lbp;       color[1] = color[0];   color[2] = color[0];    color[3] = color[0];
-        color[4] = *(lbp + 1); color[5] = *(lbp + 2);
-        lbp = (unsigned long*)src_line[2];
-        color[6] = *lbp;     color[7] = color[6];     color[8] = *(lbp + 1); color[9] = *(lbp + 2);
-        lbp = (unsigned long*)src_line[3];
-        color[10] = *lbp;    color[11] = *(lbp + 1);
+        /* Same matrix the previous row leaves behind */
+        if (PixelsPerMask == 2) {
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
+            color[0] = *sbp;     color[1] = *(sbp + 1);
+            sbp = (__UInt16*)src_line[1];
+            color[2] = *sbp;     color[3] = color[2];    color[4] = *(sbp + 1);  color[5] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[2];
+            color[6] = *sbp;     color[7] = color[6];    color[8] = *(sbp + 1);  color[9] = *(sbp + 2);
+            sbp = (__UInt16*)src_line[3];
+            color[10] = *sbp;    color[11] = *(sbp + 1);
+        }
+        else {
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
+            color[0] = *lbp;     color[1] = *(lbp + 1);
+            lbp = (__UInt32*)src_line[1];
+            color[2] = *lbp;     color[3] = color[2];    color[4] = *(lbp + 1);  color[5] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[2];
+            color[6] = *lbp;     color[7] = color[6];    color[8] = *(lbp + 1);  color[9] = *(lbp + 2);
+            lbp = (__UInt32*)src_line[3];
+            color[10] = *lbp;    color[11] = *(lbp + 1);
+        }
     }
 
-    for (y = 0; y < height; y++) {
+    for (y = first_row; y < last_row; y++) {
     
         /* Todo: x = width - 2, x = width - 1 */
         
         for (x = 0; x < width; x++) {
-            unsigned long product1a, product1b, product2a, product2b;
+            __UInt32 product1a, product1b, product2a, product2b;
 
 /*
 ---------------------------------------     B1 B2           0  1
@@ -622,14 +885,14 @@ void SuperEagle_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
             }
 
             if (PixelsPerMask == 2) {
-                *((unsigned long *) (&dst_line[0][x * 4])) = product1a | (product1b << 16);
-                *((unsigned long *) (&dst_line[1][x * 4])) = product2a | (product2b << 16);
+                *((__UInt32 *) (&dst_line[0][x * 4])) = product1a | (product1b << 16);
+                *((__UInt32 *) (&dst_line[1][x * 4])) = product2a | (product2b << 16);
             }
             else {
-                *((unsigned long *) (&dst_line[0][x * 8])) = product1a;
-                *((unsigned long *) (&dst_line[0][x * 8 + 4])) = product1b;
-                *((unsigned long *) (&dst_line[1][x * 8])) = product2a;
-                *((unsigned long *) (&dst_line[1][x * 8 + 4])) = product2b;
+                *((__UInt32 *) (&dst_line[0][x * 8])) = product1a;
+                *((__UInt32 *) (&dst_line[0][x * 8 + 4])) = product1b;
+                *((__UInt32 *) (&dst_line[1][x * 8])) = product2a;
+                *((__UInt32 *) (&dst_line[1][x * 8 + 4])) = product2b;
             }
             
             /* Move color matrix forward */
@@ -641,25 +904,30 @@ void SuperEagle_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
             if (x < width - 2) {
                 x += 2;
                 if (PixelsPerMask == 2) {
-                    color[1] = *(((unsigned short*)src_line[0]) + x);
-                    if (x < width) {
-                        color[5] = *(((unsigned short*)src_line[1]) + x + 1);
-                        color[9] = *(((unsigned short*)src_line[2]) + x + 1);
-                    }
-                    color[11] = *(((unsigned short*)src_line[3]) + x);
+                    color[1] = *(((__UInt16*)src_line[0]) + x);
+                    color[5] = *(((__UInt16*)src_line[1]) + MIN(x + 1, width - 1));
+                    color[9] = *(((__UInt16*)src_line[2]) + MIN(x + 1, width - 1));
+                    color[11] = *(((__UInt16*)src_line[3]) + x);
                 }
                 else {
-                    color[1] = *(((unsigned long*)src_line[0]) + x);
-                    if (x < width) {
-                        color[5] = *(((unsigned long*)src_line[1]) + x + 1);
-                        color[9] = *(((unsigned long*)src_line[2]) + x + 1);
-                    }
-                    color[11] = *(((unsigned long*)src_line[3]) + x);
+                    color[1] = *(((__UInt32*)src_line[0]) + x);
+                    color[5] = *(((__UInt32*)src_line[1]) + MIN(x + 1, width - 1));
+                    color[9] = *(((__UInt32*)src_line[2]) + MIN(x + 1, width - 1));
+                    color[11] = *(((__UInt32*)src_line[3]) + x);
                 }
                 x -= 2;
             }
         }
 
+        /* The 2 rightmost columns are defective: repeat the one
+         * before them */
+        for (j = 0; j < 2; j++) {
+            if (PixelsPerMask == 2)
+                ((__UInt16*)dst_line[j])[width * 2 - 1] = ((__UInt16*)dst_line[j])[width * 2 - 2] = ((__UInt16*)dst_line[j])[width * 2 - 3];
+            else
+                ((__UInt32*)dst_line[j])[width * 2 - 1] = ((__UInt32*)dst_line[j])[width * 2 - 2] = ((__UInt32*)dst_line[j])[width * 2 - 3];
+        }
+
         /* We're done with one line, so we shift the source lines up */
         src_line[0] = src_line[1];
         src_line[1] = src_line[2];
@@ -673,41 +941,32 @@ void SuperEagle_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *de
             
         /* Then shift the color matrix up */
         if (PixelsPerMask == 2) {
-            unsigned short *sbp;
-            sbp = (unsigned short*)src_line[0];
+            __UInt16 *sbp;
+            sbp = (__UInt16*)src_line[0];
             color[0] = *sbp;     color[1] = *(sbp + 1);
-            sbp = (unsigned short*)src_line[1];
+            sbp = (__UInt16*)src_line[1];
             color[2] = *sbp;     color[3] = color[2];    color[4] = *(sbp + 1);  color[5] = *(sbp + 2);
-            sbp = (unsigned short*)src_line[2];
+            sbp = (__UInt16*)src_line[2];
             color[6] = *sbp;     color[7] = color[6];    color[8] = *(sbp + 1);  color[9] = *(sbp + 2);
-            sbp = (unsigned short*)src_line[3];
+            sbp = (__UInt16*)src_line[3];
             color[10] = *sbp;    color[11] = *(sbp + 1);
         }
         else {
-            unsigned long *lbp;
-            lbp = (unsigned long*)src_line[0];
+            __UInt32 *lbp;
+            lbp = (__UInt32*)src_line[0];
             color[0] = *lbp;     color[1] = *(lbp + 1);
-            lbp = (unsigned long*)src_line[1];
+            lbp = (__UInt32*)src_line[1];
             color[2] = *lbp;     color[3] = color[2];    color[4] = *(lbp + 1);  color[5] = *(lbp + 2);
-            lbp = (unsigned long*)src_line[2];
+            lbp = (__UInt32*)src_line[2];
             color[6] = *lbp;     color[7] = color[6];    color[8] = *(lbp + 1);  color[9] = *(lbp + 2);
-            lbp = (unsigned long*)src_line[3];
+            lbp = (__UInt32*)src_line[3];
             color[10] = *lbp;    color[11] = *(lbp + 1);
         }
 
 
         /* Write the 2 lines, if not already done so */
-        if (v) {
-            unsigned long dst_addr;
-        
-            dst_addr = bmp_write_line(dest, y * 2);
-            for (j = 0; j < dest->w * sbpp; j += sizeof(long))
-                bmp_write32(dst_addr + j, *((unsigned long *) (dst_line[0] + j)));
-                
-            dst_addr = bmp_write_line(dest, y * 2 + 1);
-            for (j = 0; j < dest->w * sbpp; j += sizeof(long))
-                bmp_write32(dst_addr + j, *((unsigned long *) (dst_line[1] + j)));
-        }
+        if (v)
+            xsai_write_lines(dest, y, dst_line, sbpp);
         else {
             if (y < height - 1) {
                 dst_line[0] = dest->line[y * 2 + 2];
@@ -47,8 +47,10 @@ typedef unsigned __int32 __UInt32;
 int Init_2xSaI(int depth);
 void Super2xSaI(BITMAP *src, BITMAP *dest, int s_x, int s_y, int d_x, int d_y, int w, int h);
 void Super2xSaI_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *dest, __UInt32 width, __UInt32 height);
+void Super2xSaI_rows(BITMAP *src, BITMAP *dest, int first_row, int last_row);
 
 void SuperEagle(BITMAP *src, BITMAP *dest, int s_x, int s_y, int d_x, int d_y, int w, int h);
 void SuperEagle_ex(__UInt8 *src, __UInt32 src_pitch, __UInt8 *unused, BITMAP *dest, __UInt32 width, __UInt32 height);
+void SuperEagle_rows(BITMAP *src, BITMAP *dest, int first_row, int last_row);
 
 #endif
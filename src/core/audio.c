@@ -64,7 +64,7 @@ music_t *music_load(const char *path)
 
     if(NULL == (m = resourcemanager_find_music(path))) {
         resource_filepath(abs_path, path, sizeof(abs_path), RESFP_READ);
-        logfile_message("music_load('%s')", abs_path);
+        logfile_debug("music_load('%s')", abs_path);
 
         /* build the music object */
         m = mallocx(sizeof *m);
@@ -75,7 +75,7 @@ music_t *music_load(const char *path)
         /* load the ogg stream */
         m->stream = logg_get_stream(abs_path, 255, 128, 0);
         if(m->stream == NULL) {
-            logfile_message("music_load() error: can't get ogg stream");
+            logfile_log(LOGLEVEL_ERROR, "music_load('%s') error: can't get ogg stream", abs_path);
             free(m);
             return NULL;
         }
@@ -85,7 +85,7 @@ music_t *music_load(const char *path)
         resourcemanager_ref_music(path);
 
         /* done! */
-        logfile_message("music_load() ok");
+        logfile_debug("music_load() ok");
     }
     else
         resourcemanager_ref_music(path);
@@ -253,7 +253,7 @@ sound_t *sound_load(const char *path)
 
     if(NULL == (s = resourcemanager_find_sample(path))) {
         resource_filepath(abs_path, path, sizeof(abs_path), RESFP_READ);
-        logfile_message("sound_load('%s')", abs_path);
+        logfile_debug("sound_load('%s')", abs_path);
 
         /* build the sound object */
         s = mallocx(sizeof *s);
@@ -261,7 +261,7 @@ sound_t *sound_load(const char *path)
 
         /* loading the sample */
         if(NULL == (s->data = IS_OGG(path) ? logg_load(abs_path) : load_sample(abs_path))) {
-            logfile_message("sound_load() error: %s", allegro_error);
+            logfile_log(LOGLEVEL_ERROR, "sound_load('%s') error: %s", abs_path, allegro_error);
             free(s);
             return NULL;
         }
@@ -271,7 +271,7 @@ sound_t *sound_load(const char *path)
         resourcemanager_ref_sample(path);
 
         /* done! */
-        logfile_message("sound_load() ok");
+        logfile_debug("sound_load() ok");
     }
     else
         resourcemanager_ref_sample(path);
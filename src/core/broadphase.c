@@ -0,0 +1,373 @@
+/*
+ * broadphase.c - which boxes overlap? (sort and sweep)
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include "broadphase.h"
+#include "global.h"
+#include "util.h"
+
+/* constants */
+#define BROADPHASE_INITIALCAPACITY      64
+
+/* an entry */
+typedef struct broadentry_t {
+    int key;
+    float box[4]; /* enlarged by the margin */
+    void *data;
+    int first, count; /* its pairs: partner[first .. first+count-1] */
+} broadentry_t;
+
+/* sorting by x */
+typedef struct broadsort_t {
+    float x;
+    int index;
+} broadsort_t;
+
+/* broad phase */
+struct broadphase_t {
+    float margin;
+    broadentry_t *entry; /* entry[0 .. length-1] */
+    int length, capacity;
+    int *slot; /* hash table: data -> index+1 (0 = free slot) */
+    int slot_count; /* a power of two */
+    broadsort_t *sorted; /* capacity */
+    int *active; /* capacity */
+    int *pair; /* pair[2k], pair[2k+1] */
+    int pair_count, pair_capacity;
+    int *partner; /* 2 * pair_capacity */
+    int dirty; /* should we sweep again? */
+    broadphasestats_t stats;
+};
+
+/* private methods */
+static void sweep(broadphase_t *bp);
+static void add_pair(broadphase_t *bp, int a, int b);
+static int find_entry(const broadphase_t *bp, const void *data);
+static void rehash(broadphase_t *bp);
+static unsigned hash(const void *data);
+static void enlarge(const broadphase_t *bp, const float box[4], float out[4]);
+static int contains(const float outer[4], const float inner[4]);
+static int sort_cmp(const void *a, const void *b);
+
+
+
+/*
+ * broadphase_create()
+ * Creates a new broad phase. The boxes will
+ * be enlarged by margin pixels on each side.
+ */
+broadphase_t* broadphase_create(float margin)
+{
+    broadphase_t *bp = mallocx(sizeof *bp);
+
+    bp->margin = margin;
+    bp->length = 0;
+    bp->capacity = BROADPHASE_INITIALCAPACITY;
+    bp->entry = mallocx(bp->capacity * sizeof *(bp->entry));
+    bp->sorted = mallocx(bp->capacity * sizeof *(bp->sorted));
+    bp->active = mallocx(bp->capacity * sizeof *(bp->active));
+    bp->slot_count = 2 * BROADPHASE_INITIALCAPACITY;
+    bp->slot = mallocx(bp->slot_count * sizeof *(bp->slot));
+    bp->pair_count = 0;
+    bp->pair_capacity = BROADPHASE_INITIALCAPACITY;
+    bp->pair = mallocx(2 * bp->pair_capacity * sizeof *(bp->pair));
+    bp->partner = mallocx(2 * bp->pair_capacity * sizeof *(bp->partner));
+
+    broadphase_clear(bp);
+    return bp;
+}
+
+
+/*
+ * broadphase_destroy()
+ * Destroys a broad phase
+ */
+broadphase_t* broadphase_destroy(broadphase_t *bp)
+{
+    free(bp->entry);
+    free(bp->sorted);
+    free(bp->active);
+    free(bp->slot);
+    free(bp->pair);
+    free(bp->partner);
+    free(bp);
+    return NULL;
+}
+
+
+/*
+ * broadphase_clear()
+ * Removes every entry and resets the statistics.
+ * The memory is kept for reuse.
+ */
+void broadphase_clear(broadphase_t *bp)
+{
+    int i;
+
+    for(i=0; i<bp->slot_count; i++)
+        bp->slot[i] = 0;
+
+    bp->length = 0;
+    bp->pair_count = 0;
+    bp->dirty = FALSE;
+    bp->stats.entries = 0;
+    bp->stats.sweeps = 0;
+    bp->stats.pairs = 0;
+    bp->stats.tests = 0;
+}
+
+
+/*
+ * broadphase_insert()
+ * Adds an entry
+ */
+void broadphase_insert(broadphase_t *bp, int key, const float box[4], void *data)
+{
+    broadentry_t *e;
+    unsigned mask;
+    int s;
+
+    if(bp->length >= bp->capacity) {
+        bp->capacity *= 2;
+        bp->entry = reallocx(bp->entry, bp->capacity * sizeof *(bp->entry));
+        bp->sorted = reallocx(bp->sorted, bp->capacity * sizeof *(bp->sorted));
+        bp->active = reallocx(bp->active, bp->capacity * sizeof *(bp->active));
+    }
+
+    e = &(bp->entry[bp->length++]);
+    e->key = key;
+    e->data = data;
+    e->first = e->count = 0;
+    enlarge(bp, box, e->box);
+
+    /* keep the hash table at most half full */
+    if(2 * bp->length > bp->slot_count)
+        rehash(bp);
+    else {
+        mask = (unsigned)(bp->slot_count - 1);
+        for(s = (int)(hash(data) & mask); bp->slot[s] != 0; s = (int)((s + 1) & mask));
+        bp->slot[s] = bp->length;
+    }
+
+    bp->stats.entries = bp->length;
+    bp->dirty = TRUE;
+}
+
+
+/*
+ * broadphase_move()
+ * The entry of data has a new box. Nothing
+ * happens as long as the new box is within
+ * the margin of the old one.
+ */
+void broadphase_move(broadphase_t *bp, const void *data, const float box[4])
+{
+    int i = find_entry(bp, data);
+
+    if(i >= 0 && !contains(bp->entry[i].box, box)) {
+        enlarge(bp, box, bp->entry[i].box);
+        bp->dirty = TRUE;
+    }
+}
+
+
+/*
+ * broadphase_find()
+ * Finds an entry of a given key whose box overlaps
+ * the box of data and such that collide(data, other)
+ * is true. Returns NULL if there's no such entry.
+ */
+void* broadphase_find(broadphase_t *bp, const void *data, int key, int (*collide)(const void *data, const void *other))
+{
+    broadentry_t *e;
+    int i, j;
+
+    if(bp->dirty)
+        sweep(bp);
+
+    /* data isn't here: test everything */
+    if((i = find_entry(bp, data)) < 0) {
+        for(j=0; j<bp->length; j++) {
+            e = &(bp->entry[j]);
+            if(e->key == key && e->data != data) {
+                bp->stats.tests++;
+                if(collide(data, e->data))
+                    return e->data;
+            }
+        }
+        return NULL;
+    }
+
+    /* test only the overlapping pairs */
+    for(j=0; j<bp->entry[i].count; j++) {
+        e = &(bp->entry[bp->partner[bp->entry[i].first + j]]);
+        if(e->key == key) {
+            bp->stats.tests++;
+            if(collide(data, e->data))
+                return e->data;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * broadphase_stats()
+ * Statistics since the last clear
+ */
+broadphasestats_t broadphase_stats(const broadphase_t *bp)
+{
+    return bp->stats;
+}
+
+
+
+/* private methods */
+
+/* finds the pairs of overlapping boxes */
+void sweep(broadphase_t *bp)
+{
+    int i, j, k, a, b, active_count = 0;
+    broadentry_t *e;
+
+    /* sort by x */
+    for(i=0; i<bp->length; i++) {
+        bp->sorted[i].x = bp->entry[i].box[0];
+        bp->sorted[i].index = i;
+    }
+    qsort(bp->sorted, bp->length, sizeof *(bp->sorted), sort_cmp);
+
+    /* sweep: the active boxes are the ones that reach the current x */
+    bp->pair_count = 0;
+    for(i=0; i<bp->length; i++) {
+        a = bp->sorted[i].index;
+        e = &(bp->entry[a]);
+
+        for(j=k=0; j<active_count; j++) {
+            b = bp->active[j];
+            if(bp->entry[b].box[2] >= e->box[0]) {
+                bp->active[k++] = b;
+                if(bp->entry[b].box[1] <= e->box[3] && bp->entry[b].box[3] >= e->box[1])
+                    add_pair(bp, a, b);
+            }
+        }
+
+        bp->active[k++] = a;
+        active_count = k;
+    }
+
+    /* the pairs of each entry */
+    for(i=0; i<bp->length; i++)
+        bp->entry[i].count = 0;
+    for(i=0; i<2*bp->pair_count; i++)
+        bp->entry[bp->pair[i]].count++;
+    for(i=k=0; i<bp->length; i++) {
+        bp->entry[i].first = k;
+        k += bp->entry[i].count;
+        bp->entry[i].count = 0;
+    }
+    for(i=0; i<bp->pair_count; i++) {
+        a = bp->pair[2*i];
+        b = bp->pair[2*i+1];
+        bp->partner[bp->entry[a].first + (bp->entry[a].count++)] = b;
+        bp->partner[bp->entry[b].first + (bp->entry[b].count++)] = a;
+    }
+
+    bp->dirty = FALSE;
+    bp->stats.sweeps++;
+    bp->stats.pairs = bp->pair_count;
+}
+
+/* adds a pair of overlapping boxes */
+void add_pair(broadphase_t *bp, int a, int b)
+{
+    if(bp->pair_count >= bp->pair_capacity) {
+        bp->pair_capacity *= 2;
+        bp->pair = reallocx(bp->pair, 2 * bp->pair_capacity * sizeof *(bp->pair));
+        bp->partner = reallocx(bp->partner, 2 * bp->pair_capacity * sizeof *(bp->partner));
+    }
+
+    bp->pair[2 * bp->pair_count] = a;
+    bp->pair[2 * bp->pair_count + 1] = b;
+    bp->pair_count++;
+}
+
+/* the index of the entry of data, or -1 */
+int find_entry(const broadphase_t *bp, const void *data)
+{
+    unsigned mask = (unsigned)(bp->slot_count - 1);
+    int s;
+
+    for(s = (int)(hash(data) & mask); bp->slot[s] != 0; s = (int)((s + 1) & mask)) {
+        if(bp->entry[bp->slot[s] - 1].data == data)
+            return bp->slot[s] - 1;
+    }
+
+    return -1;
+}
+
+/* doubles the hash table */
+void rehash(broadphase_t *bp)
+{
+    unsigned mask;
+    int i, s;
+
+    bp->slot_count *= 2;
+    bp->slot = reallocx(bp->slot, bp->slot_count * sizeof *(bp->slot));
+    mask = (unsigned)(bp->slot_count - 1);
+
+    for(i=0; i<bp->slot_count; i++)
+        bp->slot[i] = 0;
+
+    for(i=0; i<bp->length; i++) {
+        for(s = (int)(hash(bp->entry[i].data) & mask); bp->slot[s] != 0; s = (int)((s + 1) & mask));
+        bp->slot[s] = i + 1;
+    }
+}
+
+/* hash function of a pointer */
+unsigned hash(const void *data)
+{
+    unsigned long x = (unsigned long)data;
+    return (unsigned)((x >> 4) * 2654435761UL);
+}
+
+/* box enlarged by the margin */
+void enlarge(const broadphase_t *bp, const float box[4], float out[4])
+{
+    out[0] = box[0] - bp->margin;
+    out[1] = box[1] - bp->margin;
+    out[2] = box[2] + bp->margin;
+    out[3] = box[3] + bp->margin;
+}
+
+/* is inner inside outer? */
+int contains(const float outer[4], const float inner[4])
+{
+    return (inner[0] >= outer[0] && inner[1] >= outer[1] && inner[2] <= outer[2] && inner[3] <= outer[3]);
+}
+
+/* compares two entries by x */
+int sort_cmp(const void *a, const void *b)
+{
+    float i = ((const broadsort_t*)a)->x;
+    float j = ((const broadsort_t*)b)->x;
+    return (i < j) ? -1 : (i > j) ? 1 : 0;
+}
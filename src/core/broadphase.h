@@ -0,0 +1,66 @@
+/*
+ * broadphase.h - which boxes overlap? (sort and sweep)
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _BROADPHASE_H
+#define _BROADPHASE_H
+
+/*
+   A broad phase keeps a box and an integer key for each
+   entity, and answers "which entities of this key collide
+   with this one?" without testing every possible pair.
+
+   The boxes are enlarged by a margin and sorted by x. A
+   single sweep finds all the pairs of overlapping boxes.
+   A query only runs the (expensive) narrow phase on the
+   pairs of its entity. The sweep is deferred until the
+   first query after the boxes have changed; moving an
+   entity within its margin changes nothing.
+*/
+
+typedef struct broadphase_t broadphase_t;
+
+/* statistics (since the last clear) */
+typedef struct {
+    int entries; /* number of entities */
+    int sweeps; /* how many times the pairs were found */
+    int pairs; /* overlapping pairs found by the last sweep */
+    int tests; /* narrow phase tests */
+} broadphasestats_t;
+
+/* create & destroy */
+broadphase_t* broadphase_create(float margin);
+broadphase_t* broadphase_destroy(broadphase_t *bp);
+
+/* removes every entry & resets the statistics (the memory is kept for reuse) */
+void broadphase_clear(broadphase_t *bp);
+
+/* adds an entry. box[4] = x1, y1, x2, y2 */
+void broadphase_insert(broadphase_t *bp, int key, const float box[4], void *data);
+
+/* the entry of data has a new box */
+void broadphase_move(broadphase_t *bp, const void *data, const float box[4]);
+
+/* finds an entry of a given key whose box overlaps the box of data and
+ * such that collide(data, other) is true, or NULL if there's no such entry */
+void* broadphase_find(broadphase_t *bp, const void *data, int key, int (*collide)(const void *data, const void *other));
+
+/* statistics */
+broadphasestats_t broadphase_stats(const broadphase_t *bp);
+
+#endif
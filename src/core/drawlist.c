@@ -0,0 +1,477 @@
+/*
+ * drawlist.c - deferred, band-parallel drawing
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "drawlist.h"
+#include "global.h"
+#include "util.h"
+#include "thread.h"
+
+/* constants */
+#define DRAWLIST_INITIALCAPACITY        256
+#define DRAWLIST_BATCHWINDOW            32 /* how far back do we look for the same image? */
+
+/* command types */
+enum drawcmd_type {
+    DRAWCMD_BLIT,
+    DRAWCMD_DRAW,
+    DRAWCMD_DRAW_SCALED,
+    DRAWCMD_DRAW_ROTATED,
+    DRAWCMD_DRAW_TRANS,
+    DRAWCMD_PUTPIXEL,
+    DRAWCMD_RECTFILL,
+    DRAWCMD_CLEAR
+};
+
+/* a recorded drawing. Coordinates refer to the target */
+typedef struct {
+    enum drawcmd_type type;
+    const image_t *src;
+    int x, y; /* destination (rectfill: first corner) */
+    int x2, y2; /* rectfill: second corner */
+    int sx, sy, w, h; /* blit: source rectangle */
+    int cx, cy; /* pivot */
+    v2d_t scale;
+    float ang, alpha;
+    uint32 color, flags;
+    int layer, seq; /* sorting keys */
+    int bx1, by1, bx2, by2; /* bounding box, clipped to the target: [bx1,bx2) x [by1,by2) */
+} drawcmd_t;
+
+/* a horizontal band of the target */
+typedef struct {
+    image_t *image; /* shares its pixels with the target */
+    int top, height;
+    int visible; /* does it intersect the clipping rectangle? */
+} drawband_t;
+
+/* internal data */
+static drawcmd_t *cmd; /* cmd[0 .. length-1] */
+static int *order, *sorted; /* indices of cmd[], in execution order */
+static int length, capacity;
+static image_t *target; /* NULL if we're not recording */
+static int executing; /* are the bands executing the list? */
+static int current_layer;
+static drawband_t *band;
+static int band_count;
+static drawliststats_t stats, last_stats;
+
+/* private methods */
+static drawcmd_t* new_command(enum drawcmd_type type, const image_t *src);
+static void add_command(drawcmd_t *c, int x, int y, int w, int h);
+static void sort_commands();
+static int cmd_cmp(const void *a, const void *b);
+static int overlap(const drawcmd_t *a, const drawcmd_t *b);
+static void execute_band(int index, void *param);
+static void create_bands(image_t *img);
+static void destroy_bands();
+static int bands_match(const image_t *img);
+
+
+
+/* public methods */
+
+/* initializes this module */
+void drawlist_init()
+{
+    capacity = DRAWLIST_INITIALCAPACITY;
+    cmd = mallocx(capacity * sizeof *cmd);
+    order = mallocx(capacity * sizeof *order);
+    sorted = mallocx(capacity * sizeof *sorted);
+    length = 0;
+    target = NULL;
+    executing = FALSE;
+    current_layer = 0;
+    band = NULL;
+    band_count = 0;
+    memset(&stats, 0, sizeof stats);
+    last_stats = stats;
+}
+
+/* releases this module */
+void drawlist_release()
+{
+    drawlist_end();
+    destroy_bands();
+
+    free(cmd);
+    free(order);
+    free(sorted);
+    cmd = NULL;
+    order = sorted = NULL;
+    length = capacity = 0;
+}
+
+/* starts recording the drawings on target */
+void drawlist_begin(image_t *img)
+{
+    drawlist_end();
+
+    memset(&stats, 0, sizeof stats);
+    current_layer = 0;
+
+    if(img == NULL || img->data == NULL || !is_memory_bitmap(img->data))
+        return;
+
+    if(!bands_match(img)) {
+        destroy_bands();
+        create_bands(img);
+    }
+
+    target = img;
+}
+
+/* executes the recorded drawings and stops recording */
+void drawlist_end()
+{
+    long area;
+
+    if(target != NULL) {
+        drawlist_flush();
+
+        area = (long)max(0, target->data->cr - target->data->cl) * (long)max(0, target->data->cb - target->data->ct);
+        stats.overdraw = max(0, stats.pixels - area);
+        last_stats = stats;
+    }
+
+    target = NULL;
+}
+
+/* the layer of the next commands */
+void drawlist_set_layer(int layer)
+{
+    current_layer = layer;
+}
+
+/* statistics of the last frame */
+drawliststats_t drawlist_stats()
+{
+    return last_stats;
+}
+
+/* executes the recorded drawings */
+void drawlist_flush()
+{
+    int i, cl, ct, cr, cb;
+
+    if(target == NULL || executing || length == 0)
+        return;
+
+    /* each band is clipped to the intersection of its rows
+     * and the clipping rectangle of the target */
+    cl = target->data->cl; cr = target->data->cr;
+    ct = target->data->ct; cb = target->data->cb;
+    for(i=0; i<band_count; i++) {
+        int top = max(ct, band[i].top), bottom = min(cb, band[i].top + band[i].height);
+        band[i].visible = (cl < cr && top < bottom);
+        if(band[i].visible)
+            set_clip_rect(band[i].image->data, cl, top - band[i].top, cr - 1, bottom - band[i].top - 1);
+    }
+
+    sort_commands();
+    stats.commands += length;
+
+    executing = TRUE;
+    thread_parallel_for(band_count, execute_band, NULL);
+    executing = FALSE;
+
+    length = 0;
+}
+
+/* should a drawing from src to dest be recorded? */
+int drawlist_intercept(const image_t *src, const image_t *dest)
+{
+    if(target == NULL || executing)
+        return FALSE;
+
+    if(dest == target && src != target)
+        return TRUE;
+
+    /* dest may be a source of a pending command, or src may be the target */
+    drawlist_flush();
+    return FALSE;
+}
+
+/* recording */
+void drawlist_blit(const image_t *src, int source_x, int source_y, int dest_x, int dest_y, int width, int height)
+{
+    drawcmd_t *c = new_command(DRAWCMD_BLIT, src);
+    c->sx = source_x; c->sy = source_y;
+    c->x = dest_x; c->y = dest_y;
+    c->w = width; c->h = height;
+    add_command(c, dest_x, dest_y, width, height);
+}
+
+void drawlist_draw(const image_t *src, int x, int y, uint32 flags)
+{
+    drawcmd_t *c = new_command(DRAWCMD_DRAW, src);
+    c->x = x; c->y = y;
+    c->flags = flags;
+    add_command(c, x, y, src->w, src->h);
+}
+
+void drawlist_draw_scaled(const image_t *src, int x, int y, v2d_t scale, uint32 flags)
+{
+    drawcmd_t *c = new_command(DRAWCMD_DRAW_SCALED, src);
+    c->x = x; c->y = y;
+    c->scale = scale;
+    c->flags = flags;
+    add_command(c, x, y, (int)(scale.x * src->w), (int)(scale.y * src->h));
+}
+
+void drawlist_draw_rotated(const image_t *src, int x, int y, int cx, int cy, float ang, uint32 flags)
+{
+    drawcmd_t *c = new_command(DRAWCMD_DRAW_ROTATED, src);
+    int r = abs(cx) + abs(cy) + src->w + src->h; /* no pixel is farther than this from (x,y) */
+    c->x = x; c->y = y;
+    c->cx = cx; c->cy = cy;
+    c->ang = ang;
+    c->flags = flags;
+    add_command(c, x - r, y - r, 2*r + 1, 2*r + 1);
+}
+
+void drawlist_draw_trans(const image_t *src, int x, int y, uint32 color, float alpha, uint32 flags)
+{
+    drawcmd_t *c = new_command(DRAWCMD_DRAW_TRANS, src);
+    c->x = x; c->y = y;
+    c->color = color;
+    c->alpha = alpha;
+    c->flags = flags;
+    add_command(c, x, y, src->w, src->h);
+}
+
+void drawlist_putpixel(int x, int y, uint32 color)
+{
+    drawcmd_t *c = new_command(DRAWCMD_PUTPIXEL, NULL);
+    c->x = x; c->y = y;
+    c->color = color;
+    add_command(c, x, y, 1, 1);
+}
+
+void drawlist_rectfill(int x1, int y1, int x2, int y2, uint32 color)
+{
+    drawcmd_t *c = new_command(DRAWCMD_RECTFILL, NULL);
+    c->x = x1; c->y = y1;
+    c->x2 = x2; c->y2 = y2;
+    c->color = color;
+    add_command(c, min(x1, x2), min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1);
+}
+
+void drawlist_clear(uint32 color)
+{
+    drawcmd_t *c = new_command(DRAWCMD_CLEAR, NULL);
+    c->color = color;
+    add_command(c, 0, 0, target->w, target->h);
+}
+
+
+
+/* private methods */
+
+/* prepares a new command at the end of the list */
+drawcmd_t* new_command(enum drawcmd_type type, const image_t *src)
+{
+    drawcmd_t *c;
+
+    if(length >= capacity) {
+        capacity *= 2;
+        cmd = reallocx(cmd, capacity * sizeof *cmd);
+        order = reallocx(order, capacity * sizeof *order);
+        sorted = reallocx(sorted, capacity * sizeof *sorted);
+    }
+
+    c = &cmd[length];
+    c->type = type;
+    c->src = src;
+    c->layer = current_layer;
+    c->seq = length;
+    return c;
+}
+
+/* adds the command prepared by new_command(), unless
+ * its bounding box is outside the target */
+void add_command(drawcmd_t *c, int x, int y, int w, int h)
+{
+    const BITMAP *data = target->data;
+
+    c->bx1 = max(x, data->cl); c->bx2 = min(x + w, data->cr);
+    c->by1 = max(y, data->ct); c->by2 = min(y + h, data->cb);
+
+    if(w > 0 && h > 0 && c->bx1 < c->bx2 && c->by1 < c->by2) {
+        stats.pixels += (long)(c->bx2 - c->bx1) * (long)(c->by2 - c->by1);
+        length++;
+    }
+    else
+        stats.culled++;
+}
+
+/* sorts the commands by layer. Within a layer, a command
+ * joins the last one using the same image if it doesn't
+ * overlap any command in between */
+void sort_commands()
+{
+    int i, k, n, pos;
+    const drawcmd_t *c, *o;
+
+    for(i=0; i<length; i++)
+        sorted[i] = i;
+    qsort(sorted, length, sizeof *sorted, cmd_cmp);
+
+    for(n=0, i=0; i<length; i++, n++) {
+        c = &cmd[sorted[i]];
+        pos = n;
+
+        if(c->src != NULL) {
+            for(k=n-1; k>=0 && k>=n-DRAWLIST_BATCHWINDOW; k--) {
+                o = &cmd[order[k]];
+                if(o->layer != c->layer || overlap(o, c))
+                    break;
+                else if(o->src == c->src) {
+                    pos = k+1;
+                    break;
+                }
+            }
+        }
+
+        if(pos < n) {
+            memmove(order + pos + 1, order + pos, (n - pos) * sizeof *order);
+            stats.batched++;
+        }
+
+        order[pos] = sorted[i];
+    }
+}
+
+/* compares two commands by layer, then by recording order */
+int cmd_cmp(const void *a, const void *b)
+{
+    const drawcmd_t *ca = &cmd[*((const int*)a)];
+    const drawcmd_t *cb = &cmd[*((const int*)b)];
+
+    if(ca->layer != cb->layer)
+        return (ca->layer > cb->layer) - (ca->layer < cb->layer);
+    else
+        return (ca->seq > cb->seq) - (ca->seq < cb->seq);
+}
+
+/* do the bounding boxes of two commands overlap? */
+int overlap(const drawcmd_t *a, const drawcmd_t *b)
+{
+    return (a->bx1 < b->bx2 && b->bx1 < a->bx2 && a->by1 < b->by2 && b->by1 < a->by2);
+}
+
+/* executes the whole list on a band (runs on a worker thread) */
+void execute_band(int index, void *param)
+{
+    int i, top = band[index].top, bottom = band[index].top + band[index].height;
+    image_t *dest = band[index].image;
+    const drawcmd_t *c;
+
+    if(!band[index].visible)
+        return;
+
+    for(i=0; i<length; i++) {
+        c = &cmd[order[i]];
+        if(c->by2 <= top || c->by1 >= bottom)
+            continue; /* not in this band */
+
+        switch(c->type) {
+            case DRAWCMD_BLIT:
+                image_blit(c->src, dest, c->sx, c->sy, c->x, c->y - top, c->w, c->h);
+                break;
+
+            case DRAWCMD_DRAW:
+                image_draw(c->src, dest, c->x, c->y - top, c->flags);
+                break;
+
+            case DRAWCMD_DRAW_SCALED:
+                image_draw_scaled(c->src, dest, c->x, c->y - top, c->scale, c->flags);
+                break;
+
+            case DRAWCMD_DRAW_ROTATED:
+                image_draw_rotated(c->src, dest, c->x, c->y - top, c->cx, c->cy, c->ang, c->flags);
+                break;
+
+            case DRAWCMD_DRAW_TRANS:
+                image_draw_trans(c->src, dest, c->x, c->y - top, c->color, c->alpha, c->flags);
+                break;
+
+            case DRAWCMD_PUTPIXEL:
+                image_putpixel(dest, c->x, c->y - top, c->color);
+                break;
+
+            case DRAWCMD_RECTFILL:
+                image_rectfill(dest, c->x, c->y - top, c->x2, c->y2 - top, c->color);
+                break;
+
+            case DRAWCMD_CLEAR:
+                image_clear(dest, c->color);
+                break;
+        }
+    }
+}
+
+/* splits img into horizontal bands, one per worker thread */
+void create_bands(image_t *img)
+{
+    int i;
+
+    band_count = min(thread_worker_count(), img->h);
+    band = mallocx(band_count * sizeof *band);
+
+    for(i=0; i<band_count; i++) {
+        band[i].top = (i * img->h) / band_count;
+        band[i].height = ((i+1) * img->h) / band_count - band[i].top;
+        band[i].image = image_create_shared(img, 0, band[i].top, img->w, band[i].height);
+        band[i].visible = TRUE;
+    }
+}
+
+/* destroys the bands */
+void destroy_bands()
+{
+    int i;
+
+    for(i=0; i<band_count; i++)
+        image_destroy(band[i].image);
+
+    if(band != NULL)
+        free(band);
+
+    band = NULL;
+    band_count = 0;
+}
+
+/* do the current bands map the pixels of img? The surface
+ * may have been destroyed and recreated since they were made */
+int bands_match(const image_t *img)
+{
+    int i;
+
+    if(band_count != min(thread_worker_count(), img->h))
+        return FALSE;
+
+    for(i=0; i<band_count; i++) {
+        if(band[i].image->w != img->w || band[i].image->data->line[0] != img->data->line[band[i].top])
+            return FALSE;
+    }
+
+    return (band[band_count-1].top + band[band_count-1].height == img->h);
+}
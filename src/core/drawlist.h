@@ -0,0 +1,88 @@
+/*
+ * drawlist.h - deferred, band-parallel drawing
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _DRAWLIST_H
+#define _DRAWLIST_H
+
+#include "image.h"
+#include "v2d.h"
+
+/*
+   While a draw list is being recorded, the drawing routines
+   of image.c don't touch the target surface: they append a
+   command to the list instead. When the list is flushed, the
+   target is split into horizontal bands, one per worker
+   thread, and each band executes the whole list clipped to
+   its own rows. The commands keep their order within each
+   band, so the result is exactly the same as drawing
+   directly.
+
+   Anything that could observe the target (reading it,
+   drawing it somewhere else, drawing into an image used by
+   a pending command, destroying an image...) flushes the
+   list first. Drawings that aren't clipped pixel-exactly
+   (lines, ellipses) are not recorded either.
+
+   Before execution, the commands are sorted by layer. Within
+   a layer, a command is moved next to a previous one using
+   the same image, provided that it doesn't overlap anything
+   in between (so the picture stays the same). Commands that
+   fall outside the target are culled as they're recorded.
+*/
+
+/* layers, in rendering order */
+#define DRAWLAYER_BACKGROUND            0
+#define DRAWLAYER_ENTITIES              1
+#define DRAWLAYER_FOREGROUND            2
+#define DRAWLAYER_HUD                   3
+
+/* statistics of a frame */
+typedef struct {
+    int commands; /* executed commands */
+    int culled; /* commands outside the target */
+    int batched; /* commands moved next to another one with the same image */
+    long pixels; /* pixels covered by the commands (bounding boxes) */
+    long overdraw; /* pixels covered more than once */
+} drawliststats_t;
+
+/* public methods */
+void drawlist_init(); /* initializes this module */
+void drawlist_release(); /* releases this module */
+void drawlist_begin(image_t *target); /* starts recording the drawings on target (a new frame) */
+void drawlist_end(); /* executes the recorded drawings and stops recording */
+void drawlist_flush(); /* executes the recorded drawings */
+void drawlist_set_layer(int layer); /* the layer of the next commands */
+drawliststats_t drawlist_stats(); /* statistics of the last frame */
+
+/* called by image.c: should a drawing from src (may be NULL) to
+ * dest be recorded? If it shouldn't, the pending commands are
+ * flushed whenever necessary. */
+int drawlist_intercept(const image_t *src, const image_t *dest);
+
+/* recording (see image.h) */
+void drawlist_blit(const image_t *src, int source_x, int source_y, int dest_x, int dest_y, int width, int height);
+void drawlist_draw(const image_t *src, int x, int y, uint32 flags);
+void drawlist_draw_scaled(const image_t *src, int x, int y, v2d_t scale, uint32 flags);
+void drawlist_draw_rotated(const image_t *src, int x, int y, int cx, int cy, float ang, uint32 flags);
+void drawlist_draw_trans(const image_t *src, int x, int y, uint32 color, float alpha, uint32 flags);
+void drawlist_putpixel(int x, int y, uint32 color);
+void drawlist_rectfill(int x1, int y1, int x2, int y2, uint32 color);
+void drawlist_clear(uint32 color);
+
+#endif
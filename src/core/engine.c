@@ -37,6 +37,11 @@
 #include "lang.h"
 #include "screenshot.h"
 #include "preferences.h"
+#include "metaindex.h"
+#include "thread.h"
+#include "trig.h"
+#include "scriptcache.h"
+#include "image.h"
 #include "commandline.h"
 #include "nanoparser/nanoparser.h"
 #include "../scenes/quest.h"
@@ -159,9 +164,13 @@ void init_basic_stuff()
     randomize();
     osspec_init();
     logfile_init();
+    thread_init();
+    trig_init();
     nanoparser_set_error_function(parser_error);
     nanoparser_set_warning_function(parser_warning);
+    scriptcache_init();
     preferences_init();
+    metaindex_init();
 }
 
 
@@ -237,11 +246,13 @@ void push_initial_scene(commandline_t cmd)
 void release_accessories()
 {
     scenestack_release();
+    level_release_kept_brickset();
     storyboard_release();
     lang_release();
     screenshot_release();
     objects_release();
     soundfactory_release();
+    font_release();
     sprite_release();
 }
 
@@ -252,6 +263,7 @@ void release_accessories()
 void release_managers()
 {
     input_release();
+    image_prefetch_discard();
     video_release();
     resourcemanager_release();
     audio_release();
@@ -266,6 +278,9 @@ void release_managers()
  */
 void release_basic_stuff()
 {
+    metaindex_release();
+    scriptcache_release();
+    thread_release();
     logfile_release();
     osspec_release();
     allegro_exit();
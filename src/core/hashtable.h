@@ -48,7 +48,7 @@ hashtable_##T* hashtable_##T##_create(void (*destroy_element_strategy)(T*)) \
 { \
     int i; \
     hashtable_##T *h = mallocx(sizeof *h); \
-    logfile_message("hashtable_" #T "_create()"); \
+    logfile_debug("hashtable_" #T "_create()"); \
     h->destroy_element = destroy_element_strategy; \
     for(i=0; i<HASHTABLE_TABLESIZE; i++) \
         h->data[i] = NULL; \
@@ -58,7 +58,7 @@ hashtable_##T* hashtable_##T##_destroy(hashtable_##T *h) \
 { \
     int i; \
     hashtable_list_##T *p, *q; \
-    logfile_message("hashtable_" #T "_destroy()"); \
+    logfile_debug("hashtable_" #T "_destroy()"); \
     for(i=0; i<HASHTABLE_TABLESIZE; i++) { \
         p = h->data[i]; \
         while(p != NULL) { \
@@ -69,7 +69,7 @@ hashtable_##T* hashtable_##T##_destroy(hashtable_##T *h) \
             p = q; \
         } \
     } \
-    logfile_message("hashtable_" #T "_destroy() - success!"); \
+    logfile_debug("hashtable_" #T "_destroy() - success!"); \
     return NULL; \
 } \
 T* hashtable_##T##_find(hashtable_##T *h, const char *key) \
@@ -89,7 +89,7 @@ void hashtable_##T##_add(hashtable_##T *h, const char *key, T *value) \
     if(NULL == hashtable_##T##_find(h, key)) { \
         int k = HASHTABLE_HASHFUNCTION(key); \
         hashtable_list_##T *q; \
-        logfile_message("hashtable_" #T "_add(): adding '%s'...", key); \
+        logfile_debug("hashtable_" #T "_add(): adding '%s'...", key); \
         q = mallocx(sizeof *q); \
         q->key = str_dup(key); \
         q->value = value; \
@@ -98,13 +98,13 @@ void hashtable_##T##_add(hashtable_##T *h, const char *key, T *value) \
         h->data[k] = q; \
     } \
     else \
-        logfile_message("hashtable_" #T "_add(): item '%s' already exists! It won't be added.", key); \
+        logfile_log(LOGLEVEL_WARNING, "hashtable_" #T "_add(): item '%s' already exists! It won't be added.", key); \
 } \
 void hashtable_##T##_remove(hashtable_##T *h, const char *key) \
 { \
     int k = HASHTABLE_HASHFUNCTION(key); \
     hashtable_list_##T *p, *q; \
-    logfile_message("hashtable_" #T "_remove(): removing element '%s'...", key); \
+    logfile_debug("hashtable_" #T "_remove(): removing element '%s'...", key); \
     if(h->data[k] != NULL) { \
         p = h->data[k]; \
         if(str_icmp(p->key, key) == 0) { \
@@ -115,7 +115,7 @@ void hashtable_##T##_remove(hashtable_##T *h, const char *key) \
                 free(p); \
             } \
             else \
-                logfile_message("hashtable_" #T "_remove(): element '%s' has %d active references. It won't be removed.", key, p->reference_count); \
+                logfile_log(LOGLEVEL_WARNING, "hashtable_" #T "_remove(): element '%s' has %d active references. It won't be removed.", key, p->reference_count); \
             return; \
         } \
         else { \
@@ -129,14 +129,14 @@ void hashtable_##T##_remove(hashtable_##T *h, const char *key) \
                         free(q); \
                     } \
                     else \
-                        logfile_message("hashtable_" #T "_remove(): element '%s' has %d active references. It won't be removed.", key, p->next->reference_count); \
+                        logfile_log(LOGLEVEL_WARNING, "hashtable_" #T "_remove(): element '%s' has %d active references. It won't be removed.", key, p->next->reference_count); \
                     return; \
                 } \
                 p = p->next; \
             } \
         } \
     } \
-    logfile_message("hashtable_" #T "_remove(): element '%s' does not exist.", key); \
+    logfile_log(LOGLEVEL_WARNING, "hashtable_" #T "_remove(): element '%s' does not exist.", key); \
 } \
 int hashtable_##T##_ref(hashtable_##T *h, const char *key) \
 { \
@@ -17,26 +17,53 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <png.h>
 #include <allegro.h>
 #include <loadpng.h>
 #include <jpgalleg.h>
 #include "image.h"
+#include "imagekernel.h"
 #include "video.h"
 #include "stringutil.h"
 #include "logfile.h"
 #include "osspec.h"
 #include "resourcemanager.h"
 #include "util.h"
+#include "drawlist.h"
+#include "thread.h"
 
 /* useful macros */
 #define IS_PNG(path) (str_icmp((path)+strlen(path)-4, ".png") == 0)
+#define IS_JPG(path) (str_icmp((path)+strlen(path)-4, ".jpg") == 0)
 
 /* private stuff */
 static void maskcolor_bugfix(image_t *img);
+static image_t* get_scratch(int width, int height);
+static image_t *scratch = NULL; /* temporary surface, reused */
+
+/* images read ahead of time (maybe by another thread).
+ * Allegro isn't thread-safe: they're decoded on the main thread */
+typedef struct prefetched_t {
+    char *path; /* relative path */
+    char *abs_path;
+    void *file_data; /* contents of the file, or NULL */
+    int file_size;
+    image_t *img; /* NULL until it's decoded */
+    struct prefetched_t *next;
+} prefetched_t;
+static prefetched_t *prefetched = NULL;
+static volatile int prefetched_lock = FALSE;
+static image_t* decode(const char *abs_path, void *file_data, int file_size);
+static image_t* take_prefetched(const char *path);
+static prefetched_t* find_prefetched(const char *path);
+static void destroy_prefetched(prefetched_t *p);
+static void lock_prefetched();
+static void unlock_prefetched();
 
 /*
  * image_load()
@@ -49,31 +76,16 @@ image_t *image_load(const char *path)
     image_t *img;
 
     if(NULL == (img = resourcemanager_find_image(path))) {
-        resource_filepath(abs_path, path, sizeof(abs_path), RESFP_READ);
-        logfile_message("image_load(%s)", abs_path);
-
-        /* build the image object */
-        img = mallocx(sizeof *img);
-
-        /* loading the image */
-        img->data = load_bitmap(abs_path, NULL);
-        if(img->data == NULL) {
-            logfile_message("image_load() error: %s", allegro_error);
-            free(img);
-            return NULL;
+        /* was it read ahead of time? */
+        if(NULL == (img = take_prefetched(path))) {
+            resource_filepath(abs_path, path, sizeof(abs_path), RESFP_READ);
+            if(NULL == (img = decode(abs_path, NULL, 0)))
+                return NULL;
         }
 
-        /* configuring the image */
-        img->w = img->data->w;
-        img->h = img->data->h;
-        maskcolor_bugfix(img);
-
         /* adding it to the resource manager */
         resourcemanager_add_image(path, img);
         resourcemanager_ref_image(path);
-
-        /* done! */
-        logfile_message("image_load() ok");
     }
     else
         resourcemanager_ref_image(path);
@@ -83,6 +95,141 @@ image_t *image_load(const char *path)
 
 
 
+/*
+ * image_is_loaded()
+ * Is this image in the memory already?
+ */
+int image_is_loaded(const char *path)
+{
+    return resourcemanager_find_image(path) != NULL;
+}
+
+
+
+/*
+ * image_prefetch_read()
+ * Reads the file of a image ahead of time, so that the next
+ * image_load(path) won't have to. abs_path must be given by
+ * resource_filepath(), which isn't thread-safe. Unlike
+ * image_load(), this may be called from any thread: the
+ * image is decoded later, on the main thread (see
+ * image_prefetch_decode()). Returns the size of the file.
+ */
+int image_prefetch_read(const char *path, const char *abs_path)
+{
+    prefetched_t *p;
+    FILE *fp;
+    long size;
+
+    p = mallocx(sizeof *p);
+    p->path = str_dup(path);
+    p->abs_path = str_dup(abs_path);
+    p->file_data = NULL;
+    p->file_size = 0;
+    p->img = NULL;
+
+    /* the memory loaders handle PNG and JPG only: the
+       other formats are decoded from the file itself.
+       Only the C library is used here (not Allegro). */
+    if((IS_PNG(abs_path) || IS_JPG(abs_path)) && NULL != (fp = fopen(abs_path, "rb"))) {
+        if(fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && size < INT_MAX && fseek(fp, 0, SEEK_SET) == 0) {
+            p->file_data = mallocx(size);
+            p->file_size = (int)size;
+            if(fread(p->file_data, 1, p->file_size, fp) != (size_t)p->file_size) {
+                free(p->file_data);
+                p->file_data = NULL;
+                p->file_size = 0;
+            }
+        }
+        fclose(fp);
+    }
+
+    lock_prefetched();
+    p->next = prefetched;
+    prefetched = p;
+    unlock_prefetched();
+
+    return p->file_size;
+}
+
+
+
+/*
+ * image_prefetch_decode()
+ * Decodes a image that has been read by image_prefetch_read(),
+ * so that the next image_load(path) will simply take it.
+ * Call this from the main thread. Returns the memory taken
+ * by the image, in bytes (0 if there's nothing to decode).
+ */
+int image_prefetch_decode(const char *path)
+{
+    prefetched_t *p;
+
+    lock_prefetched();
+    p = find_prefetched(path);
+    unlock_prefetched();
+
+    /* only the main thread decodes or takes the images */
+    if(p == NULL || p->img != NULL)
+        return 0;
+
+    if(NULL == (p->img = decode(p->abs_path, p->file_data, p->file_size)))
+        return 0;
+
+    if(p->file_data != NULL)
+        free(p->file_data);
+    p->file_data = NULL;
+    p->file_size = 0;
+
+    return p->img->w * p->img->h * ((bitmap_color_depth(p->img->data) + 7) / 8);
+}
+
+
+
+/*
+ * image_is_prefetched()
+ * Has this image been read ahead of time
+ * (and not loaded yet)?
+ */
+int image_is_prefetched(const char *path)
+{
+    prefetched_t *p;
+
+    lock_prefetched();
+    p = find_prefetched(path);
+    unlock_prefetched();
+
+    return p != NULL;
+}
+
+
+
+/*
+ * image_prefetch_discard()
+ * Destroys the prefetched images that
+ * haven't been loaded (yet). Call this
+ * when nothing is being read anymore.
+ */
+void image_prefetch_discard()
+{
+    prefetched_t *p, *next;
+
+    lock_prefetched();
+    p = prefetched;
+    prefetched = NULL;
+    unlock_prefetched();
+
+    for(; p != NULL; p = next) {
+        next = p->next;
+        logfile_debug("image_prefetch_discard(): %s wasn't used", p->path);
+        if(p->img != NULL)
+            image_destroy(p->img);
+        destroy_prefetched(p);
+    }
+}
+
+
+
 /*
  * image_unref()
  * Will try to release the resource from
@@ -115,6 +262,7 @@ void image_save(const image_t *img, const char *path)
     PALETTE pal;
     BITMAP *tmp;
 
+    drawlist_flush();
     resource_filepath(abs_path, path, sizeof(abs_path), RESFP_WRITE);
     logfile_message("image_save(%p,%s)", img, abs_path);
 
@@ -173,6 +321,26 @@ image_t *image_create(int width, int height)
 }
 
 
+/*
+ * image_create_shared()
+ * Creates an image that shares its pixels with a
+ * rectangle of parent. Destroy it before the parent.
+ */
+image_t *image_create_shared(const image_t *parent, int x, int y, int width, int height)
+{
+    image_t *img = mallocx(sizeof *img);
+
+    img->data = create_sub_bitmap(parent->data, x, y, width, height);
+    img->w = width;
+    img->h = height;
+
+    if(img->data == NULL)
+        logfile_message("ERROR - image_create_shared(%d,%d,%d,%d): couldn't create bitmap", x, y, width, height);
+
+    return img;
+}
+
+
 /*
  * image_destroy()
  * Destroys an image. This is called automatically
@@ -180,6 +348,8 @@ image_t *image_create(int width, int height)
  */
 void image_destroy(image_t *img)
 {
+    drawlist_flush();
+
     if(img->data != NULL) {
         destroy_bitmap(img->data);
         img->data = NULL;
@@ -195,6 +365,7 @@ void image_destroy(image_t *img)
  */
 uint32 image_getpixel(const image_t *img, int x, int y)
 {
+    drawlist_flush();
     return getpixel(img->data, x, y);
 }
 
@@ -205,6 +376,11 @@ uint32 image_getpixel(const image_t *img, int x, int y)
  */
 void image_putpixel(image_t *img, int x, int y, uint32 color)
 {
+    if(drawlist_intercept(NULL, img)) {
+        drawlist_putpixel(x, y, color);
+        return;
+    }
+
     putpixel(img->data, x, y, color);
 }
 
@@ -215,6 +391,7 @@ void image_putpixel(image_t *img, int x, int y, uint32 color)
  */
 void image_line(image_t *img, int x1, int y1, int x2, int y2, uint32 color)
 {
+    drawlist_flush(); /* clipping a line may change its pixels */
     line(img->data, x1, y1, x2, y2, color);
 }
 
@@ -225,6 +402,7 @@ void image_line(image_t *img, int x1, int y1, int x2, int y2, uint32 color)
  */
 void image_ellipse(image_t *img, int cx, int cy, int radius_x, int radius_y, uint32 color)
 {
+    drawlist_flush(); /* same as image_line() */
     ellipse(img->data, cx, cy, radius_x, radius_y, color);
 }
 
@@ -235,6 +413,11 @@ void image_ellipse(image_t *img, int cx, int cy, int radius_x, int radius_y, uin
  */
 void image_rectfill(image_t *img, int x1, int y1, int x2, int y2, uint32 color)
 {
+    if(drawlist_intercept(NULL, img)) {
+        drawlist_rectfill(x1, y1, x2, y2, color);
+        return;
+    }
+
     rectfill(img->data, x1, y1, x2, y2, color);
 }
 
@@ -267,6 +450,11 @@ void image_color2rgb(uint32 color, uint8 *r, uint8 *g, uint8 *b)
  */
 void image_clear(image_t *img, uint32 color)
 {
+    if(drawlist_intercept(NULL, img)) {
+        drawlist_clear(color);
+        return;
+    }
+
     clear_to_color(img->data, color);
 }
 
@@ -277,6 +465,11 @@ void image_clear(image_t *img, uint32 color)
  */
 void image_blit(const image_t *src, image_t *dest, int source_x, int source_y, int dest_x, int dest_y, int width, int height)
 {
+    if(drawlist_intercept(src, dest)) {
+        drawlist_blit(src, source_x, source_y, dest_x, dest_y, width, height);
+        return;
+    }
+
     blit(src->data, dest->data, source_x, source_y, dest_x, dest_y, width, height);
 }
 
@@ -290,6 +483,11 @@ void image_blit(const image_t *src, image_t *dest, int source_x, int source_y, i
  */
 void image_draw(const image_t *src, image_t *dest, int x, int y, uint32 flags)
 {
+    if(drawlist_intercept(src, dest)) {
+        drawlist_draw(src, x, y, flags);
+        return;
+    }
+
     if((flags & IF_HFLIP) && !(flags & IF_VFLIP))
         draw_sprite_h_flip(dest->data, src->data, x, y);
     else if(!(flags & IF_HFLIP) && (flags & IF_VFLIP))
@@ -313,14 +511,25 @@ void image_draw(const image_t *src, image_t *dest, int x, int y, uint32 flags)
  */
 void image_draw_scaled(const image_t *src, image_t *dest, int x, int y, v2d_t scale, uint32 flags)
 {
-    image_t *tmp;
     int w = (int)(scale.x * src->w);
     int h = (int)(scale.y * src->h);
 
-    tmp = image_create(w, h);
-    stretch_blit(src->data, tmp->data, 0, 0, src->w, src->h, 0, 0, w, h);
-    image_draw(tmp, dest, x, y, flags);
-    image_destroy(tmp);
+    if(w <= 0 || h <= 0)
+        return;
+
+    if(drawlist_intercept(src, dest)) {
+        drawlist_draw_scaled(src, x, y, scale, flags);
+        return;
+    }
+
+    if(is_memory_bitmap(src->data) && is_memory_bitmap(dest->data))
+        imagekernel_draw_scaled(src->data, dest->data, x, y, w, h, video_get_maskcolor(), flags & IF_HFLIP, flags & IF_VFLIP);
+    else {
+        /* this isn't a memory bitmap */
+        image_t *tmp = get_scratch(w, h);
+        stretch_blit(src->data, tmp->data, 0, 0, src->w, src->h, 0, 0, w, h);
+        image_draw(tmp, dest, x, y, flags);
+    }
 }
 
 
@@ -335,6 +544,11 @@ void image_draw_rotated(const image_t *src, image_t *dest, int x, int y, int cx,
 {
     float conv = (-ang * (180.0/PI)) * (64.0/90.0);
 
+    if(drawlist_intercept(src, dest)) {
+        drawlist_draw_rotated(src, x, y, cx, cy, ang, flags);
+        return;
+    }
+
     if((flags & IF_HFLIP) && !(flags & IF_VFLIP))
         pivot_sprite_v_flip(dest->data, src->data, x, y, cx, 0, ftofix((float)(conv+128)));
     else if(!(flags & IF_HFLIP) && (flags & IF_VFLIP))
@@ -355,19 +569,27 @@ void image_draw_rotated(const image_t *src, image_t *dest, int x, int y, int cx,
  */
 void image_draw_trans(const image_t *src, image_t *dest, int x, int y, uint32 color, float alpha, uint32 flags)
 {
-    image_t *tmp;
     uint8 r, g, b;
 
+    if(drawlist_intercept(src, dest)) {
+        drawlist_draw_trans(src, x, y, color, alpha, flags);
+        return;
+    }
+
     if(video_get_color_depth() > 8) {
         alpha = clip(alpha, 0.0, 1.0);
-        image_color2rgb(color, &r, &g, &b);
-        set_trans_blender(r, g, b, (int)(255 * alpha));
-
-        tmp = image_create(src->w, src->h);
-        image_clear(tmp, video_get_maskcolor());
-        image_draw(src, tmp, 0, 0, flags);
-        draw_trans_sprite(dest->data, tmp->data, x, y);
-        image_destroy(tmp);
+
+        if(is_memory_bitmap(src->data) && is_memory_bitmap(dest->data))
+            imagekernel_draw_trans(src->data, dest->data, x, y, video_get_maskcolor(), (int)(255 * alpha), flags & IF_HFLIP, flags & IF_VFLIP);
+        else {
+            /* this isn't a memory bitmap */
+            image_t *tmp = get_scratch(src->w, src->h);
+            image_color2rgb(color, &r, &g, &b);
+            set_trans_blender(r, g, b, (int)(255 * alpha));
+            image_clear(tmp, video_get_maskcolor());
+            image_draw(src, tmp, 0, 0, flags);
+            draw_trans_sprite(dest->data, tmp->data, x, y);
+        }
     }
     else
         image_draw(src, dest, x, y, flags);
@@ -425,16 +647,142 @@ int image_pixelperfect_collision(const image_t *img1, const image_t *img2, int x
 void maskcolor_bugfix(image_t *img)
 {
     int i, j;
-    uint32 mask = video_get_maskcolor();
+    uint32 pixel, mask = video_get_maskcolor();
     uint8 pixel_r, pixel_g, pixel_b, mask_r, mask_g, mask_b;
     image_color2rgb(mask, &mask_r, &mask_g, &mask_b);
 
+    /* img isn't drawn anywhere yet: no need to flush the drawlist */
     for(j=0; j<img->h; j++) {
         for(i=0; i<img->w; i++) {
-            image_color2rgb(image_getpixel(img, i, j), &pixel_r, &pixel_g, &pixel_b);
+            pixel = getpixel(img->data, i, j);
+            image_color2rgb(pixel, &pixel_r, &pixel_g, &pixel_b);
             if(pixel_r == mask_r && pixel_g == mask_g && pixel_b == mask_b)
-                image_putpixel(img, i, j, mask);
+                putpixel(img->data, i, j, mask);
         }
     }
 }
 
+
+/*
+ * decode()
+ * Decodes a image file, or its contents (file_data)
+ * if they've been read already. Call this from the
+ * main thread: Allegro's loaders aren't thread-safe.
+ */
+image_t* decode(const char *abs_path, void *file_data, int file_size)
+{
+    image_t *img;
+
+    logfile_debug("image_load(%s)", abs_path);
+
+    /* build the image object */
+    img = mallocx(sizeof *img);
+
+    /* loading the image */
+    if(file_data == NULL)
+        img->data = load_bitmap(abs_path, NULL);
+    else if(IS_PNG(abs_path))
+        img->data = load_memory_png(file_data, file_size, NULL);
+    else
+        img->data = load_memory_jpg(file_data, file_size, NULL);
+    if(img->data == NULL) {
+        logfile_log(LOGLEVEL_ERROR, "image_load(%s) error: %s", abs_path, allegro_error);
+        free(img);
+        return NULL;
+    }
+
+    /* configuring the image */
+    img->w = img->data->w;
+    img->h = img->data->h;
+    maskcolor_bugfix(img);
+
+    /* done! */
+    logfile_debug("image_load() ok");
+    return img;
+}
+
+
+/*
+ * take_prefetched()
+ * Removes a prefetched image from the list and
+ * returns it (decoding it if it hasn't been
+ * decoded yet), or NULL if there's none
+ */
+image_t* take_prefetched(const char *path)
+{
+    prefetched_t **p, *q = NULL;
+    image_t *img;
+
+    lock_prefetched();
+    for(p = &prefetched; *p != NULL; p = &((*p)->next)) {
+        if(str_icmp((*p)->path, path) == 0) {
+            q = *p;
+            *p = q->next;
+            break;
+        }
+    }
+    unlock_prefetched();
+
+    if(q == NULL)
+        return NULL;
+
+    img = (q->img != NULL) ? q->img : decode(q->abs_path, q->file_data, q->file_size);
+    destroy_prefetched(q);
+    return img;
+}
+
+/* finds a prefetched image (call lock_prefetched() first) */
+prefetched_t* find_prefetched(const char *path)
+{
+    prefetched_t *p;
+
+    for(p = prefetched; p != NULL; p = p->next) {
+        if(str_icmp(p->path, path) == 0)
+            return p;
+    }
+
+    return NULL;
+}
+
+/* destroys an entry of the list (but not its image) */
+void destroy_prefetched(prefetched_t *p)
+{
+    if(p->file_data != NULL)
+        free(p->file_data);
+    free(p->abs_path);
+    free(p->path);
+    free(p);
+}
+
+
+/* a tiny spinlock: the list of prefetched images is short-lived */
+void lock_prefetched()
+{
+    while(!atomic_cas(&prefetched_lock, FALSE, TRUE))
+        thread_yield();
+}
+
+void unlock_prefetched()
+{
+    atomic_set(&prefetched_lock, FALSE);
+}
+
+
+/*
+ * get_scratch()
+ * Returns a temporary surface of the given size. It is
+ * kept between calls and recreated only when the size
+ * changes, so please don't destroy it.
+ */
+image_t* get_scratch(int width, int height)
+{
+    if(scratch != NULL && (scratch->w != width || scratch->h != height)) {
+        image_destroy(scratch);
+        scratch = NULL;
+    }
+
+    if(scratch == NULL)
+        scratch = image_create(width, height);
+
+    return scratch;
+}
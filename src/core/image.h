@@ -39,7 +39,13 @@ struct image_t {
 /* image management */
 image_t *image_load(const char *path); /* will be unloaded automatically */
 int image_unref(const char *path); /* use if you want to save memory... */
+int image_is_loaded(const char *path); /* is it in the resource manager? */
+int image_prefetch_read(const char *path, const char *abs_path); /* reads the file of a image for a later image_load(path): can be called from any thread. Returns the size of the file */
+int image_prefetch_decode(const char *path); /* decodes a image read by image_prefetch_read() (main thread only). Returns its size in bytes */
+int image_is_prefetched(const char *path); /* has it been read ahead of time? */
+void image_prefetch_discard(); /* destroys the prefetched images that weren't loaded */
 image_t *image_create(int width, int height); /* create a memory surface */
+image_t *image_create_shared(const image_t *parent, int x, int y, int width, int height); /* shares the pixels of parent */
 void image_destroy(image_t *img); /* call this after image_create() */
 void image_save(const image_t *img, const char *path);
 
@@ -0,0 +1,236 @@
+/*
+ * imagekernel.c - drawing routines that write straight into memory bitmaps routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "imagekernel.h"
+#include "util.h"
+
+
+
+/*
+ * imagekernel_draw_scaled()
+ * Draws src, stretched to w x h, at (x,y). The source is
+ * sampled with a 16.16 fixed-point step.
+ */
+void imagekernel_draw_scaled(BITMAP *src, BITMAP *dest, int x, int y, int w, int h, uint32 mask, int hflip, int vflip)
+{
+    int i, j, sx, sy, fx, dx, dy, x0, y0, x1, y1;
+
+    if(w <= 0 || h <= 0)
+        return;
+
+    /* clipping */
+    x0 = max(x, dest->cl); x1 = min(x + w, dest->cr);
+    y0 = max(y, dest->ct); y1 = min(y + h, dest->cb);
+    if(x0 >= x1 || y0 >= y1)
+        return;
+
+    /* 16.16 fixed point steps */
+    dx = (src->w << 16) / w;
+    dy = (src->h << 16) / h;
+
+    /* as if we had stretched src to a w x h image and then flipped it */
+    #define SCALED_BLIT(pixel_t) \
+        for(j=y0; j<y1; j++) { \
+            const pixel_t *in; \
+            pixel_t *out = (pixel_t*)dest->line[j]; \
+            sy = ((vflip ? h-1-(j-y) : (j-y)) * dy) >> 16; \
+            in = (const pixel_t*)src->line[sy]; \
+            if(hflip) { \
+                for(i=x0, fx=(w-1-(x0-x))*dx; i<x1; i++, fx-=dx) { \
+                    if(in[fx >> 16] != (pixel_t)mask) \
+                        out[i] = in[fx >> 16]; \
+                } \
+            } \
+            else { \
+                for(i=x0, fx=(x0-x)*dx; i<x1; i++, fx+=dx) { \
+                    if(in[fx >> 16] != (pixel_t)mask) \
+                        out[i] = in[fx >> 16]; \
+                } \
+            } \
+        }
+
+    switch(bitmap_color_depth(dest)) {
+        case 8:  SCALED_BLIT(uint8);  break;
+        case 15: SCALED_BLIT(uint16); break;
+        case 16: SCALED_BLIT(uint16); break;
+        case 32: SCALED_BLIT(uint32); break;
+
+        default:
+            for(j=y0; j<y1; j++) {
+                sy = ((vflip ? h-1-(j-y) : (j-y)) * dy) >> 16;
+                for(i=x0; i<x1; i++) {
+                    sx = ((hflip ? w-1-(i-x) : (i-x)) * dx) >> 16;
+                    if((uint32)_getpixel24(src, sx, sy) != mask)
+                        _putpixel24(dest, i, j, _getpixel24(src, sx, sy));
+                }
+            }
+            break;
+    }
+
+    #undef SCALED_BLIT
+}
+
+
+/*
+ * imagekernel_draw_trans()
+ * Draws src at (x,y), blending its pixels with the
+ * ones of dest just like draw_trans_sprite() does
+ */
+void imagekernel_draw_trans(BITMAP *src, BITMAP *dest, int x, int y, uint32 mask, int alpha, int hflip, int vflip)
+{
+    int i, j, sx, sy, x0, y0, x1, y1;
+
+    /* clipping */
+    x0 = max(x, dest->cl); x1 = min(x + src->w, dest->cr);
+    y0 = max(y, dest->ct); y1 = min(y + src->h, dest->cb);
+    if(x0 >= x1 || y0 >= y1)
+        return;
+
+    #define TRANS_BLIT(pixel_t, blend) \
+        for(j=y0; j<y1; j++) { \
+            const pixel_t *in; \
+            pixel_t *out = (pixel_t*)dest->line[j]; \
+            sy = vflip ? src->h-1-(j-y) : (j-y); \
+            in = (const pixel_t*)src->line[sy]; \
+            for(i=x0; i<x1; i++) { \
+                sx = hflip ? src->w-1-(i-x) : (i-x); \
+                if(in[sx] != (pixel_t)mask) \
+                    out[i] = (pixel_t)blend(in[sx], out[i], alpha); \
+            } \
+        }
+
+    switch(bitmap_color_depth(dest)) {
+        case 15: TRANS_BLIT(uint16, imagekernel_blend15); break;
+        case 16: TRANS_BLIT(uint16, imagekernel_blend16); break;
+        case 32: TRANS_BLIT(uint32, imagekernel_blend32); break;
+
+        default:
+            for(j=y0; j<y1; j++) {
+                sy = vflip ? src->h-1-(j-y) : (j-y);
+                for(i=x0; i<x1; i++) {
+                    sx = hflip ? src->w-1-(i-x) : (i-x);
+                    if((uint32)_getpixel24(src, sx, sy) != mask)
+                        _putpixel24(dest, i, j, imagekernel_blend32(_getpixel24(src, sx, sy), _getpixel24(dest, i, j), alpha));
+                }
+            }
+            break;
+    }
+
+    #undef TRANS_BLIT
+}
+
+
+/*
+ * imagekernel_tint()
+ * Copies src to dest, multiplying (AND) the pixels that
+ * aren't the mask color by color. In these depths, that's
+ * the same as multiplying their r, g and b components.
+ */
+void imagekernel_tint(BITMAP *src, BITMAP *dest, uint32 mask, uint32 color)
+{
+    int i, j;
+    uint32 px;
+
+    #define TINT(pixel_t) \
+        for(j=0; j<src->h; j++) { \
+            const pixel_t *in = (const pixel_t*)src->line[j]; \
+            pixel_t *out = (pixel_t*)dest->line[j]; \
+            for(i=0; i<src->w; i++) { \
+                if(in[i] != (pixel_t)mask) { \
+                    /* a tinted pixel of the mask color would vanish */ \
+                    px = in[i] & color; \
+                    out[i] = (pixel_t)((px != mask) ? px : (px ^ 1)); \
+                } \
+                else \
+                    out[i] = in[i]; \
+            } \
+        }
+
+    switch(bitmap_color_depth(dest)) {
+        case 15: TINT(uint16); break;
+        case 16: TINT(uint16); break;
+        case 32: TINT(uint32); break;
+
+        default:
+            for(j=0; j<src->h; j++) {
+                for(i=0; i<src->w; i++) {
+                    if((px = (uint32)_getpixel24(src, i, j)) != mask) {
+                        px &= color;
+                        px = (px != mask) ? px : (px ^ 1);
+                    }
+                    _putpixel24(dest, i, j, px);
+                }
+            }
+            break;
+    }
+
+    #undef TINT
+}
+
+
+/*
+ * imagekernel_blend15(), imagekernel_blend16(), imagekernel_blend32()
+ * Linear interpolation between the pixels x and y,
+ * 0 <= n <= 255. Same as Allegro's trans blenders.
+ */
+uint32 imagekernel_blend15(uint32 x, uint32 y, int n)
+{
+    uint32 result;
+
+    if(n)
+        n = (n + 1) / 8;
+
+    x = ((x & 0xFFFF) | (x << 16)) & 0x3E07C1F;
+    y = ((y & 0xFFFF) | (y << 16)) & 0x3E07C1F;
+    result = ((x - y) * n / 32 + y) & 0x3E07C1F;
+
+    return ((result & 0xFFFF) | (result >> 16));
+}
+
+uint32 imagekernel_blend16(uint32 x, uint32 y, int n)
+{
+    uint32 result;
+
+    if(n)
+        n = (n + 1) / 8;
+
+    x = ((x & 0xFFFF) | (x << 16)) & 0x7E0F81F;
+    y = ((y & 0xFFFF) | (y << 16)) & 0x7E0F81F;
+    result = ((x - y) * n / 32 + y) & 0x7E0F81F;
+
+    return ((result & 0xFFFF) | (result >> 16));
+}
+
+uint32 imagekernel_blend32(uint32 x, uint32 y, int n)
+{
+    uint32 result, g;
+
+    if(n)
+        n++;
+
+    result = ((x & 0xFF00FF) - (y & 0xFF00FF)) * n / 256 + y;
+    y &= 0xFF00;
+    x &= 0xFF00;
+    g = (x - y) * n / 256 + y;
+
+    result &= 0xFF00FF;
+    g &= 0xFF00;
+
+    return result | g;
+}
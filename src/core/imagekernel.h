@@ -0,0 +1,46 @@
+/*
+ * imagekernel.h - drawing routines that write straight into memory bitmaps routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _IMAGEKERNEL_H
+#define _IMAGEKERNEL_H
+
+#include <allegro.h>
+#include "global.h"
+
+/*
+   The scaled and the translucent drawing of image.c (and
+   the tinted glyphs of font.c), for
+   memory bitmaps of the same color depth. The result is the
+   same as stretching (or tinting) src into a temporary bitmap,
+   flipping it and drawing it as a sprite, without the
+   temporary bitmap. The clipping rectangle of dest is honoured
+   and the pixels of the mask color are skipped.
+
+   These only need the bitmaps, so src/checks/image_check.c
+   builds them without the rest of the engine.
+*/
+
+void imagekernel_draw_scaled(BITMAP *src, BITMAP *dest, int x, int y, int w, int h, uint32 mask, int hflip, int vflip); /* src is stretched to w x h */
+void imagekernel_draw_trans(BITMAP *src, BITMAP *dest, int x, int y, uint32 mask, int alpha, int hflip, int vflip); /* 0 <= alpha <= 255; 15, 16, 24 & 32 bpp */
+void imagekernel_tint(BITMAP *src, BITMAP *dest, uint32 mask, uint32 color); /* dest = src AND color (same size, 15 to 32 bpp) */
+uint32 imagekernel_blend15(uint32 x, uint32 y, int n); /* same as Allegro's trans blenders, 0 <= n <= 255 */
+uint32 imagekernel_blend16(uint32 x, uint32 y, int n);
+uint32 imagekernel_blend32(uint32 x, uint32 y, int n);
+
+#endif
@@ -18,7 +18,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
+#include <allegro.h>
 #include "lang.h"
 #include "util.h"
 #include "osspec.h"
@@ -26,6 +28,20 @@
 #include "logfile.h"
 #include "hashtable.h"
 #include "nanoparser/nanoparser.h"
+#include "scriptcache.h"
+
+/* compiled tables are mapped into memory where mmap() is
+ * available (newlib on the 3DS has unistd.h, but no mmap) */
+#ifndef __WIN32__
+#include <unistd.h>
+#if defined(_POSIX_MAPPED_FILES) && (_POSIX_MAPPED_FILES > 0)
+#define LANG_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#endif
 
 /* fake string type */
 typedef struct { char *data; } stringadapter_t;
@@ -38,10 +54,51 @@ static void stringadapter_destroy(stringadapter_t *s);
 HASHTABLE_GENERATE_CODE(stringadapter_t)
 static hashtable_stringadapter_t* strings;
 
+/* compiled string tables: language files are compiled into
+ * $HOME/.$GAME_UNIXNAME/cache/, so that we don't need to parse
+ * a whole .lng file just to read its title or its compatibility.
+ *
+ * layout: [ header | entry[0] ... entry[count-1] | blob ]
+ * entries are sorted by key (keys are stored in upper case);
+ * key & value are offsets to NUL-terminated strings in the blob */
+#define LANGTABLE_MAGIC             0x544C534F /* "OSLT" */
+#define LANGTABLE_VERSION           1
+#define LANGTABLE_NONE              0xFFFFFFFF /* missing offset */
+#define LANGTABLE_DIRECTORY         "cache"
+#define LANGTABLE_EXTENSION         "lsc"
+typedef struct {
+    uint32 magic, version;
+    uint32 source_size, source_mtime; /* invalidation */
+    int32 ver, subver, wipver; /* LANG_COMPATIBILITY */
+    uint32 compatibility, title; /* LANG_COMPATIBILITY & LANG_LANGUAGE */
+    uint32 count; /* number of keys */
+    uint32 blob_size;
+} langtable_header_t;
+typedef struct { uint32 key, value; } langtable_entry_t;
+typedef struct {
+    char filepath[1024]; /* absolute path of the .lng file */
+    const langtable_header_t *header;
+    const langtable_entry_t *entry;
+    const char *blob;
+    void *data; /* raw data */
+    size_t size; /* size of data, in bytes */
+    int mapped; /* is data memory-mapped? */
+} langtable_t;
+static langtable_t* langtable_open(const char *abs_path);
+static langtable_t* langtable_close(langtable_t *t);
+static const char* langtable_find(const langtable_t *t, const char *key);
+static langtable_t* langtable_get(const char *filepath);
+static void* langtable_compile(const char *abs_path, size_t *size);
+static int langtable_validate(const void *data, size_t size, uint32 source_size, uint32 source_mtime);
+static void langtable_cachepath(char *dest, const char *abs_path, size_t dest_size);
+static langtable_t *last_table; /* the most recently used table */
+static unsigned int generation; /* incremented whenever a language file is loaded */
+
 /* private stuff */
-typedef struct { const char *key; const char *value; } inout_t;
-static int traverse(const parsetree_statement_t *stmt);
-static int traverse_inout(const parsetree_statement_t *stmt, void *inout);
+typedef struct { char *key; const char *value; int index; } keyvalue_t;
+typedef struct { keyvalue_t *pair; int count, capacity; } keyvalue_list_t;
+static int traverse_compile(const parsetree_statement_t *stmt, void *list);
+static int keyvalue_cmp(const void *a, const void *b);
 
 
 /*
@@ -52,6 +109,8 @@ void lang_init()
 {
     logfile_message("Initializing the language module");
     strings = hashtable_stringadapter_t_create(stringadapter_destroy);
+    last_table = NULL;
+    generation = 0;
     lang_loadfile(DEFAULT_LANGUAGE_FILEPATH);
     logfile_message("lang_init() ok!");
 }
@@ -64,6 +123,7 @@ void lang_init()
 void lang_release()
 {
     logfile_message("Releasing the language module...");
+    last_table = langtable_close(last_table);
     strings = hashtable_stringadapter_t_destroy(strings);
 }
 
@@ -75,8 +135,10 @@ void lang_release()
 void lang_loadfile(const char *filepath)
 {
     int ver, subver, wipver;
-    char abs_path[1024];
-    parsetree_program_t *prog;
+    uint32 i;
+    langtable_t *t;
+    stringadapter_t *s;
+    const char *key, *value;
 
     logfile_message("lang_loadfile(\"%s\")...", filepath);
 
@@ -84,10 +146,17 @@ void lang_loadfile(const char *filepath)
     if(!(GAME_VERSION == ver && GAME_SUB_VERSION == subver && GAME_WIP_VERSION == wipver))
         fatal_error("\"%s\" (version %d.%d.%d) is not compatible with version %d.%d.%d of the engine", filepath, ver, subver, wipver, GAME_VERSION, GAME_SUB_VERSION, GAME_WIP_VERSION);
 
-    resource_filepath(abs_path, filepath, sizeof(abs_path), RESFP_READ);
-    prog = nanoparser_construct_tree(abs_path);
-    nanoparser_traverse_program(prog, traverse);
-    prog = nanoparser_deconstruct_tree(prog);
+    t = langtable_get(filepath);
+    for(i=0; i<t->header->count; i++) {
+        key = t->blob + t->entry[i].key;
+        value = t->blob + t->entry[i].value;
+        if(NULL == (s = hashtable_stringadapter_t_find(strings, key)))
+            hashtable_stringadapter_t_add(strings, key, stringadapter_create(value));
+        else
+            stringadapter_set_data(s, value);
+    }
+
+    generation++;
 }
 
 
@@ -98,23 +167,12 @@ void lang_loadfile(const char *filepath)
  */
 void lang_readstring(const char *filepath, const char *desired_key, char *str, int str_size)
 {
-    char abs_path[1024];
-    inout_t param;
-    parsetree_program_t *prog;
-
-    resource_filepath(abs_path, filepath, sizeof(abs_path), RESFP_READ);
-    param.key = desired_key;
-    param.value = NULL;
+    const char *value = langtable_find(langtable_get(filepath), desired_key);
 
-    prog = nanoparser_construct_tree(abs_path);
-    nanoparser_traverse_program_ex(prog, (void*)(&param), traverse_inout);
-
-    if(param.value == NULL)
+    if(value == NULL)
         fatal_error("lang_readstring(\"%s\", \"%s\") failed", filepath, desired_key);
     else
-        str_cpy(str, param.value, str_size);
-
-    prog = nanoparser_deconstruct_tree(prog);
+        str_cpy(str, value, str_size);
 }
 
 
@@ -153,49 +211,314 @@ const char *lang_get(const char *desired_key)
  */
 void lang_readcompatibility(const char *filename, int *ver, int *subver, int *wipver)
 {
-    char compat[32];
-    lang_readstring(filename, "LANG_COMPATIBILITY", compat, sizeof(compat));
-    if(sscanf(compat, "%d.%d.%d", ver, subver, wipver) < 3)
-        *ver = *subver = *wipver = 0;
+    const langtable_header_t *h = langtable_get(filename)->header;
+
+    if(h->compatibility == LANGTABLE_NONE)
+        fatal_error("lang_readcompatibility(\"%s\") failed: no LANG_COMPATIBILITY", filename);
+
+    *ver = h->ver;
+    *subver = h->subver;
+    *wipver = h->wipver;
+}
+
+
+/*
+ * lang_generation()
+ * Incremented whenever a language file gets loaded.
+ * Useful for invalidating caches of translated strings
+ */
+unsigned int lang_generation()
+{
+    return generation;
 }
 
 
 /* private stuff */
 
-int traverse(const parsetree_statement_t *stmt)
+/* returns the compiled table of a language file. Since
+ * langselect.c reads a few keys of every .lng file in a
+ * row, the last table is kept open */
+langtable_t* langtable_get(const char *filepath)
 {
-    const char *id = nanoparser_get_identifier(stmt);
-    const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
-    const parsetree_parameter_t *p = nanoparser_get_nth_parameter(param_list, 1);
-    const char *key, *value;
-    stringadapter_t *s;
+    char abs_path[1024];
 
-    nanoparser_expect_string(p, "a string is expected after each key of the language file");
-    key = id;
-    value = nanoparser_get_string(p);
+    resource_filepath(abs_path, filepath, sizeof(abs_path), RESFP_READ);
+    if(last_table == NULL || strcmp(last_table->filepath, abs_path) != 0) {
+        last_table = langtable_close(last_table);
+        last_table = langtable_open(abs_path);
+    }
 
-    if(NULL == (s = hashtable_stringadapter_t_find(strings, key)))
-        hashtable_stringadapter_t_add(strings, key, stringadapter_create(value));
-    else
-        stringadapter_set_data(s, value);
+    return last_table;
+}
 
-    return 0;
+/* opens the compiled table of a language file, compiling it if necessary */
+langtable_t* langtable_open(const char *abs_path)
+{
+    char cache_path[1024], tmp_path[1024];
+    uint32 source_size = (uint32)file_size_ex(abs_path);
+    uint32 source_mtime = (uint32)file_time(abs_path);
+    langtable_t *t = mallocx(sizeof *t);
+    FILE *fp;
+
+    str_cpy(t->filepath, abs_path, sizeof(t->filepath));
+    t->data = NULL;
+    t->size = 0;
+    t->mapped = FALSE;
+    langtable_cachepath(cache_path, abs_path, sizeof(cache_path));
+
+    /* is there an up-to-date compiled table? */
+#ifdef LANG_USE_MMAP
+    {
+        int fd;
+        struct stat st;
+
+        if((fd = open(cache_path, O_RDONLY)) >= 0) {
+            if(fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p != MAP_FAILED) {
+                    if(langtable_validate(p, (size_t)st.st_size, source_size, source_mtime)) {
+                        t->data = p;
+                        t->size = (size_t)st.st_size;
+                        t->mapped = TRUE;
+                    }
+                    else
+                        munmap(p, (size_t)st.st_size);
+                }
+            }
+            close(fd);
+        }
+    }
+#else
+    if(NULL != (fp = fopen(cache_path, "rb"))) {
+        long size;
+        fseek(fp, 0, SEEK_END);
+        if((size = ftell(fp)) > 0) {
+            void *p = mallocx(size);
+            fseek(fp, 0, SEEK_SET);
+            if(fread(p, 1, size, fp) == (size_t)size && langtable_validate(p, (size_t)size, source_size, source_mtime)) {
+                t->data = p;
+                t->size = (size_t)size;
+            }
+            else
+                free(p);
+        }
+        fclose(fp);
+    }
+#endif
+
+    /* no. Let's compile the language file */
+    if(t->data == NULL) {
+        logfile_message("Compiling language file \"%s\"...", abs_path);
+        t->data = langtable_compile(abs_path, &(t->size));
+        ((langtable_header_t*)(t->data))->source_size = source_size;
+        ((langtable_header_t*)(t->data))->source_mtime = source_mtime;
+
+        /* a table that is mapped by another instance of the game
+         * is never truncated: write a new file and replace it */
+        sprintf(tmp_path, "%.1000s.tmp", cache_path);
+        if(NULL != (fp = fopen(tmp_path, "wb"))) {
+            int ok = (fwrite(t->data, 1, t->size, fp) == t->size);
+            ok = (fclose(fp) == 0) && ok;
+#ifdef __WIN32__
+            if(ok)
+                remove(cache_path); /* rename() doesn't replace files on Windows */
+#endif
+            if(!ok || rename(tmp_path, cache_path) != 0) {
+                logfile_message("Warning: couldn't write \"%s\"", cache_path);
+                remove(tmp_path);
+            }
+        }
+    }
+
+    /* done! */
+    t->header = (const langtable_header_t*)(t->data);
+    t->entry = (const langtable_entry_t*)((const char*)(t->data) + sizeof(langtable_header_t));
+    t->blob = (const char*)(t->entry + t->header->count);
+    return t;
+}
+
+/* closes a compiled table */
+langtable_t* langtable_close(langtable_t *t)
+{
+    if(t != NULL) {
+#ifdef LANG_USE_MMAP
+        if(t->mapped)
+            munmap(t->data, t->size);
+        else
+            free(t->data);
+#else
+        free(t->data);
+#endif
+        free(t);
+    }
+
+    return NULL;
+}
+
+/* binary search (case insensitive). Returns NULL if the key isn't found */
+const char* langtable_find(const langtable_t *t, const char *key)
+{
+    const char *k = str_to_upper(key);
+    int cmp, mid, low = 0, high = (int)(t->header->count) - 1;
+
+    while(low <= high) {
+        mid = (low + high) / 2;
+        cmp = strcmp(k, t->blob + t->entry[mid].key);
+        if(cmp == 0)
+            return t->blob + t->entry[mid].value;
+        else if(cmp < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+
+    return NULL;
+}
+
+/* compiles a language file. Returns a mallocx'ed buffer */
+void* langtable_compile(const char *abs_path, size_t *size)
+{
+    int i, j, n;
+    char *data, *blob;
+    uint32 blob_size;
+    keyvalue_list_t list;
+    langtable_header_t *h;
+    langtable_entry_t *e;
+    parsetree_program_t *prog;
+
+    /* reading the key/value pairs */
+    list.count = 0;
+    list.capacity = 256;
+    list.pair = mallocx(list.capacity * sizeof *(list.pair));
+    prog = scriptcache_construct_tree(abs_path);
+    nanoparser_traverse_program_ex(prog, (void*)(&list), traverse_compile);
+
+    /* sorting the keys. Repeated keys: the last one wins */
+    qsort(list.pair, list.count, sizeof *(list.pair), keyvalue_cmp);
+    for(i=0,n=0; i<list.count; i++) {
+        if(i+1 < list.count && strcmp(list.pair[i].key, list.pair[i+1].key) == 0)
+            free(list.pair[i].key);
+        else
+            list.pair[n++] = list.pair[i];
+    }
+
+    /* computing the size of the blob */
+    blob_size = 0;
+    for(i=0; i<n; i++)
+        blob_size += strlen(list.pair[i].key) + strlen(list.pair[i].value) + 2;
+
+    /* filling the table */
+    *size = sizeof(langtable_header_t) + n * sizeof(langtable_entry_t) + blob_size;
+    data = mallocx(*size);
+    h = (langtable_header_t*)data;
+    e = (langtable_entry_t*)(data + sizeof(langtable_header_t));
+    blob = (char*)(e + n);
+
+    h->magic = LANGTABLE_MAGIC;
+    h->version = LANGTABLE_VERSION;
+    h->source_size = h->source_mtime = 0;
+    h->ver = h->subver = h->wipver = 0;
+    h->compatibility = h->title = LANGTABLE_NONE;
+    h->count = n;
+    h->blob_size = blob_size;
+
+    for(i=0,j=0; i<n; i++) {
+        e[i].key = j;
+        strcpy(blob + j, list.pair[i].key);
+        j += strlen(list.pair[i].key) + 1;
+        e[i].value = j;
+        strcpy(blob + j, list.pair[i].value);
+        j += strlen(list.pair[i].value) + 1;
+
+        /* metadata */
+        if(strcmp(list.pair[i].key, "LANG_LANGUAGE") == 0)
+            h->title = e[i].value;
+        else if(strcmp(list.pair[i].key, "LANG_COMPATIBILITY") == 0) {
+            int ver, subver, wipver;
+            h->compatibility = e[i].value;
+            if(sscanf(list.pair[i].value, "%d.%d.%d", &ver, &subver, &wipver) == 3) {
+                h->ver = ver;
+                h->subver = subver;
+                h->wipver = wipver;
+            }
+        }
+
+        free(list.pair[i].key);
+    }
+
+    /* done! */
+    free(list.pair);
+    prog = nanoparser_deconstruct_tree(prog);
+    return data;
+}
+
+/* is the given data a valid, up-to-date compiled table? */
+int langtable_validate(const void *data, size_t size, uint32 source_size, uint32 source_mtime)
+{
+    uint32 i;
+    const langtable_header_t *h = (const langtable_header_t*)data;
+    const langtable_entry_t *e = (const langtable_entry_t*)((const char*)data + sizeof(langtable_header_t));
+
+    if(size < sizeof(langtable_header_t))
+        return FALSE;
+
+    if(h->magic != LANGTABLE_MAGIC || h->version != LANGTABLE_VERSION)
+        return FALSE;
+
+    if(h->source_size != source_size || h->source_mtime != source_mtime)
+        return FALSE;
+
+    if(size != sizeof(langtable_header_t) + h->count * sizeof(langtable_entry_t) + h->blob_size)
+        return FALSE;
+
+    if(h->blob_size == 0 || ((const char*)(e + h->count))[h->blob_size - 1] != '\0')
+        return FALSE;
+
+    for(i=0; i<h->count; i++) {
+        if(e[i].key >= h->blob_size || e[i].value >= h->blob_size)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* where should we store the compiled table of a given language file? */
+void langtable_cachepath(char *dest, const char *abs_path, size_t dest_size)
+{
+    char relativefp[1024];
+    sprintf(relativefp, "%s/%s.%08x.%s", LANGTABLE_DIRECTORY, basename(abs_path), (unsigned int)str_to_hash(abs_path), LANGTABLE_EXTENSION);
+    home_filepath(dest, relativefp, dest_size);
 }
 
-int traverse_inout(const parsetree_statement_t *stmt, void *inout)
+int traverse_compile(const parsetree_statement_t *stmt, void *list)
 {
-    inout_t *x = (inout_t*)inout;
+    keyvalue_list_t *x = (keyvalue_list_t*)list;
     const char *id = nanoparser_get_identifier(stmt);
     const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
     const parsetree_parameter_t *p = nanoparser_get_nth_parameter(param_list, 1);
 
     nanoparser_expect_string(p, "a string is expected after each key of the language file");
-    if(str_icmp(id, x->key) == 0)
-        x->value = nanoparser_get_string(p);
+    if(x->count >= x->capacity) {
+        x->capacity *= 2;
+        x->pair = reallocx(x->pair, x->capacity * sizeof *(x->pair));
+    }
+
+    x->pair[x->count].key = str_dup(str_to_upper(id));
+    x->pair[x->count].value = nanoparser_get_string(p);
+    x->pair[x->count].index = x->count;
+    x->count++;
 
     return 0;
 }
 
+int keyvalue_cmp(const void *a, const void *b)
+{
+    const keyvalue_t *x = (const keyvalue_t*)a;
+    const keyvalue_t *y = (const keyvalue_t*)b;
+    int cmp = strcmp(x->key, y->key);
+    return (cmp != 0) ? cmp : (x->index - y->index);
+}
+
 stringadapter_t* stringadapter_create(const char *data)
 {
     stringadapter_t *s = mallocx(sizeof *s);
@@ -30,5 +30,6 @@ void lang_loadfile(const char *filepath);
 void lang_getstring(const char *desired_key, char *str, int str_size);
 const char *lang_get(const char *desired_key);
 void lang_readcompatibility(const char *filename, int *ver, int *subver, int *wipver);
+unsigned int lang_generation(); /* changes whenever a language file gets loaded */
 
 #endif
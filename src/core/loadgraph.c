@@ -0,0 +1,477 @@
+/*
+ * loadgraph.c - jobs that load things, and what they depend on
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "loadgraph.h"
+#include "global.h"
+#include "util.h"
+#include "thread.h"
+#include "timer.h"
+#include "logfile.h"
+
+/* constants */
+#define LOADGRAPH_INITIALCAPACITY       32
+#define LOADGRAPH_MAXHELPERS            8
+
+/* job states */
+#define JS_WAITING                      0 /* not started yet */
+#define JS_RUNNING                      1 /* the routine is running */
+#define JS_FINISHED                     2 /* the routine has returned, but some of its children haven't */
+#define JS_COMPLETE                     3 /* done */
+
+/* a job */
+typedef struct loadjobinfo_t {
+    const char *phase;
+    int main_thread;
+    loadjob_t routine;
+    void *param;
+    int state;
+    int parent; /* -1 if none */
+    int pending; /* dependencies that aren't complete */
+    int unfinished; /* this job and its children that aren't complete */
+    int *dependent; /* jobs that depend on this one */
+    int dependent_count, dependent_capacity;
+    uint32 start_time, end_time;
+} loadjobinfo_t;
+
+/* load graph */
+struct loadgraph_t {
+    loadjobinfo_t *job; /* job[0 .. count-1] */
+    int count, capacity;
+    int complete_count, running_count;
+    const char *last_phase; /* phase of the last completed job */
+    mutex_t *mutex; /* protects everything above */
+    event_t *wakeup; /* there may be something to do */
+    thread_t *helper[LOADGRAPH_MAXHELPERS];
+    int helper_count; /* 0 if the graph isn't running */
+    uint32 start_time;
+    volatile int quit;
+};
+
+/* private methods */
+static void helper_routine(void *arg);
+static int take_job(loadgraph_t *g, int main_thread);
+static int has_ready_job(const loadgraph_t *g, int main_thread);
+static int is_ready(const loadgraph_t *g, int j, int main_thread);
+static void run_job(loadgraph_t *g, int j);
+static void complete_job(loadgraph_t *g, int j);
+static void log_phases(const loadgraph_t *g);
+
+
+
+/*
+ * loadgraph_create()
+ * Creates a new (empty) load graph
+ */
+loadgraph_t* loadgraph_create()
+{
+    loadgraph_t *g = mallocx(sizeof *g);
+
+    g->count = 0;
+    g->capacity = LOADGRAPH_INITIALCAPACITY;
+    g->job = mallocx(g->capacity * sizeof *(g->job));
+    g->complete_count = g->running_count = 0;
+    g->last_phase = "";
+    g->mutex = mutex_create();
+    g->wakeup = event_create();
+    g->helper_count = 0;
+    g->start_time = 0;
+    g->quit = FALSE;
+
+    return g;
+}
+
+
+/*
+ * loadgraph_destroy()
+ * Destroys a load graph. If it has been started,
+ * the remaining jobs are run first.
+ */
+loadgraph_t* loadgraph_destroy(loadgraph_t *g)
+{
+    int i;
+
+    /* it's still running */
+    if(g->helper_count > 0)
+        loadgraph_finish(g, NULL, NULL);
+
+    for(i=0; i<g->count; i++)
+        free(g->job[i].dependent);
+
+    free(g->job);
+    g->mutex = mutex_destroy(g->mutex);
+    g->wakeup = event_destroy(g->wakeup);
+    free(g);
+    return NULL;
+}
+
+
+/*
+ * loadgraph_add()
+ * Adds a job and returns its id. If parent isn't -1,
+ * the new job is a child of parent, which must be the
+ * job that's calling this function: the child starts
+ * once the parent returns, and the parent is only done
+ * when all of its children are.
+ */
+int loadgraph_add(loadgraph_t *g, int parent, const char *phase, int main_thread, loadjob_t routine, void *param)
+{
+    loadjobinfo_t *job;
+    int j;
+
+    mutex_lock(g->mutex);
+
+    if(g->count >= g->capacity) {
+        g->capacity *= 2;
+        g->job = reallocx(g->job, g->capacity * sizeof *(g->job));
+    }
+
+    j = g->count++;
+    job = &(g->job[j]);
+    job->phase = phase;
+    job->main_thread = main_thread ? TRUE : FALSE;
+    job->routine = routine;
+    job->param = param;
+    job->state = JS_WAITING;
+    job->parent = parent;
+    job->pending = 0;
+    job->unfinished = 1;
+    job->dependent = NULL;
+    job->dependent_count = job->dependent_capacity = 0;
+    job->start_time = job->end_time = 0;
+
+    if(parent >= 0)
+        g->job[parent].unfinished++;
+
+    mutex_unlock(g->mutex);
+
+    /* the graph may be running already */
+    if(parent < 0)
+        event_signal(g->wakeup);
+
+    return j;
+}
+
+
+/*
+ * loadgraph_depend()
+ * job won't start before dependency is done. Call this
+ * before job may start, i.e., before loadgraph_run() or
+ * from the routine of the parent of job.
+ */
+void loadgraph_depend(loadgraph_t *g, int job, int dependency)
+{
+    loadjobinfo_t *dep;
+
+    mutex_lock(g->mutex);
+
+    dep = &(g->job[dependency]);
+    if(dep->state != JS_COMPLETE) {
+        if(dep->dependent_count >= dep->dependent_capacity) {
+            dep->dependent_capacity = max(4, 2 * dep->dependent_capacity);
+            dep->dependent = reallocx(dep->dependent, dep->dependent_capacity * sizeof *(dep->dependent));
+        }
+        dep->dependent[dep->dependent_count++] = job;
+        g->job[job].pending++;
+    }
+
+    mutex_unlock(g->mutex);
+}
+
+
+/*
+ * loadgraph_run()
+ * Runs all the jobs and returns when they're done.
+ * The calling thread is the main thread: it runs the
+ * jobs that need it, and helps with the others.
+ * progress() (may be NULL) is called on this thread
+ * whenever some job is done.
+ */
+void loadgraph_run(loadgraph_t *g, void (*progress)(const char *phase, float done, void *param), void *param)
+{
+    loadgraph_start(g);
+    loadgraph_finish(g, progress, param);
+}
+
+
+/*
+ * loadgraph_start()
+ * Starts running the jobs in the background and
+ * returns at once. The jobs that need the main
+ * thread only run when it calls loadgraph_poll()
+ * or loadgraph_finish().
+ */
+void loadgraph_start(loadgraph_t *g)
+{
+    int i;
+
+    if(g->helper_count > 0)
+        return;
+
+    g->start_time = timer_get_ticks();
+    g->quit = FALSE;
+    g->helper_count = clip(thread_worker_count() - 1, 1, LOADGRAPH_MAXHELPERS);
+    for(i=0; i<g->helper_count; i++)
+        g->helper[i] = thread_create(helper_routine, g);
+}
+
+
+/*
+ * loadgraph_poll()
+ * Runs the jobs of the main thread that are ready
+ * (if any), for up to about max_time milliseconds
+ * (at least one job is run), and returns TRUE if
+ * everything is done. Call this from the main thread.
+ */
+int loadgraph_poll(loadgraph_t *g, uint32 max_time)
+{
+    int j, done;
+    uint32 start_time = timer_get_ticks();
+
+    mutex_lock(g->mutex);
+    while((j = take_job(g, TRUE)) >= 0) {
+        mutex_unlock(g->mutex);
+        run_job(g, j);
+        mutex_lock(g->mutex);
+        if(timer_get_ticks() >= start_time + max_time)
+            break;
+    }
+    done = (g->complete_count >= g->count);
+    mutex_unlock(g->mutex);
+
+    return done;
+}
+
+
+/*
+ * loadgraph_finish()
+ * Runs the remaining jobs (helping the background
+ * threads) and returns when they're all done.
+ * progress() (may be NULL) is called on this thread
+ * whenever some job is done.
+ */
+void loadgraph_finish(loadgraph_t *g, void (*progress)(const char *phase, float done, void *param), void *param)
+{
+    int i, j, reported = -1;
+    const char *phase;
+    float done;
+
+    loadgraph_start(g);
+
+    /* run the jobs */
+    mutex_lock(g->mutex);
+    while(g->complete_count < g->count) {
+        /* report the progress */
+        if(progress != NULL && reported != g->complete_count) {
+            reported = g->complete_count;
+            done = (float)g->complete_count / (float)g->count;
+            phase = g->last_phase;
+            mutex_unlock(g->mutex);
+            progress(phase, done, param);
+            mutex_lock(g->mutex);
+            continue;
+        }
+
+        /* the jobs of the main thread come first */
+        if((j = take_job(g, TRUE)) >= 0 || (j = take_job(g, FALSE)) >= 0) {
+            mutex_unlock(g->mutex);
+            run_job(g, j);
+            mutex_lock(g->mutex);
+        }
+        else if(g->running_count == 0) {
+            mutex_unlock(g->mutex);
+            fatal_error("loadgraph_finish(): circular dependency (%d of %d jobs done)", g->complete_count, g->count);
+        }
+        else {
+            /* wait for the helpers */
+            mutex_unlock(g->mutex);
+            thread_yield();
+            mutex_lock(g->mutex);
+        }
+    }
+    mutex_unlock(g->mutex);
+
+    if(progress != NULL)
+        progress(g->last_phase, 1.0f, param);
+
+    /* stop the helpers */
+    atomic_set(&(g->quit), TRUE);
+    event_signal(g->wakeup);
+    for(i=0; i<g->helper_count; i++)
+        thread_join(g->helper[i]);
+
+    /* done! */
+    log_phases(g);
+    g->helper_count = 0;
+}
+
+
+
+/* private methods */
+
+/* the main loop of a helper thread: it only runs
+ * the jobs that don't need the main thread */
+void helper_routine(void *arg)
+{
+    loadgraph_t *g = (loadgraph_t*)arg;
+    int j;
+
+    mutex_lock(g->mutex);
+    while(!atomic_get(&(g->quit))) {
+        if((j = take_job(g, FALSE)) >= 0) {
+            mutex_unlock(g->mutex);
+            run_job(g, j);
+            mutex_lock(g->mutex);
+        }
+        else {
+            mutex_unlock(g->mutex);
+            event_wait(g->wakeup);
+            mutex_lock(g->mutex);
+        }
+    }
+    mutex_unlock(g->mutex);
+
+    /* the next helper should quit too */
+    event_signal(g->wakeup);
+}
+
+/* takes a job that's ready to run, or returns -1.
+ * The mutex must be locked. */
+int take_job(loadgraph_t *g, int main_thread)
+{
+    int j;
+
+    for(j=0; j<g->count; j++) {
+        if(is_ready(g, j, main_thread)) {
+            g->job[j].state = JS_RUNNING;
+            g->job[j].start_time = timer_get_ticks();
+            g->running_count++;
+
+            /* some other helper may take the next one */
+            if(has_ready_job(g, FALSE))
+                event_signal(g->wakeup);
+
+            return j;
+        }
+    }
+
+    return -1;
+}
+
+/* is there a job ready to run? */
+int has_ready_job(const loadgraph_t *g, int main_thread)
+{
+    int j;
+
+    for(j=0; j<g->count; j++) {
+        if(is_ready(g, j, main_thread))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* can job j run now on the main thread (or on a helper)? */
+int is_ready(const loadgraph_t *g, int j, int main_thread)
+{
+    const loadjobinfo_t *job = &(g->job[j]);
+
+    return (
+        job->state == JS_WAITING &&
+        job->pending == 0 &&
+        job->main_thread == main_thread &&
+        (job->parent < 0 || g->job[job->parent].state != JS_RUNNING)
+    );
+}
+
+/* runs job j, which has just been taken */
+void run_job(loadgraph_t *g, int j)
+{
+    loadjob_t routine;
+    void *param;
+
+    mutex_lock(g->mutex);
+    routine = g->job[j].routine;
+    param = g->job[j].param;
+    mutex_unlock(g->mutex);
+
+    routine(g, j, param);
+
+    mutex_lock(g->mutex);
+    g->job[j].state = JS_FINISHED;
+    g->job[j].end_time = timer_get_ticks();
+    g->running_count--;
+    if(--(g->job[j].unfinished) == 0)
+        complete_job(g, j);
+    mutex_unlock(g->mutex);
+
+    /* something may be ready now */
+    event_signal(g->wakeup);
+}
+
+/* job j and all of its children are done.
+ * The mutex must be locked. */
+void complete_job(loadgraph_t *g, int j)
+{
+    loadjobinfo_t *job = &(g->job[j]);
+    int i;
+
+    job->state = JS_COMPLETE;
+    g->complete_count++;
+    g->last_phase = job->phase;
+
+    for(i=0; i<job->dependent_count; i++)
+        g->job[job->dependent[i]].pending--;
+
+    if(job->parent >= 0 && --(g->job[job->parent].unfinished) == 0)
+        complete_job(g, job->parent);
+}
+
+/* writes the time taken by each phase to the log file */
+void log_phases(const loadgraph_t *g)
+{
+    uint32 first, last, busy;
+    int i, j, jobs;
+
+    for(i=0; i<g->count; i++) {
+        /* we've seen this phase already */
+        for(j=0; j<i && strcmp(g->job[j].phase, g->job[i].phase) != 0; j++);
+        if(j < i)
+            continue;
+
+        /* all the jobs of this phase */
+        first = g->job[i].start_time;
+        last = g->job[i].end_time;
+        busy = 0;
+        jobs = 0;
+        for(j=i; j<g->count; j++) {
+            if(strcmp(g->job[j].phase, g->job[i].phase) == 0) {
+                first = min(first, g->job[j].start_time);
+                last = max(last, g->job[j].end_time);
+                busy += g->job[j].end_time - g->job[j].start_time;
+                jobs++;
+            }
+        }
+
+        logfile_message("loadgraph: %s - %d job(s), %u ms (%u ms of work)", g->job[i].phase, jobs, (unsigned)(last - first), (unsigned)busy);
+    }
+
+    logfile_message("loadgraph: %d job(s) done in %u ms, using %d thread(s)", g->count, (unsigned)(timer_get_ticks() - g->start_time), 1 + g->helper_count);
+}
@@ -0,0 +1,69 @@
+/*
+ * loadgraph.h - jobs that load things, and what they depend on
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LOADGRAPH_H
+#define _LOADGRAPH_H
+
+#include "global.h"
+
+/*
+   A load graph is a set of jobs (parse this script, decode
+   that image...) and the dependencies between them. Running
+   it runs every job once all of its dependencies are done,
+   many of them at the same time: each worker thread takes
+   the next job that's ready.
+
+   A job may add jobs of its own (its children): they start
+   once it returns, and the job is only considered done when
+   all of its children are. Jobs that must run on the main
+   thread (anything that touches Allegro, the resource manager
+   or the parser...) are flagged as such.
+
+   A graph may also be started in the background, while the
+   game goes on: the main thread then runs its jobs whenever
+   it polls the graph.
+
+   Jobs are grouped into phases (just a name): the time taken
+   by each phase is written to the log file.
+*/
+
+typedef struct loadgraph_t loadgraph_t;
+typedef void (*loadjob_t)(loadgraph_t *graph, int job, void *param);
+
+/* create & destroy */
+loadgraph_t* loadgraph_create();
+loadgraph_t* loadgraph_destroy(loadgraph_t *graph);
+
+/* adds a job and returns its id. parent is -1, or the job calling this
+ * function. The phase string must outlive the graph. */
+int loadgraph_add(loadgraph_t *graph, int parent, const char *phase, int main_thread, loadjob_t routine, void *param);
+
+/* job won't start before dependency is done. Call it before the job may start. */
+void loadgraph_depend(loadgraph_t *graph, int job, int dependency);
+
+/* runs everything. progress(phase, done, param) is called on this
+ * thread whenever a job is done; done goes from 0.0 to 1.0 */
+void loadgraph_run(loadgraph_t *graph, void (*progress)(const char *phase, float done, void *param), void *param);
+
+/* running in the background */
+void loadgraph_start(loadgraph_t *graph); /* returns at once */
+int loadgraph_poll(loadgraph_t *graph, uint32 max_time); /* runs the main thread jobs that are ready, for up to about max_time ms. Returns TRUE if everything is done */
+void loadgraph_finish(loadgraph_t *graph, void (*progress)(const char *phase, float done, void *param), void *param); /* waits for the remaining jobs */
+
+#endif
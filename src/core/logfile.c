@@ -19,14 +19,73 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#ifndef __WIN32__
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
 #include "logfile.h"
 #include "global.h"
 #include "osspec.h"
+#include "thread.h"
+#include "util.h"
+#include "stringutil.h"
 
 
 /* private stuff ;) */
 #define LOGFILE_PATH        "logfile.txt" /* default log file */
 static FILE *logfile;
+static int logfile_fd = 2; /* used when crashing: stdio isn't async-signal-safe */
+static const char *level_prefix[] = { "[debug] ", "", "[warning] ", "[error] " };
+
+/* The queue is a ring of lines. Any thread may add lines to
+ * it without locking (a slot is reserved with a compare-and-
+ * swap on the head); the lines are taken out in order by the
+ * writer thread, or by logfile_flush(). The sequence number of
+ * a slot tells whether it's free or holding a line:
+ * seq == pos: free for position pos; seq == pos+1: ready */
+#define LOGFILE_RINGSIZE    256 /* lines */
+#define LOGFILE_LINELEN     2048 /* longer messages are truncated */
+
+typedef struct {
+    volatile int seq;
+    int level;
+    char text[LOGFILE_LINELEN];
+} logline_t;
+
+static logline_t ring[LOGFILE_RINGSIZE];
+static volatile int ring_head; /* next position to be reserved */
+static volatile int ring_tail; /* next position to be written (guarded by drain_mutex) */
+static int ring_ready = FALSE;
+static mutex_t *drain_mutex;
+
+/* writer thread */
+static thread_t *writer;
+static event_t *writer_wakeup;
+static volatile int writer_sleeping;
+static volatile int writer_quit;
+
+/* repeated messages */
+static char last_text[LOGFILE_LINELEN];
+static int last_level = -1;
+static int repeat_count;
+
+/* crash handling */
+static const int crash_signal[] = { SIGSEGV, SIGFPE, SIGILL, SIGABRT };
+#define CRASH_SIGNALS       ((int)(sizeof(crash_signal) / sizeof(crash_signal[0])))
+static void (*old_handler[CRASH_SIGNALS])(int);
+
+static void vlog(int level, const char *fmt, va_list args);
+static void enqueue(int level, const char *text);
+static int pending();
+static void drain(int summarize);
+static void write_line(int level, const char *text);
+static void write_repetitions();
+static void writer_routine(void *arg);
+static void crash_handler(int sig);
+static void crash_write(const char *text);
 
 
 /*
@@ -36,12 +95,34 @@ static FILE *logfile;
 void logfile_init()
 {
     char abs_path[1024];
+    int i;
 
     resource_filepath(abs_path, LOGFILE_PATH, sizeof(abs_path), RESFP_WRITE);
 
     if(NULL == (logfile = fopen(abs_path, "w")))
         logfile_message("WARNING: couldn't open %s for writing.\n", LOGFILE_PATH);
-    else {
+    logfile_fd = fileno(logfile ? logfile : stderr);
+
+    /* the queue */
+    for(i=0; i<LOGFILE_RINGSIZE; i++)
+        ring[i].seq = i;
+    ring_head = ring_tail = 0;
+    drain_mutex = mutex_create();
+    last_level = -1;
+    repeat_count = 0;
+
+    /* the writer thread */
+    writer_sleeping = FALSE;
+    writer_quit = FALSE;
+    writer_wakeup = event_create();
+    writer = thread_create(writer_routine, NULL);
+    atomic_set(&ring_ready, TRUE);
+
+    /* flush on crash */
+    for(i=0; i<CRASH_SIGNALS; i++)
+        old_handler[i] = signal(crash_signal[i], crash_handler);
+
+    if(logfile) {
         logfile_message("%s version %d.%d.%d", GAME_TITLE, GAME_VERSION, GAME_SUB_VERSION, GAME_WIP_VERSION);
         logfile_message("logfile_init()");
     }
@@ -55,15 +136,58 @@ void logfile_init()
  */
 void logfile_message(const char *fmt, ...)
 {
-    char buf[2048];
     va_list args;
 
     va_start(args, fmt);
-    vsprintf(buf, fmt, args);
+    vlog(LOGLEVEL_INFO, fmt, args);
     va_end(args);
+}
 
-    fprintf(logfile ? logfile : stderr, "%s\n", buf);
-    fflush(logfile ? logfile : stderr);
+
+/*
+ * logfile_log()
+ * Prints a message of a given severity
+ * level (LOGLEVEL_*) on the logfile
+ */
+void logfile_log(int level, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vlog(level, fmt, args);
+    va_end(args);
+}
+
+
+/*
+ * logfile_debug_message()
+ * Prints a debug message on the logfile.
+ * Call it via logfile_debug(), so that it
+ * can be compiled out.
+ */
+void logfile_debug_message(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vlog(LOGLEVEL_DEBUG, fmt, args);
+    va_end(args);
+}
+
+
+/*
+ * logfile_flush()
+ * Writes the pending messages to the disk
+ * before returning
+ */
+void logfile_flush()
+{
+    if(!atomic_get(&ring_ready))
+        return;
+
+    mutex_lock(drain_mutex);
+    drain(TRUE);
+    mutex_unlock(drain_mutex);
 }
 
 
@@ -74,8 +198,197 @@ void logfile_message(const char *fmt, ...)
  */
 void logfile_release()
 {
+    int i;
+
     logfile_message("logfile_release()");
+
+    /* stop the writer */
+    atomic_set(&writer_quit, TRUE);
+    event_signal(writer_wakeup);
+    thread_join(writer);
+    writer_wakeup = event_destroy(writer_wakeup);
+
+    /* from now on, messages are written directly */
+    for(i=0; i<CRASH_SIGNALS; i++)
+        signal(crash_signal[i], old_handler[i]);
+    atomic_set(&ring_ready, FALSE);
+    mutex_lock(drain_mutex);
+    drain(TRUE);
+    mutex_unlock(drain_mutex);
+    drain_mutex = mutex_destroy(drain_mutex);
+
     if(logfile)
         fclose(logfile);
+    logfile = NULL;
+    logfile_fd = 2;
 }
 
+
+
+/* private methods */
+
+/* formats and queues a message */
+void vlog(int level, const char *fmt, va_list args)
+{
+    char buf[LOGFILE_LINELEN];
+
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    buf[sizeof(buf)-1] = '\0';
+
+    if(atomic_get(&ring_ready))
+        enqueue(level, buf);
+    else {
+        /* the writer isn't running */
+        write_line(level, buf);
+        fflush(logfile ? logfile : stderr);
+    }
+}
+
+/* adds a line to the ring */
+void enqueue(int level, const char *text)
+{
+    logline_t *slot;
+    int pos, dif;
+
+    /* reserve a slot */
+    for(;;) {
+        pos = atomic_get(&ring_head);
+        slot = &ring[(unsigned)pos % LOGFILE_RINGSIZE];
+        dif = (int)((unsigned)atomic_get(&slot->seq) - (unsigned)pos);
+
+        if(dif == 0) {
+            if(atomic_cas(&ring_head, pos, (int)((unsigned)pos + 1)))
+                break;
+        }
+        else if(dif < 0) {
+            /* the ring is full: write the lines ourselves */
+            logfile_flush();
+            thread_yield();
+        }
+    }
+
+    /* fill it */
+    slot->level = level;
+    str_cpy(slot->text, text, sizeof(slot->text));
+    atomic_set(&slot->seq, (int)((unsigned)pos + 1));
+
+    /* wake up the writer */
+    if(atomic_get(&writer_sleeping))
+        event_signal(writer_wakeup);
+}
+
+/* is there a line ready to be written? */
+int pending()
+{
+    int pos = atomic_get(&ring_tail);
+    logline_t *slot = &ring[(unsigned)pos % LOGFILE_RINGSIZE];
+    return ((unsigned)atomic_get(&slot->seq) == (unsigned)pos + 1);
+}
+
+/* writes the lines that are ready. If summarize is TRUE,
+ * the pending repetitions are reported as well. Call it
+ * with drain_mutex locked (unless crashing). */
+void drain(int summarize)
+{
+    int pos;
+    logline_t *slot;
+
+    while(pending()) {
+        pos = ring_tail;
+        slot = &ring[(unsigned)pos % LOGFILE_RINGSIZE];
+        write_line(slot->level, slot->text);
+        atomic_set(&slot->seq, (int)((unsigned)pos + LOGFILE_RINGSIZE));
+        atomic_set(&ring_tail, (int)((unsigned)pos + 1));
+    }
+
+    if(summarize)
+        write_repetitions();
+
+    fflush(logfile ? logfile : stderr);
+}
+
+/* writes a line, unless it's a copy of the previous one */
+void write_line(int level, const char *text)
+{
+    FILE *fp = logfile ? logfile : stderr;
+
+    if(level == last_level && strcmp(text, last_text) == 0) {
+        repeat_count++;
+        return;
+    }
+
+    write_repetitions();
+    str_cpy(last_text, text, sizeof(last_text));
+    last_level = level;
+
+    fprintf(fp, "%s%s\n", level_prefix[clip(level, LOGLEVEL_DEBUG, LOGLEVEL_ERROR)], text);
+}
+
+/* how many times was the last line repeated? */
+void write_repetitions()
+{
+    if(repeat_count > 0) {
+        fprintf(logfile ? logfile : stderr, "(the previous message was repeated %d more time%s)\n", repeat_count, repeat_count > 1 ? "s" : "");
+        repeat_count = 0;
+    }
+}
+
+/* the writer thread */
+void writer_routine(void *arg)
+{
+    for(;;) {
+        /* sleep until there's something to write */
+        atomic_set(&writer_sleeping, TRUE);
+        if(!pending() && !atomic_get(&writer_quit))
+            event_wait(writer_wakeup);
+        atomic_set(&writer_sleeping, FALSE);
+
+        if(atomic_get(&writer_quit))
+            break;
+
+        mutex_lock(drain_mutex);
+        drain(FALSE);
+        mutex_unlock(drain_mutex);
+    }
+}
+
+/* the program has crashed: write what we can. Only
+ * async-signal-safe calls here: the lines go straight
+ * to the file descriptor, bypassing stdio. */
+void crash_handler(int sig)
+{
+    logline_t *slot;
+    int i, pos;
+
+    /* the mutex might be held by the crashed thread */
+    while(pending()) {
+        pos = ring_tail;
+        slot = &ring[(unsigned)pos % LOGFILE_RINGSIZE];
+        crash_write(level_prefix[clip(slot->level, LOGLEVEL_DEBUG, LOGLEVEL_ERROR)]);
+        crash_write(slot->text);
+        crash_write("\n");
+        atomic_set(&slot->seq, (int)((unsigned)pos + LOGFILE_RINGSIZE));
+        atomic_set(&ring_tail, (int)((unsigned)pos + 1));
+    }
+
+    for(i=0; i<CRASH_SIGNALS; i++) {
+        if(crash_signal[i] == sig) {
+            signal(sig, (old_handler[i] != SIG_ERR) ? old_handler[i] : SIG_DFL);
+            break;
+        }
+    }
+
+    raise(sig);
+}
+
+/* writes a string to the log file descriptor */
+void crash_write(const char *text)
+{
+    size_t len = strlen(text);
+    int n;
+
+    while(len > 0 && (n = (int)write(logfile_fd, text, len)) > 0) {
+        text += n;
+        len -= n;
+    }
+}
@@ -20,9 +20,37 @@
 #ifndef _LOGFILE_H
 #define _LOGFILE_H
 
+/*
+   Messages are formatted by the caller and queued; a
+   background thread writes them to the disk. Consecutive
+   copies of the same message are written only once, followed
+   by the number of repetitions. The pending messages are
+   written on exit and if the program crashes.
+
+   Debug messages are compiled in only if LOGFILE_DEBUG is
+   defined. Otherwise, logfile_debug() doesn't even evaluate
+   its arguments.
+*/
+
+/* severity levels */
+#define LOGLEVEL_DEBUG          0
+#define LOGLEVEL_INFO           1
+#define LOGLEVEL_WARNING        2
+#define LOGLEVEL_ERROR          3
+
 void logfile_init(); /* initializes the logfile module */
 void logfile_message(const char *fmt, ...); /* prints a message to the logfile (printf style) */
+void logfile_log(int level, const char *fmt, ...); /* prints a message of a given severity level */
+void logfile_debug_message(const char *fmt, ...); /* use logfile_debug() instead */
+void logfile_flush(); /* writes the pending messages right away */
 void logfile_release(); /* releases the logfile module */
 
+/* debug messages */
+#ifdef LOGFILE_DEBUG
+#define logfile_debug           logfile_debug_message
+#else
+#define logfile_debug           1 ? (void)0 : logfile_debug_message
+#endif
+
 #endif
 
@@ -0,0 +1,405 @@
+/*
+ * metaindex.c - persistent index of file metadata
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro.h>
+#include "metaindex.h"
+#include "global.h"
+#include "util.h"
+#include "osspec.h"
+#include "stringutil.h"
+#include "logfile.h"
+
+/* constants */
+#define METAINDEX_FILE                  "cache/metadata.idx"
+#define METAINDEX_SIGNATURE             "OSMETA01"
+#define METAINDEX_TABLESIZE             97 /* prime number */
+#define METAINDEX_LINEMAXLENGTH         8192
+
+
+/* file structure (text):
+ *
+ * OSMETA01
+ * <path> TAB <size> TAB <mtime> TAB <number of fields>
+ * <field> TAB <value>
+ * <field> TAB <value>
+ * ...
+ *
+ * backslashes, tabs and newlines are escaped */
+
+
+/* index structure */
+typedef struct metafield_t {
+    char *key, *value;
+    struct metafield_t *next;
+} metafield_t;
+
+typedef struct metaentry_t {
+    char *path; /* absolute path */
+    uint32 size, mtime; /* invalidation */
+    int checked; /* have we compared size & mtime with the file yet? */
+    int valid; /* is this entry up-to-date? */
+    metafield_t *field;
+    struct metaentry_t *next;
+} metaentry_t;
+
+static metaentry_t *table[METAINDEX_TABLESIZE];
+static int modified;
+
+
+/* private methods */
+static const char* get_metaindex_fullpath();
+static void load();
+static void save();
+static metaentry_t* find_entry(const char *abs_path);
+static metaentry_t* create_entry(const char *abs_path, uint32 size, uint32 mtime);
+static metafield_t* delete_fields(metafield_t *field);
+static int bucket(const char *abs_path);
+static void escape(FILE *fp, const char *str);
+static char* unescape(char *str);
+
+
+
+/*
+ * metaindex_init()
+ * Initializes this module
+ */
+void metaindex_init()
+{
+    int i;
+
+    logfile_message("metaindex_init()");
+
+    for(i=0; i<METAINDEX_TABLESIZE; i++)
+        table[i] = NULL;
+
+    modified = FALSE;
+    load();
+}
+
+
+/*
+ * metaindex_release()
+ * Releases this module
+ */
+void metaindex_release()
+{
+    int i;
+    metaentry_t *e, *next;
+
+    logfile_message("metaindex_release()");
+
+    if(modified)
+        save();
+
+    for(i=0; i<METAINDEX_TABLESIZE; i++) {
+        for(e=table[i]; e; e=next) {
+            next = e->next;
+            delete_fields(e->field);
+            free(e->path);
+            free(e);
+        }
+        table[i] = NULL;
+    }
+}
+
+
+/*
+ * metaindex_lookup()
+ * Is there an up-to-date entry for the given file?
+ */
+int metaindex_lookup(const char *abs_path)
+{
+    metaentry_t *e = find_entry(abs_path);
+
+    if(e != NULL && !e->checked) {
+        e->checked = TRUE;
+        e->valid = (e->size == (uint32)file_size_ex(abs_path) && e->mtime == (uint32)file_time(abs_path));
+    }
+
+    return (e != NULL && e->valid);
+}
+
+
+/*
+ * metaindex_get()
+ * Returns the value of a field, or NULL if there's no such field
+ */
+const char* metaindex_get(const char *abs_path, const char *field)
+{
+    metaentry_t *e = find_entry(abs_path);
+    metafield_t *f;
+
+    if(e != NULL && e->valid) {
+        for(f=e->field; f; f=f->next) {
+            if(strcmp(f->key, field) == 0)
+                return f->value;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * metaindex_set()
+ * Sets the value of a field
+ */
+void metaindex_set(const char *abs_path, const char *field, const char *value)
+{
+    uint32 size = (uint32)file_size_ex(abs_path);
+    uint32 mtime = (uint32)file_time(abs_path);
+    metaentry_t *e = find_entry(abs_path);
+    metafield_t *f;
+
+    /* new or outdated entry */
+    if(e == NULL)
+        e = create_entry(abs_path, size, mtime);
+    else if(!e->valid || e->size != size || e->mtime != mtime) {
+        e->field = delete_fields(e->field);
+        e->size = size;
+        e->mtime = mtime;
+    }
+    e->checked = e->valid = TRUE;
+    modified = TRUE;
+
+    /* updating the field */
+    for(f=e->field; f; f=f->next) {
+        if(strcmp(f->key, field) == 0) {
+            free(f->value);
+            f->value = str_dup(value);
+            return;
+        }
+    }
+
+    f = mallocx(sizeof *f);
+    f->key = str_dup(field);
+    f->value = str_dup(value);
+    f->next = e->field;
+    e->field = f;
+}
+
+
+
+/* private methods */
+
+/* full filepath of the index */
+const char* get_metaindex_fullpath()
+{
+    static char abs_path[1024] = "";
+
+    /* we need WRITE privileges */
+    if(strcmp(abs_path, "") == 0)
+        resource_filepath(abs_path, METAINDEX_FILE, sizeof(abs_path), RESFP_WRITE);
+
+    return abs_path;
+}
+
+/* loads the index from disk */
+void load()
+{
+    static char line[METAINDEX_LINEMAXLENGTH];
+    char *path, *key, *value, *p;
+    unsigned long size, mtime;
+    int i, n, count = 0;
+    metaentry_t *e;
+    metafield_t *f;
+    FILE *fp;
+
+    if(NULL == (fp = fopen(get_metaindex_fullpath(), "r"))) {
+        logfile_message("The metadata index \"%s\" doesn't exist yet", get_metaindex_fullpath());
+        return;
+    }
+
+    /* signature */
+    if(fgets(line, sizeof(line), fp) == NULL || strncmp(line, METAINDEX_SIGNATURE, strlen(METAINDEX_SIGNATURE)) != 0) {
+        logfile_message("ERROR: invalid file signature (metadata index)");
+        fclose(fp);
+        return;
+    }
+
+    /* entries */
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        path = line;
+        if(NULL == (p = strchr(path, '\t')) || sscanf(p+1, "%lu\t%lu\t%d", &size, &mtime, &n) != 3)
+            break; /* corrupted index */
+
+        *p = 0;
+        e = create_entry(unescape(path), (uint32)size, (uint32)mtime);
+        for(i=0; i<n && fgets(line, sizeof(line), fp) != NULL; i++) {
+            key = line;
+            if(NULL == (value = strchr(key, '\t')))
+                break;
+            *(value++) = 0;
+            if(NULL != (p = strchr(value, '\n')))
+                *p = 0;
+            else if(!feof(fp))
+                break; /* this line is too long */
+
+            f = mallocx(sizeof *f);
+            f->key = str_dup(unescape(key));
+            f->value = str_dup(unescape(value));
+            f->next = e->field;
+            e->field = f;
+        }
+
+        /* the entry is incomplete: it'll be rebuilt */
+        if(i < n) {
+            e->field = delete_fields(e->field);
+            e->checked = TRUE;
+            e->valid = FALSE;
+            break;
+        }
+
+        count++;
+    }
+
+    fclose(fp);
+    logfile_message("Loaded the metadata index - %d entries", count);
+}
+
+/* saves the index to disk */
+void save()
+{
+    int i, n;
+    metaentry_t *e;
+    metafield_t *f;
+    FILE *fp = fopen(get_metaindex_fullpath(), "w");
+
+    if(fp != NULL) {
+        fprintf(fp, "%s\n", METAINDEX_SIGNATURE);
+
+        for(i=0; i<METAINDEX_TABLESIZE; i++) {
+            for(e=table[i]; e; e=e->next) {
+                /* outdated entries are discarded */
+                if(e->checked && !e->valid)
+                    continue;
+
+                for(n=0,f=e->field; f; f=f->next)
+                    n++;
+
+                escape(fp, e->path);
+                fprintf(fp, "\t%lu\t%lu\t%d\n", (unsigned long)e->size, (unsigned long)e->mtime, n);
+                for(f=e->field; f; f=f->next) {
+                    escape(fp, f->key);
+                    fputc('\t', fp);
+                    escape(fp, f->value);
+                    fputc('\n', fp);
+                }
+            }
+        }
+
+        fclose(fp);
+        modified = FALSE;
+        logfile_message("Saved the metadata index");
+    }
+    else
+        logfile_message("ERROR: couldn't open the metadata index for writing. file=\"%s\"", get_metaindex_fullpath());
+}
+
+/* finds an entry, or NULL if there's no such entry */
+metaentry_t* find_entry(const char *abs_path)
+{
+    metaentry_t *e;
+
+    for(e=table[bucket(abs_path)]; e; e=e->next) {
+        if(strcmp(e->path, abs_path) == 0)
+            return e;
+    }
+
+    return NULL;
+}
+
+/* creates a new (empty) entry */
+metaentry_t* create_entry(const char *abs_path, uint32 size, uint32 mtime)
+{
+    int k = bucket(abs_path);
+    metaentry_t *e = mallocx(sizeof *e);
+
+    e->path = str_dup(abs_path);
+    e->size = size;
+    e->mtime = mtime;
+    e->checked = FALSE;
+    e->valid = FALSE;
+    e->field = NULL;
+    e->next = table[k];
+    table[k] = e;
+
+    return e;
+}
+
+/* deletes a list of fields */
+metafield_t* delete_fields(metafield_t *field)
+{
+    metafield_t *next;
+
+    while(field != NULL) {
+        next = field->next;
+        free(field->key);
+        free(field->value);
+        free(field);
+        field = next;
+    }
+
+    return NULL;
+}
+
+/* hash function */
+int bucket(const char *abs_path)
+{
+    return ((str_to_hash(abs_path) % METAINDEX_TABLESIZE) + METAINDEX_TABLESIZE) % METAINDEX_TABLESIZE;
+}
+
+/* writes str to fp, escaping backslashes, tabs and newlines */
+void escape(FILE *fp, const char *str)
+{
+    for(; *str; str++) {
+        switch(*str) {
+            case '\\': fputs("\\\\", fp); break;
+            case '\t': fputs("\\t", fp); break;
+            case '\n': fputs("\\n", fp); break;
+            case '\r': fputs("\\r", fp); break;
+            default: fputc(*str, fp); break;
+        }
+    }
+}
+
+/* unescapes str (in place) */
+char* unescape(char *str)
+{
+    char *p, *q;
+
+    for(p=q=str; *p; p++,q++) {
+        if(*p == '\\' && *(p+1)) {
+            switch(*(++p)) {
+                case 't': *q = '\t'; break;
+                case 'n': *q = '\n'; break;
+                case 'r': *q = '\r'; break;
+                default: *q = *p; break;
+            }
+        }
+        else
+            *q = *p;
+    }
+
+    *q = 0;
+    return str;
+}
@@ -0,0 +1,51 @@
+/*
+ * metaindex.h - persistent index of file metadata
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _METAINDEX_H
+#define _METAINDEX_H
+
+/*
+   The metadata index remembers a few fields (name, act,
+   author...) of the data files (levels, quests...), so
+   that the menus don't need to parse every file again.
+
+   Each entry is identified by the absolute path of the
+   file and gets invalidated whenever the size or the
+   modification time of the file changes. The index is
+   saved in the home directory.
+*/
+
+/* initializes this module */
+void metaindex_init();
+
+/* releases this module, saving the index if it has been modified */
+void metaindex_release();
+
+/* is there an up-to-date entry for the given file? */
+int metaindex_lookup(const char *abs_path);
+
+/* returns the value of a field, or NULL if there's no such field
+ * (call metaindex_lookup() first) */
+const char* metaindex_get(const char *abs_path, const char *field);
+
+/* sets the value of a field. If the entry is outdated,
+ * its old fields are discarded */
+void metaindex_set(const char *abs_path, const char *field, const char *value);
+
+#endif
@@ -18,6 +18,8 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 #include <allegro.h>
 #include "global.h"
 #include "osspec.h"
@@ -96,6 +98,53 @@ static cache_t *cache_root;
 static cache_t *cachetree_release(cache_t *node);
 static cache_t *cachetree_search(cache_t *node, const char *key);
 static cache_t *cachetree_insert(cache_t *node, const char *key, const char *value);
+
+/* directory snapshot (also private): the list of the data files
+ * of both the home directory and the game directory, so that we
+ * don't need to walk the directories (see fix_case_path()) every
+ * time we look for a file. The snapshot is saved to disk and it's
+ * rebuilt whenever the modification time of a directory changes */
+#define SNAPSHOT_FILE                       "cache/paths.idx"
+#define SNAPSHOT_SIGNATURE                  "OSPATH01"
+static const char *snapshot_dirs[] = { /* data directories */
+    "config", "images", "languages", "levels", "musics",
+    "objects", "quests", "samples", "sprites", "themes", NULL
+};
+typedef struct {
+    char *key; /* relative path, case-folded */
+    char *path; /* relative path */
+    int attrib; /* FA_DIREC or 0 */
+} snapshot_entry_t;
+typedef struct {
+    char *path; /* relative path ("" is the root) */
+    uint32 mtime;
+} snapshot_dir_t;
+typedef struct {
+    char root[1024]; /* absolute path, ending with a slash */
+    snapshot_entry_t *entry; /* sorted by key */
+    int entry_count, entry_capacity;
+    snapshot_dir_t *dir;
+    int dir_count, dir_capacity;
+} snapshot_t;
+static snapshot_t snapshot[2]; /* home, game */
+static int snapshot_count; /* 0 if the snapshot isn't ready */
+static void snapshot_init();
+static void snapshot_release();
+static void snapshot_clear(snapshot_t *s);
+static int snapshot_search(char *dest, const char *relativefp, size_t dest_size);
+static int snapshot_load();
+static void snapshot_save();
+static void snapshot_build(snapshot_t *s);
+static void snapshot_scan(snapshot_t *s, const char *relative_dir);
+static void snapshot_add_entry(snapshot_t *s, const char *path, int attrib);
+static void snapshot_add_dir(snapshot_t *s, const char *path, uint32 mtime);
+static int snapshot_find(const snapshot_t *s, const char *key);
+static int snapshot_entry_cmp(const void *a, const void *b);
+static const char* snapshot_fold(const char *relativefp);
+static const char* snapshot_filepath(const char *filepath);
+static int snapshot_join(char *dest, size_t dest_size, const char *root, const char *path);
+static void snapshot_add_file(const char *abs_path);
+static int wildcard_match(const char *pattern, const char *str);
 #endif
 
 
@@ -116,7 +165,8 @@ void osspec_init()
         { "screenshots" },   /* etc. */
         { "mods" },
         { "themes" },
-        { "quests"}
+        { "quests"},
+        { "cache" }
     }; /* TODO: quest '.sav' directory? */
 
 
@@ -153,6 +203,7 @@ void osspec_release()
 #ifndef DISABLE_FILEPATH_OPTIMIZATIONS
     /* releasing the cache */
     cache_release();
+    snapshot_release();
 #endif
 }
 
@@ -247,7 +298,8 @@ void home_filepath(char *dest, const char *relativefp, size_t dest_size)
  * resource_filepath()
  * Similar to absolute_filepath() and home_filepath(), but this routine
  * searches the specified file both in the home directory and in the
- * game directory
+ * game directory. Call it from the main thread only: the lookups go
+ * through caches that are built lazily and aren't thread-safe.
  */
 void resource_filepath(char *dest, const char *relativefp, size_t dest_size, int resfp_mode)
 {
@@ -264,12 +316,11 @@ void resource_filepath(char *dest, const char *relativefp, size_t dest_size, int
             if(is_relative_filename(relativefp)) {
                 if(NULL == (path=cache_search(relativefp))) {
                     /* I'll have to search the file... */
-                    search_the_file(dest, relativefp, dest_size);
+                    if(!snapshot_search(dest, relativefp, dest_size))
+                        search_the_file(dest, relativefp, dest_size);
 
                     /* store the resulting filepath in the memory */
-                    path = mallocx( (strlen(dest)+1) * sizeof *path );
-                    strcpy(path, dest);
-                    cache_insert(relativefp, path);
+                    cache_insert(relativefp, dest);
                 }
                 else
                     str_cpy(dest, path, dest_size);
@@ -321,6 +372,11 @@ void resource_filepath(char *dest, const char *relativefp, size_t dest_size, int
 
             }
 
+#ifndef DISABLE_FILEPATH_OPTIMIZATIONS
+            /* the file will be created: keep the snapshot up-to-date */
+            snapshot_add_file(dest);
+#endif
+
             break;
         }
 
@@ -393,6 +449,62 @@ char *basename(const char *path)
 
 
 
+/*
+ * for_each_resource()
+ * Like Allegro's for_each_file_ex(), but it lists the files (not
+ * the directories) matching the given relative wildcard, both in
+ * the game directory and in the home directory. Example of a
+ * wildcard: "levels/x*.lev". Returns the number of files found.
+ */
+int for_each_resource(const char *wildcard, int (*callback)(const char *filename, int attrib, void *param), void *param)
+{
+    int j, n = 0;
+    char abs_path[2][1024];
+
+#ifndef DISABLE_FILEPATH_OPTIMIZATIONS
+    int i;
+    char filename[1024], dir[1024];
+    const char *pattern = get_filename(wildcard);
+    const char *name;
+    int len;
+
+    str_cpy(dir, wildcard, min(sizeof(dir), pattern - wildcard + 1));
+    if(snapshot_fold(dir) != NULL) {
+        str_cpy(dir, snapshot_fold(dir), sizeof(dir));
+        len = strlen(dir);
+        if(snapshot_count == 0)
+            snapshot_init();
+
+        /* the game directory comes first */
+        for(j=snapshot_count-1; j>=0; j--) {
+            const snapshot_t *s = &snapshot[j];
+            for(i=snapshot_find(s, dir); i<s->entry_count && strncmp(s->entry[i].key, dir, len) == 0; i++) {
+                name = s->entry[i].path + len;
+                if(!(s->entry[i].attrib & FA_DIREC) && strchr(name, '/') == NULL && wildcard_match(pattern, name)) {
+                    sprintf(filename, "%s%s", s->root, s->entry[i].path);
+                    fix_filename_slashes(filename);
+                    n++;
+                    if(callback(filename, s->entry[i].attrib, param) != 0)
+                        return n;
+                }
+            }
+        }
+
+        return n;
+    }
+#endif
+
+    /* official and $HOME files */
+    absolute_filepath(abs_path[0], wildcard, sizeof(abs_path[0]));
+    home_filepath(abs_path[1], wildcard, sizeof(abs_path[1]));
+    for(j=0; j<((strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2); j++)
+        n += for_each_file_ex(abs_path[j], 0, FA_DIREC | FA_LABEL, callback, param);
+
+    return n;
+}
+
+
+
 
 
 
@@ -580,11 +692,11 @@ cache_t *cachetree_insert(cache_t *node, const char *key, const char *value)
         cmp = strcmp(key, node->key);
 
         if(cmp < 0)
-            return (node->left = cachetree_insert(node->left, key, value));
+            node->left = cachetree_insert(node->left, key, value);
         else if(cmp > 0)
-            return (node->right = cachetree_insert(node->right, key, value));
-        else
-            return node;
+            node->right = cachetree_insert(node->right, key, value);
+
+        return node;
     }
     else {
         t = mallocx(sizeof *t);
@@ -596,5 +708,375 @@ cache_t *cachetree_insert(cache_t *node, const char *key, const char *value)
         return t;
     }
 }
-#endif
 
+
+
+/* ------ directory snapshot --------- */
+
+/* loads the snapshot, building it if necessary */
+void snapshot_init()
+{
+    int j;
+
+    absolute_filepath(snapshot[1].root, "", sizeof(snapshot[1].root));
+    home_filepath(snapshot[0].root, "", sizeof(snapshot[0].root));
+    snapshot_count = (strcmp(snapshot[0].root, snapshot[1].root) == 0) ? 1 : 2;
+    for(j=0; j<snapshot_count; j++) {
+        put_backslash(snapshot[j].root);
+        snapshot_clear(&snapshot[j]);
+    }
+
+    if(!snapshot_load()) {
+        for(j=0; j<snapshot_count; j++)
+            snapshot_build(&snapshot[j]);
+        snapshot_save();
+    }
+}
+
+/* releases the snapshot */
+void snapshot_release()
+{
+    int j;
+
+    for(j=0; j<snapshot_count; j++)
+        snapshot_clear(&snapshot[j]);
+
+    snapshot_count = 0;
+}
+
+/* removes all the entries of s */
+void snapshot_clear(snapshot_t *s)
+{
+    int i;
+
+    for(i=0; i<s->entry_count; i++) {
+        free(s->entry[i].key);
+        free(s->entry[i].path);
+    }
+
+    for(i=0; i<s->dir_count; i++)
+        free(s->dir[i].path);
+
+    if(s->entry)
+        free(s->entry);
+
+    if(s->dir)
+        free(s->dir);
+
+    s->entry = NULL;
+    s->entry_count = s->entry_capacity = 0;
+    s->dir = NULL;
+    s->dir_count = s->dir_capacity = 0;
+}
+
+/* searches the snapshot for relativefp, first in the home directory,
+ * then in the game directory. Returns TRUE on success */
+int snapshot_search(char *dest, const char *relativefp, size_t dest_size)
+{
+    int i, j;
+    const char *key;
+
+    if(snapshot_count == 0)
+        snapshot_init();
+
+    if(NULL == (key = snapshot_fold(relativefp)))
+        return FALSE;
+
+    for(j=0; j<snapshot_count; j++) {
+        i = snapshot_find(&snapshot[j], key);
+        if(i < snapshot[j].entry_count && strcmp(snapshot[j].entry[i].key, key) == 0) {
+            /* the file may have been deleted since the snapshot was taken */
+            if(snapshot_join(dest, dest_size, snapshot[j].root, snapshot[j].entry[i].path)) {
+                fix_filename_slashes(dest);
+                if(filepath_exists(dest) || directory_exists(dest))
+                    return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/* loads the snapshot from disk. Returns FALSE if it's missing or outdated */
+int snapshot_load()
+{
+    char line[2048], abs_path[2048], *p;
+    unsigned long mtime;
+    const char *filepath = snapshot_filepath(SNAPSHOT_FILE);
+    int attrib, j = -1;
+    FILE *fp;
+
+    if(filepath == NULL || NULL == (fp = fopen(filepath, "r")))
+        return FALSE;
+
+    if(fgets(line, sizeof(line), fp) == NULL || strncmp(line, SNAPSHOT_SIGNATURE, strlen(SNAPSHOT_SIGNATURE)) != 0) {
+        fclose(fp);
+        return FALSE;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        if(NULL != (p = strchr(line, '\n')))
+            *p = 0;
+
+        if(line[0] == 'R' && line[1] == '\t') {
+            /* root */
+            if(++j >= snapshot_count || strcmp(line+2, snapshot[j].root) != 0)
+                break;
+        }
+        else if(line[0] == 'D' && j >= 0 && sscanf(line, "D\t%lu\t", &mtime) == 1 && NULL != (p = strchr(line+2, '\t'))) {
+            /* directory */
+            if(!snapshot_join(abs_path, sizeof(abs_path), snapshot[j].root, p+1))
+                break;
+            fix_filename_slashes(abs_path);
+            if((uint32)mtime != (uint32)file_time(abs_path))
+                break;
+            snapshot_add_dir(&snapshot[j], p+1, (uint32)mtime);
+        }
+        else if(line[0] == 'F' && j >= 0 && sscanf(line, "F\t%d\t", &attrib) == 1 && NULL != (p = strchr(line+2, '\t')))
+            snapshot_add_entry(&snapshot[j], p+1, attrib);
+        else
+            break;
+    }
+
+    /* is it up-to-date? */
+    if(!feof(fp) || j != snapshot_count-1) {
+        fclose(fp);
+        for(j=0; j<snapshot_count; j++)
+            snapshot_clear(&snapshot[j]);
+        return FALSE;
+    }
+
+    fclose(fp);
+    for(j=0; j<snapshot_count; j++)
+        qsort(snapshot[j].entry, snapshot[j].entry_count, sizeof(snapshot_entry_t), snapshot_entry_cmp);
+
+    return TRUE;
+}
+
+/* saves the snapshot to disk */
+void snapshot_save()
+{
+    int i, j;
+    const char *filepath = snapshot_filepath(SNAPSHOT_FILE);
+    FILE *fp = filepath ? fopen(filepath, "w") : NULL;
+
+    if(fp != NULL) {
+        fprintf(fp, "%s\n", SNAPSHOT_SIGNATURE);
+        for(j=0; j<snapshot_count; j++) {
+            fprintf(fp, "R\t%s\n", snapshot[j].root);
+            for(i=0; i<snapshot[j].dir_count; i++)
+                fprintf(fp, "D\t%lu\t%s\n", (unsigned long)snapshot[j].dir[i].mtime, snapshot[j].dir[i].path);
+            for(i=0; i<snapshot[j].entry_count; i++)
+                fprintf(fp, "F\t%d\t%s\n", snapshot[j].entry[i].attrib, snapshot[j].entry[i].path);
+        }
+        fclose(fp);
+    }
+}
+
+/* walks the data directories of s->root */
+void snapshot_build(snapshot_t *s)
+{
+    int i;
+    char abs_path[1024];
+
+    snapshot_add_dir(s, "", (uint32)file_time(s->root));
+    for(i=0; snapshot_dirs[i] != NULL; i++) {
+        if(snapshot_join(abs_path, sizeof(abs_path), s->root, snapshot_dirs[i]) && directory_exists(abs_path)) {
+            snapshot_add_entry(s, snapshot_dirs[i], FA_DIREC);
+            snapshot_scan(s, snapshot_dirs[i]);
+        }
+    }
+
+    qsort(s->entry, s->entry_count, sizeof(snapshot_entry_t), snapshot_entry_cmp);
+}
+
+/* adds the contents of a directory to the snapshot (recursively) */
+void snapshot_scan(snapshot_t *s, const char *relative_dir)
+{
+    char abs_path[1024], path[1024];
+    struct al_ffblk info;
+
+    /* paths that don't fit aren't listed: they're searched the slow way */
+    if(!snapshot_join(abs_path, sizeof(abs_path) - 2, s->root, relative_dir))
+        return;
+    snapshot_add_dir(s, relative_dir, (uint32)file_time(abs_path));
+
+    strcat(abs_path, "/*");
+    fix_filename_slashes(abs_path);
+    if(al_findfirst(abs_path, &info, FA_ALL) == 0) {
+        do {
+            if(strcmp(info.name, ".") == 0 || strcmp(info.name, "..") == 0 || strchr(info.name, '\n') != NULL)
+                continue;
+
+            if(strlen(relative_dir) + 1 + strlen(info.name) >= sizeof(path))
+                continue;
+            sprintf(path, "%s/%s", relative_dir, info.name);
+            snapshot_add_entry(s, path, (info.attrib & FA_DIREC) ? FA_DIREC : 0);
+            if(info.attrib & FA_DIREC)
+                snapshot_scan(s, path);
+        }
+        while(al_findnext(&info) == 0);
+        al_findclose(&info);
+    }
+}
+
+/* adds an entry to the snapshot (not sorted) */
+void snapshot_add_entry(snapshot_t *s, const char *path, int attrib)
+{
+    if(s->entry_count >= s->entry_capacity) {
+        s->entry_capacity = max(256, 2 * s->entry_capacity);
+        s->entry = reallocx(s->entry, s->entry_capacity * sizeof(snapshot_entry_t));
+    }
+
+    s->entry[s->entry_count].path = str_dup(path);
+    s->entry[s->entry_count].key = str_dup(snapshot_fold(path) ? snapshot_fold(path) : path);
+    s->entry[s->entry_count].attrib = attrib;
+    s->entry_count++;
+}
+
+/* adds a directory (and its modification time) to the snapshot */
+void snapshot_add_dir(snapshot_t *s, const char *path, uint32 mtime)
+{
+    if(s->dir_count >= s->dir_capacity) {
+        s->dir_capacity = max(32, 2 * s->dir_capacity);
+        s->dir = reallocx(s->dir, s->dir_capacity * sizeof(snapshot_dir_t));
+    }
+
+    s->dir[s->dir_count].path = str_dup(path);
+    s->dir[s->dir_count].mtime = mtime;
+    s->dir_count++;
+}
+
+/* binary search: returns the index of the first entry whose
+ * key is not less than the given key */
+int snapshot_find(const snapshot_t *s, const char *key)
+{
+    int mid, low = 0, high = s->entry_count;
+
+    while(low < high) {
+        mid = (low + high) / 2;
+        if(strcmp(s->entry[mid].key, key) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+int snapshot_entry_cmp(const void *a, const void *b)
+{
+    return strcmp(((const snapshot_entry_t*)a)->key, ((const snapshot_entry_t*)b)->key);
+}
+
+/* case-folds a relative filepath. Returns a static char*, or NULL if
+ * the filepath isn't stored in the snapshot */
+const char* snapshot_fold(const char *relativefp)
+{
+    static char buf[1024];
+    char *p;
+    int i;
+
+    /* "./levels/a.lev" is the same as "levels/a.lev" */
+    while(relativefp[0] == '.' && (relativefp[1] == '/' || relativefp[1] == '\\'))
+        relativefp += 2;
+
+    if(!is_relative_filename(relativefp) || strstr(relativefp, "..") != NULL || strlen(relativefp) >= sizeof(buf))
+        return NULL;
+
+    for(p=buf; *relativefp; relativefp++)
+        *(p++) = (*relativefp == '\\') ? '/' : tolower((unsigned char)*relativefp);
+    *p = 0;
+
+    /* is this a data directory? */
+    for(i=0; snapshot_dirs[i] != NULL; i++) {
+        size_t len = strlen(snapshot_dirs[i]);
+        if(strncmp(buf, snapshot_dirs[i], len) == 0 && (buf[len] == '/' || buf[len] == '\0'))
+            return buf;
+    }
+
+    return NULL;
+}
+
+/* absolute filepath of something in the home directory. Returns
+ * a static char*, or NULL if it doesn't fit */
+const char* snapshot_filepath(const char *filepath)
+{
+    static char buf[1024];
+
+    if(!snapshot_join(buf, sizeof(buf), snapshot[0].root, filepath))
+        return NULL;
+
+    fix_filename_slashes(buf);
+    return buf;
+}
+
+/* dest = root + path. Returns FALSE (and leaves dest
+ * unchanged) if the result doesn't fit in dest_size */
+int snapshot_join(char *dest, size_t dest_size, const char *root, const char *path)
+{
+    size_t len = strlen(root);
+
+    if(len + strlen(path) >= dest_size)
+        return FALSE;
+
+    strcpy(dest, root);
+    strcpy(dest + len, path);
+    return TRUE;
+}
+
+/* lists a file that is about to be created (and its parent
+ * directories) in the snapshot, if it's a data file */
+void snapshot_add_file(const char *abs_path)
+{
+    char path[1024], *p;
+    const char *key;
+    snapshot_t *s = NULL;
+    int i, j;
+
+    for(j=0; j<snapshot_count && s == NULL; j++) {
+        if(strncmp(abs_path, snapshot[j].root, strlen(snapshot[j].root)) == 0)
+            s = &snapshot[j];
+    }
+
+    if(s == NULL)
+        return;
+
+    str_cpy(path, abs_path + strlen(s->root), sizeof(path));
+    for(p=path; *p; p++) {
+        if(*p == '\\')
+            *p = '/';
+    }
+
+    /* the parent directories first: "levels", "levels/mine", then "levels/mine/a.lev" */
+    for(p=strchr(path, '/'); ; p=strchr(p+1, '/')) {
+        if(p != NULL)
+            *p = 0;
+
+        if(NULL != (key = snapshot_fold(path))) {
+            i = snapshot_find(s, key);
+            if(!(i < s->entry_count && strcmp(s->entry[i].key, key) == 0)) {
+                snapshot_add_entry(s, path, (p != NULL) ? FA_DIREC : 0);
+                qsort(s->entry, s->entry_count, sizeof(snapshot_entry_t), snapshot_entry_cmp);
+            }
+        }
+
+        if(p == NULL)
+            break;
+        *p = '/';
+    }
+}
+
+/* does str match the pattern? ('*' and '?' are supported; case insensitive) */
+int wildcard_match(const char *pattern, const char *str)
+{
+    if(*pattern == '\0')
+        return (*str == '\0');
+    else if(*pattern == '*')
+        return wildcard_match(pattern+1, str) || (*str != '\0' && wildcard_match(pattern, str+1));
+    else if(*str != '\0' && (*pattern == '?' || tolower((unsigned char)*pattern) == tolower((unsigned char)*str)))
+        return wildcard_match(pattern+1, str+1);
+    else
+        return FALSE;
+}
+#endif
@@ -35,9 +35,10 @@ int filepath_exists(const char *filepath);
 int directory_exists(const char *dirpath);
 void absolute_filepath(char *dest, const char *relativefp, size_t dest_size);
 void home_filepath(char *dest, const char *relativefp, size_t dest_size);
-void resource_filepath(char *dest, const char *relativefp, size_t dest_size, int resfp_mode);
+void resource_filepath(char *dest, const char *relativefp, size_t dest_size, int resfp_mode); /* main thread only */
 void create_process(const char *path, int argc, char *argv[]);
 char* basename(const char *path);
+int for_each_resource(const char *wildcard, int (*callback)(const char *filename, int attrib, void *param), void *param);
 
 
 #endif
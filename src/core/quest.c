@@ -28,7 +28,9 @@
 #include "logfile.h"
 #include "quest.h"
 #include "osspec.h"
+#include "metaindex.h"
 #include "nanoparser/nanoparser.h"
+#include "scriptcache.h"
 
 
 
@@ -40,6 +42,8 @@
 /* private functions */
 static image_t *load_quest_image(const char *file);
 static int traverse_quest(const parsetree_statement_t* stmt, void *quest);
+static quest_t *create_quest(const char *abs_path);
+static void set_quest_string(char **field, const char *value);
 
 
 
@@ -50,23 +54,13 @@ static int traverse_quest(const parsetree_statement_t* stmt, void *quest);
  */
 quest_t *load_quest(const char *abs_path)
 {
-    quest_t *q = mallocx(sizeof *q);
+    quest_t *q = create_quest(abs_path);
     parsetree_program_t *prog;
 
     logfile_message("load_quest('%s')", abs_path);
 
-    /* default values */
-    q->file = str_dup(abs_path);
-    q->name = str_dup("null");
-    q->author = str_dup("null");
-    q->version = str_dup("null");
-    q->description = str_dup("null");
-    q->image = NULL;
-    q->level_count = 0;
-    q->show_ending = FALSE;
-
     /* reading the quest */
-    prog = nanoparser_construct_tree(abs_path);
+    prog = scriptcache_construct_tree(abs_path);
     nanoparser_traverse_program_ex(prog, (void*)q, traverse_quest);
     prog = nanoparser_deconstruct_tree(prog);
 
@@ -74,6 +68,14 @@ quest_t *load_quest(const char *abs_path)
     if(q->image == NULL)
         q->image = load_quest_image(NULL);
 
+    /* updating the metadata index */
+    metaindex_set(abs_path, "name", q->name);
+    metaindex_set(abs_path, "author", q->author);
+    metaindex_set(abs_path, "version", q->version);
+    metaindex_set(abs_path, "description", q->description);
+    metaindex_set(abs_path, "image", q->image_file ? q->image_file : "");
+    metaindex_set(abs_path, "show_ending", q->show_ending ? "TRUE" : "FALSE");
+
     /* success! */
     logfile_message("load_quest() ok!");
     return q;
@@ -81,6 +83,61 @@ quest_t *load_quest(const char *abs_path)
 
 
 
+/*
+ * load_quest_info()
+ * Loads the meta data of a quest (name, author, etc.), but not
+ * its levels. The thumbnail is loaded by quest_thumbnail()
+ */
+quest_t *load_quest_info(const char *abs_path)
+{
+    quest_t *q;
+    const char *val;
+
+    /* not in the index? */
+    if(!metaindex_lookup(abs_path)) {
+        int i;
+
+        q = load_quest(abs_path);
+        for(i=0; i<q->level_count; i++)
+            free(q->level_path[i]);
+        q->level_count = 0;
+
+        return q;
+    }
+
+    /* reading the index */
+    q = create_quest(abs_path);
+    if(NULL != (val = metaindex_get(abs_path, "name")))
+        set_quest_string(&(q->name), val);
+    if(NULL != (val = metaindex_get(abs_path, "author")))
+        set_quest_string(&(q->author), val);
+    if(NULL != (val = metaindex_get(abs_path, "version")))
+        set_quest_string(&(q->version), val);
+    if(NULL != (val = metaindex_get(abs_path, "description")))
+        set_quest_string(&(q->description), val);
+    if(NULL != (val = metaindex_get(abs_path, "image")) && *val)
+        q->image_file = str_dup(val);
+    if(NULL != (val = metaindex_get(abs_path, "show_ending")))
+        q->show_ending = atob(val);
+
+    return q;
+}
+
+
+
+/*
+ * quest_thumbnail()
+ * Returns the thumbnail of the quest, loading it if necessary
+ */
+image_t *quest_thumbnail(quest_t *qst)
+{
+    if(qst->image == NULL)
+        qst->image = load_quest_image(qst->image_file);
+
+    return qst->image;
+}
+
+
 
 /*
  * unload_quest()
@@ -99,7 +156,12 @@ quest_t *unload_quest(quest_t *qst)
     for(i=0; i<qst->level_count; i++)
         free(qst->level_path[i]);
 
-    image_destroy(qst->image);
+    if(qst->image_file)
+        free(qst->image_file);
+
+    if(qst->image)
+        image_destroy(qst->image);
+
     free(qst);
     return NULL;
 }
@@ -109,6 +171,31 @@ quest_t *unload_quest(quest_t *qst)
 
 /* private functions */
 
+/* creates a quest with default values */
+quest_t *create_quest(const char *abs_path)
+{
+    quest_t *q = mallocx(sizeof *q);
+
+    q->file = str_dup(abs_path);
+    q->name = str_dup("null");
+    q->author = str_dup("null");
+    q->version = str_dup("null");
+    q->description = str_dup("null");
+    q->image = NULL;
+    q->image_file = NULL;
+    q->level_count = 0;
+    q->show_ending = FALSE;
+
+    return q;
+}
+
+/* replaces a string field of the quest */
+void set_quest_string(char **field, const char *value)
+{
+    free(*field);
+    *field = str_dup(value);
+}
+
 /* returns the quest image */
 image_t *load_quest_image(const char *file)
 {
@@ -160,7 +247,9 @@ int traverse_quest(const parsetree_statement_t* stmt, void *quest)
     else if(str_icmp(id, "image") == 0) {
         nanoparser_expect_string(p, "Quest loader: quest image is expected");
         if(q->image) image_destroy(q->image);
-        q->image = load_quest_image(nanoparser_get_string(p));
+        if(q->image_file) free(q->image_file);
+        q->image_file = str_dup(nanoparser_get_string(p));
+        q->image = load_quest_image(q->image_file);
     }
     else if(str_icmp(id, "show_ending") == 0) {
         nanoparser_expect_string(p, "Quest loader: show_ending boolean value is expected");
@@ -42,7 +42,8 @@ struct quest_t {
     char *author; /* author */
     char *version; /* version string */
     char *description; /* description */
-    struct image_t *image; /* thumbnail */
+    struct image_t *image; /* thumbnail (see quest_thumbnail()) */
+    char *image_file; /* relative path of the thumbnail, or NULL */
     int show_ending; /* if true, shows the ending scene when this quest gets over */
 
     /* quest data */
@@ -51,6 +52,8 @@ struct quest_t {
 };
 
 quest_t *load_quest(const char *abs_path);
+quest_t *load_quest_info(const char *abs_path); /* meta data only, no levels. Fast (uses the metadata index) */
 quest_t *unload_quest(quest_t *qst);
+struct image_t *quest_thumbnail(quest_t *qst); /* loads the thumbnail on demand */
 
 #endif
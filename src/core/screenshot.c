@@ -18,16 +18,90 @@
  */
 
 #include <allegro.h>
+#include <png.h>
 #include <stdio.h>
 #include "screenshot.h"
+#include "global.h"
 #include "osspec.h"
 #include "logfile.h"
 #include "video.h"
 #include "input.h"
+#include "image.h"
+#include "thread.h"
+#include "util.h"
+#include "stringutil.h"
+
+/*
+   The backbuffer is copied into a buffer of a small pool,
+   and a background thread encodes it. If every buffer is
+   busy, the capture is skipped: memory stays bounded and the
+   game never waits for the disk.
+
+   Allegro isn't thread-safe, so the encoder doesn't call it:
+   the main thread describes the pixel format of every copy
+   (color masks, palette), and the encoder reads the raw rows
+   and writes the PNG files with libpng.
+
+   Recording mode (F11) streams every SCREENSHOT_RECORD_EVERY-th
+   frame to screenshots/rNNN.raw. The file starts with a text
+   line "OSREC <width> <height> <bytes per pixel> <every>", then
+   every frame is its number (4 bytes, little-endian) followed
+   by its pixels, row by row, in the native format of the
+   backbuffer. If the size of the backbuffer changes, the
+   recording goes on in a new file, with its own header.
+*/
 
 /* private data */
+#define SCREENSHOT_BUFFERS          6 /* pooled copies of the backbuffer */
+#define SCREENSHOT_MAXJOBS          16
+#define SCREENSHOT_RECORD_EVERY     2 /* record one frame out of N */
+
+typedef enum { JOB_SCREENSHOT, JOB_RECORD_START, JOB_RECORD_FRAME, JOB_RECORD_STOP, JOB_QUIT } jobtype_t;
+
+typedef struct {
+    int depth; /* 8, 15, 16, 24 or 32 */
+    uint32 mask[3]; /* red, green and blue (depth > 8) */
+    uint8 palette[256][3]; /* depth == 8 */
+} pixelformat_t;
+
+typedef struct {
+    jobtype_t type;
+    int buffer; /* index of the pooled buffer (or -1) */
+    uint32 frame;
+    char file[64]; /* relative path of the file to be written (or "") */
+    char abs_path[1024]; /* resolved by the main thread */
+} screenshotjob_t;
+
 static input_t *in;
-static char *next_available_filename();
+static thread_t *encoder;
+static mutex_t *mutex; /* guards everything below */
+static event_t *wakeup;
+static image_t *buffer[SCREENSHOT_BUFFERS];
+static pixelformat_t format[SCREENSHOT_BUFFERS]; /* filled by the main thread */
+static int buffer_busy[SCREENSHOT_BUFFERS];
+static screenshotjob_t job[SCREENSHOT_MAXJOBS];
+static int job_first, job_count;
+static char saved_file[SCREENSHOT_MAXJOBS][64]; /* screenshots done, to be announced */
+static int saved_count;
+static int next_screenshot, next_record; /* main thread */
+
+/* recording */
+static int recording;
+static uint32 record_frame;
+static int record_dropped; /* main thread */
+static int record_written; /* encoder thread */
+static int record_w, record_h; /* main thread: size of the frames of the current file */
+
+static int grab_backbuffer();
+static int push_job(jobtype_t type, int buffer_index, uint32 frame, const char *file);
+static void release_buffer(int buffer_index);
+static int start_recording();
+static void encoder_routine(void *arg);
+static int next_available_filename(char *dest, size_t dest_size, const char *fmt, int start);
+static void describe_format(pixelformat_t *fmt, int depth);
+static void write_frame(FILE *fp, const image_t *img, const pixelformat_t *fmt, uint32 frame);
+static void write_png(const char *abs_path, const image_t *img, const pixelformat_t *fmt);
+static uint32 read_pixel(const uint8 *row, int x, int bytes);
 
 /*
  * screenshot_init()
@@ -35,14 +109,28 @@ static char *next_available_filename();
  */
 void screenshot_init()
 {
-    int m[IB_MAX];
+    int m[IB_MAX], i;
 
     m[IB_UP] = m[IB_DOWN] = m[IB_LEFT] = m[IB_RIGHT] = KEY_A; /* whatever */
-    m[IB_FIRE3] = m[IB_FIRE4] = KEY_A;
+    m[IB_FIRE4] = KEY_A;
     m[IB_FIRE1] = KEY_EQUALS;
     m[IB_FIRE2] = KEY_PRTSCR;
+    m[IB_FIRE3] = KEY_F11; /* record */
 
     in = input_create_keyboard(m);
+
+    for(i=0; i<SCREENSHOT_BUFFERS; i++) {
+        buffer[i] = NULL;
+        buffer_busy[i] = FALSE;
+    }
+    job_first = job_count = 0;
+    saved_count = 0;
+    next_screenshot = next_record = 0;
+    recording = FALSE;
+
+    mutex = mutex_create();
+    wakeup = event_create();
+    encoder = thread_create(encoder_routine, NULL);
 }
 
 
@@ -53,13 +141,69 @@ void screenshot_init()
  */
 void screenshot_update()
 {
+    int i, b, n;
+    char file[64];
+    image_t *backbuffer;
+
     /* take the snapshot! (press the '=' key or the 'printscreen' key) */
     if(input_button_pressed(in, IB_FIRE1) || input_button_pressed(in, IB_FIRE2)) {
-        char *file = next_available_filename();
-        image_save(video_get_backbuffer(), file);
-        video_showmessage("'screenshots/%s' saved", basename(file));
-        logfile_message("New screenshot: %s", file);
+        b = grab_backbuffer();
+        n = next_available_filename(file, sizeof(file), "screenshots/s%03d.png", next_screenshot);
+        if(b >= 0 && push_job(JOB_SCREENSHOT, b, 0, file))
+            next_screenshot = n + 1;
+        else {
+            if(b >= 0)
+                release_buffer(b);
+            video_showmessage("Busy. Please try again.");
+        }
+    }
+
+    /* start/stop recording (F11) */
+    if(input_button_pressed(in, IB_FIRE3)) {
+        if(!recording) {
+            if(start_recording()) {
+                recording = TRUE;
+                record_frame = 0;
+                record_dropped = 0;
+                video_showmessage("Recording...");
+            }
+        }
+        else if(push_job(JOB_RECORD_STOP, -1, 0, NULL)) {
+            recording = FALSE;
+            video_showmessage("Recording stopped (%d frames dropped)", record_dropped);
+        }
+    }
+
+    /* record the current frame */
+    if(recording) {
+        backbuffer = video_get_backbuffer();
+        if(backbuffer->w != record_w || backbuffer->h != record_h) {
+            /* the header of the file wouldn't match the new size:
+             * the recording goes on in a new file */
+            if(push_job(JOB_RECORD_STOP, -1, 0, NULL) && !start_recording()) {
+                recording = FALSE;
+                video_showmessage("Recording stopped (%d frames dropped)", record_dropped);
+            }
+        }
+        else if(record_frame++ % SCREENSHOT_RECORD_EVERY == 0) {
+            /* if the encoder can't keep up, the frame is dropped */
+            b = grab_backbuffer();
+            if(b < 0 || !push_job(JOB_RECORD_FRAME, b, record_frame - 1, NULL)) {
+                if(b >= 0)
+                    release_buffer(b);
+                record_dropped++;
+            }
+        }
+    }
+
+    /* announce the screenshots that have been saved */
+    mutex_lock(mutex);
+    for(i=0; i<saved_count; i++) {
+        video_showmessage("'screenshots/%s' saved", basename(saved_file[i]));
+        logfile_message("New screenshot: %s", saved_file[i]);
     }
+    saved_count = 0;
+    mutex_unlock(mutex);
 }
 
 
@@ -69,6 +213,23 @@ void screenshot_update()
  */
 void screenshot_release()
 {
+    int i;
+
+    /* finish the pending jobs */
+    if(recording)
+        while(!push_job(JOB_RECORD_STOP, -1, 0, NULL))
+            thread_yield();
+    while(!push_job(JOB_QUIT, -1, 0, NULL))
+        thread_yield();
+    thread_join(encoder);
+
+    for(i=0; i<SCREENSHOT_BUFFERS; i++) {
+        if(buffer[i] != NULL)
+            image_destroy(buffer[i]);
+    }
+
+    wakeup = event_destroy(wakeup);
+    mutex = mutex_destroy(mutex);
     input_destroy(in);
 }
 
@@ -78,15 +239,296 @@ void screenshot_release()
 
 
 /* misc */
-char *next_available_filename()
+
+/* copies the backbuffer into a free buffer of the pool.
+ * Returns its index, or -1 if there's none. */
+int grab_backbuffer()
 {
-    static char f[64], abs_path[1024];
-    int i;
+    image_t *backbuffer = video_get_backbuffer();
+    int i, b = -1;
+
+    mutex_lock(mutex);
+    for(i=0; i<SCREENSHOT_BUFFERS && b < 0; i++) {
+        if(!buffer_busy[i]) {
+            buffer_busy[i] = TRUE;
+            b = i;
+        }
+    }
+    mutex_unlock(mutex);
+
+    if(b >= 0) {
+        /* the size of the backbuffer may change (level editor) */
+        if(buffer[b] != NULL && (buffer[b]->w != backbuffer->w || buffer[b]->h != backbuffer->h)) {
+            image_destroy(buffer[b]);
+            buffer[b] = NULL;
+        }
+        if(buffer[b] == NULL)
+            buffer[b] = image_create(backbuffer->w, backbuffer->h);
+
+        image_blit(backbuffer, buffer[b], 0, 0, 0, 0, backbuffer->w, backbuffer->h);
+        describe_format(&format[b], bitmap_color_depth(backbuffer->data));
+    }
+
+    return b;
+}
+
+/* adds a job to the queue of the encoder. Returns FALSE if it's full.
+ * The path of the file (if any) is resolved here, in the main thread */
+int push_job(jobtype_t type, int buffer_index, uint32 frame, const char *file)
+{
+    int ok = FALSE;
+    screenshotjob_t *j;
+    char abs_path[1024] = "";
+
+    if(file != NULL)
+        resource_filepath(abs_path, file, sizeof(abs_path), RESFP_WRITE);
+
+    mutex_lock(mutex);
+    if(job_count < SCREENSHOT_MAXJOBS) {
+        j = &job[(job_first + job_count++) % SCREENSHOT_MAXJOBS];
+        j->type = type;
+        j->buffer = buffer_index;
+        j->frame = frame;
+        str_cpy(j->file, file ? file : "", sizeof(j->file));
+        str_cpy(j->abs_path, abs_path, sizeof(j->abs_path));
+        ok = TRUE;
+    }
+    mutex_unlock(mutex);
+
+    if(ok)
+        event_signal(wakeup);
+
+    return ok;
+}
+
+/* gives a buffer back to the pool */
+void release_buffer(int buffer_index)
+{
+    mutex_lock(mutex);
+    buffer_busy[buffer_index] = FALSE;
+    mutex_unlock(mutex);
+}
+
+/* queues the start of a recording to a new file.
+ * Returns FALSE if the queue is full */
+int start_recording()
+{
+    char file[64];
+    image_t *backbuffer = video_get_backbuffer();
+    int n = next_available_filename(file, sizeof(file), "screenshots/r%03d.raw", next_record);
+
+    if(!push_job(JOB_RECORD_START, -1, 0, file))
+        return FALSE;
+
+    next_record = n + 1;
+    record_w = backbuffer->w;
+    record_h = backbuffer->h;
+    return TRUE;
+}
+
+/* the encoder thread */
+void encoder_routine(void *arg)
+{
+    int quit = FALSE, has_job;
+    screenshotjob_t j;
+    FILE *fp = NULL;
+    const image_t *img;
+    const pixelformat_t *fmt;
+
+    while(!quit) {
+        event_wait(wakeup);
+
+        for(;;) {
+            /* next job */
+            mutex_lock(mutex);
+            if((has_job = (job_count > 0))) {
+                j = job[job_first];
+                job_first = (job_first + 1) % SCREENSHOT_MAXJOBS;
+                job_count--;
+            }
+            mutex_unlock(mutex);
+
+            if(!has_job)
+                break;
+
+            img = (j.buffer >= 0) ? buffer[j.buffer] : NULL;
+            fmt = (j.buffer >= 0) ? &format[j.buffer] : NULL;
+            switch(j.type) {
+                case JOB_SCREENSHOT:
+                    write_png(j.abs_path, img, fmt);
+                    mutex_lock(mutex);
+                    if(saved_count < SCREENSHOT_MAXJOBS)
+                        str_cpy(saved_file[saved_count++], j.file, sizeof(saved_file[0]));
+                    mutex_unlock(mutex);
+                    break;
+
+                case JOB_RECORD_START:
+                    if(fp != NULL)
+                        fclose(fp);
+                    if(NULL != (fp = fopen(j.abs_path, "wb"))) {
+                        logfile_message("Recording to %s", j.file);
+                        record_written = 0;
+                    }
+                    else
+                        logfile_log(LOGLEVEL_WARNING, "Can't record to %s", j.file);
+                    break;
+
+                case JOB_RECORD_FRAME:
+                    if(fp != NULL) {
+                        write_frame(fp, img, fmt, j.frame);
+                        record_written++;
+                    }
+                    break;
+
+                case JOB_RECORD_STOP:
+                    if(fp != NULL) {
+                        fclose(fp);
+                        fp = NULL;
+                        logfile_message("Recording finished: %d frames", record_written);
+                    }
+                    break;
+
+                case JOB_QUIT:
+                    quit = TRUE;
+                    break;
+            }
+
+            if(j.buffer >= 0)
+                release_buffer(j.buffer);
+        }
+    }
 
-    for(i=0;;i++) {
-        sprintf(f, "screenshots/s%03d.png", i);
-        resource_filepath(abs_path, f, sizeof(abs_path), RESFP_WRITE);
+    if(fp != NULL)
+        fclose(fp);
+}
+
+/* finds the first file that doesn't exist, starting at
+ * index start. Returns its index */
+int next_available_filename(char *dest, size_t dest_size, const char *fmt, int start)
+{
+    char abs_path[1024];
+
+    for(;; start++) {
+        sprintf(dest, fmt, start);
+        resource_filepath(abs_path, dest, sizeof(abs_path), RESFP_WRITE);
         if(!filepath_exists(abs_path))
-            return abs_path;
+            break;
+    }
+
+    return start;
+}
+
+/* describes the pixel format of the backbuffer, so that
+ * the encoder doesn't need Allegro. Main thread only */
+void describe_format(pixelformat_t *fmt, int depth)
+{
+    PALETTE pal;
+    int i;
+
+    fmt->depth = depth;
+    if(depth == 8) {
+        /* the components of an Allegro palette range from 0 to 63 */
+        get_palette(pal);
+        for(i=0; i<256; i++) {
+            fmt->palette[i][0] = (pal[i].r * 255) / 63;
+            fmt->palette[i][1] = (pal[i].g * 255) / 63;
+            fmt->palette[i][2] = (pal[i].b * 255) / 63;
+        }
+    }
+    else {
+        fmt->mask[0] = makecol_depth(depth, 255, 0, 0);
+        fmt->mask[1] = makecol_depth(depth, 0, 255, 0);
+        fmt->mask[2] = makecol_depth(depth, 0, 0, 255);
     }
 }
+
+/* reads a pixel of a row in the native format (little-endian) */
+uint32 read_pixel(const uint8 *row, int x, int bytes)
+{
+    const uint8 *p = row + x * bytes;
+
+    switch(bytes) {
+        case 1: return p[0];
+        case 2: return *((const uint16*)p);
+        case 3: return p[0] | (p[1] << 8) | (p[2] << 16);
+        default: return *((const uint32*)p);
+    }
+}
+
+/* saves a copy of the backbuffer as a 24-bit PNG file */
+void write_png(const char *abs_path, const image_t *img, const pixelformat_t *fmt)
+{
+    int x, y, k, bytes = (fmt->depth + 7) / 8;
+    uint32 c, mask, max;
+    int shift[3];
+    FILE *fp;
+    png_structp png;
+    png_infop info;
+    uint8 *row;
+
+    logfile_message("image_save(%p,%s)", img, abs_path);
+    if(NULL == (fp = fopen(abs_path, "wb"))) {
+        logfile_log(LOGLEVEL_WARNING, "Can't save %s", abs_path);
+        return;
+    }
+
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = png ? png_create_info_struct(png) : NULL;
+    row = mallocx(img->w * 3);
+    if(png == NULL || info == NULL || setjmp(png_jmpbuf(png))) {
+        logfile_log(LOGLEVEL_WARNING, "Can't encode %s", abs_path);
+        png_destroy_write_struct(&png, &info);
+        free(row);
+        fclose(fp);
+        return;
+    }
+
+    for(k=0; k<3 && fmt->depth > 8; k++) {
+        for(shift[k]=0; shift[k]<31 && !(fmt->mask[k] & (1 << shift[k])); shift[k]++);
+    }
+
+    png_init_io(png, fp);
+    png_set_IHDR(png, info, img->w, img->h, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for(y=0; y<img->h; y++) {
+        for(x=0; x<img->w; x++) {
+            c = read_pixel(img->data->line[y], x, bytes);
+            for(k=0; k<3; k++) {
+                if(fmt->depth == 8)
+                    row[x*3+k] = fmt->palette[c & 0xFF][k];
+                else {
+                    mask = fmt->mask[k] >> shift[k];
+                    max = mask ? mask : 1;
+                    row[x*3+k] = (((c >> shift[k]) & mask) * 255) / max;
+                }
+            }
+        }
+        png_write_row(png, row);
+    }
+
+    png_write_end(png, info);
+    png_destroy_write_struct(&png, &info);
+    free(row);
+    fclose(fp);
+}
+
+/* appends a frame to a recording */
+void write_frame(FILE *fp, const image_t *img, const pixelformat_t *fmt, uint32 frame)
+{
+    int y, bpp = (fmt->depth + 7) / 8;
+    unsigned char header[4];
+
+    /* file header */
+    if(ftell(fp) == 0)
+        fprintf(fp, "OSREC %d %d %d %d\n", img->w, img->h, bpp, SCREENSHOT_RECORD_EVERY);
+
+    header[0] = frame & 0xFF;
+    header[1] = (frame >> 8) & 0xFF;
+    header[2] = (frame >> 16) & 0xFF;
+    header[3] = (frame >> 24) & 0xFF;
+    fwrite(header, 1, 4, fp);
+
+    for(y=0; y<img->h; y++)
+        fwrite(img->data->line[y], bpp, img->w, fp);
+}
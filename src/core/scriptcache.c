@@ -0,0 +1,220 @@
+/*
+ * scriptcache.c - scripts parsed ahead of time
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include "scriptcache.h"
+#include "global.h"
+#include "util.h"
+#include "stringutil.h"
+#include "thread.h"
+#include "logfile.h"
+
+/* a parsed script */
+typedef struct cachedscript_t {
+    char *abs_path;
+    parsetree_program_t *tree;
+    struct cachedscript_t *next;
+} cachedscript_t;
+
+/* private stuff */
+static cachedscript_t *cache = NULL;
+static mutex_t *cache_mutex = NULL; /* protects the cache */
+static mutex_t *parser_mutex = NULL; /* nanoparser has global state */
+static cachedscript_t** find(const char *abs_path);
+
+
+
+/*
+ * scriptcache_init()
+ * Initializes the script cache
+ */
+void scriptcache_init()
+{
+    logfile_message("scriptcache_init()");
+    cache = NULL;
+    cache_mutex = mutex_create();
+    parser_mutex = mutex_create();
+}
+
+
+/*
+ * scriptcache_release()
+ * Releases the script cache
+ */
+void scriptcache_release()
+{
+    logfile_message("scriptcache_release()");
+    scriptcache_discard();
+    parser_mutex = mutex_destroy(parser_mutex);
+    cache_mutex = mutex_destroy(cache_mutex);
+}
+
+
+/*
+ * scriptcache_parse()
+ * Parses a script (unless it's been parsed already)
+ * and keeps its tree until someone takes it. This
+ * may be called from any thread.
+ */
+const parsetree_program_t* scriptcache_parse(const char *abs_path)
+{
+    cachedscript_t **p, *q;
+    parsetree_program_t *tree, *duplicate = NULL;
+
+    /* is it here? */
+    mutex_lock(cache_mutex);
+    if(*(p = find(abs_path)) != NULL) {
+        tree = (*p)->tree;
+        mutex_unlock(cache_mutex);
+        return tree;
+    }
+    mutex_unlock(cache_mutex);
+
+    /* parse it */
+    tree = scriptcache_construct_tree(abs_path);
+
+    /* keep it (unless another thread has parsed it meanwhile) */
+    mutex_lock(cache_mutex);
+    if(*(p = find(abs_path)) == NULL) {
+        q = mallocx(sizeof *q);
+        q->abs_path = str_dup(abs_path);
+        q->tree = tree;
+        q->next = cache;
+        cache = q;
+    }
+    else {
+        duplicate = tree;
+        tree = (*p)->tree;
+    }
+    mutex_unlock(cache_mutex);
+
+    if(duplicate != NULL) {
+        mutex_lock(parser_mutex);
+        nanoparser_deconstruct_tree(duplicate);
+        mutex_unlock(parser_mutex);
+    }
+
+    return tree;
+}
+
+
+/*
+ * scriptcache_take()
+ * Returns the tree of a script, parsing it now if it's
+ * not in the cache. The tree is removed from the cache:
+ * call nanoparser_deconstruct_tree() when you're done.
+ */
+parsetree_program_t* scriptcache_take(const char *abs_path)
+{
+    cachedscript_t **p, *q = NULL;
+    parsetree_program_t *tree;
+
+    mutex_lock(cache_mutex);
+    if(*(p = find(abs_path)) != NULL) {
+        q = *p;
+        *p = q->next;
+    }
+    mutex_unlock(cache_mutex);
+
+    if(q == NULL)
+        return scriptcache_construct_tree(abs_path);
+
+    logfile_message("scriptcache_take('%s'): parsed ahead of time", abs_path);
+    tree = q->tree;
+    free(q->abs_path);
+    free(q);
+    return tree;
+}
+
+
+/*
+ * scriptcache_contains()
+ * Has this script been parsed already?
+ */
+int scriptcache_contains(const char *abs_path)
+{
+    int found;
+
+    mutex_lock(cache_mutex);
+    found = (*find(abs_path) != NULL);
+    mutex_unlock(cache_mutex);
+
+    return found;
+}
+
+
+/*
+ * scriptcache_discard()
+ * Deconstructs the trees that haven't been taken
+ */
+void scriptcache_discard()
+{
+    cachedscript_t *p, *next;
+
+    mutex_lock(cache_mutex);
+    p = cache;
+    cache = NULL;
+    mutex_unlock(cache_mutex);
+
+    for(; p != NULL; p = next) {
+        next = p->next;
+        logfile_debug("scriptcache_discard(): '%s' wasn't used", p->abs_path);
+        mutex_lock(parser_mutex);
+        nanoparser_deconstruct_tree(p->tree);
+        mutex_unlock(parser_mutex);
+        free(p->abs_path);
+        free(p);
+    }
+}
+
+
+/*
+ * scriptcache_construct_tree()
+ * Parses a script, skipping the cache. nanoparser
+ * has global state: every script of the game must
+ * be parsed here, as workers may be parsing too
+ */
+parsetree_program_t* scriptcache_construct_tree(const char *filepath)
+{
+    parsetree_program_t *tree;
+
+    mutex_lock(parser_mutex);
+    tree = nanoparser_construct_tree(filepath);
+    mutex_unlock(parser_mutex);
+
+    return tree;
+}
+
+
+
+/* private stuff */
+
+/* finds a script in the cache. The cache must be locked.
+ * Returns a pointer to the link that points to it (or to NULL). */
+cachedscript_t** find(const char *abs_path)
+{
+    cachedscript_t **p;
+
+    for(p = &cache; *p != NULL; p = &((*p)->next)) {
+        if(str_icmp((*p)->abs_path, abs_path) == 0)
+            break;
+    }
+
+    return p;
+}
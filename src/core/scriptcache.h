@@ -0,0 +1,45 @@
+/*
+ * scriptcache.h - scripts parsed ahead of time
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SCRIPTCACHE_H
+#define _SCRIPTCACHE_H
+
+#include "nanoparser/nanoparser.h"
+
+/*
+   The parser isn't thread-safe: scriptcache_parse() lets
+   other threads parse scripts (one at a time) and keeps the
+   resulting trees until they're taken by the main thread.
+   scriptcache_take() is a drop-in replacement for
+   nanoparser_construct_tree(): it parses the file if it
+   isn't here. Use absolute paths (resource_filepath()).
+
+   Don't call nanoparser_construct_tree() directly: use
+   scriptcache_construct_tree() if you don't want the cache.
+*/
+
+void scriptcache_init();
+void scriptcache_release();
+const parsetree_program_t* scriptcache_parse(const char *abs_path); /* parses & keeps the tree (any thread) */
+parsetree_program_t* scriptcache_take(const char *abs_path); /* removes the tree from the cache: you'll deconstruct it */
+int scriptcache_contains(const char *abs_path); /* has this script been parsed already? */
+void scriptcache_discard(); /* deconstructs the trees that haven't been taken */
+parsetree_program_t* scriptcache_construct_tree(const char *filepath); /* nanoparser_construct_tree(), one thread at a time */
+
+#endif
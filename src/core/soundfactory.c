@@ -26,6 +26,7 @@
 #include "osspec.h"
 #include "hashtable.h"
 #include "nanoparser/nanoparser.h"
+#include "scriptcache.h"
 
 /* storage */
 typedef struct factorysound_t factorysound_t;
@@ -106,7 +107,7 @@ int traverse(const parsetree_statement_t *stmt)
             hashtable_factorysound_t_add(samples, sound_name, f);
         }
 
-        logfile_message("soundfactory: loaded sample '%s'", sound_name);
+        logfile_debug("soundfactory: loaded sample '%s'", sound_name);
     }
     else
         fatal_error("soundfactory: unknown identifier '%s' at the sound definition file. Valid keywords: 'sample'");
@@ -151,7 +152,7 @@ void load_samples_table()
     logfile_message("soundfactory: loading the samples table...");
     resource_filepath(abs_path, "config/samples.def", sizeof(abs_path), RESFP_READ);
 
-    s = nanoparser_construct_tree(abs_path);
+    s = scriptcache_construct_tree(abs_path);
     nanoparser_traverse_program(s, traverse);
     s = nanoparser_deconstruct_tree(s);
 }
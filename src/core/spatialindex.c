@@ -0,0 +1,283 @@
+/*
+ * spatialindex.c - spatial index for closest-entity queries
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "spatialindex.h"
+#include "global.h"
+#include "util.h"
+
+/* constants */
+#define SPATIALINDEX_TABLESIZE          31 /* prime number */
+#define SPATIALINDEX_INITIALCAPACITY    16
+
+/* an entry */
+typedef struct spatialentry_t {
+    float x, y;
+    void *data;
+} spatialentry_t;
+
+/* the entries of a given key */
+typedef struct spatialkey_t {
+    int key;
+    spatialentry_t *entry; /* entry[0 .. length-1] */
+    int length, capacity;
+    int sorted; /* is entry[] sorted by x? */
+    struct spatialkey_t *next;
+} spatialkey_t;
+
+/* spatial index */
+struct spatialindex_t {
+    spatialkey_t *table[SPATIALINDEX_TABLESIZE];
+};
+
+/* private methods */
+static spatialkey_t* find_key(spatialindex_t *index, int key);
+static int bucket(int key);
+static void sort_key(spatialkey_t *k);
+static int lower_bound(const spatialkey_t *k, float x);
+static int entry_cmp(const void *a, const void *b);
+
+
+
+/*
+ * spatialindex_create()
+ * Creates a new spatial index
+ */
+spatialindex_t* spatialindex_create()
+{
+    int i;
+    spatialindex_t *index = mallocx(sizeof *index);
+
+    for(i=0; i<SPATIALINDEX_TABLESIZE; i++)
+        index->table[i] = NULL;
+
+    return index;
+}
+
+
+/*
+ * spatialindex_destroy()
+ * Destroys a spatial index
+ */
+spatialindex_t* spatialindex_destroy(spatialindex_t *index)
+{
+    int i;
+    spatialkey_t *k, *next;
+
+    for(i=0; i<SPATIALINDEX_TABLESIZE; i++) {
+        for(k=index->table[i]; k; k=next) {
+            next = k->next;
+            free(k->entry);
+            free(k);
+        }
+    }
+
+    free(index);
+    return NULL;
+}
+
+
+/*
+ * spatialindex_clear()
+ * Removes every entry. The memory is kept, so that
+ * the index can be refilled without allocations.
+ */
+void spatialindex_clear(spatialindex_t *index)
+{
+    int i;
+    spatialkey_t *k;
+
+    for(i=0; i<SPATIALINDEX_TABLESIZE; i++) {
+        for(k=index->table[i]; k; k=k->next) {
+            k->length = 0;
+            k->sorted = TRUE;
+        }
+    }
+}
+
+
+/*
+ * spatialindex_insert()
+ * Adds an entry
+ */
+void spatialindex_insert(spatialindex_t *index, int key, v2d_t position, void *data)
+{
+    spatialkey_t *k = find_key(index, key);
+    spatialentry_t *e;
+
+    /* new key */
+    if(k == NULL) {
+        int b = bucket(key);
+        k = mallocx(sizeof *k);
+        k->key = key;
+        k->capacity = SPATIALINDEX_INITIALCAPACITY;
+        k->entry = mallocx(k->capacity * sizeof *(k->entry));
+        k->length = 0;
+        k->sorted = TRUE;
+        k->next = index->table[b];
+        index->table[b] = k;
+    }
+
+    /* need more space? */
+    if(k->length >= k->capacity) {
+        k->capacity *= 2;
+        k->entry = reallocx(k->entry, k->capacity * sizeof *(k->entry));
+    }
+
+    /* adding the entry */
+    e = &(k->entry[k->length++]);
+    e->x = position.x;
+    e->y = position.y;
+    e->data = data;
+
+    if(k->length > 1 && e->x < (e-1)->x)
+        k->sorted = FALSE;
+}
+
+
+/*
+ * spatialindex_nearest()
+ * Finds the closest entry of a given key relative to
+ * position. Returns NULL if there's no such entry.
+ */
+void* spatialindex_nearest(spatialindex_t *index, int key, v2d_t position, int (*accept)(void *data, void *param), void *param, float *distance)
+{
+    spatialkey_t *k = find_key(index, key);
+    spatialentry_t *e;
+    float best = INFINITY_FLT, dx, dy, d;
+    void *ret = NULL;
+    int lo, left, right;
+
+    if(k != NULL && k->length > 0) {
+        /* first entry such that entry.x >= position.x */
+        sort_key(k);
+        lo = lower_bound(k, position.x);
+
+        /* walk outwards, the nearest column first. best is a squared distance */
+        left = lo - 1;
+        right = lo;
+        while(left >= 0 || right < k->length) {
+            if(right >= k->length || (left >= 0 && position.x - k->entry[left].x < k->entry[right].x - position.x))
+                e = &(k->entry[left--]);
+            else
+                e = &(k->entry[right++]);
+
+            dx = e->x - position.x;
+            if(dx * dx >= best)
+                break; /* the remaining entries are even farther */
+
+            dy = e->y - position.y;
+            d = dx * dx + dy * dy;
+            if(d < best && (accept == NULL || accept(e->data, param))) {
+                best = d;
+                ret = e->data;
+            }
+        }
+    }
+
+    if(distance)
+        *distance = (ret != NULL) ? sqrt(best) : INFINITY_FLT;
+
+    return ret;
+}
+
+
+
+/*
+ * spatialindex_query()
+ * Calls callback(data, param) for each entry of a given key
+ * whose position is in the rectangle [x1,x2] x [y1,y2].
+ * Returns the number of such entries.
+ */
+int spatialindex_query(spatialindex_t *index, int key, float x1, float y1, float x2, float y2, void (*callback)(void *data, void *param), void *param)
+{
+    spatialkey_t *k = find_key(index, key);
+    spatialentry_t *e;
+    int i, count = 0;
+
+    if(k != NULL && k->length > 0) {
+        sort_key(k);
+        for(i=lower_bound(k, x1); i<k->length && k->entry[i].x <= x2; i++) {
+            e = &(k->entry[i]);
+            if(e->y >= y1 && e->y <= y2) {
+                callback(e->data, param);
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+
+
+/* private methods */
+
+/* finds the entries of a given key, or NULL if there's no such key */
+spatialkey_t* find_key(spatialindex_t *index, int key)
+{
+    spatialkey_t *k;
+
+    for(k=index->table[bucket(key)]; k; k=k->next) {
+        if(k->key == key)
+            return k;
+    }
+
+    return NULL;
+}
+
+/* hash function */
+int bucket(int key)
+{
+    return ((key % SPATIALINDEX_TABLESIZE) + SPATIALINDEX_TABLESIZE) % SPATIALINDEX_TABLESIZE;
+}
+
+/* sorts the entries of a key by x, if needed */
+void sort_key(spatialkey_t *k)
+{
+    if(!k->sorted) {
+        qsort(k->entry, k->length, sizeof *(k->entry), entry_cmp);
+        k->sorted = TRUE;
+    }
+}
+
+/* the first entry (of a sorted key) such that entry.x >= x */
+int lower_bound(const spatialkey_t *k, float x)
+{
+    int mid, lo = 0, hi = k->length;
+
+    while(lo < hi) {
+        mid = (lo + hi) / 2;
+        if(k->entry[mid].x < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* compares two entries by x */
+int entry_cmp(const void *a, const void *b)
+{
+    float xa = ((const spatialentry_t*)a)->x;
+    float xb = ((const spatialentry_t*)b)->x;
+    return (xa > xb) - (xa < xb);
+}
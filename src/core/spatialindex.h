@@ -0,0 +1,63 @@
+/*
+ * spatialindex.h - spatial index for closest-entity queries
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SPATIALINDEX_H
+#define _SPATIALINDEX_H
+
+#include "v2d.h"
+
+/*
+   A spatial index groups entities by an integer key
+   (e.g., the type of an item) and answers "which entity
+   of this key is the closest to a given point?"
+
+   Each key keeps its entries sorted by x. A query does a
+   binary search and walks left and right, stopping as
+   soon as the horizontal distance alone exceeds the best
+   distance found so far. Sorting is deferred until the
+   first query of a key, so inserting is cheap.
+
+   The entries of a key that lie in a rectangle can be
+   listed, too: only the ones whose x is in range are
+   visited.
+*/
+
+typedef struct spatialindex_t spatialindex_t;
+
+/* create & destroy */
+spatialindex_t* spatialindex_create();
+spatialindex_t* spatialindex_destroy(spatialindex_t *index);
+
+/* removes every entry (the memory is kept for reuse) */
+void spatialindex_clear(spatialindex_t *index);
+
+/* adds an entry */
+void spatialindex_insert(spatialindex_t *index, int key, v2d_t position, void *data);
+
+/* finds the closest entry of a given key relative to position,
+ * or NULL if there's no such entry. If accept != NULL, only
+ * the entries for which accept(data, param) is true are considered.
+ * If distance != NULL, it receives the distance to the entry found */
+void* spatialindex_nearest(spatialindex_t *index, int key, v2d_t position, int (*accept)(void *data, void *param), void *param, float *distance);
+
+/* calls callback(data, param) for each entry of a given key whose position
+ * is in the rectangle [x1,x2] x [y1,y2]. Returns the number of such entries */
+int spatialindex_query(spatialindex_t *index, int key, float x1, float y1, float x2, float y2, void (*callback)(void *data, void *param), void *param);
+
+#endif
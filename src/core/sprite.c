@@ -26,6 +26,7 @@
 #include "osspec.h"
 #include "hashtable.h"
 #include "nanoparser/nanoparser.h"
+#include "scriptcache.h"
 
 /* private stuff ;) */
 #define SPRITE_MAX_ANIM         1000 /* sprites can have at most SPRITE_MAX_ANIM animations (numbered 0 .. SPRITE_MAX_ANIM-1) */
@@ -58,20 +59,12 @@ void sprite_init()
 {
     parsetree_program_t *prog = NULL;
     const char *path = "sprites/*.spr";
-    char abs_path[2][1024];
-    int j, max_paths, deny_flags = FA_DIREC | FA_LABEL;
 
     logfile_message("Loading sprites...");
     sprites = hashtable_spriteinfo_t_create(spriteinfo_destroy);
 
-    /* official and $HOME files */
-    absolute_filepath(abs_path[0], path, sizeof(abs_path[0]));
-    home_filepath(abs_path[1], path, sizeof(abs_path[1]));
-    max_paths = (strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2;
-
-    /* Reading the parse tree */
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dirfill, (void*)(&prog));
+    /* Reading the parse tree (official and $HOME files) */
+    for_each_resource(path, dirfill, (void*)(&prog));
 
     if(prog == NULL)
         fatal_error("FATAL ERROR: no sprites have been found. Please reinstall the game.");
@@ -200,7 +193,7 @@ int dirfill(const char *filename, int attrib, void *param)
 {
     parsetree_program_t** p = (parsetree_program_t**)param;
 
-    *p = nanoparser_append_program(*p, nanoparser_construct_tree(filename));
+    *p = nanoparser_append_program(*p, scriptcache_construct_tree(filename));
 
     return 0;
 }
@@ -268,7 +261,7 @@ animation_t* animation_delete(animation_t *anim)
  */
 void register_sprite(const char *sprite_name, spriteinfo_t *spr)
 {
-    logfile_message("Registering sprite '%s'...", sprite_name);
+    logfile_debug("Registering sprite '%s'...", sprite_name);
     hashtable_spriteinfo_t_add(sprites, sprite_name, spr);
 }
 
@@ -390,14 +383,14 @@ int traverse(const parsetree_statement_t *stmt)
         nanoparser_expect_program(p2, "Must provide sprite attributes");
 
         s = nanoparser_get_string(p1);
-        logfile_message("Loading sprite '%s'", s);
+        logfile_debug("Loading sprite '%s'", s);
 
         if(NULL == hashtable_spriteinfo_t_find(sprites, s))
             register_sprite(s, spriteinfo_create(nanoparser_get_program(p2)));
         else
             fatal_error("Can't redefine sprite '%s'", s);
 
-        logfile_message("Loaded sprite '%s'", s);
+        logfile_debug("Loaded sprite '%s'", s);
     }
     else
         fatal_error("Can't load sprites. Unknown identifier '%s'", identifier);
@@ -0,0 +1,524 @@
+/*
+ * thread.c - portable threads & a worker pool
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include "thread.h"
+#include "global.h"
+#include "util.h"
+#include "logfile.h"
+
+#ifndef __WIN32__
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#else
+
+#include <winalleg.h>
+#include <process.h>
+
+#endif
+
+
+
+/* threads */
+struct thread_t {
+#ifndef __WIN32__
+    pthread_t handle;
+#else
+    HANDLE handle;
+#endif
+    void (*routine)(void*);
+    void *arg;
+};
+
+/* mutexes */
+struct mutex_t {
+#ifndef __WIN32__
+    pthread_mutex_t handle;
+#else
+    CRITICAL_SECTION handle;
+#endif
+};
+
+/* events */
+struct event_t {
+#ifndef __WIN32__
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int signaled;
+#else
+    HANDLE handle;
+#endif
+};
+
+/* worker pool */
+#define THREAD_MAXWORKERS           8
+
+typedef struct {
+    thread_t *thread;
+    event_t *start, *done;
+} worker_t;
+
+static worker_t worker[THREAD_MAXWORKERS];
+static int worker_count = 1;
+static int quit_pool;
+static int pool_busy;
+static void (*job_routine)(int,void*);
+static void *job_param;
+static int job_count;
+static volatile int next_job;
+
+static void worker_routine(void *arg);
+static void run_jobs();
+#ifndef __WIN32__
+static void* thread_entry(void *arg);
+#else
+static unsigned __stdcall thread_entry(void *arg);
+#endif
+
+
+
+/* worker pool */
+
+/*
+ * thread_init()
+ * Creates the worker pool: one worker per processor,
+ * the calling thread included
+ */
+void thread_init()
+{
+    int i;
+
+    logfile_message("thread_init()");
+
+    worker_count = clip(thread_cpu_count(), 1, THREAD_MAXWORKERS);
+    quit_pool = FALSE;
+    pool_busy = FALSE;
+
+    for(i=1; i<worker_count; i++) {
+        worker[i].start = event_create();
+        worker[i].done = event_create();
+        worker[i].thread = thread_create(worker_routine, &worker[i]);
+    }
+
+    logfile_message("%d worker thread(s)", worker_count);
+}
+
+
+/*
+ * thread_release()
+ * Stops the worker pool
+ */
+void thread_release()
+{
+    int i;
+
+    logfile_message("thread_release()");
+
+    quit_pool = TRUE;
+    for(i=1; i<worker_count; i++) {
+        event_signal(worker[i].start);
+        thread_join(worker[i].thread);
+        worker[i].start = event_destroy(worker[i].start);
+        worker[i].done = event_destroy(worker[i].done);
+    }
+
+    worker_count = 1;
+}
+
+
+/*
+ * thread_worker_count()
+ * Number of threads that run the jobs of
+ * thread_parallel_for(), including the caller
+ */
+int thread_worker_count()
+{
+    return worker_count;
+}
+
+
+/*
+ * thread_parallel_for()
+ * Runs job(i, param) for 0 <= i < count, in parallel.
+ * Returns when all the jobs are done.
+ */
+void thread_parallel_for(int count, void (*job)(int index, void *param), void *param)
+{
+    int i;
+
+    /* no need to wake up the pool */
+    if(worker_count <= 1 || count <= 1 || pool_busy) {
+        for(i=0; i<count; i++)
+            job(i, param);
+        return;
+    }
+
+    pool_busy = TRUE;
+    job_routine = job;
+    job_param = param;
+    job_count = count;
+    atomic_set(&next_job, 0);
+
+    for(i=1; i<worker_count; i++)
+        event_signal(worker[i].start);
+
+    run_jobs();
+
+    for(i=1; i<worker_count; i++)
+        event_wait(worker[i].done);
+
+    pool_busy = FALSE;
+}
+
+
+
+/* threads */
+
+/*
+ * thread_create()
+ * Spawns a new thread running routine(arg)
+ */
+thread_t* thread_create(void (*routine)(void *arg), void *arg)
+{
+    thread_t *thread = mallocx(sizeof *thread);
+
+    thread->routine = routine;
+    thread->arg = arg;
+
+#ifndef __WIN32__
+    if(pthread_create(&(thread->handle), NULL, thread_entry, thread) != 0)
+        fatal_error("thread_create(): couldn't create a thread");
+#else
+    thread->handle = (HANDLE)_beginthreadex(NULL, 0, thread_entry, thread, 0, NULL);
+    if(thread->handle == 0)
+        fatal_error("thread_create(): couldn't create a thread");
+#endif
+
+    return thread;
+}
+
+
+/*
+ * thread_join()
+ * Waits for a thread to finish and destroys it
+ */
+void thread_join(thread_t *thread)
+{
+#ifndef __WIN32__
+    pthread_join(thread->handle, NULL);
+#else
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#endif
+
+    free(thread);
+}
+
+
+/*
+ * thread_cpu_count()
+ * Number of processors available
+ */
+int thread_cpu_count()
+{
+#ifndef __WIN32__
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#else
+    return 1;
+#endif
+#else
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max(1, (int)info.dwNumberOfProcessors);
+#endif
+}
+
+
+/*
+ * thread_yield()
+ * Lets other threads run
+ */
+void thread_yield()
+{
+#ifndef __WIN32__
+    sched_yield();
+#else
+    Sleep(0);
+#endif
+}
+
+
+
+/* mutexes */
+
+/*
+ * mutex_create()
+ * Creates a new mutex
+ */
+mutex_t* mutex_create()
+{
+    mutex_t *mutex = mallocx(sizeof *mutex);
+
+#ifndef __WIN32__
+    pthread_mutex_init(&(mutex->handle), NULL);
+#else
+    InitializeCriticalSection(&(mutex->handle));
+#endif
+
+    return mutex;
+}
+
+
+/*
+ * mutex_destroy()
+ * Destroys a mutex
+ */
+mutex_t* mutex_destroy(mutex_t *mutex)
+{
+#ifndef __WIN32__
+    pthread_mutex_destroy(&(mutex->handle));
+#else
+    DeleteCriticalSection(&(mutex->handle));
+#endif
+
+    free(mutex);
+    return NULL;
+}
+
+
+/*
+ * mutex_lock()
+ * Locks a mutex
+ */
+void mutex_lock(mutex_t *mutex)
+{
+#ifndef __WIN32__
+    pthread_mutex_lock(&(mutex->handle));
+#else
+    EnterCriticalSection(&(mutex->handle));
+#endif
+}
+
+
+/*
+ * mutex_unlock()
+ * Unlocks a mutex
+ */
+void mutex_unlock(mutex_t *mutex)
+{
+#ifndef __WIN32__
+    pthread_mutex_unlock(&(mutex->handle));
+#else
+    LeaveCriticalSection(&(mutex->handle));
+#endif
+}
+
+
+
+/* events */
+
+/*
+ * event_create()
+ * Creates a new (non-signaled) event
+ */
+event_t* event_create()
+{
+    event_t *event = mallocx(sizeof *event);
+
+#ifndef __WIN32__
+    pthread_mutex_init(&(event->mutex), NULL);
+    pthread_cond_init(&(event->cond), NULL);
+    event->signaled = FALSE;
+#else
+    event->handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if(event->handle == NULL)
+        fatal_error("event_create(): couldn't create an event");
+#endif
+
+    return event;
+}
+
+
+/*
+ * event_destroy()
+ * Destroys an event
+ */
+event_t* event_destroy(event_t *event)
+{
+#ifndef __WIN32__
+    pthread_cond_destroy(&(event->cond));
+    pthread_mutex_destroy(&(event->mutex));
+#else
+    CloseHandle(event->handle);
+#endif
+
+    free(event);
+    return NULL;
+}
+
+
+/*
+ * event_signal()
+ * Signals an event. One waiting thread is released
+ * (or the next one to wait, if nobody is waiting).
+ */
+void event_signal(event_t *event)
+{
+#ifndef __WIN32__
+    pthread_mutex_lock(&(event->mutex));
+    event->signaled = TRUE;
+    pthread_cond_signal(&(event->cond));
+    pthread_mutex_unlock(&(event->mutex));
+#else
+    SetEvent(event->handle);
+#endif
+}
+
+
+/*
+ * event_wait()
+ * Waits until the event is signaled, then resets it
+ */
+void event_wait(event_t *event)
+{
+#ifndef __WIN32__
+    pthread_mutex_lock(&(event->mutex));
+    while(!event->signaled)
+        pthread_cond_wait(&(event->cond), &(event->mutex));
+    event->signaled = FALSE;
+    pthread_mutex_unlock(&(event->mutex));
+#else
+    WaitForSingleObject(event->handle, INFINITE);
+#endif
+}
+
+
+
+/* atomic operations */
+
+/*
+ * atomic_get()
+ * Reads *ptr
+ */
+int atomic_get(volatile int *ptr)
+{
+#ifndef __WIN32__
+    int value = *ptr;
+    __sync_synchronize();
+    return value;
+#else
+    return (int)InterlockedCompareExchange((volatile LONG*)ptr, 0, 0);
+#endif
+}
+
+
+/*
+ * atomic_set()
+ * Writes *ptr
+ */
+void atomic_set(volatile int *ptr, int value)
+{
+#ifndef __WIN32__
+    __sync_synchronize();
+    *ptr = value;
+    __sync_synchronize();
+#else
+    InterlockedExchange((volatile LONG*)ptr, (LONG)value);
+#endif
+}
+
+
+/*
+ * atomic_cas()
+ * Compare-and-swap: if *ptr == old_value, then
+ * *ptr = new_value and TRUE is returned
+ */
+int atomic_cas(volatile int *ptr, int old_value, int new_value)
+{
+#ifndef __WIN32__
+    return __sync_bool_compare_and_swap(ptr, old_value, new_value) ? TRUE : FALSE;
+#else
+    return (InterlockedCompareExchange((volatile LONG*)ptr, (LONG)new_value, (LONG)old_value) == (LONG)old_value) ? TRUE : FALSE;
+#endif
+}
+
+
+
+/*
+ * atomic_add()
+ * *ptr += value. Returns the old value of *ptr
+ */
+int atomic_add(volatile int *ptr, int value)
+{
+#ifndef __WIN32__
+    return __sync_fetch_and_add(ptr, value);
+#else
+    return (int)InterlockedExchangeAdd((volatile LONG*)ptr, (LONG)value);
+#endif
+}
+
+
+
+/* private stuff */
+
+/* the main loop of a worker */
+void worker_routine(void *arg)
+{
+    worker_t *w = (worker_t*)arg;
+
+    for(;;) {
+        event_wait(w->start);
+        if(quit_pool)
+            break;
+
+        run_jobs();
+        event_signal(w->done);
+    }
+}
+
+/* runs jobs until there are no more left */
+void run_jobs()
+{
+    int i;
+
+    while((i = atomic_add(&next_job, 1)) < job_count)
+        job_routine(i, job_param);
+}
+
+/* starts a thread */
+#ifndef __WIN32__
+void* thread_entry(void *arg)
+{
+    thread_t *thread = (thread_t*)arg;
+    thread->routine(thread->arg);
+    return NULL;
+}
+#else
+unsigned __stdcall thread_entry(void *arg)
+{
+    thread_t *thread = (thread_t*)arg;
+    thread->routine(thread->arg);
+    return 0;
+}
+#endif
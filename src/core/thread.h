@@ -0,0 +1,70 @@
+/*
+ * thread.h - portable threads & a worker pool
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _THREAD_H
+#define _THREAD_H
+
+/*
+   A thin layer over pthreads (or the Win32 API), plus a
+   pool of worker threads created at startup.
+
+   thread_parallel_for() runs job(0), job(1), ..., job(count-1)
+   on the pool and on the calling thread, and returns when
+   all of them are done. A job must not touch what another
+   job of the same call writes to. Calling it from inside a
+   job is allowed: the inner loop simply runs serially.
+   The threads grab the jobs in order, one at a time, so a
+   thread that finishes early takes over the remaining ones.
+*/
+
+typedef struct thread_t thread_t;
+typedef struct mutex_t mutex_t;
+typedef struct event_t event_t; /* auto-reset event */
+
+/* worker pool */
+void thread_init(); /* creates the pool */
+void thread_release(); /* stops the pool */
+int thread_worker_count(); /* number of threads that run jobs, including the caller */
+void thread_parallel_for(int count, void (*job)(int index, void *param), void *param);
+
+/* threads */
+thread_t* thread_create(void (*routine)(void *arg), void *arg);
+void thread_join(thread_t *thread); /* waits for the thread and destroys it */
+int thread_cpu_count(); /* number of processors */
+void thread_yield(); /* gives up the processor for a while */
+
+/* mutexes */
+mutex_t* mutex_create();
+mutex_t* mutex_destroy(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+/* events */
+event_t* event_create();
+event_t* event_destroy(event_t *event);
+void event_signal(event_t *event); /* wakes up one waiting thread */
+void event_wait(event_t *event);
+
+/* atomic operations (they're also full memory barriers) */
+int atomic_get(volatile int *ptr);
+void atomic_set(volatile int *ptr, int value);
+int atomic_cas(volatile int *ptr, int old_value, int new_value); /* if *ptr == old_value, sets *ptr = new_value and returns TRUE */
+int atomic_add(volatile int *ptr, int value); /* *ptr += value; returns the old value */
+
+#endif
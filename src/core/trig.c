@@ -0,0 +1,130 @@
+/*
+ * trig.c - trigonometry tables
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include "trig.h"
+#include "global.h"
+
+/* how far from a whole number of degrees an angle may be */
+#define TRIG_TOLERANCE          1e-3
+
+/* tables */
+static float sin_table[360];
+static float tan_table[360];
+
+/* private methods */
+static int wrap(int degrees);
+
+
+
+/*
+ * trig_init()
+ * Builds the tables
+ */
+void trig_init()
+{
+    int i;
+
+    for(i=0; i<360; i++) {
+        sin_table[i] = sin(i * PI / 180.0);
+        tan_table[i] = tan(i * PI / 180.0);
+    }
+}
+
+
+/*
+ * trig_sin()
+ * Sine of an angle given in degrees
+ */
+float trig_sin(int degrees)
+{
+    return sin_table[wrap(degrees)];
+}
+
+
+/*
+ * trig_cos()
+ * Cosine of an angle given in degrees
+ */
+float trig_cos(int degrees)
+{
+    return sin_table[wrap(degrees + 90)];
+}
+
+
+/*
+ * trig_tan()
+ * Tangent of an angle given in degrees
+ */
+float trig_tan(int degrees)
+{
+    return tan_table[wrap(degrees)];
+}
+
+
+/*
+ * trig_degrees()
+ * If radians is a whole number of degrees, returns
+ * it in [0,360). Otherwise, returns -1.
+ */
+int trig_degrees(float radians)
+{
+    double d = radians * (180.0 / PI);
+    double r = floor(d + 0.5);
+
+    if(fabs(d - r) > TRIG_TOLERANCE || fabs(r) > 1e6)
+        return -1;
+
+    return wrap((int)r);
+}
+
+
+/*
+ * trig_rotate()
+ * Rotates a vector by an angle given in radians.
+ * The same as v2d_rotate(), but the tables are used
+ * if the angle is a whole number of degrees.
+ */
+v2d_t trig_rotate(v2d_t v, float radians)
+{
+    int deg = trig_degrees(radians);
+    float s, c;
+    v2d_t w;
+
+    if(deg < 0)
+        return v2d_rotate(v, radians);
+
+    s = sin_table[deg];
+    c = sin_table[wrap(deg + 90)];
+    w.x = v.x*c - v.y*s;
+    w.y = v.y*c + v.x*s;
+
+    return w;
+}
+
+
+
+/* private methods */
+
+/* maps degrees to [0,360) */
+int wrap(int degrees)
+{
+    degrees %= 360;
+    return (degrees < 0) ? degrees + 360 : degrees;
+}
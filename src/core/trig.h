@@ -1,5 +1,5 @@
 /*
- * elliptical_trajectory.h - This decorator makes the object follow an elliptical trajectory
+ * trig.h - trigonometry tables
  * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
  *
  * This program is free software; you can redistribute it and/or modify
@@ -17,22 +17,26 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifndef _OD_ELLIPTICALTRAJECTORY_H
-#define _OD_ELLIPTICALTRAJECTORY_H
+#ifndef _TRIG_H
+#define _TRIG_H
 
-#include "base/objectdecorator.h"
+#include "v2d.h"
 
 /*
-Please provide:
+   The angles of the bricks (and therefore the angles of
+   the actors walking on them) are whole numbers of degrees.
+   These tables give their sines & cosines without calling
+   the math library. Other angles fall back to it.
 
-    amplitude_x     (in pixels)
-    amplitude_y     (in pixels)
-    angularspeed_x  (in revolutions per second)
-    angularspeed_y  (in revolutions per second)
-    initialphase_x  (in degrees)
-    initialphase_y  (in degrees)
+   The tables are read-only after trig_init(), so they can
+   be used by different threads at the same time.
 */
-objectmachine_t* objectdecorator_ellipticaltrajectory_new(objectmachine_t *decorated_machine, float amplitude_x, float amplitude_y, float angularspeed_x, float angularspeed_y, float initialphase_x, float initialphase_y);
 
-#endif
+void trig_init(); /* builds the tables */
+float trig_sin(int degrees);
+float trig_cos(int degrees);
+float trig_tan(int degrees);
+int trig_degrees(float radians); /* radians as a whole number of degrees in [0,360), or -1 if it's not one */
+v2d_t trig_rotate(v2d_t v, float radians); /* same as v2d_rotate(), but uses the tables whenever possible */
 
+#endif
@@ -177,7 +177,8 @@ void fatal_error(const char *fmt, ...)
     vsprintf(buf, fmt, args);
     va_end(args);
 
-    logfile_message(buf);
+    logfile_log(LOGLEVEL_ERROR, "%s", buf);
+    logfile_flush();
     set_gfx_mode(GFX_TEXT, 0, 0, 0, 0);
     allegro_message("%s", buf);
     exit(1);
@@ -29,6 +29,8 @@
 #include "timer.h"
 #include "logfile.h"
 #include "util.h"
+#include "thread.h"
+#include "drawlist.h"
 
 
 
@@ -54,6 +56,22 @@ static void losangle(image_t *img, int x, int y, int r, int col);
 static void draw_to_screen(image_t *img);
 static void setup_color_depth(int bpp);
 
+/* band-parallel scaling: the window surfaces are split
+ * into horizontal bands, one per worker thread */
+typedef struct {
+    image_t *src, *dest, **band;
+    v2d_t scale;
+    int filter;
+} scalejob_t;
+static int band_count;
+static image_t **window_band, **window_half_band;
+static image_t** create_bands(image_t *img);
+static image_t** destroy_bands(image_t **band);
+static int band_top(const image_t *img, int index);
+static void parallel_draw_scaled(image_t *src, image_t *dest, image_t **band, v2d_t scale);
+static void scaled_band(int index, void *param);
+static void filter_band(int index, void *param);
+
 /* Fade-in & fade-out */
 #define FADEFX_NONE            0
 #define FADEFX_IN              1
@@ -91,6 +109,9 @@ void video_init(const char *window_title, int resolution, int smooth, int fullsc
     /* video init */
     video_buffer = NULL;
     window_surface = window_surface_half = NULL;
+    window_band = window_half_band = NULL;
+    band_count = thread_worker_count();
+    drawlist_init();
     video_changemode(resolution, smooth, fullscreen);
 
     /* window properties */
@@ -157,6 +178,8 @@ void video_changemode(int resolution, int smooth, int fullscreen)
 
     /* creating the window surface... */
     logfile_message("creating the window surface...");
+    window_band = destroy_bands(window_band);
+    window_half_band = destroy_bands(window_half_band);
     if(window_surface != NULL)
         image_destroy(window_surface);
     window_surface = image_create((int)(video_get_window_size().x), (int)(video_get_window_size().y));
@@ -168,6 +191,9 @@ void video_changemode(int resolution, int smooth, int fullscreen)
     window_surface_half = image_create(window_surface->w/2, window_surface->h/2);
     image_clear(window_surface_half, image_rgb(0,0,0));
 
+    window_band = create_bands(window_surface);
+    window_half_band = create_bands(window_surface_half);
+
     /* setting up the window... */
     logfile_message("setting up the window...");
     mode = video_fullscreen ? GFX_AUTODETECT : GFX_AUTODETECT_WINDOWED;
@@ -366,12 +392,12 @@ void video_render()
             if(video_is_smooth() && tmp->w >= 2*VIDEO_SCREEN_W && tmp->h >= 2*VIDEO_SCREEN_H) {
                 image_t *half = window_surface_half;
                 v2d_t scale = v2d_new((float)half->w / (float)video_get_backbuffer()->w, (float)half->h / (float)video_get_backbuffer()->h);
-                image_draw_scaled(video_get_backbuffer(), half, 0, 0, scale, IF_NONE);
+                parallel_draw_scaled(video_get_backbuffer(), half, window_half_band, scale);
                 filter_blit(half, tmp, FILTER_2XSAI);
             }
             else {
                 v2d_t scale = v2d_new((float)tmp->w / (float)video_get_backbuffer()->w, (float)tmp->h / (float)video_get_backbuffer()->h);
-                image_draw_scaled(video_get_backbuffer(), tmp, 0, 0, scale, IF_NONE);
+                parallel_draw_scaled(video_get_backbuffer(), tmp, window_band, scale);
             }
 
             draw_to_screen(tmp);
@@ -396,6 +422,10 @@ void video_release()
 {
     logfile_message("video_release()");
 
+    drawlist_release();
+    window_band = destroy_bands(window_band);
+    window_half_band = destroy_bands(window_half_band);
+
     if(video_buffer != NULL)
         image_destroy(video_buffer);
 
@@ -501,26 +531,26 @@ int video_is_fps_visible()
 void filter_blit(image_t *src, image_t *dest, int filter)
 {
     int i, j, k=2;
+    scalejob_t job;
 
     if(src->data == NULL || dest->data == NULL)
         return;
 
-    switch(filter) {
-        case FILTER_2XSAI:
-            Super2xSaI(src->data, dest->data, 0, 0, 0, 0, src->w, src->h);
-            for(i=0; i<dest->h; i++) { /* image fix */
-                for(j=0; j<k; j++)
-                    putpixel(dest->data, j, i, getpixel(dest->data, k, i));
-            }
-            break;
-
-        case FILTER_SUPEREAGLE:
-            SuperEagle(src->data, dest->data, 0, 0, 0, 0, src->w, src->h);
-            for(i=0; i<dest->h; i++) { /* image fix */
-                for(j=0; j<k; j++)
-                    putpixel(dest->data, dest->w-1-j, i, getpixel(dest->data, dest->w-1-k, i));
-            }
-            break;
+    /* the rows are split among the worker threads. The
+     * defective columns are fixed along with each row. */
+    job.src = src;
+    job.dest = dest;
+    job.filter = filter;
+    thread_parallel_for(band_count, filter_band, &job);
+
+    /* rows left over by the filter, if any */
+    for(i=2*src->h; i<dest->h; i++) { /* image fix */
+        for(j=0; j<k; j++) {
+            if(filter == FILTER_2XSAI)
+                putpixel(dest->data, j, i, getpixel(dest->data, k, i));
+            else
+                putpixel(dest->data, dest->w-1-j, i, getpixel(dest->data, dest->w-1-k, i));
+        }
     }
 }
 
@@ -610,6 +640,82 @@ void losangle(image_t *img, int x, int y, int r, int col)
     polygon(img->data, 4, points, col);
 }
 
+/* splits img into bands (they share its pixels) */
+image_t** create_bands(image_t *img)
+{
+    int i;
+    image_t **band;
+
+    if(img->data == NULL)
+        return NULL;
+
+    band = mallocx(band_count * sizeof *band);
+    for(i=0; i<band_count; i++)
+        band[i] = image_create_shared(img, 0, band_top(img, i), img->w, band_top(img, i+1) - band_top(img, i));
+
+    return band;
+}
+
+/* destroys the bands created with create_bands() */
+image_t** destroy_bands(image_t **band)
+{
+    int i;
+
+    if(band != NULL) {
+        for(i=0; i<band_count; i++)
+            image_destroy(band[i]);
+        free(band);
+    }
+
+    return NULL;
+}
+
+/* the first row of a band */
+int band_top(const image_t *img, int index)
+{
+    return (index * img->h) / band_count;
+}
+
+/* image_draw_scaled(src, dest, 0, 0, scale, IF_NONE),
+ * one band of dest per worker thread */
+void parallel_draw_scaled(image_t *src, image_t *dest, image_t **band, v2d_t scale)
+{
+    scalejob_t job;
+
+    job.src = src;
+    job.dest = dest;
+    job.band = band;
+    job.scale = scale;
+
+    if(band != NULL && dest->h >= band_count && dest->data != NULL)
+        thread_parallel_for(band_count, scaled_band, &job);
+    else
+        image_draw_scaled(src, dest, 0, 0, scale, IF_NONE);
+}
+
+/* scales the source onto a band of the destination */
+void scaled_band(int index, void *param)
+{
+    scalejob_t *job = (scalejob_t*)param;
+    image_draw_scaled(job->src, job->band[index], 0, -band_top(job->dest, index), job->scale, IF_NONE);
+}
+
+/* applies a filter to a band of rows of the source */
+void filter_band(int index, void *param)
+{
+    scalejob_t *job = (scalejob_t*)param;
+
+    switch(job->filter) {
+        case FILTER_2XSAI:
+            Super2xSaI_rows(job->src->data, job->dest->data, band_top(job->src, index), band_top(job->src, index+1));
+            break;
+
+        case FILTER_SUPEREAGLE:
+            SuperEagle_rows(job->src->data, job->dest->data, band_top(job->src, index), band_top(job->src, index+1));
+            break;
+    }
+}
+
 /* setups the color depth */
 void setup_color_depth(int bpp)
 {
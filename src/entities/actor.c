@@ -27,24 +27,39 @@
 #include "../core/logfile.h"
 #include "../core/video.h"
 #include "../core/timer.h"
+#include "../core/thread.h"
+#include "../core/trig.h"
 
 
 /* constants */
 #define MAGIC_DIFF              -2  /* platform movement & collision detectors magic */
 #define SIDE_CORNERS_HEIGHT     0.5 /* height of the left/right sensors */
+#define SENSORCACHE_MAXPREPEND  32  /* see sensor_cache_lookup() */
+#define ACTORPOOL_MINSIZE       16  /* destroyed actors kept for reuse */
+#define ACTORPOOL_MAXSIZE       512
 
 
 /* private data */
-static int floor_priority = TRUE; /* default behavior: priority(floor) > priority(wall) */
-static int slope_priority = TRUE; /* default behavior: priority(slope) > priority(floor) */
-static brick_t* brick_at(brick_list_t *list, float rect[4]);
-static int is_leftwall_disabled = FALSE;
-static int is_rightwall_disabled = FALSE;
-static int is_floor_disabled = FALSE;
-static int is_ceiling_disabled = FALSE;
+static const sensorcontext_t default_context = {
+    TRUE, /* default behavior: priority(floor) > priority(wall) */
+    TRUE, /* default behavior: priority(slope) > priority(floor) */
+    FALSE, FALSE, FALSE, FALSE /* nothing is disabled */
+};
+static brick_t* brick_at(brick_list_t *list, float rect[4], const sensorcontext_t *ctx);
+static int sensor_frame = 1; /* the memoized sensor results are valid during a single frame */
+static volatile int sensor_hits = 0, sensor_misses = 0; /* current frame (the sensors may run in parallel) */
+static int sensor_last_hits = 0, sensor_last_misses = 0; /* last frame */
+static actor_t* actor_pool[ACTORPOOL_MAXSIZE]; /* free actors */
+static int actor_pool_length = 0, actor_pool_capacity = ACTORPOOL_MINSIZE;
+static int actor_pool_reuses = 0, actor_pool_allocations = 0;
 
 /* private functions */
 static void calculate_rotated_boundingbox(const actor_t *act, v2d_t spot[4]);
+static actorsensorcache_t* sensor_cache_lookup(actor_t *act, float sqrsize, brick_list_t *brick_list, const v2d_t spot[8]);
+static int prepended_bricks_are_away(const actorsensorcache_t *c, brick_list_t *brick_list);
+static int brick_sweepable(const brick_t *brk, v2d_t delta, const sensorcontext_t *ctx);
+static float brick_sweep(const brick_t *brk, const float rect[4], v2d_t delta);
+static int brick_shape(const brick_t *brk, v2d_t vertex[5], v2d_t *normal);
 
 
 /* actor functions */
@@ -57,7 +72,18 @@ static void calculate_rotated_boundingbox(const actor_t *act, v2d_t spot[4]);
  */
 actor_t* actor_create()
 {
-    actor_t *act = mallocx(sizeof *act);
+    actor_t *act;
+    int i;
+
+    /* recycle a destroyed actor, if possible */
+    if(actor_pool_length > 0) {
+        act = actor_pool[--actor_pool_length];
+        actor_pool_reuses++;
+    }
+    else {
+        act = mallocx(sizeof *act);
+        actor_pool_allocations++;
+    }
 
     act->spawn_point = v2d_new(0,0);
     act->position = act->spawn_point;
@@ -82,6 +108,11 @@ actor_t* actor_create()
     act->carry_offset = v2d_new(0,0);
     act->carrying = NULL;
 
+    for(i=0; i<ACTOR_SENSORCACHE_SIZE; i++)
+        act->sensor_cache[i].frame = 0;
+    act->sensor_cache_next = 0;
+    act->sensor_context = default_context;
+
     return act;
 }
 
@@ -94,7 +125,57 @@ void actor_destroy(actor_t *act)
 {
     if(act->input)
         input_destroy(act->input);
-    free(act);
+
+    if(actor_pool_length < actor_pool_capacity)
+        actor_pool[actor_pool_length++] = act;
+    else
+        free(act);
+}
+
+
+/*
+ * actor_pool_reserve()
+ * Keeps up to count destroyed actors for reuse
+ * (count is clipped to a sane range). They are
+ * allocated right away.
+ */
+void actor_pool_reserve(int count)
+{
+    actor_pool_capacity = clip(count, ACTORPOOL_MINSIZE, ACTORPOOL_MAXSIZE);
+
+    while(actor_pool_length > actor_pool_capacity)
+        free(actor_pool[--actor_pool_length]);
+    while(actor_pool_length < actor_pool_capacity)
+        actor_pool[actor_pool_length++] = mallocx(sizeof(actor_t));
+}
+
+
+/*
+ * actor_pool_release()
+ * Frees the actors kept for reuse and
+ * resets the statistics
+ */
+void actor_pool_release()
+{
+    while(actor_pool_length > 0)
+        free(actor_pool[--actor_pool_length]);
+
+    actor_pool_capacity = ACTORPOOL_MINSIZE;
+    actor_pool_reuses = actor_pool_allocations = 0;
+}
+
+
+/*
+ * actor_pool_stats()
+ * Actors created from recycled memory (reuses)
+ * and from fresh memory (allocations) since the
+ * last release, and how many are waiting (free)
+ */
+void actor_pool_stats(int *reuses, int *allocations, int *free_count)
+{
+    *reuses = actor_pool_reuses;
+    *allocations = actor_pool_allocations;
+    *free_count = actor_pool_length;
 }
 
 
@@ -185,14 +266,14 @@ void actor_render_corners(const actor_t *act, float sqrsize, float diff, v2d_t c
     int frame_height = actor_image(act)->h;
 
     v2d_t feet      = v2d_subtract(act->position, offset);
-    v2d_t vup        = v2d_add ( feet , v2d_rotate( v2d_new(0, -frame_height+diff), -act->angle) );
-    v2d_t vdown      = v2d_add ( feet , v2d_rotate( v2d_new(0, -diff), -act->angle) ); 
-    v2d_t vleft      = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
-    v2d_t vright     = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
-    v2d_t vupleft    = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -frame_height+diff), -act->angle) );
-    v2d_t vupright   = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -frame_height+diff), -act->angle) );
-    v2d_t vdownleft  = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -diff), -act->angle) );
-    v2d_t vdownright = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -diff), -act->angle) );
+    v2d_t vup        = v2d_add ( feet , trig_rotate( v2d_new(0, -frame_height+diff), -act->angle) );
+    v2d_t vdown      = v2d_add ( feet , trig_rotate( v2d_new(0, -diff), -act->angle) ); 
+    v2d_t vleft      = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
+    v2d_t vright     = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
+    v2d_t vupleft    = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -frame_height+diff), -act->angle) );
+    v2d_t vupright   = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -frame_height+diff), -act->angle) );
+    v2d_t vdownleft  = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -diff), -act->angle) );
+    v2d_t vdownright = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -diff), -act->angle) );
 
     float cd_up[4] = { vup.x-sqrsize , vup.y-sqrsize , vup.x+sqrsize , vup.y+sqrsize };
     float cd_down[4] = { vdown.x-sqrsize , vdown.y-sqrsize , vdown.x+sqrsize , vdown.y+sqrsize };
@@ -225,14 +306,14 @@ int actor_collision(const actor_t *a, const actor_t *b)
 {
     int j, right = 0;
     v2d_t corner[2][4];
-    corner[0][0] = v2d_subtract(a->position, v2d_rotate(a->hot_spot, -a->angle)); /* a's topleft */
-    corner[0][1] = v2d_add( corner[0][0] , v2d_rotate(v2d_new(actor_image(a)->w, 0), -a->angle) ); /* a's topright */
-    corner[0][2] = v2d_add( corner[0][0] , v2d_rotate(v2d_new(actor_image(a)->w, actor_image(a)->h), -a->angle) ); /* a's bottomright */
-    corner[0][3] = v2d_add( corner[0][0] , v2d_rotate(v2d_new(0, actor_image(a)->h), -a->angle) ); /* a's bottomleft */
-    corner[1][0] = v2d_subtract(b->position, v2d_rotate(b->hot_spot, -b->angle)); /* b's topleft */
-    corner[1][1] = v2d_add( corner[1][0] , v2d_rotate(v2d_new(actor_image(b)->w, 0), -b->angle) ); /* b's topright */
-    corner[1][2] = v2d_add( corner[1][0] , v2d_rotate(v2d_new(actor_image(b)->w, actor_image(b)->h), -b->angle) ); /* b's bottomright */
-    corner[1][3] = v2d_add( corner[1][0] , v2d_rotate(v2d_new(0, actor_image(b)->h), -b->angle) ); /* b's bottomleft */
+    corner[0][0] = v2d_subtract(a->position, trig_rotate(a->hot_spot, -a->angle)); /* a's topleft */
+    corner[0][1] = v2d_add( corner[0][0] , trig_rotate(v2d_new(actor_image(a)->w, 0), -a->angle) ); /* a's topright */
+    corner[0][2] = v2d_add( corner[0][0] , trig_rotate(v2d_new(actor_image(a)->w, actor_image(a)->h), -a->angle) ); /* a's bottomright */
+    corner[0][3] = v2d_add( corner[0][0] , trig_rotate(v2d_new(0, actor_image(a)->h), -a->angle) ); /* a's bottomleft */
+    corner[1][0] = v2d_subtract(b->position, trig_rotate(b->hot_spot, -b->angle)); /* b's topleft */
+    corner[1][1] = v2d_add( corner[1][0] , trig_rotate(v2d_new(actor_image(b)->w, 0), -b->angle) ); /* b's topright */
+    corner[1][2] = v2d_add( corner[1][0] , trig_rotate(v2d_new(actor_image(b)->w, actor_image(b)->h), -b->angle) ); /* b's bottomright */
+    corner[1][3] = v2d_add( corner[1][0] , trig_rotate(v2d_new(0, actor_image(b)->h), -b->angle) ); /* b's bottomleft */
     right += fabs(a->angle)<EPSILON||fabs(a->angle-PI/2)<EPSILON||fabs(a->angle-PI)<EPSILON||fabs(a->angle-3*PI/2)<EPSILON;
     right += fabs(b->angle)<EPSILON||fabs(b->angle-PI/2)<EPSILON||fabs(b->angle-PI)<EPSILON||fabs(b->angle-3*PI/2)<EPSILON;
 
@@ -332,8 +413,8 @@ int actor_pixelperfect_collision(const actor_t *a, const actor_t *b)
             size_b.x = max(b_spot[0].x, max(b_spot[1].x, max(b_spot[2].x, b_spot[3].x))) - pos_b.x;
             size_b.y = max(b_spot[0].y, max(b_spot[1].y, max(b_spot[2].y, b_spot[3].y))) - pos_b.y;
 
-            ac = v2d_add(v2d_subtract(a_spot[0], pos_a), v2d_rotate(a->hot_spot, -a->angle));
-            bc = v2d_add(v2d_subtract(b_spot[0], pos_b), v2d_rotate(b->hot_spot, -b->angle));
+            ac = v2d_add(v2d_subtract(a_spot[0], pos_a), trig_rotate(a->hot_spot, -a->angle));
+            bc = v2d_add(v2d_subtract(b_spot[0], pos_b), trig_rotate(b->hot_spot, -b->angle));
 
             image_a = image_create(size_a.x, size_a.y);
             image_b = image_create(size_b.x, size_b.y);
@@ -355,14 +436,31 @@ int actor_pixelperfect_collision(const actor_t *a, const actor_t *b)
 }
 
 
+/*
+ * actor_bounding_box()
+ * The axis-aligned box containing the (rotated)
+ * image of the actor. box[4] = x1, y1, x2, y2
+ */
+void actor_bounding_box(const actor_t *act, float box[4])
+{
+    v2d_t spot[4]; /* rotated spots */
+
+    calculate_rotated_boundingbox(act, spot);
+    box[0] = min(spot[0].x, min(spot[1].x, min(spot[2].x, spot[3].x)));
+    box[1] = min(spot[0].y, min(spot[1].y, min(spot[2].y, spot[3].y)));
+    box[2] = max(spot[0].x, max(spot[1].x, max(spot[2].x, spot[3].x)));
+    box[3] = max(spot[0].y, max(spot[1].y, max(spot[2].y, spot[3].y)));
+}
+
+
 /*
  * actor_brick_collision()
  * Actor collided with a brick?
  */
 int actor_brick_collision(actor_t *act, brick_t *brk)
 {
-    v2d_t topleft = v2d_subtract(act->position, v2d_rotate(act->hot_spot, act->angle));
-    v2d_t bottomright = v2d_add( topleft , v2d_rotate(v2d_new(actor_image(act)->w, actor_image(act)->h), act->angle) );
+    v2d_t topleft = v2d_subtract(act->position, trig_rotate(act->hot_spot, act->angle));
+    v2d_t bottomright = v2d_add( topleft , trig_rotate(v2d_new(actor_image(act)->w, actor_image(act)->h), act->angle) );
     float a[4] = { topleft.x , topleft.y , bottomright.x , bottomright.y };
     float b[4] = { (float)brk->x , (float)brk->y , (float)(brk->x+brk->brick_ref->image->w) , (float)(brk->y+brk->brick_ref->image->h) };
 
@@ -464,14 +562,14 @@ void actor_corners(actor_t *act, float sqrsize, float diff, brick_list_t *brick_
     int frame_height = actor_image(act)->h;
 
     v2d_t feet      = act->position;
-    v2d_t vup        = v2d_add ( feet , v2d_rotate( v2d_new(0, -frame_height+diff), -act->angle) );
-    v2d_t vdown      = v2d_add ( feet , v2d_rotate( v2d_new(0, -diff), -act->angle) ); 
-    v2d_t vleft      = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
-    v2d_t vright     = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
-    v2d_t vupleft    = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -frame_height+diff), -act->angle) );
-    v2d_t vupright   = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -frame_height+diff), -act->angle) );
-    v2d_t vdownleft  = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width/2+diff, -diff), -act->angle) );
-    v2d_t vdownright = v2d_add ( feet , v2d_rotate( v2d_new(frame_width/2-diff, -diff), -act->angle) );
+    v2d_t vup        = v2d_add ( feet , trig_rotate( v2d_new(0, -frame_height+diff), -act->angle) );
+    v2d_t vdown      = v2d_add ( feet , trig_rotate( v2d_new(0, -diff), -act->angle) ); 
+    v2d_t vleft      = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
+    v2d_t vright     = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -frame_height*SIDE_CORNERS_HEIGHT), -act->angle) );
+    v2d_t vupleft    = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -frame_height+diff), -act->angle) );
+    v2d_t vupright   = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -frame_height+diff), -act->angle) );
+    v2d_t vdownleft  = v2d_add ( feet , trig_rotate( v2d_new(-frame_width/2+diff, -diff), -act->angle) );
+    v2d_t vdownright = v2d_add ( feet , trig_rotate( v2d_new(frame_width/2-diff, -diff), -act->angle) );
 
     actor_corners_ex(act, sqrsize, vup, vupright, vright, vdownright, vdown, vdownleft, vleft, vupleft, brick_list, up, upright, right, downright, down, downleft, left, upleft);
 }
@@ -483,26 +581,144 @@ void actor_corners(actor_t *act, float sqrsize, float diff, brick_list_t *brick_
  * actor_corners_ex()
  * Like actor_corners(), but this procedure allows to specify the
  * collision detectors positions'
+ *
+ * The results are memoized per actor until the next call to
+ * actor_corners_new_frame(): the decorators of an object usually
+ * query the very same sensors, one after the other. Moving the
+ * actor (or changing the sensors) is a cache miss.
  */
 void actor_corners_ex(actor_t *act, float sqrsize, v2d_t vup, v2d_t vupright, v2d_t vright, v2d_t vdownright, v2d_t vdown, v2d_t vdownleft, v2d_t vleft, v2d_t vupleft, brick_list_t *brick_list, brick_t **up, brick_t **upright, brick_t **right, brick_t **downright, brick_t **down, brick_t **downleft, brick_t **left, brick_t **upleft)
 {
-    float cd_up[4] = { vup.x-sqrsize , vup.y-sqrsize , vup.x+sqrsize , vup.y+sqrsize };
+    v2d_t spot[8];
+    brick_t **out[8];
+    actorsensorcache_t *c;
+    float cd[4];
+    int i, hits = 0, misses = 0;
+
+    spot[0] = vup;   spot[1] = vupright;   spot[2] = vright;  spot[3] = vdownright;
+    spot[4] = vdown; spot[5] = vdownleft;  spot[6] = vleft;   spot[7] = vupleft;
+    out[0] = up;     out[1] = upright;     out[2] = right;    out[3] = downright;
+    out[4] = down;   out[5] = downleft;    out[6] = left;     out[7] = upleft;
+
+    c = sensor_cache_lookup(act, sqrsize, brick_list, spot);
+    for(i=0; i<8; i++) {
+        if(!out[i])
+            continue;
+
+        if(!(c->known & (1 << i))) {
+            cd[0] = spot[i].x - sqrsize;
+            cd[1] = spot[i].y - sqrsize;
+            cd[2] = spot[i].x + sqrsize;
+            cd[3] = spot[i].y + sqrsize;
+            c->brick[i] = brick_at(brick_list, cd, &(act->sensor_context));
+            c->known |= (1 << i);
+            misses++;
+        }
+        else
+            hits++;
+
+        *(out[i]) = c->brick[i];
+    }
+
+    if(hits > 0)
+        atomic_add(&sensor_hits, hits);
+    if(misses > 0)
+        atomic_add(&sensor_misses, misses);
+}
+
+
+/*
+ * actor_corners_new_frame()
+ * Forgets the memoized sensor results of all actors
+ * (the bricks may have changed). Call it once per frame.
+ */
+void actor_corners_new_frame()
+{
+    sensor_last_hits = sensor_hits;
+    sensor_last_misses = sensor_misses;
+    sensor_hits = sensor_misses = 0;
+
+    if(++sensor_frame <= 0)
+        sensor_frame = 1;
+}
+
+
+/*
+ * actor_corners_stats()
+ * How many sensor queries of the last frame were
+ * answered by the cache (hits) and by brick_at (misses)
+ */
+void actor_corners_stats(int *hits, int *misses)
+{
+    if(hits) *hits = sensor_last_hits;
+    if(misses) *misses = sensor_last_misses;
+}
+
+
+/*
+ * actor_raycast()
+ * Casts a ray from origin towards direction. Returns the first
+ * brick it hits within maxdist pixels (or NULL), and sets
+ * *distance (may be NULL) to the distance of the hit. The rules
+ * of brick_at() apply. Clouds only stop a ray going down.
+ */
+brick_t* actor_raycast(brick_list_t *brick_list, const sensorcontext_t *ctx, v2d_t origin, v2d_t direction, float maxdist, float *distance)
+{
+    float point[4] = { origin.x, origin.y, origin.x, origin.y };
+    return actor_sweep(brick_list, ctx, point, v2d_multiply(v2d_normalize(direction), maxdist), distance);
+}
+
+
+/*
+ * actor_sweep()
+ * Moves the rectangle rect = [x1,y1,x2,y2] along delta and returns
+ * the first brick it touches (or NULL). *distance (may be NULL) is
+ * set to the distance travelled until the contact. Nothing is
+ * skipped, no matter how long delta is. Slopes are intersected
+ * analytically. ctx may be NULL (default sensor context).
+ */
+brick_t* actor_sweep(brick_list_t *brick_list, const sensorcontext_t *ctx, const float rect[4], v2d_t delta, float *distance)
+{
+    brick_list_t *p;
+    brick_t *ret = NULL;
+    float t, best = 2.0f;
+
+    if(ctx == NULL)
+        ctx = &default_context;
+
+    for(p=brick_list; p; p=p->next) {
+        if(!brick_sweepable(p->data, delta, ctx))
+            continue;
+
+        t = brick_sweep(p->data, rect, delta);
+        if(t < 0.0f)
+            continue;
+
+        /* the nearest brick wins. On a tie, obstacles win over clouds */
+        if(t < best || (t == best && ret->brick_ref->property == BRK_CLOUD)) {
+            ret = p->data;
+            best = t;
+        }
+    }
+
+    if(distance)
+        *distance = ret ? best * v2d_magnitude(delta) : 0.0f;
+
+    return ret;
+}
+
+
+/*
+ * actor_corners_sweep_down()
+ * Sweeps the 'down' sensor of actor_corners() along delta
+ * (in world coordinates). See actor_sweep().
+ */
+brick_t* actor_corners_sweep_down(actor_t *act, float sqrsize, float diff, brick_list_t *brick_list, v2d_t delta, float *distance)
+{
+    v2d_t vdown = v2d_add( act->position , trig_rotate( v2d_new(0, -diff), -act->angle) );
     float cd_down[4] = { vdown.x-sqrsize , vdown.y-sqrsize , vdown.x+sqrsize , vdown.y+sqrsize };
-    float cd_left[4] = { vleft.x-sqrsize , vleft.y-sqrsize , vleft.x+sqrsize , vleft.y+sqrsize };
-    float cd_right[4] = { vright.x-sqrsize , vright.y-sqrsize , vright.x+sqrsize , vright.y+sqrsize };
-    float cd_upleft[4] = { vupleft.x-sqrsize , vupleft.y-sqrsize , vupleft.x+sqrsize , vupleft.y+sqrsize };
-    float cd_upright[4] = { vupright.x-sqrsize , vupright.y-sqrsize , vupright.x+sqrsize , vupright.y+sqrsize };
-    float cd_downleft[4] = { vdownleft.x-sqrsize , vdownleft.y-sqrsize , vdownleft.x+sqrsize , vdownleft.y+sqrsize };
-    float cd_downright[4] = { vdownright.x-sqrsize , vdownright.y-sqrsize , vdownright.x+sqrsize , vdownright.y+sqrsize };
 
-    if(up) *up = brick_at(brick_list, cd_up);
-    if(down) *down = brick_at(brick_list, cd_down);
-    if(left) *left = brick_at(brick_list, cd_left);
-    if(right) *right = brick_at(brick_list, cd_right);
-    if(upleft) *upleft = brick_at(brick_list, cd_upleft);
-    if(upright) *upright = brick_at(brick_list, cd_upright);
-    if(downleft) *downleft = brick_at(brick_list, cd_downleft);
-    if(downright) *downright = brick_at(brick_list, cd_downright);
+    return actor_sweep(brick_list, &(act->sensor_context), cd_down, delta, distance);
 }
 
 
@@ -511,20 +727,20 @@ void actor_corners_ex(actor_t *act, float sqrsize, v2d_t vup, v2d_t vupright, v2
  * Which one has the greatest priority: floor (TRUE) or wall (FALSE) ?
  * Collision-detection routine. See also: brick_at()
  */
-void actor_corners_set_floor_priority(int floor)
+void actor_corners_set_floor_priority(actor_t *act, int floor)
 {
-    floor_priority = floor;
+    act->sensor_context.floor_priority = floor;
 }
 
 
 /*
  * actor_corners_restore_floor_priority()
- * Shortcut to actor_corners_set_floor_priority(TRUE);
+ * Shortcut to actor_corners_set_floor_priority(act, TRUE);
  * TRUE is the default value.
  */
-void actor_corners_restore_floor_priority()
+void actor_corners_restore_floor_priority(actor_t *act)
 {
-    actor_corners_set_floor_priority(TRUE);
+    actor_corners_set_floor_priority(act, TRUE);
 }
 
 /*
@@ -532,33 +748,34 @@ void actor_corners_restore_floor_priority()
  * Which one has the greatest priority: slope (TRUE) or floor (FALSE) ?
  * Collision-detection routine. See also: brick_at()
  */
-void actor_corners_set_slope_priority(int slope)
+void actor_corners_set_slope_priority(actor_t *act, int slope)
 {
-    slope_priority = slope;
+    act->sensor_context.slope_priority = slope;
 }
 
 
 /*
  * actor_corners_restore_slope_priority()
- * Shortcut to actor_corners_set_slope_priority(TRUE);
+ * Shortcut to actor_corners_set_slope_priority(act, TRUE);
  * TRUE is the default value.
  */
-void actor_corners_restore_slope_priority()
+void actor_corners_restore_slope_priority(actor_t *act)
 {
-    actor_corners_set_slope_priority(TRUE);
+    actor_corners_set_slope_priority(act, TRUE);
 }
 
 
 /*
  * actor_corners_disable_detection()
  * Disables the collision detection of a few bricks
+ * (for the sensors of this actor only)
  */
-void actor_corners_disable_detection(int disable_leftwall, int disable_rightwall, int disable_floor, int disable_ceiling)
+void actor_corners_disable_detection(actor_t *act, int disable_leftwall, int disable_rightwall, int disable_floor, int disable_ceiling)
 {
-    is_leftwall_disabled = disable_leftwall;
-    is_rightwall_disabled = disable_rightwall;
-    is_floor_disabled = disable_floor;
-    is_ceiling_disabled = disable_ceiling;
+    act->sensor_context.leftwall_disabled = disable_leftwall;
+    act->sensor_context.rightwall_disabled = disable_rightwall;
+    act->sensor_context.floor_disabled = disable_floor;
+    act->sensor_context.ceiling_disabled = disable_ceiling;
 }
 
 
@@ -628,6 +845,25 @@ v2d_t actor_platform_movement(actor_t *act, brick_list_t *brick_list, float grav
 
 
 
+/*
+ * actor_prefetch_platform_movement()
+ * Makes the collision queries the next call to
+ * actor_platform_movement() will start with, so
+ * that they're found in the sensor cache. It
+ * doesn't change anything else: different actors
+ * may be prefetched at the same time.
+ */
+void actor_prefetch_platform_movement(actor_t *act, brick_list_t *brick_list)
+{
+    v2d_t up, upright, right, downright, down, downleft, left, upleft;
+    brick_t *brick_up, *brick_upright, *brick_right, *brick_downright, *brick_down, *brick_downleft, *brick_left, *brick_upleft;
+
+    actor_get_collision_detectors(act, MAGIC_DIFF, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+    actor_handle_collision_detectors(act, brick_list, up, upright, right, downright, down, downleft, left, upleft, &brick_up, &brick_upright, &brick_right, &brick_downright, &brick_down, &brick_downleft, &brick_left, &brick_upleft);
+}
+
+
+
 /*
  * actor_particle_movement()
  *
@@ -784,14 +1020,14 @@ void actor_get_collision_detectors(actor_t *act, float diff, v2d_t *up, v2d_t *u
     else       { top = 1.0; middle = 0.7; lateral = 0.25; }
 
     /* calculating the collision detectors */
-    *up        = v2d_add ( feet , v2d_rotate( v2d_new(0, -frame_height*top+diff), -act->angle) );
-    *down      = v2d_add ( feet , v2d_rotate( v2d_new(0, -diff), -act->angle) ); 
-    *left      = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*middle), -act->angle) );
-    *right     = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*middle), -act->angle) );
-    *upleft    = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*top+diff), -act->angle) );
-    *upright   = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*top+diff), -act->angle) );
-    *downleft  = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -diff), -act->angle) );
-    *downright = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -diff), -act->angle) );
+    *up        = v2d_add ( feet , trig_rotate( v2d_new(0, -frame_height*top+diff), -act->angle) );
+    *down      = v2d_add ( feet , trig_rotate( v2d_new(0, -diff), -act->angle) ); 
+    *left      = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*middle), -act->angle) );
+    *right     = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -frame_height*middle), -act->angle) );
+    *upleft    = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*top+diff), -act->angle) );
+    *upright   = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -frame_height*top+diff), -act->angle) );
+    *downleft  = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -diff), -act->angle) );
+    *downright = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -diff), -act->angle) );
 }
 
 
@@ -1152,11 +1388,237 @@ void actor_handle_floor_collision(actor_t *act, float diff, float natural_angle,
 
 /* private stuff */
 
+/* sensor_cache_lookup(): returns the memoized results
+ * of the given sensors, or an empty entry for them */
+actorsensorcache_t* sensor_cache_lookup(actor_t *act, float sqrsize, brick_list_t *brick_list, const v2d_t spot[8])
+{
+    const sensorcontext_t *ctx = &(act->sensor_context);
+    actorsensorcache_t *c;
+    int i, j, flags;
+
+    flags = (ctx->floor_priority ? 1 : 0) | (ctx->slope_priority ? 2 : 0) |
+            (ctx->leftwall_disabled ? 4 : 0) | (ctx->rightwall_disabled ? 8 : 0) |
+            (ctx->floor_disabled ? 16 : 0) | (ctx->ceiling_disabled ? 32 : 0);
+
+    for(i=0; i<ACTOR_SENSORCACHE_SIZE; i++) {
+        c = &(act->sensor_cache[i]);
+        if(c->frame == sensor_frame && c->sqrsize == sqrsize && c->flags == flags) {
+            for(j=0; j<8; j++) {
+                if(c->spot[j].x != spot[j].x || c->spot[j].y != spot[j].y)
+                    break;
+            }
+            if(j == 8 && (c->brick_list == brick_list || prepended_bricks_are_away(c, brick_list))) {
+                c->brick_list = brick_list;
+                return c;
+            }
+        }
+    }
+
+    /* miss: replace the oldest entry */
+    c = &(act->sensor_cache[act->sensor_cache_next]);
+    act->sensor_cache_next = (act->sensor_cache_next + 1) % ACTOR_SENSORCACHE_SIZE;
+    c->frame = sensor_frame;
+    c->brick_list = brick_list;
+    c->sqrsize = sqrsize;
+    c->flags = flags;
+    for(j=0; j<8; j++)
+        c->spot[j] = spot[j];
+    c->known = 0;
+
+    return c;
+}
+
+/* prepended_bricks_are_away(): the level prepends bricks
+ * to the list along the frame (obstacle items & objects).
+ * If brick_list is c->brick_list with a few new bricks in
+ * front, none of which touches the sensors of c, brick_at()
+ * would give the same results, so c is still valid. */
+int prepended_bricks_are_away(const actorsensorcache_t *c, brick_list_t *brick_list)
+{
+    brick_list_t *p;
+    float area[4], br[4];
+    int j, n;
+
+    /* the area covered by the sensors */
+    area[0] = area[2] = c->spot[0].x;
+    area[1] = area[3] = c->spot[0].y;
+    for(j=1; j<8; j++) {
+        area[0] = min(area[0], c->spot[j].x);
+        area[1] = min(area[1], c->spot[j].y);
+        area[2] = max(area[2], c->spot[j].x);
+        area[3] = max(area[3], c->spot[j].y);
+    }
+    area[0] -= c->sqrsize; area[1] -= c->sqrsize;
+    area[2] += c->sqrsize; area[3] += c->sqrsize;
+
+    /* the new bricks */
+    for(p=brick_list, n=0; p != c->brick_list; p=p->next, n++) {
+        if(p == NULL || n >= SENSORCACHE_MAXPREPEND)
+            return FALSE;
+
+        br[0] = (float)p->data->x;
+        br[1] = (float)p->data->y;
+        br[2] = (float)(p->data->x + p->data->brick_ref->image->w);
+        br[3] = (float)(p->data->y + p->data->brick_ref->image->h);
+        if(bounding_box(area, br))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* brick_sweepable(): can brk stop something moving
+ * along delta? (same rules as brick_at) */
+int brick_sweepable(const brick_t *brk, v2d_t delta, const sensorcontext_t *ctx)
+{
+    int angle = brk->brick_ref->angle;
+
+    if(brk->brick_ref->property == BRK_NONE || !brk->enabled)
+        return FALSE;
+
+    if(brk->brick_ref->property == BRK_CLOUD && delta.y <= 0.0f)
+        return FALSE;
+
+    if(angle % 90 != 0 && !ctx->slope_priority)
+        return FALSE;
+
+    if(ctx->floor_disabled && angle == 0)
+        return FALSE;
+
+    if(ctx->ceiling_disabled && angle == 180)
+        return FALSE;
+
+    if(ctx->rightwall_disabled && angle > 0 && angle < 180)
+        return FALSE;
+
+    if(ctx->leftwall_disabled && angle > 180 && angle < 360)
+        return FALSE;
+
+    return TRUE;
+}
+
+/* brick_sweep(): moving rect along delta, when does it
+ * start to overlap brk? Returns t in [0,1] (the contact
+ * happens at rect + t*delta) or -1 if it doesn't.
+ * Separating axis test: the axes of the rectangle and
+ * the normal of the slope, if any */
+float brick_sweep(const brick_t *brk, const float rect[4], v2d_t delta)
+{
+    v2d_t vertex[5], axis[3], corner[4];
+    float enter = -1e10, leave = 1e10;
+    float pmin, pmax, rmin, rmax, d, a, b;
+    int i, j, n, axes;
+
+    n = brick_shape(brk, vertex, &axis[2]);
+    if(n == 0)
+        return -1.0f;
+
+    axis[0] = v2d_new(1, 0);
+    axis[1] = v2d_new(0, 1);
+    axes = (brk->brick_ref->angle % 90 != 0) ? 3 : 2;
+
+    corner[0] = v2d_new(rect[0], rect[1]);
+    corner[1] = v2d_new(rect[2], rect[1]);
+    corner[2] = v2d_new(rect[2], rect[3]);
+    corner[3] = v2d_new(rect[0], rect[3]);
+
+    for(i=0; i<axes; i++) {
+        pmin = pmax = v2d_dotproduct(vertex[0], axis[i]);
+        for(j=1; j<n; j++) {
+            d = v2d_dotproduct(vertex[j], axis[i]);
+            pmin = min(pmin, d);
+            pmax = max(pmax, d);
+        }
+
+        rmin = rmax = v2d_dotproduct(corner[0], axis[i]);
+        for(j=1; j<4; j++) {
+            d = v2d_dotproduct(corner[j], axis[i]);
+            rmin = min(rmin, d);
+            rmax = max(rmax, d);
+        }
+
+        /* the projections overlap for a < t < b */
+        d = v2d_dotproduct(delta, axis[i]);
+        if(fabs(d) < EPSILON) {
+            if(!(rmin < pmax && rmax > pmin))
+                return -1.0f;
+            continue;
+        }
+        else if(d > 0.0f) {
+            a = (pmin - rmax) / d;
+            b = (pmax - rmin) / d;
+        }
+        else {
+            a = (pmax - rmin) / d;
+            b = (pmin - rmax) / d;
+        }
+
+        enter = max(enter, a);
+        leave = min(leave, b);
+    }
+
+    if(enter >= leave || leave <= 0.0f || enter > 1.0f)
+        return -1.0f;
+
+    return max(enter, 0.0f);
+}
+
+/* brick_shape(): the solid region of a brick, as a convex
+ * polygon (returns the number of vertices). Slopes are the
+ * bounding box of the brick cut by the line of brick_at() */
+int brick_shape(const brick_t *brk, v2d_t vertex[5], v2d_t *normal)
+{
+    float br[4], m, c, di, dj;
+    v2d_t box[4];
+    int deg, i, j, n;
+
+    br[0] = (float)brk->x;
+    br[1] = (float)brk->y;
+    br[2] = (float)(brk->x + brk->brick_ref->image->w);
+    br[3] = (float)(brk->y + brk->brick_ref->image->h);
+
+    box[0] = v2d_new(br[0], br[1]);
+    box[1] = v2d_new(br[2], br[1]);
+    box[2] = v2d_new(br[2], br[3]);
+    box[3] = v2d_new(br[0], br[3]);
+
+    deg = brk->brick_ref->angle;
+    if(deg % 90 == 0) {
+        for(i=0; i<4; i++)
+            vertex[i] = box[i];
+        *normal = v2d_new(0, 1);
+        return 4;
+    }
+
+    /* the solid side of the line: normal . p >= c */
+    m = tan(deg * PI/180.0);
+    switch( (int)(deg/90) % 4 ) {
+        case 0:  *normal = v2d_new(m, 1);  c = m*br[0] + br[3]; break;
+        case 1:  *normal = v2d_new(m, -1); c = m*br[2] - br[3]; break;
+        case 2:  *normal = v2d_new(m, -1); c = m*br[0] - br[3]; break;
+        default: *normal = v2d_new(m, 1);  c = m*br[2] + br[3]; break;
+    }
+
+    /* clip the box */
+    for(n=0, i=0; i<4; i++) {
+        j = (i+1) % 4;
+        di = v2d_dotproduct(*normal, box[i]) - c;
+        dj = v2d_dotproduct(*normal, box[j]) - c;
+        if(di >= 0.0f)
+            vertex[n++] = box[i];
+        if((di >= 0.0f) != (dj >= 0.0f))
+            vertex[n++] = v2d_lerp(box[i], box[j], di / (di - dj));
+    }
+
+    return n;
+}
+
 /* brick_at(): given a list of bricks, returns
  * one that collides with the rectangle 'rect'
+ * (according to the sensor context ctx)
  * PS: this code ignores the bricks that are
  * not obstacles */
-static brick_t* brick_at(brick_list_t *list, float rect[4])
+static brick_t* brick_at(brick_list_t *list, float rect[4], const sensorcontext_t *ctx)
 {
     brick_t *ret = NULL;
     brick_list_t *p;
@@ -1180,19 +1642,19 @@ static brick_t* brick_at(brick_list_t *list, float rect[4])
             continue;
 
         /* I don't want a floor! */
-        if(is_floor_disabled && p->data->brick_ref->angle == 0)
+        if(ctx->floor_disabled && p->data->brick_ref->angle == 0)
             continue;
 
         /* I don't want a ceiling! */
-        if(is_ceiling_disabled && p->data->brick_ref->angle == 180)
+        if(ctx->ceiling_disabled && p->data->brick_ref->angle == 180)
             continue;
 
         /* I don't want a right wall */
-        if(is_rightwall_disabled && p->data->brick_ref->angle > 0 && p->data->brick_ref->angle < 180)
+        if(ctx->rightwall_disabled && p->data->brick_ref->angle > 0 && p->data->brick_ref->angle < 180)
             continue;
 
         /* I don't want a left wall */
-        if(is_leftwall_disabled && p->data->brick_ref->angle > 180 && p->data->brick_ref->angle < 360)
+        if(ctx->leftwall_disabled && p->data->brick_ref->angle > 180 && p->data->brick_ref->angle < 360)
             continue;
 
         /* here's something I like... */
@@ -1216,11 +1678,11 @@ static brick_t* brick_at(brick_list_t *list, float rect[4])
             else if(p->data->brick_ref->angle % 90 == 0) { /* if not slope */
 
 
-                if(slope_priority) {
+                if(ctx->slope_priority) {
                     if(!ret) /* this code priorizes the slopes */
                         ret = p->data;
                     else {
-                        if(floor_priority) {
+                        if(ctx->floor_priority) {
                             if(ret->brick_ref->angle % 180 != 0) /* priorizes the floor/ceil */
                                 ret = p->data;
                         }
@@ -1235,7 +1697,7 @@ static brick_t* brick_at(brick_list_t *list, float rect[4])
 
 
             }
-            else if(slope_priority) { /* if slope */
+            else if(ctx->slope_priority) { /* if slope */
                 deg = p->data->brick_ref->angle;
                 mytan = tan(deg * PI/180.0);
                 for(x=rect[0]; x<=rect[2] && !end; x++) {
@@ -1296,9 +1758,9 @@ void calculate_rotated_boundingbox(const actor_t *act, v2d_t spot[4])
     c = v2d_subtract(v2d_new(w, h), hs);
     d = v2d_subtract(v2d_new(0, h), hs);
 
-    spot[0] = v2d_add(pos, v2d_rotate(a, angle));
-    spot[1] = v2d_add(pos, v2d_rotate(b, angle));
-    spot[2] = v2d_add(pos, v2d_rotate(c, angle));
-    spot[3] = v2d_add(pos, v2d_rotate(d, angle));
+    spot[0] = v2d_add(pos, trig_rotate(a, angle));
+    spot[1] = v2d_add(pos, trig_rotate(b, angle));
+    spot[2] = v2d_add(pos, trig_rotate(c, angle));
+    spot[3] = v2d_add(pos, trig_rotate(d, angle));
 }
 
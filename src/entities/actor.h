@@ -25,6 +25,27 @@
 #include "../core/v2d.h"
 #include "brick.h"
 
+/* collision query context: how the sensors of an
+ * actor pick the bricks (see actor_corners_ex) */
+typedef struct {
+    int floor_priority; /* floor (TRUE) x wall (FALSE) */
+    int slope_priority; /* slope (TRUE) x floor (FALSE) */
+    int leftwall_disabled, rightwall_disabled, floor_disabled, ceiling_disabled;
+} sensorcontext_t;
+
+/* memoized results of the sensors (see actor_corners_ex) */
+#define ACTOR_SENSORCACHE_SIZE      4
+
+typedef struct {
+    int frame; /* 0 = empty entry */
+    brick_list_t *brick_list;
+    float sqrsize;
+    int flags; /* sensor context at the time of the query */
+    v2d_t spot[8];
+    brick_t *brick[8];
+    int known; /* bitmask: which brick[i] have been computed */
+} actorsensorcache_t;
+
 /* actor structure */
 typedef struct actor_t {
 
@@ -53,12 +74,20 @@ typedef struct actor_t {
     struct actor_t *carried_by; /* something is carrying me */
     struct actor_t *carrying; /* I'm carrying something */
 
+    /* sensors */
+    sensorcontext_t sensor_context;
+    actorsensorcache_t sensor_cache[ACTOR_SENSORCACHE_SIZE];
+    int sensor_cache_next; /* entry to be replaced */
+
 } actor_t;
 
 
 /* actor functions */
 actor_t* actor_create();
 void actor_destroy(actor_t *act);
+void actor_pool_reserve(int count); /* keeps up to count destroyed actors for reuse (main thread only) */
+void actor_pool_release(); /* frees the actors kept for reuse */
+void actor_pool_stats(int *reuses, int *allocations, int *free_count);
 void actor_render(actor_t *act, v2d_t camera_position);
 void actor_render_repeat_xy(actor_t *act, v2d_t camera_position, int repeat_x, int repeat_y);
 void actor_move(actor_t *act, v2d_t delta_space); /* uses the orientation angle (you must call the delta timer yourself) ; s = vt */
@@ -73,6 +102,7 @@ int actor_animation_finished(actor_t *act); /* true if the current animation has
 /* collision detection */
 int actor_collision(const actor_t *a, const actor_t *b); /* tests bounding-box collision between a and b */
 int actor_orientedbox_collision(const actor_t *a, const actor_t *b); /* oriented bounding-box collision */
+void actor_bounding_box(const actor_t *act, float box[4]); /* axis-aligned box of the (rotated) image */
 int actor_pixelperfect_collision(const actor_t *a, const actor_t *b); /* tests pixel-perfect collision between a and b */
 int actor_brick_collision(actor_t *act, brick_t *brk);
 
@@ -80,11 +110,18 @@ int actor_brick_collision(actor_t *act, brick_t *brk);
 void actor_render_corners(const actor_t *act, float sqrsize, float diff, v2d_t camera_position);
 void actor_corners(actor_t *act, float sqrsize, float diff, brick_list_t *brick_list, brick_t **up, brick_t **upright, brick_t **right, brick_t **downright, brick_t **down, brick_t **downleft, brick_t **left, brick_t **upleft);
 void actor_corners_ex(actor_t *act, float sqrsize, v2d_t vup, v2d_t vupright, v2d_t vright, v2d_t vdownright, v2d_t vdown, v2d_t vdownleft, v2d_t vleft, v2d_t vupleft, brick_list_t *brick_list, brick_t **up, brick_t **upright, brick_t **right, brick_t **downright, brick_t **down, brick_t **downleft, brick_t **left, brick_t **upleft);
-void actor_corners_set_floor_priority(int floor); /* floor x wall */
-void actor_corners_restore_floor_priority();
-void actor_corners_set_slope_priority(int slope); /* slope x floor */
-void actor_corners_restore_slope_priority();
-void actor_corners_disable_detection(int disable_leftwall, int disable_rightwall, int disable_floor, int disable_ceiling);
+void actor_corners_set_floor_priority(actor_t *act, int floor); /* floor x wall */
+void actor_corners_restore_floor_priority(actor_t *act);
+void actor_corners_set_slope_priority(actor_t *act, int slope); /* slope x floor */
+void actor_corners_restore_slope_priority(actor_t *act);
+void actor_corners_disable_detection(actor_t *act, int disable_leftwall, int disable_rightwall, int disable_floor, int disable_ceiling);
+void actor_corners_new_frame(); /* forgets the memoized sensor results. Call it once per frame */
+void actor_corners_stats(int *hits, int *misses); /* sensor queries of the last frame */
+brick_t* actor_corners_sweep_down(actor_t *act, float sqrsize, float diff, brick_list_t *brick_list, v2d_t delta, float *distance); /* sweeps the 'down' sensor */
+
+/* brick queries (the first brick hit & its distance) */
+brick_t* actor_raycast(brick_list_t *brick_list, const sensorcontext_t *ctx, v2d_t origin, v2d_t direction, float maxdist, float *distance); /* ctx may be NULL */
+brick_t* actor_sweep(brick_list_t *brick_list, const sensorcontext_t *ctx, const float rect[4], v2d_t delta, float *distance); /* ctx may be NULL */
 void actor_get_collision_detectors(actor_t *act, float diff, v2d_t *up, v2d_t *upright, v2d_t *right, v2d_t *downright, v2d_t *down, v2d_t *downleft, v2d_t *left, v2d_t *upleft); /* get collision detectors */
 
 /* platform movement routines */
@@ -100,6 +137,7 @@ void actor_handle_acceleration(actor_t *act, float friction, brick_t *brick_down
 
 /* pre-defined movement routines */
 v2d_t actor_platform_movement(actor_t *act, brick_list_t *brick_list, float gravity);
+void actor_prefetch_platform_movement(actor_t *act, brick_list_t *brick_list); /* warms up the sensor cache; thread-safe among different actors */
 v2d_t actor_particle_movement(actor_t *act, float gravity);
 v2d_t actor_eightdirections_movement(actor_t *act);
 v2d_t actor_bullet_movement(actor_t *act);
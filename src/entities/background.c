@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <math.h>
+#include <limits.h>
 #include "background.h"
 #include "actor.h"
 #include "../core/sprite.h"
@@ -29,6 +30,7 @@
 #include "../core/logfile.h"
 #include "../core/timer.h"
 #include "../core/nanoparser/nanoparser.h"
+#include "../core/scriptcache.h"
 
 /* forward declarations */
 typedef struct background_t background_t;
@@ -58,6 +60,8 @@ struct background_t {
     int repeat_x, repeat_y; /* repeat background? */
     float zindex; /* 0.0 (far) <= zindex <= 1.0 (near) */
     bgstrategy_t *strategy; /* Strategy design pattern */
+    int *opaque; /* opaque[i] is TRUE if data->frame_data[i] has no transparent pixels */
+    int draw_count; /* how many tiles have been drawn in the last frame? (profiling) */
 };
 static background_t *background_new(); /* constructor */
 static background_t *background_delete(background_t *bg); /* destructor */
@@ -96,6 +100,12 @@ static void bgstrategy_linear_update(bgstrategy_t *strategy); /* private class m
 static void sort_backgrounds(bgtheme_t *bgtheme);
 static int sort_cmp(const void *a, const void *b);
 static void render(bgtheme_t *theme, v2d_t camera_position, int foreground);
+static void render_layer(background_t *bg, v2d_t topleft);
+static int covers_the_screen(background_t *bg, v2d_t topleft);
+static void get_tiles(background_t *bg, v2d_t topleft, int *x, int *y, int *cols, int *rows);
+static void animate(background_t *bg);
+static int is_opaque(background_t *bg, image_t *img);
+static void check_opacity(background_t *bg);
 static int traverse(const parsetree_statement_t *stmt, void *bgtheme);
 static int traverse_background_attributes(const parsetree_statement_t *stmt, void *background);
 static void validate_background(const background_t *bg);
@@ -120,7 +130,7 @@ bgtheme_t* background_load(const char *file)
     bgtheme->data = NULL;
     bgtheme->length = 0;
 
-    tree = nanoparser_construct_tree(abs_path);
+    tree = scriptcache_take(abs_path);
     nanoparser_traverse_program_ex(tree, (void*)bgtheme, traverse);
     tree = nanoparser_deconstruct_tree(tree);
 
@@ -187,6 +197,30 @@ void background_render_fg(bgtheme_t *bgtheme, v2d_t camera_position)
 
 
 
+/*
+ * background_layer_count()
+ * How many layers does this theme have?
+ */
+int background_layer_count(const bgtheme_t *bgtheme)
+{
+    return bgtheme->length;
+}
+
+
+
+/*
+ * background_draw_count()
+ * Profiling: how many tiles of the given layer
+ * have been drawn in the last frame? (0 if the
+ * layer has been culled)
+ */
+int background_draw_count(const bgtheme_t *bgtheme, int layer)
+{
+    return (layer >= 0 && layer < bgtheme->length) ? bgtheme->data[layer]->draw_count : 0;
+}
+
+
+
 
 
 
@@ -202,6 +236,8 @@ background_t *background_new()
     bg->repeat_x = FALSE;
     bg->repeat_y = FALSE;
     bg->zindex = 0.0f;
+    bg->opaque = NULL;
+    bg->draw_count = 0;
 
     return bg;
 }
@@ -209,6 +245,8 @@ background_t *background_new()
 background_t *background_delete(background_t *bg)
 {
     bg->strategy = bgstrategy_delete(bg->strategy);
+    if(bg->opaque != NULL)
+        free(bg->opaque);
     spriteinfo_destroy(bg->data);
     actor_destroy(bg->actor);
     free(bg);
@@ -302,21 +340,144 @@ void bgstrategy_linear_update(bgstrategy_t *strategy)
 
 void render(bgtheme_t *bgtheme, v2d_t camera_position, int foreground)
 {
-    int i;
-    v2d_t halfscreen = v2d_new(VIDEO_SCREEN_W/2, VIDEO_SCREEN_H/2);
-    v2d_t topleft = v2d_subtract(camera_position, halfscreen);
+    int i, first = 0;
+    v2d_t topleft = v2d_subtract(camera_position, v2d_new(VIDEO_SCREEN_W/2, VIDEO_SCREEN_H/2));
     background_t *bg;
 
+    /* the layers behind an opaque layer that covers the whole screen can't be seen */
     for(i=0; i<bgtheme->length; i++) {
         bg = bgtheme->data[i];
         if((!foreground && bg->zindex <= 0.5f) || (foreground && bg->zindex > 0.5f)) {
-            bg->actor->position.x += topleft.x * bg->actor->speed.x;
-            bg->actor->position.y += topleft.y * bg->actor->speed.y;
+            if(covers_the_screen(bg, topleft))
+                first = i;
+        }
+    }
 
-            actor_render_repeat_xy(bg->actor, halfscreen, bg->repeat_x, bg->repeat_y);
+    /* render */
+    for(i=0; i<bgtheme->length; i++) {
+        bg = bgtheme->data[i];
+        if((!foreground && bg->zindex <= 0.5f) || (foreground && bg->zindex > 0.5f)) {
+            if(i >= first)
+                render_layer(bg, topleft);
+            else {
+                bg->draw_count = 0;
+                animate(bg);
+            }
+        }
+    }
+}
 
-            bg->actor->position.y -= topleft.y * bg->actor->speed.y;
-            bg->actor->position.x -= topleft.x * bg->actor->speed.x;
+/* renders the visible tiles of a layer */
+void render_layer(background_t *bg, v2d_t topleft)
+{
+    int i, j, x, y, cols, rows, i0, i1, j0, j1, opaque;
+    image_t *img = actor_image(bg->actor);
+    image_t *buf = video_get_backbuffer();
+
+    bg->draw_count = 0;
+    if(!bg->actor->visible || !bg->actor->animation)
+        return;
+
+    /* visible tile spans: [i0,i1) x [j0,j1) */
+    get_tiles(bg, topleft, &x, &y, &cols, &rows);
+    i0 = (x < 0) ? (-x) / img->w : 0;
+    j0 = (y < 0) ? (-y) / img->h : 0;
+    i1 = (x < VIDEO_SCREEN_W) ? min(cols, (VIDEO_SCREEN_W - x + img->w - 1) / img->w) : 0;
+    j1 = (y < VIDEO_SCREEN_H) ? min(rows, (VIDEO_SCREEN_H - y + img->h - 1) / img->h) : 0;
+
+    /* opaque tiles don't need a masked blit */
+    opaque = (bg->actor->mirror == IF_NONE) && is_opaque(bg, img);
+
+    for(j=j0; j<j1; j++) {
+        for(i=i0; i<i1; i++) {
+            if(opaque)
+                image_blit(img, buf, 0, 0, x + i*img->w, y + j*img->h, img->w, img->h);
+            else
+                image_draw(img, buf, x + i*img->w, y + j*img->h, bg->actor->mirror);
+        }
+    }
+
+    bg->draw_count = max(0, i1 - i0) * max(0, j1 - j0);
+    animate(bg);
+}
+
+/* does this layer cover the whole screen with opaque tiles? */
+int covers_the_screen(background_t *bg, v2d_t topleft)
+{
+    int x, y, cols, rows;
+    image_t *img;
+
+    if(!bg->actor->visible || !bg->actor->animation)
+        return FALSE;
+
+    img = actor_image(bg->actor);
+    if(!is_opaque(bg, img))
+        return FALSE;
+
+    get_tiles(bg, topleft, &x, &y, &cols, &rows);
+    return (x <= 0 && y <= 0 && x + cols * img->w >= VIDEO_SCREEN_W && y + rows * img->h >= VIDEO_SCREEN_H);
+}
+
+/* screen position of the first tile of a layer, and how many tiles it has */
+void get_tiles(background_t *bg, v2d_t topleft, int *x, int *y, int *cols, int *rows)
+{
+    actor_t *act = bg->actor;
+    image_t *img = actor_image(act);
+    v2d_t pos;
+
+    /* parallax */
+    pos.x = act->position.x + topleft.x * act->speed.x;
+    pos.y = act->position.y + topleft.y * act->speed.y;
+
+    *x = (int)((int)pos.x % (bg->repeat_x ? img->w : INT_MAX) - act->hot_spot.x - (bg->repeat_x ? img->w : 0));
+    *y = (int)((int)pos.y % (bg->repeat_y ? img->h : INT_MAX) - act->hot_spot.y - (bg->repeat_y ? img->h : 0));
+    *cols = bg->repeat_x ? (VIDEO_SCREEN_W / img->w + 3) : 1;
+    *rows = bg->repeat_y ? (VIDEO_SCREEN_H / img->h + 3) : 1;
+}
+
+/* updates the animation of a layer */
+void animate(background_t *bg)
+{
+    actor_t *act = bg->actor;
+
+    if(act->visible && act->animation) {
+        act->animation_frame += (act->animation->fps * act->animation_speed_factor) * timer_get_delta();
+        if((int)act->animation_frame >= act->animation->frame_count) {
+            if(act->animation->repeat)
+                act->animation_frame = (int)act->animation_frame % act->animation->frame_count;
+            else
+                act->animation_frame = act->animation->frame_count-1;
+        }
+    }
+}
+
+/* img has no transparent pixels? */
+int is_opaque(background_t *bg, image_t *img)
+{
+    int i;
+
+    for(i=0; i<bg->data->frame_count; i++) {
+        if(bg->data->frame_data[i] == img)
+            return bg->opaque[i];
+    }
+
+    return FALSE;
+}
+
+/* finds out which frames of a layer are opaque */
+void check_opacity(background_t *bg)
+{
+    int i, x, y;
+    image_t *img;
+    uint32 mask = video_get_maskcolor();
+
+    bg->opaque = mallocx(max(1, bg->data->frame_count) * sizeof *(bg->opaque));
+    for(i=0; i<bg->data->frame_count; i++) {
+        img = bg->data->frame_data[i];
+        bg->opaque[i] = TRUE;
+        for(y=0; y<img->h && bg->opaque[i]; y++) {
+            for(x=0; x<img->w && bg->opaque[i]; x++)
+                bg->opaque[i] = (image_getpixel(img, x, y) != mask);
         }
     }
 }
@@ -361,6 +522,7 @@ int traverse(const parsetree_statement_t *stmt, void *bgtheme)
         theme->data[theme->length-1] = bg;
         nanoparser_traverse_program_ex(nanoparser_get_program(p1), (void*)bg, traverse_background_attributes);
         validate_background(bg);
+        check_opacity(bg);
         actor_change_animation(bg->actor, bg->data->animation_data[0]);
     }
     else
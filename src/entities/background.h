@@ -29,6 +29,8 @@ bgtheme_t* background_unload(bgtheme_t *bgtheme); /* unloads the bg/fg theme */
 void background_update(bgtheme_t *bgtheme); /* updates the given theme */
 void background_render_bg(bgtheme_t *bgtheme, v2d_t camera_position); /* renders the background */
 void background_render_fg(bgtheme_t *bgtheme, v2d_t camera_position); /* renders the foreground */
+int background_layer_count(const bgtheme_t *bgtheme); /* number of layers */
+int background_draw_count(const bgtheme_t *bgtheme, int layer); /* profiling: tiles drawn by a layer in the last frame */
 
 #endif
 
@@ -27,6 +27,7 @@
 #include "../core/util.h"
 #include "../core/timer.h"
 #include "../core/nanoparser/nanoparser.h"
+#include "../core/scriptcache.h"
 
 
 /* private data */
@@ -61,7 +62,7 @@ void brickdata_load(const char *filename)
     for(i=0; i<BRKDATA_MAX; i++) 
         brickdata[i] = NULL;
 
-    tree = nanoparser_construct_tree(abs_path);
+    tree = scriptcache_take(abs_path);
     nanoparser_traverse_program(tree, traverse);
     tree = nanoparser_deconstruct_tree(tree);
 
@@ -70,6 +70,8 @@ struct brick_t { /* a real, concrete brick */
     int enabled; /* useful on sonic loops */
     int state; /* BRS_* */
     float value[BRICK_MAXVALUES]; /* alterable values */
+    float motion_time; /* value[0] when motion was computed (see level_brick_move_actor) */
+    v2d_t motion; /* velocity of a moving brick at motion_time */
     float animation_frame; /* controlled by a timer */
 };
 
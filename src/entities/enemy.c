@@ -28,6 +28,7 @@
 #include "../core/stringutil.h"
 #include "../core/osspec.h"
 #include "../core/nanoparser/nanoparser.h"
+#include "../core/scriptcache.h"
 #include "../scenes/level.h"
 #include "actor.h"
 #include "player.h"
@@ -60,10 +61,15 @@ static int find_object_block(const parsetree_statement_t *stmt, void *in_out_par
 static int fill_object_data(const parsetree_statement_t *stmt, void *object_name_data);
 static int dirfill(const char *filename, int attrib, void *param); /* file system callback */
 static int is_hidden_object(const char *name);
+static int name_id_cmp(const void *a, const void *b);
 
 static parsetree_program_t *objects;
 static object_name_data_t name_table;
 
+typedef struct { char *name; int id; } name_id_t;
+static name_id_t *name_id_table; /* sorted by name */
+static int name_id_count, name_id_capacity;
+
 
 /* ------ public class methods ---------- */
 
@@ -74,22 +80,16 @@ static object_name_data_t name_table;
 void objects_init()
 {
     const char *path = "objects/*.obj";
-    char abs_path[2][1024];
-    int j, max_paths, deny_flags = FA_DIREC | FA_LABEL;
 
     logfile_message("Loading objects scripts...");
     objects = NULL;
 
-    /* official and $HOME filepaths */
-    absolute_filepath(abs_path[0], path, sizeof(abs_path[0]));
-    home_filepath(abs_path[1], path, sizeof(abs_path[1]));
-    max_paths = (strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2;
-
-    /* reading the parse tree */
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dirfill, (void*)(&objects));
+    /* reading the parse tree (official and $HOME filepaths) */
+    for_each_resource(path, dirfill, (void*)(&objects));
 
     /* creating the name table */
+    name_id_table = NULL;
+    name_id_count = name_id_capacity = 0;
     name_table.length = 0;
     nanoparser_traverse_program_ex(objects, (void*)(&name_table), fill_object_data);
     qsort(name_table.name, name_table.length, sizeof(name_table.name[0]), object_name_table_cmp);
@@ -101,6 +101,15 @@ void objects_init()
  */
 void objects_release()
 {
+    int i;
+
+    for(i=0; i<name_id_count; i++)
+        free(name_id_table[i].name);
+    if(name_id_table != NULL)
+        free(name_id_table);
+    name_id_table = NULL;
+    name_id_count = name_id_capacity = 0;
+
     objects = nanoparser_deconstruct_tree(objects);
 }
 
@@ -114,6 +123,36 @@ const char** objects_get_list_of_names(int *n)
     return name_table.name;
 }
 
+/*
+ * objects_get_name_id()
+ * Returns an integer that identifies a name (case
+ * sensitive). Comparing these integers is the same
+ * as comparing the names, but much cheaper.
+ */
+int objects_get_name_id(const char *name)
+{
+    name_id_t key, *found;
+    int i;
+
+    key.name = (char*)name;
+    found = bsearch(&key, name_id_table, name_id_count, sizeof *name_id_table, name_id_cmp);
+    if(found != NULL)
+        return found->id;
+
+    /* a new name: keep the table sorted */
+    if(name_id_count >= name_id_capacity) {
+        name_id_capacity = max(32, 2 * name_id_capacity);
+        name_id_table = reallocx(name_id_table, name_id_capacity * sizeof *name_id_table);
+    }
+
+    for(i=name_id_count; i>0 && strcmp(name_id_table[i-1].name, name) > 0; i--)
+        name_id_table[i] = name_id_table[i-1];
+
+    name_id_table[i].name = str_dup(name);
+    name_id_table[i].id = name_id_count++;
+    return name_id_table[i].id;
+}
+
 
 
 
@@ -172,8 +211,20 @@ enemy_t *enemy_destroy(enemy_t *enemy)
  */
 void enemy_update(enemy_t *enemy, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, enemy_list_t *object_list)
 {
-    objectmachine_t *machine = *(objectvm_get_reference_to_current_state(enemy->vm));
-    machine->update(machine, team, team_size, brick_list, item_list, object_list);
+    objectvm_update(enemy->vm, team, team_size, brick_list, item_list, object_list);
+}
+
+
+
+/*
+ * enemy_think()
+ * Prefetches the collision queries the next
+ * enemy_update() will make. Different enemies
+ * may think at the same time.
+ */
+void enemy_think(enemy_t *enemy, brick_list_t *brick_list)
+{
+    objectvm_think(enemy->vm, brick_list);
 }
 
 
@@ -184,9 +235,8 @@ void enemy_update(enemy_t *enemy, player_t **team, int team_size, brick_list_t *
  */
 void enemy_render(enemy_t *enemy, v2d_t camera_position)
 {
-    objectmachine_t *machine = *(objectvm_get_reference_to_current_state(enemy->vm));
     if(!enemy->hide_unless_in_editor_mode || (enemy->hide_unless_in_editor_mode && level_editmode()))
-        machine->render(machine, camera_position);
+        objectvm_render(enemy->vm, camera_position);
 }
 
 
@@ -278,6 +328,7 @@ enemy_t* create_from_script(const char *object_name)
 
     /* setup the object */
     e->name = str_dup(object_name);
+    e->name_id = objects_get_name_id(object_name);
     e->state = ES_IDLE;
     e->actor = actor_create();
     e->actor->input = input_create_computer();
@@ -366,7 +417,7 @@ int fill_object_data(const parsetree_statement_t* stmt, void *object_name_data)
 int dirfill(const char *filename, int attrib, void *param)
 {
     parsetree_program_t** p = (parsetree_program_t**)param;
-    *p = nanoparser_append_program(*p, nanoparser_construct_tree(filename));
+    *p = nanoparser_append_program(*p, scriptcache_construct_tree(filename));
     return 0;
 }
 
@@ -444,3 +495,10 @@ object_children_t* object_children_remove(object_children_t* list, enemy_t *data
     else
         return NULL;
 }
+
+int name_id_cmp(const void *a, const void *b)
+{
+    const name_id_t *i = (const name_id_t*)a;
+    const name_id_t *j = (const name_id_t*)b;
+    return strcmp(i->name, j->name);
+}
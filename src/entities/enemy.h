@@ -44,6 +44,7 @@ enum enemystate_t {
 struct enemy_t {
     /* public attributes */
     char *name; /* name */
+    int name_id; /* the name as an integer: see objects_get_name_id() */
     struct actor_t *actor; /* actor */
     enemystate_t state; /* state */
     int created_from_editor; /* was this created from the level editor? */
@@ -79,6 +80,10 @@ void objects_release();
 /* returns an array v[0..n-1] of available object names */
 const char** objects_get_list_of_names(int *n);
 
+/* returns an integer that identifies a name (case sensitive).
+ * Different names get different integers. */
+int objects_get_name_id(const char *name);
+
 
 
 
@@ -96,6 +101,9 @@ void enemy_update(enemy_t *enemy, struct player_t **team, int team_size, struct
 /* renders an enemy */
 void enemy_render(enemy_t *enemy, v2d_t camera_position);
 
+/* prefetches the collision queries of the next update (thread-safe among different enemies) */
+void enemy_think(enemy_t *enemy, struct brick_list_t *brick_list);
+
 
 
 
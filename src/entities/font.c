@@ -19,10 +19,12 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <ctype.h>
 #include "font.h"
 #include "../core/sprite.h"
 #include "../core/video.h"
+#include "../core/imagekernel.h"
 #include "../core/lang.h"
 #include "../core/input.h"
 #include "../core/stringutil.h"
@@ -39,14 +41,45 @@ typedef struct {
     image_t *ch[256];
 } fontdata_t;
 
+/* glyphs of colored text are tinted once and
+ * kept in a (small) cache of (font type, color) pairs */
+#define TINTCACHE_SIZE      16
+typedef struct {
+    int in_use;
+    int type;
+    uint32 color;
+    unsigned int last_used;
+    image_t *ch[256];
+} tintcache_t;
+
+/* expanded variables are cached until the language
+ * or the input device changes */
+#define VARCACHE_SIZE       128 /* must be a power of two */
+typedef struct {
+    char *key; /* upper case */
+    char *value;
+} varcache_t;
+
 
 /* private data */
 static fontdata_t fontdata[FONT_MAX];
 static void get_font_size(font_t *f, int *w, int *h);
 static const char* get_variable(const char *key);
+static const char* evaluate_variable(const char *key);
+static varcache_t varcache[VARCACHE_SIZE];
+static int varcache_count;
+static unsigned int varcache_lang_generation;
+static int varcache_joystick_available;
+static void varcache_clear();
 static int has_variables_to_expand(const char *str);
 static void expand_variables(char *str);
-static void render_char(image_t *dest, image_t *ch, int x, int y, uint32 color);
+static image_t* get_glyph(int type, uint8 index, uint32 color);
+static tintcache_t tintcache[TINTCACHE_SIZE];
+static unsigned int tintcache_clock;
+static tintcache_t* tintcache_get(int type, uint32 color);
+static void tintcache_clear();
+static image_t* create_tinted_glyph(const image_t *ch, uint32 color);
+static void update_glyph_run(font_t *f);
 static uint8 hex2dec(char digit);
 
 
@@ -72,19 +105,40 @@ void font_init()
     };
 
     logfile_message("font_init()");
+    for(i=0; i<VARCACHE_SIZE; i++)
+        varcache[i].key = varcache[i].value = NULL;
+    varcache_count = 0;
+
+    for(i=0; i<TINTCACHE_SIZE; i++)
+        tintcache[i].in_use = FALSE;
+    tintcache_clock = 0;
+
     for(i=0; i<FONT_MAX; i++) {
         for(j=0; j<256; j++)
             fontdata[i].ch[j] = NULL;
 
         sprintf(sheet, "FT_FONT%d", i);
         for(p=alphabet[i],j=0; *p; p++,j++)
-            fontdata[i].ch[(int)*p] = sprite_get_image(sprite_get_animation(sheet, 0), j);
+            fontdata[i].ch[(uint8)*p] = sprite_get_image(sprite_get_animation(sheet, 0), j);
     }
     logfile_message("font_init() ok");
 }
 
 
 
+/*
+ * font_release()
+ * Releases the font module
+ */
+void font_release()
+{
+    logfile_message("font_release()");
+    tintcache_clear();
+    varcache_clear();
+}
+
+
+
 /*
  * font_create()
  * Creates a new font object
@@ -102,6 +156,10 @@ font_t *font_create(int type)
     for(i=0; i<FONT_MAXVALUES; i++)
         f->value[i] = 0;    
 
+    f->run = NULL;
+    f->run_length = f->run_capacity = 0;
+    f->run_dirty = TRUE;
+
     return f;
 }
 
@@ -117,6 +175,9 @@ void font_destroy(font_t *f)
     if(f->text)
         free(f->text);
 
+    if(f->run)
+        free(f->run);
+
     free(f);
 }
 
@@ -129,7 +190,7 @@ void font_destroy(font_t *f)
  */
 void font_set_text(font_t *f, const char *fmt, ...)
 {
-    static char buf[FONT_TEXTMAXLENGTH];
+    static char buf[FONT_TEXTMAXLENGTH], text[FONT_TEXTMAXLENGTH];
     va_list args;
     char *p, *q;
 
@@ -140,10 +201,7 @@ void font_set_text(font_t *f, const char *fmt, ...)
     while(has_variables_to_expand(buf))
         expand_variables(buf);
 
-    if(f->text) free(f->text);
-    f->text = mallocx(sizeof(char) * (strlen(buf) + 1));
-
-    for(p=buf,q=f->text; *p; p++,q++) {
+    for(p=buf,q=text; *p; p++,q++) {
         if(*p == '\\') {
             switch( *(p+1) ) {
                 case 'n':
@@ -166,6 +224,18 @@ void font_set_text(font_t *f, const char *fmt, ...)
     }
 
     *q = 0;
+
+    /* the HUD sets the same text over and over again */
+    if(f->text && strcmp(f->text, text) == 0)
+        return;
+
+    if(f->text == NULL || strlen(f->text) < (size_t)(q - text)) {
+        if(f->text) free(f->text);
+        f->text = mallocx(sizeof(char) * ((q - text) + 1));
+    }
+
+    strcpy(f->text, text);
+    f->run_dirty = TRUE;
 }
 
 
@@ -199,84 +269,16 @@ void font_set_width(font_t *f, int w)
  */
 void font_render(font_t *f, v2d_t camera_position)
 {
-    int offx = 0, offy = 0, w, h;
-    char *p;
-    image_t *ch;
-    uint32 color[FONT_STACKCAPACITY];
-    int i, top = 0;
-    int wordwrap;
+    int i, x, y;
+    fontglyph_t *g;
+    image_t *dest = video_get_backbuffer();
 
-    color[top++] = image_rgb(255,255,255);
-    get_font_size(f, &w, &h);
     if(f->visible && f->text) {
-        for(p=f->text; *p; p++) {
-            /* wordwrap */
-            wordwrap = FALSE;
-            if(p == f->text || (p != f->text && isspace((unsigned char)*(p-1)))) {
-                char *q;
-                int tag = FALSE;
-                int wordlen = 0;
-
-                for(q=p; !(*q=='\0' || isspace((unsigned char)*q)); q++) {
-                    if(*q == '<') tag = TRUE;
-                    if(!tag) wordlen++;
-                    if(*q == '>') tag = FALSE;
-                }
-
-                wordwrap = ((f->width > 0) && ((offx + (w + f->hspace)*wordlen - f->hspace) > f->width));
-            }
-
-            /* tags */
-            if(*p == '<') {
-
-                if(strncmp(p+1, "color=", 6) == 0) {
-                    char *orig = p;
-                    uint8 r, g, b;
-                    char tc;
-                    int valid = TRUE;
-
-                    p += 7;
-                    for(i=0; i<6 && valid; i++) {
-                        tc = tolower( *(p+i) );
-                        valid = ((tc >= '0' && tc <= '9') || (tc >= 'a' && tc <= 'f'));
-                    }
-                    valid = valid && (*(p+6) == '>');
-
-                    if(valid) {
-                        r = (hex2dec(*(p+0)) << 4) | hex2dec(*(p+1));
-                        g = (hex2dec(*(p+2)) << 4) | hex2dec(*(p+3));
-                        b = (hex2dec(*(p+4)) << 4) | hex2dec(*(p+5));
-                        p += 7;
-                        if(top < FONT_STACKCAPACITY)
-                            color[top++] = image_rgb(r,g,b);
-                    }
-                    else
-                        p = orig;
-                }
-
-                if(strncmp(p+1, "/color>", 7) == 0) {
-                    p += 8;
-                    if(top >= 2) /* we must not clear the color stack */
-                        top--;
-                }
-
-                if(!*p)
-                    break;
-            }
-
-            /* printing text */
-            if(wordwrap) { offx = 0; offy += h + f->vspace; }
-            if(*p != '\n') {
-                ch = fontdata[f->type].ch[(int)*p];
-                if(ch)
-                    render_char(video_get_backbuffer(), ch, (int)(f->position.x+offx-(camera_position.x-VIDEO_SCREEN_W/2)), (int)(f->position.y+offy-(camera_position.y-VIDEO_SCREEN_H/2)), color[top-1]);
-                offx += w + f->hspace;
-            }
-            else {
-                offx = 0;
-                offy += h + f->vspace;
-            }
-        }
+        update_glyph_run(f);
+        x = (int)(f->position.x-(camera_position.x-VIDEO_SCREEN_W/2));
+        y = (int)(f->position.y-(camera_position.y-VIDEO_SCREEN_H/2));
+        for(i=0,g=f->run; i<f->run_length; i++,g++)
+            image_draw(get_glyph(f->type, g->index, g->color), dest, x+g->x, y+g->y, IF_NONE);
     }
 }
 
@@ -324,8 +326,58 @@ void get_font_size(font_t *f, int *w, int *h)
 }
 
 
-/* returns a static char* (case insensitive search) */
+/* returns the value of a variable (case insensitive search),
+ * looking it up in the cache first */
 const char* get_variable(const char *key)
+{
+    const char *k = str_to_upper(key);
+    int i = str_to_hash(k) & (VARCACHE_SIZE-1);
+
+    /* is the cache still valid? */
+    if(varcache_lang_generation != lang_generation() || varcache_joystick_available != input_joystick_available()) {
+        varcache_clear();
+        varcache_lang_generation = lang_generation();
+        varcache_joystick_available = input_joystick_available();
+    }
+
+    /* linear probing */
+    for(; varcache[i].key != NULL; i = (i+1) & (VARCACHE_SIZE-1)) {
+        if(strcmp(varcache[i].key, k) == 0)
+            return varcache[i].value;
+    }
+
+    /* cache miss. We keep the load factor below 1/2 */
+    if(varcache_count >= VARCACHE_SIZE/2) {
+        varcache_clear();
+        i = str_to_hash(k) & (VARCACHE_SIZE-1);
+    }
+
+    varcache[i].key = str_dup(k);
+    varcache[i].value = str_dup(evaluate_variable(key));
+    varcache_count++;
+    return varcache[i].value;
+}
+
+
+/* clears the cache of variables */
+void varcache_clear()
+{
+    int i;
+
+    for(i=0; i<VARCACHE_SIZE; i++) {
+        if(varcache[i].key != NULL) {
+            free(varcache[i].key);
+            free(varcache[i].value);
+            varcache[i].key = varcache[i].value = NULL;
+        }
+    }
+
+    varcache_count = 0;
+}
+
+
+/* returns a static char* (case insensitive search) */
+const char* evaluate_variable(const char *key)
 {
     /* since our table is very small,
      * we can perform a linear search */
@@ -435,31 +487,213 @@ int has_variables_to_expand(const char *str)
 
 
 
-/* render_char() */
-void render_char(image_t *dest, image_t *ch, int x, int y, uint32 color)
+/* parses the text (word-wrap and <color> tags), storing
+ * the glyphs to be rendered. The run is rebuilt only if
+ * the text or the spacing have changed */
+void update_glyph_run(font_t *f)
 {
-    if(color == image_rgb(255,255,255))
-        image_draw(ch, dest, x, y, IF_NONE);
-    else {
-        int l, c;
-        uint8 r, g, b;
-        uint8 cr, cg, cb;
-        uint32 px, mask = video_get_maskcolor();
-
-        image_color2rgb(color, &cr, &cg, &cb);
-        for(l=0; l<ch->h; l++) {
-            for(c=0; c<ch->w; c++) {
-                px = image_getpixel(ch, c, l);
-                if(px != mask) {
-                    image_color2rgb(px, &r, &g, &b);
-                    r &= cr; g &= cg; b &= cb;
-                    image_putpixel(dest, x+c, y+l, image_rgb(r,g,b));
+    int offx = 0, offy = 0, w, h;
+    char *p;
+    uint32 color[FONT_STACKCAPACITY];
+    int i, top = 0;
+    int wordwrap;
+
+    if(!f->run_dirty && f->run_width == f->width && f->run_hspace == f->hspace && f->run_vspace == f->vspace)
+        return;
+
+    f->run_dirty = FALSE;
+    f->run_width = f->width;
+    f->run_hspace = f->hspace;
+    f->run_vspace = f->vspace;
+    f->run_length = 0;
+
+    color[top++] = image_rgb(255,255,255);
+    get_font_size(f, &w, &h);
+    for(p=f->text; p && *p; p++) {
+        /* wordwrap */
+        wordwrap = FALSE;
+        if(p == f->text || (p != f->text && isspace((unsigned char)*(p-1)))) {
+            char *q;
+            int tag = FALSE;
+            int wordlen = 0;
+
+            for(q=p; !(*q=='\0' || isspace((unsigned char)*q)); q++) {
+                if(*q == '<') tag = TRUE;
+                if(!tag) wordlen++;
+                if(*q == '>') tag = FALSE;
+            }
+
+            wordwrap = ((f->width > 0) && ((offx + (w + f->hspace)*wordlen - f->hspace) > f->width));
+        }
+
+        /* tags */
+        if(*p == '<') {
+
+            if(strncmp(p+1, "color=", 6) == 0) {
+                char *orig = p;
+                uint8 r, g, b;
+                char tc;
+                int valid = TRUE;
+
+                p += 7;
+                for(i=0; i<6 && valid; i++) {
+                    tc = tolower( *(p+i) );
+                    valid = ((tc >= '0' && tc <= '9') || (tc >= 'a' && tc <= 'f'));
                 }
+                valid = valid && (*(p+6) == '>');
+
+                if(valid) {
+                    r = (hex2dec(*(p+0)) << 4) | hex2dec(*(p+1));
+                    g = (hex2dec(*(p+2)) << 4) | hex2dec(*(p+3));
+                    b = (hex2dec(*(p+4)) << 4) | hex2dec(*(p+5));
+                    p += 7;
+                    if(top < FONT_STACKCAPACITY)
+                        color[top++] = image_rgb(r,g,b);
+                }
+                else
+                    p = orig;
             }
+
+            if(strncmp(p+1, "/color>", 7) == 0) {
+                p += 8;
+                if(top >= 2) /* we must not clear the color stack */
+                    top--;
+            }
+
+            if(!*p)
+                break;
+        }
+
+        /* storing the glyphs */
+        if(wordwrap) { offx = 0; offy += h + f->vspace; }
+        if(*p != '\n') {
+            if(fontdata[f->type].ch[(uint8)*p]) {
+                if(f->run_length >= f->run_capacity) {
+                    f->run_capacity = max(16, 2 * f->run_capacity);
+                    f->run = reallocx(f->run, f->run_capacity * sizeof *(f->run));
+                }
+                f->run[f->run_length].index = (uint8)*p;
+                f->run[f->run_length].x = offx;
+                f->run[f->run_length].y = offy;
+                f->run[f->run_length].color = color[top-1];
+                f->run_length++;
+            }
+            offx += w + f->hspace;
+        }
+        else {
+            offx = 0;
+            offy += h + f->vspace;
         }
     }
 }
 
+
+/* returns the image of a glyph of the given color */
+image_t* get_glyph(int type, uint8 index, uint32 color)
+{
+    tintcache_t *t;
+
+    if(color == image_rgb(255,255,255))
+        return fontdata[type].ch[index];
+
+    t = tintcache_get(type, color);
+    if(t->ch[index] == NULL)
+        t->ch[index] = create_tinted_glyph(fontdata[type].ch[index], color);
+
+    return t->ch[index];
+}
+
+/* finds the tinted glyphs of a (font type, color) pair. If
+ * they're not in the cache, the least recently used entry
+ * is discarded. The glyphs themselves are created on demand */
+tintcache_t* tintcache_get(int type, uint32 color)
+{
+    static tintcache_t *last = NULL;
+    int i, lru = 0;
+
+    if(last != NULL && last->in_use && last->type == type && last->color == color) {
+        last->last_used = tintcache_clock++;
+        return last;
+    }
+
+    for(i=0; i<TINTCACHE_SIZE; i++) {
+        if(tintcache[i].in_use && tintcache[i].type == type && tintcache[i].color == color) {
+            tintcache[i].last_used = tintcache_clock++;
+            return (last = &tintcache[i]);
+        }
+        else if(!tintcache[lru].in_use)
+            continue;
+        else if(!tintcache[i].in_use || tintcache[i].last_used < tintcache[lru].last_used)
+            lru = i;
+    }
+
+    /* cache miss */
+    last = &tintcache[lru];
+    if(last->in_use) {
+        for(i=0; i<256; i++) {
+            if(last->ch[i] != NULL)
+                image_destroy(last->ch[i]);
+        }
+    }
+
+    last->in_use = TRUE;
+    last->type = type;
+    last->color = color;
+    last->last_used = tintcache_clock++;
+    for(i=0; i<256; i++)
+        last->ch[i] = NULL;
+
+    return last;
+}
+
+/* clears the cache of tinted glyphs */
+void tintcache_clear()
+{
+    int i, j;
+
+    for(i=0; i<TINTCACHE_SIZE; i++) {
+        if(tintcache[i].in_use) {
+            for(j=0; j<256; j++) {
+                if(tintcache[i].ch[j] != NULL)
+                    image_destroy(tintcache[i].ch[j]);
+            }
+            tintcache[i].in_use = FALSE;
+        }
+    }
+}
+
+/* creates a copy of ch, multiplying (AND) its pixels by color */
+image_t* create_tinted_glyph(const image_t *ch, uint32 color)
+{
+    int l, c;
+    uint8 r, g, b;
+    uint8 cr, cg, cb;
+    uint32 px, mask = video_get_maskcolor();
+    image_t *img = image_create(ch->w, ch->h);
+
+    /* true color */
+    if(video_get_color_depth() > 8) {
+        imagekernel_tint(ch->data, img->data, mask, color);
+        return img;
+    }
+
+    /* palette */
+    image_color2rgb(color, &cr, &cg, &cb);
+    for(l=0; l<ch->h; l++) {
+        for(c=0; c<ch->w; c++) {
+            px = image_getpixel(ch, c, l);
+            if(px != mask) {
+                image_color2rgb(px, &r, &g, &b);
+                r &= cr; g &= cg; b &= cb;
+                px = image_rgb(r,g,b);
+            }
+            image_putpixel(img, c, l, px);
+        }
+    }
+
+    return img;
+}
+
 /* hex2dec() */
 uint8 hex2dec(char digit)
 {
@@ -22,6 +22,13 @@
 
 #include "../core/util.h"
 
+/* glyph run: the parsed text, ready to be rendered */
+typedef struct {
+    uint8 index; /* character */
+    int x, y; /* offset relative to the position of the font */
+    uint32 color;
+} fontglyph_t;
+
 /* font struct */
 #define FONT_MAXVALUES              5
 typedef struct {
@@ -33,6 +40,11 @@ typedef struct {
     int visible;
     float value[FONT_MAXVALUES]; /* alterable values */
     int hspace, vspace;
+
+    /* glyph run (private) */
+    fontglyph_t *run;
+    int run_length, run_capacity;
+    int run_dirty, run_width, run_hspace, run_vspace;
 } font_t;
 
 
@@ -48,6 +60,7 @@ void font_render(font_t *f, v2d_t camera_position);
 
 /* misc */
 void font_init(); /* initializes the font module */
+void font_release(); /* releases the font module */
 
 
 #endif
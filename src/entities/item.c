@@ -24,6 +24,7 @@
 
 #include "../core/global.h"
 #include "../core/audio.h"
+#include "../core/util.h"
 #include "../scenes/quest.h"
 #include "../scenes/level.h"
 
@@ -54,11 +55,205 @@
 #include "items/teleporter.h"
 
 
+/* item pools: the blocks of memory of the items that are
+ * spawned & destroyed all the time are kept for reuse */
+#define ITEMPOOL_MINSIZE        8   /* free blocks kept per type, by default */
+#define ITEMPOOL_MAXSIZE        128
+#define ITEMPOOL_COUNT          ((int)(sizeof(pool) / sizeof(pool[0])))
+
+typedef struct itempool_t {
+    int type; /* IT_* */
+    int capacity; /* we keep up to capacity free blocks */
+    item_t *block[ITEMPOOL_MAXSIZE]; /* free blocks: block[0 .. length-1] */
+    int length;
+    itempoolstats_t stats; /* (free_count is unused: see length) */
+} itempool_t;
+
+static itempool_t pool[] = {
+    { IT_RING, ITEMPOOL_MINSIZE },
+    { IT_ICON, ITEMPOOL_MINSIZE },
+    { IT_EXPLOSION, ITEMPOOL_MINSIZE },
+    { IT_FLYINGTEXT, ITEMPOOL_MINSIZE },
+    { IT_ANIMAL, ITEMPOOL_MINSIZE },
+    { IT_DANGPOWER, ITEMPOOL_MINSIZE },
+    { IT_FIREBALL, ITEMPOOL_MINSIZE }
+};
+
+static item_t* item_new(int type);
+static itempool_t* find_pool(int type);
+
+
 /*
  * item_create()
  * Creates a new item
  */
 item_t *item_create(int type)
+{
+    itempool_t *p = find_pool(type);
+    item_t *item;
+
+    /* a recycled block already has the methods of its type */
+    if(p != NULL && p->length > 0) {
+        item = p->block[--(p->length)];
+        p->stats.reuses++;
+    }
+    else if(NULL != (item = item_new(type)) && p != NULL)
+        p->stats.allocations++;
+
+    if(item != NULL) {
+        if(p != NULL && ++(p->stats.live) > p->stats.peak)
+            p->stats.peak = p->stats.live;
+
+        item->type = type;
+        item->state = IS_IDLE;
+        item->init(item);
+    }
+
+    return item;
+}
+
+
+
+/*
+ * item_destroy()
+ * Destroys an item
+ */
+item_t* item_destroy(item_t *item)
+{
+    itempool_t *p = find_pool(item->type);
+
+    item->release(item);
+
+    if(p != NULL) {
+        p->stats.live--;
+        if(p->length < p->capacity) {
+            p->block[(p->length)++] = item;
+            return NULL;
+        }
+    }
+
+    free(item);
+    return NULL;
+}
+
+
+
+/*
+ * item_pool_reserve()
+ * Keeps up to count destroyed items of the given
+ * type for reuse (count is clipped to a sane range).
+ * They are allocated right away. Only the items that
+ * are spawned all the time (rings, explosions, ...)
+ * have a pool; other types are ignored.
+ */
+void item_pool_reserve(int type, int count)
+{
+    itempool_t *p = find_pool(type);
+
+    if(p != NULL) {
+        p->capacity = clip(count, ITEMPOOL_MINSIZE, ITEMPOOL_MAXSIZE);
+
+        while(p->length > p->capacity)
+            free(p->block[--(p->length)]);
+        while(p->length < p->capacity)
+            p->block[(p->length)++] = item_new(type);
+    }
+}
+
+
+
+/*
+ * item_pool_release()
+ * Frees the items kept for reuse and resets
+ * the statistics. Call it after all the items
+ * have been destroyed.
+ */
+void item_pool_release()
+{
+    itempoolstats_t zero = { 0, 0, 0, 0, 0 };
+    itempool_t *p;
+    int i;
+
+    for(i=0; i<ITEMPOOL_COUNT; i++) {
+        p = &pool[i];
+        while(p->length > 0)
+            free(p->block[--(p->length)]);
+
+        p->capacity = ITEMPOOL_MINSIZE;
+        p->stats = zero;
+    }
+}
+
+
+
+/*
+ * item_pool_stats()
+ * Statistics of the pool of a given type, or
+ * of all the pools together if type < 0
+ */
+itempoolstats_t item_pool_stats(int type)
+{
+    itempoolstats_t st = { 0, 0, 0, 0, 0 };
+    int i;
+
+    for(i=0; i<ITEMPOOL_COUNT; i++) {
+        if(type < 0 || pool[i].type == type) {
+            st.live += pool[i].stats.live;
+            st.peak += pool[i].stats.peak;
+            st.free_count += pool[i].length;
+            st.reuses += pool[i].stats.reuses;
+            st.allocations += pool[i].stats.allocations;
+        }
+    }
+
+    return st;
+}
+
+
+
+
+/*
+ * item_render()
+ * Renders an item
+ */
+void item_render(item_t *item, v2d_t camera_position)
+{
+    item->render(item, camera_position);
+}
+
+
+
+/*
+ * item_think()
+ * Prefetches the collision queries the next
+ * item_update() will make. Different items
+ * may think at the same time.
+ */
+void item_think(item_t *item, brick_list_t *brick_list)
+{
+    if(item->think != NULL)
+        item->think(item, brick_list);
+}
+
+
+
+/*
+ * item_update()
+ * Runs every cycle of the game to update an item
+ */
+void item_update(item_t *item, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, enemy_list_t *enemy_list)
+{
+    item->update(item, team, team_size, brick_list, item_list, enemy_list);
+}
+
+
+
+
+/* private stuff */
+
+/* allocates a new item of the given type & sets its methods.
+ * Returns NULL if there's no such type */
+item_t* item_new(int type)
 {
     item_t *item = NULL;
 
@@ -388,48 +583,21 @@ item_t *item_create(int type)
             break;
     }
 
-    if(item != NULL) {
+    if(item != NULL)
         item->type = type;
-        item->state = IS_IDLE;
-        item->init(item);
-    }
 
     return item;
 }
 
-
-
-/*
- * item_destroy()
- * Destroys an item
- */
-item_t* item_destroy(item_t *item)
-{
-    item->release(item);
-    free(item);
-    return NULL;
-}
-
-
-
-
-/*
- * item_render()
- * Renders an item
- */
-void item_render(item_t *item, v2d_t camera_position)
+/* the pool of a given type, or NULL */
+itempool_t* find_pool(int type)
 {
-    item->render(item, camera_position);
-}
-
+    int i;
 
+    for(i=0; i<ITEMPOOL_COUNT; i++) {
+        if(pool[i].type == type)
+            return &pool[i];
+    }
 
-/*
- * item_update()
- * Runs every cycle of the game to update an item
- */
-void item_update(item_t *item, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, enemy_list_t *enemy_list)
-{
-    item->update(item, team, team_size, brick_list, item_list, enemy_list);
+    return NULL;
 }
-
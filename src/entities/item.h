@@ -133,6 +133,7 @@ struct item_t {
     void (*release)(item_t*); /* releases the item */
     void (*update)(item_t*, struct player_t**, int, struct brick_list_t*, item_list_t*, struct enemy_list_t*); /* updates the item (runs every frame) */
     void (*render)(item_t*, v2d_t); /* renders the item */
+    void (*think)(item_t*, struct brick_list_t*); /* prefetches what update() will need, or NULL. Runs in parallel with other items: it must not change anything but the sensor cache of its actor */
 
     /* properties of this item */
     struct actor_t* actor; /* actor */
@@ -149,10 +150,25 @@ struct item_list_t {
     item_list_t *next;
 };
 
+/* statistics of the item pools */
+typedef struct {
+    int live; /* pooled items that currently exist */
+    int peak; /* the most that existed at the same time */
+    int free_count; /* destroyed items waiting to be reused */
+    int reuses; /* items created from recycled memory */
+    int allocations; /* items created from fresh memory */
+} itempoolstats_t;
+
 /* public functions: these are used by the external world */
 item_t *item_create(int type); /* this is an item factory; type is a IT_* constant */
 item_t* item_destroy(item_t *item);
 void item_update(item_t *item, struct player_t** team, int team_size, struct brick_list_t *brick_list, struct item_list_t *item_list, struct enemy_list_t *enemy_list);
 void item_render(item_t *item, v2d_t camera_position);
+void item_think(item_t *item, struct brick_list_t *brick_list); /* thread-safe among different items */
+
+/* item pools: destroyed rings, explosions, animals, etc. are recycled */
+void item_pool_reserve(int type, int count); /* keeps up to count destroyed items of this type for reuse */
+void item_pool_release(); /* frees the items kept for reuse */
+itempoolstats_t item_pool_stats(int type); /* type < 0: all the pools together */
 
 #endif
@@ -35,6 +35,7 @@ static void animal_init(item_t *item);
 static void animal_release(item_t* item);
 static void animal_update(item_t* item, player_t** team, int team_size, brick_list_t* brick_list, item_list_t* item_list, enemy_list_t* enemy_list);
 static void animal_render(item_t* item, v2d_t camera_position);
+static void animal_think(item_t* item, brick_list_t* brick_list);
 
 
 
@@ -47,6 +48,7 @@ item_t* animal_create()
     item->release = animal_release;
     item->update = animal_update;
     item->render = animal_render;
+    item->think = animal_think;
 
     return item;
 }
@@ -120,6 +122,17 @@ void animal_update(item_t* item, player_t** team, int team_size, brick_list_t* b
 }
 
 
+void animal_think(item_t* item, brick_list_t* brick_list)
+{
+    actor_t *act = item->actor;
+    brick_t *up, *down, *left, *right;
+    float sqrsize = 2, diff = -2;
+
+    actor_corners(act, sqrsize, diff, brick_list, &up, NULL, &right, NULL, &down, NULL, &left, NULL);
+    actor_prefetch_platform_movement(act, brick_list);
+}
+
+
 void animal_render(item_t* item, v2d_t camera_position)
 {
     actor_render(item->actor, camera_position);
@@ -112,6 +112,7 @@ item_t* animalprison_create()
     item->release = animalprison_release;
     item->update = animalprison_update;
     item->render = animalprison_render;
+    item->think = NULL;
 
     me->state = NULL;
 
@@ -45,6 +45,7 @@ item_t* bigring_create()
     item->release = bigring_release;
     item->update = bigring_update;
     item->render = bigring_render;
+    item->think = NULL;
 
     return item;
 }
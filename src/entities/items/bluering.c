@@ -45,6 +45,7 @@ item_t* bluering_create()
     item->release = bluering_release;
     item->update = bluering_update;
     item->render = bluering_render;
+    item->think = NULL;
 
     return item;
 }
@@ -50,6 +50,7 @@ item_t* bumper_create()
     item->release = bumper_release;
     item->update = bumper_update;
     item->render = bumper_render;
+    item->think = NULL;
 
     return item;
 }
@@ -45,6 +45,7 @@ item_t* checkpointorb_create()
     item->release = checkpointorb_release;
     item->update = checkpointorb_update;
     item->render = checkpointorb_render;
+    item->think = NULL;
 
     return item;
 }
@@ -44,6 +44,7 @@ item_t* crushedbox_create()
     item->release = crushedbox_release;
     item->update = crushedbox_update;
     item->render = crushedbox_render;
+    item->think = NULL;
 
     return item;
 }
@@ -72,6 +72,7 @@ item_t* danger_create(const char *sprite_name, int (*player_is_vulnerable)(playe
     item->release = danger_release;
     item->update = danger_update;
     item->render = danger_render;
+    item->think = NULL;
 
     me->sprite_name = str_dup(sprite_name);
     me->player_is_vulnerable = player_is_vulnerable;
@@ -45,6 +45,7 @@ item_t* dangerouspower_create()
     item->release = dangerouspower_release;
     item->update = dangerouspower_update;
     item->render = dangerouspower_render;
+    item->think = NULL;
 
     return item;
 }
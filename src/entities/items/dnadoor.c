@@ -82,6 +82,7 @@ item_t* dnadoor_create(int authorized_player_type, int is_vertical_door)
     item->release = dnadoor_release;
     item->update = dnadoor_update;
     item->render = dnadoor_render;
+    item->think = NULL;
 
     me->authorized_player_type = authorized_player_type;
     me->is_vertical_door = is_vertical_door;
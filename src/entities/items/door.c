@@ -48,6 +48,7 @@ item_t* door_create()
     item->release = door_release;
     item->update = door_update;
     item->render = door_render;
+    item->think = NULL;
 
     return item;
 }
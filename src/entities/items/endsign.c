@@ -45,6 +45,7 @@ item_t* endsign_create()
     item->release = endsign_release;
     item->update = endsign_update;
     item->render = endsign_render;
+    item->think = NULL;
 
     return item;
 }
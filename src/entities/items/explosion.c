@@ -44,6 +44,7 @@ item_t* explosion_create()
     item->release = explosion_release;
     item->update = explosion_update;
     item->render = explosion_render;
+    item->think = NULL;
 
     return item;
 }
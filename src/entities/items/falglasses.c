@@ -44,6 +44,7 @@ item_t* falglasses_create()
     item->release = falglasses_release;
     item->update = falglasses_update;
     item->render = falglasses_render;
+    item->think = NULL;
 
     return item;
 }
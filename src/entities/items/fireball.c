@@ -40,6 +40,8 @@ static void falling_behavior(item_t *fireball, brick_list_t *brick_list);
 static void disappearing_behavior(item_t *fireball, brick_list_t *brick_list);
 static void smallfire_behavior(item_t *fireball, brick_list_t *brick_list);
 
+static brick_t* sweep_movement(actor_t *act, float sqrsize, float diff, brick_list_t *brick_list);
+
 
 
 /* public methods */
@@ -51,6 +53,7 @@ item_t* fireball_create()
     item->release = fireball_release;
     item->update = fireball_update;
     item->render = fireball_render;
+    item->think = NULL;
 
     return item;
 }
@@ -121,11 +124,12 @@ void falling_behavior(item_t *fireball, brick_list_t *brick_list)
     /* movement & animation */
     act->speed.x = 0.0f;
     act->mirror = (act->speed.y < 0.0f) ? IF_VFLIP : IF_NONE;
-    actor_move(act, actor_particle_movement(act, level_gravity()));
+    down = sweep_movement(act, sqrsize, diff, brick_list);
     actor_change_animation(act, sprite_get_animation("SD_FIREBALL", 0));
 
     /* collision detection */
-    actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
+    if(!down)
+        actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
     actor_handle_clouds(act, diff, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
     if(down) {
         /* I have just touched the ground */
@@ -158,13 +162,36 @@ void smallfire_behavior(item_t *fireball, brick_list_t *brick_list)
     brick_t *down;
 
     /* movement & animation */
-    actor_move(act, actor_particle_movement(act, level_gravity()));
+    down = sweep_movement(act, sqrsize, diff, brick_list);
     actor_change_animation(act, sprite_get_animation("SD_FIREBALL", 2));
 
     /* collision detection */
-    actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
+    if(!down)
+        actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
     actor_handle_clouds(act, diff, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
     if(down && act->speed.y > 0.0f)
         fireball->state = IS_DEAD;
 }
 
+
+/* misc */
+
+/* moves a falling fireball. Its 'down' sensor is swept
+ * along the way, so that it can't fall through a thin
+ * brick. Returns the brick it has landed on, if any */
+brick_t* sweep_movement(actor_t *act, float sqrsize, float diff, brick_list_t *brick_list)
+{
+    v2d_t ds = actor_particle_movement(act, level_gravity());
+    v2d_t world_ds = v2d_rotate(ds, -act->angle); /* see actor_move() */
+    float length = v2d_magnitude(world_ds), distance;
+    brick_t *brk = NULL;
+
+    if(ds.y > 0.0f && length > EPSILON) {
+        brk = actor_corners_sweep_down(act, sqrsize, diff, brick_list, world_ds, &distance);
+        if(brk)
+            ds = v2d_multiply(ds, distance / length);
+    }
+
+    actor_move(act, ds);
+    return brk;
+}
@@ -48,6 +48,7 @@ item_t* flyingtext_create()
     item->release = flyingtext_release;
     item->update = flyingtext_update;
     item->render = flyingtext_render;
+    item->think = NULL;
 
     return item;
 }
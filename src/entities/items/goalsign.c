@@ -22,11 +22,14 @@
 #include "../../core/util.h"
 #include "../player.h"
 #include "../enemy.h"
+#include "../../scenes/level.h"
 
 /* goalsign class */
 typedef struct goalsign_t goalsign_t;
 struct goalsign_t {
     item_t item; /* base class */
+    item_t *endsign; /* the closest endsign */
+    unsigned int generation; /* level_item_generation() when endsign was found */
 };
 
 static void goalsign_init(item_t *item);
@@ -43,6 +46,7 @@ item_t* goalsign_create()
     item->release = goalsign_release;
     item->update = goalsign_update;
     item->render = goalsign_render;
+    item->think = NULL;
 
     return item;
 }
@@ -51,6 +55,11 @@ item_t* goalsign_create()
 /* private methods */
 void goalsign_init(item_t *item)
 {
+    goalsign_t *me = (goalsign_t*)item;
+
+    me->endsign = NULL;
+    me->generation = 0;
+
     item->obstacle = FALSE;
     item->bring_to_back = TRUE;
     item->preserve = TRUE;
@@ -70,10 +79,17 @@ void goalsign_release(item_t* item)
 
 void goalsign_update(item_t* item, player_t** team, int team_size, brick_list_t* brick_list, item_list_t* item_list, enemy_list_t* enemy_list)
 {
+    goalsign_t *me = (goalsign_t*)item;
     item_t *endsign;
     int anim;
 
-    endsign = find_closest_item(item, item_list, IT_ENDSIGN, NULL);
+    /* the goal sign and the end sign don't move */
+    if(me->generation != level_item_generation()) {
+        me->generation = level_item_generation();
+        me->endsign = find_closest_item(item, item_list, IT_ENDSIGN, NULL);
+    }
+
+    endsign = me->endsign;
     if(endsign != NULL) {
         if(endsign->actor->position.x > item->actor->position.x)
             anim = 0;
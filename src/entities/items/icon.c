@@ -45,6 +45,7 @@ item_t* icon_create()
     item->release = icon_release;
     item->update = icon_update;
     item->render = icon_render;
+    item->think = NULL;
 
     return item;
 }
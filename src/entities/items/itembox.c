@@ -222,6 +222,7 @@ item_t* itembox_create(void (*on_destroy)(item_t*,player_t*), int anim_id)
     item->release = itembox_release;
     item->update = itembox_update;
     item->render = itembox_render;
+    item->think = NULL;
 
     me->on_destroy = on_destroy;
     me->anim_id = anim_id;
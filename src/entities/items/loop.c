@@ -29,6 +29,8 @@ struct loop_t {
     item_t item; /* base class */
     char *sprite_name; /* sprite name */
     void (*on_collision)(player_t*); /* strategy pattern */
+    item_t *floortop; /* the closest loopfloortop object */
+    unsigned int generation; /* level_item_generation() when floortop was found */
 };
 
 static item_t* loop_create(void (*strategy)(player_t*), const char *sprite_name);
@@ -169,6 +171,7 @@ item_t* loop_create(void (*strategy)(player_t*), const char *sprite_name)
     item->release = loop_release;
     item->update = loop_update;
     item->render = loop_render;
+    item->think = NULL;
 
     me->on_collision = strategy;
     me->sprite_name = str_dup(sprite_name);
@@ -186,6 +189,8 @@ void loop_init(item_t *item)
     item->preserve = TRUE;
     item->actor = actor_create();
 
+    me->floortop = NULL;
+    me->generation = 0;
     actor_change_animation(item->actor, sprite_get_animation(me->sprite_name, 0));
 }
 
@@ -229,7 +234,16 @@ void loop_render(item_t* item, v2d_t camera_position)
    (relative to item)? */
 int is_player_at_closest_loopfloortop(item_t *item, item_list_t *item_list, player_t *player)
 {
-    item_t *obj = find_closest_item(item, item_list, IT_LOOPFLOORTOP, NULL);
+    loop_t *me = (loop_t*)item;
+    item_t *obj;
+
+    /* loops don't move: the pair is resolved again only when items get created or destroyed */
+    if(me->generation != level_item_generation()) {
+        me->generation = level_item_generation();
+        me->floortop = find_closest_item(item, item_list, IT_LOOPFLOORTOP, NULL);
+    }
+
+    obj = me->floortop;
     return (obj != NULL) ? actor_collision(player->actor, obj->actor) : FALSE;
 }
 
@@ -38,6 +38,7 @@ static void ring_init(item_t *item);
 static void ring_release(item_t* item);
 static void ring_update(item_t* item, player_t** team, int team_size, brick_list_t* brick_list, item_list_t* item_list, enemy_list_t* enemy_list);
 static void ring_render(item_t* item, v2d_t camera_position);
+static void ring_think(item_t* item, brick_list_t* brick_list);
 
 
 
@@ -50,6 +51,7 @@ item_t* ring_create()
     item->release = ring_release;
     item->update = ring_update;
     item->render = ring_render;
+    item->think = ring_think;
 
     return item;
 }
@@ -169,6 +171,21 @@ void ring_update(item_t* item, player_t** team, int team_size, brick_list_t* bri
 }
 
 
+void ring_think(item_t* item, brick_list_t* brick_list)
+{
+    ring_t *me = (ring_t*)item;
+    actor_t *act = item->actor;
+
+    /* only a bouncing ring looks at the bricks */
+    if(me->is_moving && !me->is_disappearing) {
+        float sqrsize = 2, diff = -2;
+        brick_t *left, *right, *down;
+        actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, &right, NULL, &down, NULL, &left, NULL);
+        actor_prefetch_platform_movement(act, brick_list);
+    }
+}
+
+
 void ring_render(item_t* item, v2d_t camera_position)
 {
     actor_render(item->actor, camera_position);
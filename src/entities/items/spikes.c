@@ -103,6 +103,7 @@ item_t* spikes_create(int (*collision)(item_t*,player_t*), int anim_id, float cy
     item->release = spikes_release;
     item->update = spikes_update;
     item->render = spikes_render;
+    item->think = NULL;
 
     me->collision = collision;
     me->anim_id = anim_id;
@@ -202,6 +202,7 @@ item_t* spring_create(void (*strategy)(item_t*,player_t*), const char *sprite_na
     item->release = spring_release;
     item->update = spring_update;
     item->render = spring_render;
+    item->think = NULL;
 
     me->on_bump = strategy;
     me->sprite_name = str_dup(sprite_name);
@@ -35,6 +35,8 @@ struct switch_t {
     item_t item; /* base class */
     int is_pressed; /* is this switch being pressed? */
     item_t *partner; /* the object I am coupled with (may be NULL, a door or a teleporter) */
+    item_t *door, *teleporter; /* the closest door and the closest teleporter */
+    unsigned int generation; /* level_item_generation() when door & teleporter were found */
 };
 
 static void switch_init(item_t *item);
@@ -63,6 +65,7 @@ item_t* switch_create()
     item->release = switch_release;
     item->update = switch_update;
     item->render = switch_render;
+    item->think = NULL;
 
     return item;
 }
@@ -80,6 +83,8 @@ void switch_init(item_t *item)
 
     me->is_pressed = FALSE;
     me->partner = NULL;
+    me->door = me->teleporter = NULL;
+    me->generation = 0;
     actor_change_animation(item->actor, sprite_get_animation("SD_SWITCH", 0));
 }
 
@@ -98,16 +103,22 @@ void switch_update(item_t* item, player_t** team, int team_size, brick_list_t* b
     item_t *door, *teleporter;
     float d1, d2;
 
-    /* I have no partner */
-    me->partner = NULL;
+    /* figuring out who is my partner. Switches, doors and teleporters
+       stay where they were placed, so we only need to do this again
+       when items get created or destroyed */
+    if(me->generation != level_item_generation()) {
+        me->generation = level_item_generation();
+        me->partner = NULL;
+        me->door = find_closest_item(item, item_list, IT_DOOR, &d1);
+        me->teleporter = find_closest_item(item, item_list, IT_TELEPORTER, &d2);
+        if(me->door != NULL && d1 < d2)
+            me->partner = me->door;
+        if(me->teleporter != NULL && d2 < d1)
+            me->partner = me->teleporter;
+    }
 
-    /* figuring out who is my partner */
-    door = find_closest_item(item, item_list, IT_DOOR, &d1);
-    teleporter = find_closest_item(item, item_list, IT_TELEPORTER, &d2);
-    if(door != NULL && d1 < d2)
-        me->partner = door;
-    if(teleporter != NULL && d2 < d1)
-        me->partner = teleporter;
+    door = me->door;
+    teleporter = me->teleporter;
 
     /* handle the logic. Which logic? That depends. Who is my partner, if any? */
     if(me->partner == NULL)
@@ -123,7 +134,7 @@ void switch_render(item_t* item, v2d_t camera_position)
 {
     switch_t *me = (switch_t*)item;
 
-    if(level_editmode() && me->partner != NULL) {
+    if(level_editmode() && me->partner != NULL && me->generation == level_item_generation()) {
         v2d_t p1, p2, offset;
         offset = v2d_subtract(camera_position, v2d_new(VIDEO_SCREEN_W/2, VIDEO_SCREEN_H/2));
         p1 = v2d_subtract(item->actor->position, offset);
@@ -53,6 +53,7 @@ item_t* teleporter_create()
     item->release = teleporter_release;
     item->update = teleporter_update;
     item->render = teleporter_render;
+    item->think = NULL;
 
     return item;
 }
@@ -23,12 +23,17 @@
 #include "../../../core/global.h"
 #include "../../../entities/item.h"
 #include "../../../entities/actor.h"
+#include "../../../scenes/level.h"
 
 /*
  * find_closest_item()
  * Finds the closest item (minimal distance) of
  * a given type relative to 'me'. Returns NULL
  * if nothing nice is found.
+ *
+ * When list is the item list of the level, the
+ * spatial index of the level is used instead of
+ * a linear search.
  */
 item_t *find_closest_item(item_t *me, item_list_t *list, int desired_type, float *distance)
 {
@@ -37,6 +42,9 @@ item_t *find_closest_item(item_t *me, item_list_t *list, int desired_type, float
     item_t *ret = NULL;
     v2d_t v;
 
+    if(list != NULL && list == level_item_list())
+        return level_closest_item(me->actor->position, desired_type, distance);
+
     for(it=list; it; it=it->next) { /* this list must be small enough */
         if(it->data->type == desired_type) {
             v = v2d_subtract(it->data->actor->position, me->actor->position);
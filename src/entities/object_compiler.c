@@ -22,20 +22,9 @@
 #include "../core/util.h"
 #include "../core/stringutil.h"
 
-#include "object_decorators/look.h"
 #include "object_decorators/lock_camera.h"
-#include "object_decorators/gravity.h"
-#include "object_decorators/jump.h"
-#include "object_decorators/walk.h"
-#include "object_decorators/elliptical_trajectory.h"
 #include "object_decorators/bounce_player.h"
-#include "object_decorators/bullet_trajectory.h"
-#include "object_decorators/mosquito_movement.h"
 #include "object_decorators/on_event.h"
-#include "object_decorators/set_animation.h"
-#include "object_decorators/set_obstacle.h"
-#include "object_decorators/set_alpha.h"
-#include "object_decorators/enemy.h"
 #include "object_decorators/move_player.h"
 #include "object_decorators/player_movement.h"
 #include "object_decorators/player_action.h"
@@ -46,7 +35,6 @@
 #include "object_decorators/children.h"
 #include "object_decorators/create_item.h"
 #include "object_decorators/change_closest_object_state.h"
-#include "object_decorators/destroy.h"
 #include "object_decorators/dialog_box.h"
 #include "object_decorators/audio.h"
 #include "object_decorators/clear_level.h"
@@ -57,13 +45,9 @@
 
 /* private stuff ;) */
 #define DEFAULT_STATE                   "main"
-#define STACKMAX                        1024
-static void compile_command(objectmachine_t** machine_ref, const char *command, int n, const char *param[]);
+static void compile_command(objectvm_t* vm, const char *command, int n, const char *param[]);
 static int traverse_object(const parsetree_statement_t *stmt, void *object);
-static int traverse_object_state(const parsetree_statement_t *stmt, void *machine);
-static int push_object_state(const parsetree_statement_t *stmt, void *machine);
-static struct { const parsetree_statement_t *stmt; void *machine; } stack[STACKMAX];
-static int stacksize;
+static int traverse_object_state(const parsetree_statement_t *stmt, void *vm);
 
 /* -------------------------------------- */
 
@@ -71,100 +55,100 @@ static int stacksize;
    available actions:
    -----------------------------------------------
    they all receive:
-   1. m         : reference to an object machine (used to add a decorator to the machine)
+   1. vm        : the virtual machine (the ops are appended to its current state)
    2. n         : the length of the array containing the parameters
    3. p[0..n-1] : the array containing the parameters
 */
 
 /* basic actions */
-static void set_animation(objectmachine_t** m, int n, const char **p);
-static void set_obstacle(objectmachine_t** m, int n, const char **p);
-static void set_alpha(objectmachine_t** m, int n, const char **p);
-static void hide(objectmachine_t** m, int n, const char **p);
-static void show(objectmachine_t** m, int n, const char **p);
-static void enemy(objectmachine_t** m, int n, const char **p);
+static void set_animation(objectvm_t* vm, int n, const char **p);
+static void set_obstacle(objectvm_t* vm, int n, const char **p);
+static void set_alpha(objectvm_t* vm, int n, const char **p);
+static void hide(objectvm_t* vm, int n, const char **p);
+static void show(objectvm_t* vm, int n, const char **p);
+static void enemy(objectvm_t* vm, int n, const char **p);
 
 /* player interaction */
-static void lock_camera(objectmachine_t** m, int n, const char **p);
-static void move_player(objectmachine_t** m, int n, const char **p);
-static void hit_player(objectmachine_t** m, int n, const char **p);
-static void burn_player(objectmachine_t** m, int n, const char **p);
-static void shock_player(objectmachine_t** m, int n, const char **p);
-static void acid_player(objectmachine_t** m, int n, const char **p);
-static void add_rings(objectmachine_t** m, int n, const char **p);
-static void add_to_score(objectmachine_t** m, int n, const char **p);
-static void set_player_animation(objectmachine_t** m, int n, const char **p);
-static void enable_player_movement(objectmachine_t** m, int n, const char **p);
-static void disable_player_movement(objectmachine_t** m, int n, const char **p);
-static void set_player_xspeed(objectmachine_t** m, int n, const char **p);
-static void set_player_yspeed(objectmachine_t** m, int n, const char **p);
-static void set_player_position(objectmachine_t** m, int n, const char **p);
-static void bounce_player(objectmachine_t** m, int n, const char **p);
-static void observe_player(objectmachine_t** m, int n, const char **p);
-static void observe_current_player(objectmachine_t** m, int n, const char **p);
-static void observe_active_player(objectmachine_t** m, int n, const char **p);
-static void observe_all_players(objectmachine_t** m, int n, const char **p);
-static void attach_to_player(objectmachine_t** m, int n, const char **p);
-static void springfy_player(objectmachine_t** m, int n, const char **p);
-static void roll_player(objectmachine_t** m, int n, const char **p);
+static void lock_camera(objectvm_t* vm, int n, const char **p);
+static void move_player(objectvm_t* vm, int n, const char **p);
+static void hit_player(objectvm_t* vm, int n, const char **p);
+static void burn_player(objectvm_t* vm, int n, const char **p);
+static void shock_player(objectvm_t* vm, int n, const char **p);
+static void acid_player(objectvm_t* vm, int n, const char **p);
+static void add_rings(objectvm_t* vm, int n, const char **p);
+static void add_to_score(objectvm_t* vm, int n, const char **p);
+static void set_player_animation(objectvm_t* vm, int n, const char **p);
+static void enable_player_movement(objectvm_t* vm, int n, const char **p);
+static void disable_player_movement(objectvm_t* vm, int n, const char **p);
+static void set_player_xspeed(objectvm_t* vm, int n, const char **p);
+static void set_player_yspeed(objectvm_t* vm, int n, const char **p);
+static void set_player_position(objectvm_t* vm, int n, const char **p);
+static void bounce_player(objectvm_t* vm, int n, const char **p);
+static void observe_player(objectvm_t* vm, int n, const char **p);
+static void observe_current_player(objectvm_t* vm, int n, const char **p);
+static void observe_active_player(objectvm_t* vm, int n, const char **p);
+static void observe_all_players(objectvm_t* vm, int n, const char **p);
+static void attach_to_player(objectvm_t* vm, int n, const char **p);
+static void springfy_player(objectvm_t* vm, int n, const char **p);
+static void roll_player(objectvm_t* vm, int n, const char **p);
 
 /* movement */
-static void walk(objectmachine_t** m, int n, const char **p);
-static void gravity(objectmachine_t** m, int n, const char **p);
-static void jump(objectmachine_t** m, int n, const char **p);
-static void bullet_trajectory(objectmachine_t** m, int n, const char **p);
-static void elliptical_trajectory(objectmachine_t** m, int n, const char **p);
-static void mosquito_movement(objectmachine_t** m, int n, const char **p);
-static void look_left(objectmachine_t** m, int n, const char **p);
-static void look_right(objectmachine_t** m, int n, const char **p);
-static void look_at_player(objectmachine_t** m, int n, const char **p);
-static void look_at_walking_direction(objectmachine_t** m, int n, const char **p);
+static void walk(objectvm_t* vm, int n, const char **p);
+static void gravity(objectvm_t* vm, int n, const char **p);
+static void jump(objectvm_t* vm, int n, const char **p);
+static void bullet_trajectory(objectvm_t* vm, int n, const char **p);
+static void elliptical_trajectory(objectvm_t* vm, int n, const char **p);
+static void mosquito_movement(objectvm_t* vm, int n, const char **p);
+static void look_left(objectvm_t* vm, int n, const char **p);
+static void look_right(objectvm_t* vm, int n, const char **p);
+static void look_at_player(objectvm_t* vm, int n, const char **p);
+static void look_at_walking_direction(objectvm_t* vm, int n, const char **p);
 
 /* object management */
-static void create_item(objectmachine_t** m, int n, const char **p);
-static void change_closest_object_state(objectmachine_t** m, int n, const char **p);
-static void create_child(objectmachine_t** m, int n, const char **p);
-static void change_child_state(objectmachine_t** m, int n, const char **p);
-static void change_parent_state(objectmachine_t** m, int n, const char **p);
-static void destroy(objectmachine_t** m, int n, const char **p);
+static void create_item(objectvm_t* vm, int n, const char **p);
+static void change_closest_object_state(objectvm_t* vm, int n, const char **p);
+static void create_child(objectvm_t* vm, int n, const char **p);
+static void change_child_state(objectvm_t* vm, int n, const char **p);
+static void change_parent_state(objectvm_t* vm, int n, const char **p);
+static void destroy(objectvm_t* vm, int n, const char **p);
 
 /* events */
-static void change_state(objectmachine_t** m, int n, const char **p);
-static void on_timeout(objectmachine_t** m, int n, const char **p);
-static void on_collision(objectmachine_t** m, int n, const char **p);
-static void on_animation_finished(objectmachine_t** m, int n, const char **p);
-static void on_random_event(objectmachine_t** m, int n, const char **p);
-static void on_player_collision(objectmachine_t** m, int n, const char **p);
-static void on_player_attack(objectmachine_t** m, int n, const char **p);
-static void on_player_rect_collision(objectmachine_t** m, int n, const char **p);
-static void on_no_shield(objectmachine_t** m, int n, const char **p);
-static void on_shield(objectmachine_t** m, int n, const char **p);
-static void on_fire_shield(objectmachine_t** m, int n, const char **p);
-static void on_thunder_shield(objectmachine_t** m, int n, const char **p);
-static void on_water_shield(objectmachine_t** m, int n, const char **p);
-static void on_acid_shield(objectmachine_t** m, int n, const char **p);
-static void on_wind_shield(objectmachine_t** m, int n, const char **p);
-static void on_brick_collision(objectmachine_t** m, int n, const char **p);
-static void on_floor_collision(objectmachine_t** m, int n, const char **p);
-static void on_ceiling_collision(objectmachine_t** m, int n, const char **p);
-static void on_left_wall_collision(objectmachine_t** m, int n, const char **p);
-static void on_right_wall_collision(objectmachine_t** m, int n, const char **p);
+static void change_state(objectvm_t* vm, int n, const char **p);
+static void on_timeout(objectvm_t* vm, int n, const char **p);
+static void on_collision(objectvm_t* vm, int n, const char **p);
+static void on_animation_finished(objectvm_t* vm, int n, const char **p);
+static void on_random_event(objectvm_t* vm, int n, const char **p);
+static void on_player_collision(objectvm_t* vm, int n, const char **p);
+static void on_player_attack(objectvm_t* vm, int n, const char **p);
+static void on_player_rect_collision(objectvm_t* vm, int n, const char **p);
+static void on_no_shield(objectvm_t* vm, int n, const char **p);
+static void on_shield(objectvm_t* vm, int n, const char **p);
+static void on_fire_shield(objectvm_t* vm, int n, const char **p);
+static void on_thunder_shield(objectvm_t* vm, int n, const char **p);
+static void on_water_shield(objectvm_t* vm, int n, const char **p);
+static void on_acid_shield(objectvm_t* vm, int n, const char **p);
+static void on_wind_shield(objectvm_t* vm, int n, const char **p);
+static void on_brick_collision(objectvm_t* vm, int n, const char **p);
+static void on_floor_collision(objectvm_t* vm, int n, const char **p);
+static void on_ceiling_collision(objectvm_t* vm, int n, const char **p);
+static void on_left_wall_collision(objectvm_t* vm, int n, const char **p);
+static void on_right_wall_collision(objectvm_t* vm, int n, const char **p);
 
 /* level */
-static void show_dialog_box(objectmachine_t** m, int n, const char **p);
-static void hide_dialog_box(objectmachine_t** m, int n, const char **p);
-static void clear_level(objectmachine_t** m, int n, const char **p);
+static void show_dialog_box(objectvm_t* vm, int n, const char **p);
+static void hide_dialog_box(objectvm_t* vm, int n, const char **p);
+static void clear_level(objectvm_t* vm, int n, const char **p);
 
 /* audio commands */
-static void audio_play_sample(objectmachine_t** m, int n, const char **p);
-static void audio_play_music(objectmachine_t** m, int n, const char **p);
-static void audio_play_level_music(objectmachine_t** m, int n, const char **p);
-static void audio_set_music_volume(objectmachine_t** m, int n, const char **p);
+static void audio_play_sample(objectvm_t* vm, int n, const char **p);
+static void audio_play_music(objectvm_t* vm, int n, const char **p);
+static void audio_play_level_music(objectvm_t* vm, int n, const char **p);
+static void audio_set_music_volume(objectvm_t* vm, int n, const char **p);
 
 /* -------------------------------------- */
 
 /* command table */
-typedef struct { const char *command; void (*action)(objectmachine_t**,int,const char**); } entry_t;
+typedef struct { const char *command; void (*action)(objectvm_t*,int,const char**); } entry_t;
 static entry_t command_table[] = {
     /* basic actions */
     { "set_animation", set_animation },
@@ -285,7 +269,6 @@ int traverse_object(const parsetree_statement_t* stmt, void *object)
     object_t *e = (object_t*)object;
     const char *id = nanoparser_get_identifier(stmt);
     const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
-    objectmachine_t **machine_ref;
 
     if(str_icmp(id, "state") == 0) {
         const parsetree_parameter_t *p1, *p2;
@@ -303,14 +286,8 @@ int traverse_object(const parsetree_statement_t* stmt, void *object)
 
         objectvm_create_state(e->vm, state_name);
         objectvm_set_current_state(e->vm, state_name);
-        machine_ref = objectvm_get_reference_to_current_state(e->vm);
-
-        stacksize = 0;
-        nanoparser_traverse_program_ex(state_code, (void*)machine_ref, push_object_state);
-        while(stacksize-- > 0) /* traverse in reverse order - note the order of the decorators */
-            traverse_object_state(stack[stacksize].stmt, stack[stacksize].machine);
-
-        (*machine_ref)->init(*machine_ref);
+        nanoparser_traverse_program_ex(state_code, (void*)(e->vm), traverse_object_state);
+        objectvm_init_current_state(e->vm);
     }
     else if(str_icmp(id, "requires") == 0) {
         if(nanoparser_get_number_of_parameters(param_list) == 1) {
@@ -357,9 +334,8 @@ int traverse_object(const parsetree_statement_t* stmt, void *object)
     return 0;
 }
 
-int traverse_object_state(const parsetree_statement_t* stmt, void *machine)
+int traverse_object_state(const parsetree_statement_t* stmt, void *vm)
 {
-    objectmachine_t **ref = (objectmachine_t**)machine; /* reference to the current object machine */
     const char *id = nanoparser_get_identifier(stmt); /* command string */
     const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
     const char **p_k;
@@ -374,8 +350,8 @@ int traverse_object_state(const parsetree_statement_t* stmt, void *machine)
         p_k[i] = nanoparser_get_string(p);
     }
 
-    /* adds the corresponding decorator to the machine */
-    compile_command(ref, id, n, p_k);
+    /* appends the corresponding op to the current state */
+    compile_command((objectvm_t*)vm, id, n, p_k);
 
     /* releases the parameter list */
     free(p_k);
@@ -384,20 +360,7 @@ int traverse_object_state(const parsetree_statement_t* stmt, void *machine)
     return 0;
 }
 
-int push_object_state(const parsetree_statement_t* stmt, void *machine)
-{
-    if(stacksize < STACKMAX) {
-        stack[stacksize].stmt = stmt;
-        stack[stacksize].machine = machine;
-        stacksize++;
-    }
-    else
-        fatal_error("Object script error: you may write %d commands or less per state", STACKMAX);
-
-    return 0;
-}
-
-void compile_command(objectmachine_t** machine_ref, const char *command, int n, const char *param[])
+void compile_command(objectvm_t* vm, const char *command, int n, const char *param[])
 {
     int i = 0;
     entry_t e = command_table[i++];
@@ -405,7 +368,7 @@ void compile_command(objectmachine_t** machine_ref, const char *command, int n,
     /* finds the corresponding command in the table */
     while(e.command != NULL && e.action != NULL) {
         if(str_icmp(e.command, command) == 0) {
-            (e.action)(machine_ref, n, (const char**)param);
+            (e.action)(vm, n, (const char**)param);
             return;
         }
 
@@ -419,588 +382,600 @@ void compile_command(objectmachine_t** machine_ref, const char *command, int n,
 /* -------------------------------------- */
 
 /* action programming */
-void set_animation(objectmachine_t** m, int n, const char **p)
+void set_animation(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_setanimation_new(*m, p[0], atoi(p[1]));
+        objectvm_emit(vm, OP_SET_ANIMATION)->arg.anim = sprite_get_animation(p[0], atoi(p[1]));
     else
         fatal_error("Object script error - set_animation expects two parameters: sprite_name, animation_id");
 }
 
-void set_obstacle(objectmachine_t** m, int n, const char **p)
+void set_obstacle(objectvm_t* vm, int n, const char **p)
 {
-    if(n == 1)
-        *m = objectdecorator_setobstacle_new(*m, atob(p[0]), 0);
-    else if(n == 2)
-        *m = objectdecorator_setobstacle_new(*m, atob(p[0]), atoi(p[1]));
+    objectop_t *op;
+
+    if(n == 1 || n == 2) {
+        op = objectvm_emit(vm, OP_SET_OBSTACLE);
+        op->arg.obstacle.is_obstacle = atob(p[0]);
+        op->arg.obstacle.angle = (n == 2) ? atoi(p[1]) : 0;
+    }
     else
         fatal_error("Object script error - set_obstacle expects at least one and at most two parameters: is_obstacle (TRUE or FALSE) [, angle]");
 }
 
-void set_alpha(objectmachine_t** m, int n, const char **p)
+void set_alpha(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_setalpha_new(*m, atof(p[0]));
+        objectvm_emit(vm, OP_SET_ALPHA)->arg.alpha = clip(atof(p[0]), 0.0f, 1.0f);
     else
         fatal_error("Object script error - set_alpha expects one parameter: alpha (0.0 (transparent) <= alpha <= 1.0 (opaque))");
 }
 
-void hide(objectmachine_t** m, int n, const char **p)
+void hide(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_setalpha_new(*m, 0.0f);
+        objectvm_emit(vm, OP_SET_ALPHA)->arg.alpha = 0.0f;
     else
         fatal_error("Object script error - hide expects no parameters");
 }
 
-void show(objectmachine_t** m, int n, const char **p)
+void show(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_setalpha_new(*m, 1.0f);
+        objectvm_emit(vm, OP_SET_ALPHA)->arg.alpha = 1.0f;
     else
         fatal_error("Object script error - show expects no parameters");
 }
 
-void bullet_trajectory(objectmachine_t** m, int n, const char **p)
+void bullet_trajectory(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_bullettrajectory_new(*m, atof(p[0]), atof(p[1]));
+        objectvm_emit(vm, OP_BULLET_TRAJECTORY)->arg.speed = v2d_new(atof(p[0]), atof(p[1]));
     else
         fatal_error("Object script error - bullet_trajectory expects two parameters: speed_x, speed_y");
 }
 
-void create_item(objectmachine_t** m, int n, const char **p)
+void create_item(objectvm_t* vm, int n, const char **p)
 {
     if(n == 3)
-        *m = objectdecorator_createitem_new(*m, atoi(p[0]), atof(p[1]), atof(p[2]));
+        objectvm_emit_machine(vm, objectdecorator_createitem_new(objectvm_get_base_machine(vm), atoi(p[0]), atof(p[1]), atof(p[2])));
     else
         fatal_error("Object script error - create_item expects three parameters: item_id, offset_x, offset_y");
 }
 
-void create_child(objectmachine_t** m, int n, const char **p)
+void create_child(objectvm_t* vm, int n, const char **p)
 {
     if(n == 3)
-        *m = objectdecorator_createchild_new(*m, p[0], atof(p[1]), atof(p[2]), "\201"); /* dummy child name */
+        objectvm_emit_machine(vm, objectdecorator_createchild_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), atof(p[2]), "\201")); /* dummy child name */
     else if(n == 4)
-        *m = objectdecorator_createchild_new(*m, p[0], atof(p[1]), atof(p[2]), p[3]);
+        objectvm_emit_machine(vm, objectdecorator_createchild_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), atof(p[2]), p[3]));
     else
         fatal_error("Object script error - create_child expects three or four parameters: object_name, offset_x, offset_y [, child_name]");
 }
 
-void change_child_state(objectmachine_t** m, int n, const char **p)
+void change_child_state(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_changechildstate_new(*m, p[0], p[1]);
+        objectvm_emit_machine(vm, objectdecorator_changechildstate_new(objectvm_get_base_machine(vm), p[0], p[1]));
     else
         fatal_error("Object script error - change_child_state expects two parameters: child_name, new_state_name");
 }
 
-void change_parent_state(objectmachine_t** m, int n, const char **p)
+void change_parent_state(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_changeparentstate_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_changeparentstate_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - change_parent_state expects one parameter: new_state_name");
 }
 
-void destroy(objectmachine_t** m, int n, const char **p)
+void destroy(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_destroy_new(*m);
+        objectvm_emit(vm, OP_DESTROY);
     else
         fatal_error("Object script error - destroy expects no parameters");
 }
 
-void elliptical_trajectory(objectmachine_t** m, int n, const char **p)
+void elliptical_trajectory(objectvm_t* vm, int n, const char **p)
 {
-    if(n >= 4 && n <= 6)
-        *m = objectdecorator_ellipticaltrajectory_new(*m, atof(p[0]), atof(p[1]), atof(p[2]), atof(p[3]), atof(p[4]), atof(p[5]));
+    objectop_t *op;
+
+    if(n >= 4 && n <= 6) {
+        op = objectvm_emit(vm, OP_ELLIPTICAL_TRAJECTORY);
+        op->arg.ellipse.amplitude_x = atof(p[0]);
+        op->arg.ellipse.amplitude_y = atof(p[1]);
+        op->arg.ellipse.angularspeed_x = atof(p[2]) * (2.0f * PI);
+        op->arg.ellipse.angularspeed_y = atof(p[3]) * (2.0f * PI);
+        op->arg.ellipse.initialphase_x = (n >= 5) ? (atof(p[4]) * PI) / 180.0f : 0.0f;
+        op->arg.ellipse.initialphase_y = (n >= 6) ? (atof(p[5]) * PI) / 180.0f : 0.0f;
+    }
     else
         fatal_error("Object script error - elliptical_trajectory expects at least four and at most six parameters: amplitude_x, amplitude_y, angularspeed_x, angularspeed_y [, initialphase_x [, initialphase_y]]");
 }
 
-void gravity(objectmachine_t** m, int n, const char **p)
+void gravity(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_gravity_new(*m);
+        objectvm_emit(vm, OP_GRAVITY);
     else
         fatal_error("Object script error - gravity expects no parameters");
 }
 
-void look_left(objectmachine_t** m, int n, const char **p)
+void look_left(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_lookleft_new(*m);
+        objectvm_emit(vm, OP_LOOK_LEFT);
     else
         fatal_error("Object script error - look_left expects no parameters");
 }
 
-void look_right(objectmachine_t** m, int n, const char **p)
+void look_right(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_lookright_new(*m);
+        objectvm_emit(vm, OP_LOOK_RIGHT);
     else
         fatal_error("Object script error - look_right expects no parameters");
 }
 
-void look_at_player(objectmachine_t** m, int n, const char **p)
+void look_at_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_lookatplayer_new(*m);
+        objectvm_emit(vm, OP_LOOK_AT_PLAYER);
     else
         fatal_error("Object script error - look_at_player expects no parameters");
 }
 
-void look_at_walking_direction(objectmachine_t** m, int n, const char **p)
+void look_at_walking_direction(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_lookatwalkingdirection_new(*m);
+        objectvm_emit(vm, OP_LOOK_AT_WALKING_DIRECTION);
     else
         fatal_error("Object script error - look_at_walking_direction expects no parameters");
 }
 
-void mosquito_movement(objectmachine_t** m, int n, const char **p)
+void mosquito_movement(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_mosquitomovement_new(*m, atof(p[0]));
+        objectvm_emit(vm, OP_MOSQUITO_MOVEMENT)->arg.mosquito_speed = atof(p[0]);
     else
         fatal_error("Object script error - mosquito_movement expects one parameter: speed");
 }
 
-void move_player(objectmachine_t** m, int n, const char **p)
+void move_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_moveplayer_new(*m, atof(p[0]), atof(p[1]));
+        objectvm_emit_machine(vm, objectdecorator_moveplayer_new(objectvm_get_base_machine(vm), atof(p[0]), atof(p[1])));
     else
         fatal_error("Object script error - move_player expects two parameters: speed_x, speed_y");
 }
 
-void hit_player(objectmachine_t** m, int n, const char **p)
+void hit_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_hitplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_hitplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - hit_player expects no parameters");
 }
 
-void enemy(objectmachine_t** m, int n, const char **p)
+void enemy(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_enemy_new(*m, atoi(p[0]));
+        objectvm_emit(vm, OP_ENEMY)->arg.score = atoi(p[0]);
     else
         fatal_error("Object script error - enemy expects one parameter: score");
 }
 
-void walk(objectmachine_t** m, int n, const char **p)
+void walk(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_walk_new(*m, atof(p[0]));
+        objectvm_emit(vm, OP_WALK)->arg.walk.speed = atof(p[0]);
     else
         fatal_error("Object script error - walk expects one parameter: speed");
 }
 
-void change_state(objectmachine_t** m, int n, const char **p)
+void change_state(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_ontimeout_new(*m, 0.0f, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_ontimeout_new(objectvm_get_base_machine(vm), 0.0f, p[0]));
     else
         fatal_error("Object script error - change_state expects one parameter: new_state_name");
 }
 
-void on_timeout(objectmachine_t** m, int n, const char **p)
+void on_timeout(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_ontimeout_new(*m, atof(p[0]), p[1]);
+        objectvm_emit_machine(vm, objectdecorator_ontimeout_new(objectvm_get_base_machine(vm), atof(p[0]), p[1]));
     else
         fatal_error("Object script error - on_timeout expects two parameters: timeout (in seconds), new_state_name");
 }
 
-void on_collision(objectmachine_t** m, int n, const char **p)
+void on_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_oncollision_new(*m, p[0], p[1]);
+        objectvm_emit_machine(vm, objectdecorator_oncollision_new(objectvm_get_base_machine(vm), p[0], p[1]));
     else
         fatal_error("Object script error - on_collision expects two parameters: object_name, new_state_name");
 }
 
-void on_animation_finished(objectmachine_t** m, int n, const char **p)
+void on_animation_finished(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onanimationfinished_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onanimationfinished_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_animation_finished expects one parameter: new_state_name");
 }
 
-void on_random_event(objectmachine_t** m, int n, const char **p)
+void on_random_event(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_onrandomevent_new(*m, atof(p[0]), p[1]);
+        objectvm_emit_machine(vm, objectdecorator_onrandomevent_new(objectvm_get_base_machine(vm), atof(p[0]), p[1]));
     else
         fatal_error("Object script error - on_random_event expects two parameters: probability (0.0 <= probability <= 1.0), new_state_name");
 }
 
-void on_player_collision(objectmachine_t** m, int n, const char **p)
+void on_player_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onplayercollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onplayercollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_player_collision expects one parameter: new_state_name");
 }
 
-void on_player_attack(objectmachine_t** m, int n, const char **p)
+void on_player_attack(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onplayerattack_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onplayerattack_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_player_attack expects one parameter: new_state_name");
 }
 
-void on_player_rect_collision(objectmachine_t** m, int n, const char **p)
+void on_player_rect_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 5)
-        *m = objectdecorator_onplayerrectcollision_new(*m, atoi(p[0]), atoi(p[1]), atoi(p[2]), atoi(p[3]), p[4]);
+        objectvm_emit_machine(vm, objectdecorator_onplayerrectcollision_new(objectvm_get_base_machine(vm), atoi(p[0]), atoi(p[1]), atoi(p[2]), atoi(p[3]), p[4]));
     else
         fatal_error("Object script error - on_player_rect_collision expects five parameters: offset_x1, offset_y1, offset_x2, offset_y2, new_state_name");
 }
 
-void on_no_shield(objectmachine_t** m, int n, const char **p)
+void on_no_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onnoshield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onnoshield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_no_shield expects one parameter: new_state_name");
 }
 
-void on_shield(objectmachine_t** m, int n, const char **p)
+void on_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onshield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onshield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_shield expects one parameter: new_state_name");
 }
 
-void on_fire_shield(objectmachine_t** m, int n, const char **p)
+void on_fire_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onfireshield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onfireshield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_fire_shield expects one parameter: new_state_name");
 }
 
-void on_thunder_shield(objectmachine_t** m, int n, const char **p)
+void on_thunder_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onthundershield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onthundershield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_thunder_shield expects one parameter: new_state_name");
 }
 
-void on_water_shield(objectmachine_t** m, int n, const char **p)
+void on_water_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onwatershield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onwatershield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_water_shield expects one parameter: new_state_name");
 }
 
-void on_acid_shield(objectmachine_t** m, int n, const char **p)
+void on_acid_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onacidshield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onacidshield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_acid_shield expects one parameter: new_state_name");
 }
 
-void on_wind_shield(objectmachine_t** m, int n, const char **p)
+void on_wind_shield(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onwindshield_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onwindshield_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_wind_shield expects one parameter: new_state_name");
 }
 
-void on_brick_collision(objectmachine_t** m, int n, const char **p)
+void on_brick_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onbrickcollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onbrickcollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_brick_collision expects one parameter: new_state_name");
 }
 
-void on_floor_collision(objectmachine_t** m, int n, const char **p)
+void on_floor_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onfloorcollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onfloorcollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_floor_collision expects one parameter: new_state_name");
 }
 
-void on_ceiling_collision(objectmachine_t** m, int n, const char **p)
+void on_ceiling_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onceilingcollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onceilingcollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_ceiling_collision expects one parameter: new_state_name");
 }
 
-void on_left_wall_collision(objectmachine_t** m, int n, const char **p)
+void on_left_wall_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onleftwallcollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onleftwallcollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_left_wall_collision expects one parameter: new_state_name");
 }
 
-void on_right_wall_collision(objectmachine_t** m, int n, const char **p)
+void on_right_wall_collision(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_onrightwallcollision_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_onrightwallcollision_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - on_right_wall_collision expects one parameter: new_state_name");
 }
 
-void change_closest_object_state(objectmachine_t** m, int n, const char **p)
+void change_closest_object_state(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_changeclosestobjectstate_new(*m, p[0], p[1]);
+        objectvm_emit_machine(vm, objectdecorator_changeclosestobjectstate_new(objectvm_get_base_machine(vm), p[0], p[1]));
     else
         fatal_error("Object script error - change_closest_object_state expects two parameters: object_name, new_state_name");
 }
 
-void burn_player(objectmachine_t** m, int n, const char **p)
+void burn_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_burnplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_burnplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - burn_player expects no parameters");
 }
 
-void shock_player(objectmachine_t** m, int n, const char **p)
+void shock_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_shockplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_shockplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - shock_player expects no parameters");
 }
 
-void acid_player(objectmachine_t** m, int n, const char **p)
+void acid_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_acidplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_acidplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - acid_player expects no parameters");
 }
 
-void add_rings(objectmachine_t** m, int n, const char **p)
+void add_rings(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_addrings_new(*m, atoi(p[0]));
+        objectvm_emit_machine(vm, objectdecorator_addrings_new(objectvm_get_base_machine(vm), atoi(p[0])));
     else
         fatal_error("Object script error - add_rings expects one parameter: number_of_rings");
 }
 
-void add_to_score(objectmachine_t** m, int n, const char **p)
+void add_to_score(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_addtoscore_new(*m, atoi(p[0]));
+        objectvm_emit_machine(vm, objectdecorator_addtoscore_new(objectvm_get_base_machine(vm), atoi(p[0])));
     else
         fatal_error("Object script error - add_to_score expects one parameter: score");
 }
 
-void audio_play_sample(objectmachine_t** m, int n, const char **p)
+void audio_play_sample(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_playsample_new(*m, p[0], 1.0f, 0.0f, 1.0f, 0);
+        objectvm_emit_machine(vm, objectdecorator_playsample_new(objectvm_get_base_machine(vm), p[0], 1.0f, 0.0f, 1.0f, 0));
     else if(n == 2)
-        *m = objectdecorator_playsample_new(*m, p[0], atof(p[1]), 0.0f, 1.0f, 0);
+        objectvm_emit_machine(vm, objectdecorator_playsample_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), 0.0f, 1.0f, 0));
     else if(n == 3)
-        *m = objectdecorator_playsample_new(*m, p[0], atof(p[1]), atof(p[2]), 1.0f, 0);
+        objectvm_emit_machine(vm, objectdecorator_playsample_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), atof(p[2]), 1.0f, 0));
     else if(n == 4)
-        *m = objectdecorator_playsample_new(*m, p[0], atof(p[1]), atof(p[2]), atof(p[3]), 0);
+        objectvm_emit_machine(vm, objectdecorator_playsample_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), atof(p[2]), atof(p[3]), 0));
     else if(n == 5)
-        *m = objectdecorator_playsample_new(*m, p[0], atof(p[1]), atof(p[2]), atof(p[3]), atoi(p[4]));
+        objectvm_emit_machine(vm, objectdecorator_playsample_new(objectvm_get_base_machine(vm), p[0], atof(p[1]), atof(p[2]), atof(p[3]), atoi(p[4])));
     else
         fatal_error("Object script error - play_sample expects at least one and at most five parameters: sound_name [, volume [, pan [, frequency [, loops]]]]");
 }
 
-void audio_play_music(objectmachine_t** m, int n, const char **p)
+void audio_play_music(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_playmusic_new(*m, p[0], 0);
+        objectvm_emit_machine(vm, objectdecorator_playmusic_new(objectvm_get_base_machine(vm), p[0], 0));
     else if(n == 2)
-        *m = objectdecorator_playmusic_new(*m, p[0], atoi(p[1]));
+        objectvm_emit_machine(vm, objectdecorator_playmusic_new(objectvm_get_base_machine(vm), p[0], atoi(p[1])));
     else
         fatal_error("Object script error - play_music expects at least one and at most two parameters: music_name [, loops]");
 }
 
-void audio_play_level_music(objectmachine_t** m, int n, const char **p)
+void audio_play_level_music(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_playlevelmusic_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_playlevelmusic_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - play_level_music expects no parameters");
 }
 
-void audio_set_music_volume(objectmachine_t** m, int n, const char **p)
+void audio_set_music_volume(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_setmusicvolume_new(*m, atof(p[0]));
+        objectvm_emit_machine(vm, objectdecorator_setmusicvolume_new(objectvm_get_base_machine(vm), atof(p[0])));
     else
         fatal_error("Object script error - set_music_volume expects one parameter: volume");
 }
 
-void show_dialog_box(objectmachine_t** m, int n, const char **p)
+void show_dialog_box(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_showdialogbox_new(*m, p[0], p[1]);
+        objectvm_emit_machine(vm, objectdecorator_showdialogbox_new(objectvm_get_base_machine(vm), p[0], p[1]));
     else
         fatal_error("Object script error - show_dialog_box expects two parameters: title, message");
 }
 
-void hide_dialog_box(objectmachine_t** m, int n, const char **p)
+void hide_dialog_box(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_hidedialogbox_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_hidedialogbox_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - hide_dialog_box expects no parameters");
 }
 
-void clear_level(objectmachine_t** m, int n, const char **p)
+void clear_level(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_clearlevel_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_clearlevel_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - clear_level expects no parameters");
 }
 
-void jump(objectmachine_t** m, int n, const char **p)
+void jump(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_jump_new(*m, atof(p[0]));
+        objectvm_emit(vm, OP_JUMP)->arg.jump_strength = atof(p[0]);
     else
         fatal_error("Object script error - jump expects one parameter: jump_strength");
 }
 
-void set_player_animation(objectmachine_t** m, int n, const char **p)
+void set_player_animation(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_setplayeranimation_new(*m, p[0], atoi(p[1]));
+        objectvm_emit_machine(vm, objectdecorator_setplayeranimation_new(objectvm_get_base_machine(vm), p[0], atoi(p[1])));
     else
         fatal_error("Object script error - set_player_animation expects two parameters: sprite_name, animation_id");
 }
 
-void enable_player_movement(objectmachine_t** m, int n, const char **p)
+void enable_player_movement(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_enableplayermovement_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_enableplayermovement_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - enable_player_movement expects no parameters");
 }
 
-void disable_player_movement(objectmachine_t** m, int n, const char **p)
+void disable_player_movement(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_disableplayermovement_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_disableplayermovement_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - disable_player_movement expects no parameters");
 }
 
-void set_player_xspeed(objectmachine_t** m, int n, const char **p)
+void set_player_xspeed(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_setplayerxspeed_new(*m, atof(p[0]));
+        objectvm_emit_machine(vm, objectdecorator_setplayerxspeed_new(objectvm_get_base_machine(vm), atof(p[0])));
     else
         fatal_error("Object script error - set_player_xspeed expects one parameter: speed");
 }
 
-void set_player_yspeed(objectmachine_t** m, int n, const char **p)
+void set_player_yspeed(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_setplayeryspeed_new(*m, atof(p[0]));
+        objectvm_emit_machine(vm, objectdecorator_setplayeryspeed_new(objectvm_get_base_machine(vm), atof(p[0])));
     else
         fatal_error("Object script error - set_player_yspeed expects one parameter: speed");
 }
 
-void set_player_position(objectmachine_t** m, int n, const char **p)
+void set_player_position(objectvm_t* vm, int n, const char **p)
 {
     if(n == 2)
-        *m = objectdecorator_setplayerposition_new(*m, atoi(p[0]), atoi(p[1]));
+        objectvm_emit_machine(vm, objectdecorator_setplayerposition_new(objectvm_get_base_machine(vm), atoi(p[0]), atoi(p[1])));
     else
         fatal_error("Object script error - set_player_position expects two parameters: xpos, ypos");
 }
 
-void bounce_player(objectmachine_t** m, int n, const char **p)
+void bounce_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_bounceplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_bounceplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - bounce_player expects no parameters");
 }
 
-void lock_camera(objectmachine_t** m, int n, const char **p)
+void lock_camera(objectvm_t* vm, int n, const char **p)
 {
     if(n == 4)
-        *m = objectdecorator_lockcamera_new(*m, atoi(p[0]), atoi(p[1]), atoi(p[2]), atoi(p[3]));
+        objectvm_emit_machine(vm, objectdecorator_lockcamera_new(objectvm_get_base_machine(vm), atoi(p[0]), atoi(p[1]), atoi(p[2]), atoi(p[3])));
     else
         fatal_error("Object script error - lock_camera expects four parameters: x1, y1, x2, y2");
 }
 
-void observe_player(objectmachine_t** m, int n, const char **p)
+void observe_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 1)
-        *m = objectdecorator_observeplayer_new(*m, p[0]);
+        objectvm_emit_machine(vm, objectdecorator_observeplayer_new(objectvm_get_base_machine(vm), p[0]));
     else
         fatal_error("Object script error - observe_player expects one parameter: player_name");
 }
 
-void observe_current_player(objectmachine_t** m, int n, const char **p)
+void observe_current_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_observecurrentplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_observecurrentplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - observe_current_player expects no parameters");
 }
 
-void observe_active_player(objectmachine_t** m, int n, const char **p)
+void observe_active_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_observeactiveplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_observeactiveplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - observe_active_player expects no parameters");
 }
 
-void observe_all_players(objectmachine_t** m, int n, const char **p)
+void observe_all_players(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_observeallplayers_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_observeallplayers_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - observe_all_players expects no parameters");
 }
 
-void attach_to_player(objectmachine_t** m, int n, const char **p)
+void attach_to_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_attachtoplayer_new(*m, 0, 0);
+        objectvm_emit_machine(vm, objectdecorator_attachtoplayer_new(objectvm_get_base_machine(vm), 0, 0));
     else if(n == 1)
-        *m = objectdecorator_attachtoplayer_new(*m, atoi(p[0]), 0);
+        objectvm_emit_machine(vm, objectdecorator_attachtoplayer_new(objectvm_get_base_machine(vm), atoi(p[0]), 0));
     else if(n == 2)
-        *m = objectdecorator_attachtoplayer_new(*m, atoi(p[0]), atoi(p[1]));
+        objectvm_emit_machine(vm, objectdecorator_attachtoplayer_new(objectvm_get_base_machine(vm), atoi(p[0]), atoi(p[1])));
     else
         fatal_error("Object script error - attach_to_player expects at most two parameters: [offset_x [, offset_y]]");
 }
 
-void springfy_player(objectmachine_t** m, int n, const char **p)
+void springfy_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_springfyplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_springfyplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - springfy_player expects no parameters");
 }
 
-void roll_player(objectmachine_t** m, int n, const char **p)
+void roll_player(objectvm_t* vm, int n, const char **p)
 {
     if(n == 0)
-        *m = objectdecorator_rollplayer_new(*m);
+        objectvm_emit_machine(vm, objectdecorator_rollplayer_new(objectvm_get_base_machine(vm)));
     else
         fatal_error("Object script error - roll_player expects no parameters");
 }
@@ -31,7 +31,7 @@ struct objectbasicmachine_t {
 /* private methods */
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
 static object_t* get_object_instance(objectmachine_t *obj);
 
@@ -50,6 +50,7 @@ objectmachine_t* objectbasicmachine_new(object_t *object)
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = get_object_instance;
     me->object = object;
 
@@ -68,9 +69,9 @@ void release(objectmachine_t *obj)
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
-    ; /* empty */
+    return TRUE; /* empty */
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
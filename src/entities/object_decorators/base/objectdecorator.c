@@ -22,8 +22,6 @@
 object_t* objectdecorator_get_object_instance(objectmachine_t *obj)
 {
     objectdecorator_t *me = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = me->decorated_machine;
-
-    return decorated_machine->get_object_instance(decorated_machine);
+    return me->object;
 }
 
@@ -22,11 +22,17 @@
 
 #include "objectmachine.h"
 
-/* <<abstract>> object decorator class */
+/* <<abstract>> object decorator class
+ *
+ * A decorator is one OP_MACHINE of the program of a state: it
+ * decorates the basic machine of the state, and the object VM
+ * calls its methods in order with the other ops. None of them
+ * forwards the call to the decorated machine (see object_vm.c) */
 typedef struct objectdecorator_t objectdecorator_t;
 struct objectdecorator_t {
     objectmachine_t base; /* objectdecorator_t implements the objectmachine_t interface */
     objectmachine_t *decorated_machine; /* what are we decorating? */
+    object_t *object; /* the owner */
 };
 
 /* not all methods are abstract, though */
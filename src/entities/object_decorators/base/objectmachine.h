@@ -35,8 +35,9 @@ typedef struct objectmachine_t objectmachine_t;
 struct objectmachine_t {
     void (*init)(objectmachine_t*); /* initializes the object */
     void (*release)(objectmachine_t*); /* releases the object */
-    void (*update)(objectmachine_t*, player_t**, int, brick_list_t*, item_list_t*, object_list_t*); /* updates the object (runs every frame) */
+    int (*update)(objectmachine_t*, player_t**, int, brick_list_t*, item_list_t*, object_list_t*); /* updates the object (runs every frame). Returns FALSE to skip the rest of the state */
     void (*render)(objectmachine_t*, v2d_t); /* renders the object */
+    void (*think)(objectmachine_t*, brick_list_t*); /* prefetches what update() will need, or NULL. Runs in parallel with other objects: it must not change anything but the sensor cache of its actor */
 
     object_t* (*get_object_instance)(objectmachine_t*);
 };
@@ -30,7 +30,7 @@ struct objectdecorator_bounceplayer_t {
 /* private methods */
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
 
 
@@ -48,8 +48,10 @@ objectmachine_t* objectdecorator_bounceplayer_new(objectmachine_t *decorated_mac
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     return obj;
 }
@@ -60,43 +62,25 @@ objectmachine_t* objectdecorator_bounceplayer_new(objectmachine_t *decorated_mac
 /* private methods */
 void init(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->init(decorated_machine);
 }
 
 void release(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
-    ; /* empty */
-
-    decorated_machine->release(decorated_machine);
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     player_t *player = enemy_get_observed_player(obj->get_object_instance(obj));
 
     player_bounce(player);
 
-    decorated_machine->update(decorated_machine, team, team_size, brick_list, item_list, object_list);
+    return TRUE;
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->render(decorated_machine, camera_position);
 }
 
@@ -21,6 +21,7 @@
 #include "../object_vm.h"
 #include "../../core/util.h"
 #include "../../core/stringutil.h"
+#include "../../scenes/level.h"
 
 /* objectdecorator_changeclosestobjectstate_t class */
 typedef struct objectdecorator_changeclosestobjectstate_t objectdecorator_changeclosestobjectstate_t;
@@ -33,7 +34,7 @@ struct objectdecorator_changeclosestobjectstate_t {
 /* private methods */
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
 
 static object_t *find_closest_object(object_t *me, object_list_t *list, const char* desired_name, float *distance);
@@ -51,8 +52,10 @@ objectmachine_t* objectdecorator_changeclosestobjectstate_new(objectmachine_t *d
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     me->object_name = str_dup(object_name);
     me->new_state_name = str_dup(new_state_name);
@@ -64,49 +67,33 @@ objectmachine_t* objectdecorator_changeclosestobjectstate_new(objectmachine_t *d
 /* private methods */
 void init(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->init(decorated_machine);
 }
 
 void release(objectmachine_t *obj)
 {
     objectdecorator_changeclosestobjectstate_t *me = (objectdecorator_changeclosestobjectstate_t*)obj;
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
 
     free(me->object_name);
     free(me->new_state_name);
-
-    decorated_machine->release(decorated_machine);
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
     objectdecorator_changeclosestobjectstate_t *me = (objectdecorator_changeclosestobjectstate_t*)obj;
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     object_t *object = obj->get_object_instance(obj);
     object_t *target = find_closest_object(object, object_list, me->object_name, NULL);
 
     if(target != NULL)
         objectvm_set_current_state(target->vm, me->new_state_name);
 
-    decorated_machine->update(decorated_machine, team, team_size, brick_list, item_list, object_list);
+    return TRUE;
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->render(decorated_machine, camera_position);
 }
 
 object_t *find_closest_object(object_t *me, object_list_t *list, const char* desired_name, float *distance)
@@ -116,6 +103,10 @@ object_t *find_closest_object(object_t *me, object_list_t *list, const char* des
     object_t *ret = NULL;
     v2d_t v;
 
+    /* use the spatial index of the level, if possible */
+    if(list != NULL && list == level_enemy_list())
+        return level_closest_object(me->actor->position, desired_name, distance);
+
     for(it=list; it; it=it->next) { /* this list must be small enough */
         if(str_icmp(it->data->name, desired_name) == 0) {
             v = v2d_subtract(it->data->actor->position, me->actor->position);
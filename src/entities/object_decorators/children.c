@@ -42,7 +42,7 @@ static void changeparentstate_strategy(objectdecorator_children_t *me);
 /* private methods */
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
 
 
@@ -58,8 +58,10 @@ objectmachine_t* objectdecorator_createchild_new(objectmachine_t *decorated_mach
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     me->strategy = createchild_strategy;
     me->offset = v2d_new(offset_x, offset_y);
@@ -80,8 +82,10 @@ objectmachine_t* objectdecorator_changechildstate_new(objectmachine_t *decorated
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     me->strategy = changechildstate_strategy;
     me->offset = v2d_new(0, 0);
@@ -102,8 +106,10 @@ objectmachine_t* objectdecorator_changeparentstate_new(objectmachine_t *decorate
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     me->strategy = changeparentstate_strategy;
     me->offset = v2d_new(0, 0);
@@ -117,19 +123,12 @@ objectmachine_t* objectdecorator_changeparentstate_new(objectmachine_t *decorate
 /* private methods */
 void init(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->init(decorated_machine);
 }
 
 void release(objectmachine_t *obj)
 {
     objectdecorator_children_t *me = (objectdecorator_children_t*)obj;
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
 
     if(me->child_name != NULL)
         free(me->child_name);
@@ -139,30 +138,21 @@ void release(objectmachine_t *obj)
 
     if(me->new_state_name != NULL)
         free(me->new_state_name);
-
-    decorated_machine->release(decorated_machine);
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
     objectdecorator_children_t *me = (objectdecorator_children_t*)obj;
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
 
     me->strategy(me);
 
-    decorated_machine->update(decorated_machine, team, team_size, brick_list, item_list, object_list);
+    return TRUE;
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
-
-    decorated_machine->render(decorated_machine, camera_position);
 }
 
 
@@ -37,7 +37,7 @@ struct objectdecorator_lockcamera_t {
 /* private methods */
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
 
 static image_t* create_cute_image(int w, int h);
@@ -58,8 +58,10 @@ objectmachine_t* objectdecorator_lockcamera_new(objectmachine_t *decorated_machi
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = NULL;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
 
     me->x1 = min(x1, x2);
     me->y1 = min(y1, y2);
@@ -76,8 +78,6 @@ objectmachine_t* objectdecorator_lockcamera_new(objectmachine_t *decorated_machi
 /* private methods */
 void init(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     objectdecorator_lockcamera_t *me = (objectdecorator_lockcamera_t*)obj;
     int w, h;
 
@@ -89,14 +89,10 @@ void init(objectmachine_t *obj)
 
     me->cute_image = create_cute_image(w, h);
     me->has_locked_somebody = FALSE;
-
-    decorated_machine->init(decorated_machine);
 }
 
 void release(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     objectdecorator_lockcamera_t *me = (objectdecorator_lockcamera_t*)obj;
     player_t *player = enemy_get_observed_player(obj->get_object_instance(obj));
 
@@ -105,15 +101,11 @@ void release(objectmachine_t *obj)
         player->in_locked_area = FALSE;
         level_unlock_camera();
     }
-
-    decorated_machine->release(decorated_machine);
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     object_t *object = obj->get_object_instance(obj);
     player_t *player = enemy_get_observed_player(object);
     objectdecorator_lockcamera_t *me = (objectdecorator_lockcamera_t*)obj;
@@ -183,14 +175,11 @@ void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *
         ta->position.y = clip(ta->position.y, ry, ry + rh);
     }
 
-    decorated_machine->update(decorated_machine, team, team_size, brick_list, item_list, object_list);
+    return TRUE;
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     if(level_editmode()) {
         objectdecorator_lockcamera_t *me = (objectdecorator_lockcamera_t*)obj;
         actor_t *act = obj->get_object_instance(obj)->actor;
@@ -200,8 +189,6 @@ void render(objectmachine_t *obj, v2d_t camera_position)
         y = (act->position.y + me->y1) - (camera_position.y - VIDEO_SCREEN_H/2);
         image_draw(me->cute_image, video_get_backbuffer(), x, y, IF_NONE);
     }
-
-    decorated_machine->render(decorated_machine, camera_position);
 }
 
 
@@ -53,6 +53,7 @@ struct eventstrategy_t {
     void (*init)(eventstrategy_t*); /* initializes the strategy object */
     void (*release)(eventstrategy_t*); /* releases the strategy object */
     int (*should_trigger_event)(eventstrategy_t*,object_t*,player_t**,int,brick_list_t*,item_list_t*,object_list_t*); /* returns TRUE iff the event should be triggered */
+    void (*think)(eventstrategy_t*,object_t*,brick_list_t*); /* prefetches the sensors of should_trigger_event(), or NULL */
 };
 
 /* ontimeout_t concrete strategy */
@@ -69,7 +70,7 @@ static int ontimeout_should_trigger_event(eventstrategy_t *event, object_t *obje
 /* oncollision_t concrete strategy */
 struct oncollision_t {
     eventstrategy_t base; /* implements eventstrategy_t */
-    char *target_name; /* object name */
+    int target_id; /* object name (see objects_get_name_id()) */
 };
 static eventstrategy_t* oncollision_new(const char *target_name);
 static void oncollision_init(eventstrategy_t *event);
@@ -178,12 +179,16 @@ static void onrightwallcollision_init(eventstrategy_t *event);
 static void onrightwallcollision_release(eventstrategy_t *event);
 static int onrightwallcollision_should_trigger_event(eventstrategy_t *event, object_t *object, player_t** team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 
+/* the brick/floor/ceiling/wall strategies share the same sensors */
+static void brickcollision_think(eventstrategy_t *event, object_t *object, brick_list_t *brick_list);
+
 /* private methods */
 static objectmachine_t *make_decorator(objectmachine_t *decorated_machine, const char *new_state_name, eventstrategy_t *strategy);
 static void init(objectmachine_t *obj);
 static void release(objectmachine_t *obj);
-static void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
+static int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list);
 static void render(objectmachine_t *obj, v2d_t camera_position);
+static void think(objectmachine_t *obj, brick_list_t *brick_list);
 
 
 
@@ -301,8 +306,10 @@ objectmachine_t *make_decorator(objectmachine_t *decorated_machine, const char *
     obj->release = release;
     obj->update = update;
     obj->render = render;
+    obj->think = think;
     obj->get_object_instance = objectdecorator_get_object_instance; /* inherits from superclass */
     dec->decorated_machine = decorated_machine;
+    dec->object = decorated_machine->get_object_instance(decorated_machine);
     me->new_state_name = str_dup(new_state_name);
     me->strategy = strategy;
 
@@ -311,50 +318,45 @@ objectmachine_t *make_decorator(objectmachine_t *decorated_machine, const char *
 
 void init(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
     objectdecorator_onevent_t *me = (objectdecorator_onevent_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
 
     me->strategy->init(me->strategy);
-
-    decorated_machine->init(decorated_machine);
 }
 
 void release(objectmachine_t *obj)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
     objectdecorator_onevent_t *me = (objectdecorator_onevent_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
 
     me->strategy->release(me->strategy);
     free(me->strategy);
     free(me->new_state_name);
-
-    decorated_machine->release(decorated_machine);
     free(obj);
 }
 
-void update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+int update(objectmachine_t *obj, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
     objectdecorator_onevent_t *me = (objectdecorator_onevent_t*)obj;
     object_t *object = obj->get_object_instance(obj);
 
-    if(me->strategy->should_trigger_event(me->strategy, object, team, team_size, brick_list, item_list, object_list))
+    if(me->strategy->should_trigger_event(me->strategy, object, team, team_size, brick_list, item_list, object_list)) {
         objectvm_set_current_state(object->vm, me->new_state_name);
-    else
-        decorated_machine->update(decorated_machine, team, team_size, brick_list, item_list, object_list);
+        return FALSE; /* the rest of this state is skipped */
+    }
+
+    return TRUE;
 }
 
 void render(objectmachine_t *obj, v2d_t camera_position)
 {
-    objectdecorator_t *dec = (objectdecorator_t*)obj;
-    objectmachine_t *decorated_machine = dec->decorated_machine;
-
     ; /* empty */
+}
 
-    decorated_machine->render(decorated_machine, camera_position);
+void think(objectmachine_t *obj, brick_list_t *brick_list)
+{
+    objectdecorator_onevent_t *me = (objectdecorator_onevent_t*)obj;
+
+    if(me->strategy->think != NULL)
+        me->strategy->think(me->strategy, obj->get_object_instance(obj), brick_list);
 }
 
 
@@ -369,6 +371,7 @@ eventstrategy_t* ontimeout_new(float timeout)
     e->init = ontimeout_init;
     e->release = ontimeout_release;
     e->should_trigger_event = ontimeout_should_trigger_event;
+    e->think = NULL;
 
     x->timeout = timeout;
     x->timer = 0.0f;
@@ -408,7 +411,8 @@ eventstrategy_t* oncollision_new(const char *target_name)
     e->init = oncollision_init;
     e->release = oncollision_release;
     e->should_trigger_event = oncollision_should_trigger_event;
-    x->target_name = str_dup(target_name);
+    e->think = NULL;
+    x->target_id = objects_get_name_id(target_name);
 
     return e;
 }
@@ -420,23 +424,15 @@ void oncollision_init(eventstrategy_t *event)
 
 void oncollision_release(eventstrategy_t *event)
 {
-    oncollision_t *e = (oncollision_t*)event;
-    free(e->target_name);
+    ; /* empty */
 }
 
 int oncollision_should_trigger_event(eventstrategy_t *event, object_t *object, player_t** team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
 {
     oncollision_t *x = (oncollision_t*)event;
-    object_list_t *it;
 
-    for(it = object_list; it != NULL; it = it->next) {
-        if(strcmp(it->data->name, x->target_name) == 0) {
-            if(actor_pixelperfect_collision(it->data->actor, object->actor))
-                return TRUE;
-        }
-    }
-
-    return FALSE;
+    /* the level tests only the objects close to this one */
+    return level_object_collision(object, x->target_id) != NULL;
 }
 
 
@@ -449,6 +445,7 @@ eventstrategy_t* onanimationfinished_new()
     e->init = onanimationfinished_init;
     e->release = onanimationfinished_release;
     e->should_trigger_event = onanimationfinished_should_trigger_event;
+    e->think = NULL;
 
     return e;
 }
@@ -477,6 +474,7 @@ eventstrategy_t* onrandomevent_new(float probability)
     e->init = onrandomevent_init;
     e->release = onrandomevent_release;
     e->should_trigger_event = onrandomevent_should_trigger_event;
+    e->think = NULL;
 
     x->probability = clip(probability, 0.0f, 1.0f);
 
@@ -509,6 +507,7 @@ eventstrategy_t* onplayercollision_new()
     e->init = onplayercollision_init;
     e->release = onplayercollision_release;
     e->should_trigger_event = onplayercollision_should_trigger_event;
+    e->think = NULL;
 
     return e;
 }
@@ -539,6 +538,7 @@ eventstrategy_t* onplayerattack_new()
     e->init = onplayerattack_init;
     e->release = onplayerattack_release;
     e->should_trigger_event = onplayerattack_should_trigger_event;
+    e->think = NULL;
 
     return e;
 }
@@ -569,6 +569,7 @@ eventstrategy_t* onplayerrectcollision_new(int x1, int y1, int x2, int y2)
     e->init = onplayerrectcollision_init;
     e->release = onplayerrectcollision_release;
     e->should_trigger_event = onplayerrectcollision_should_trigger_event;
+    e->think = NULL;
 
     x->x1 = min(x1, x2);
     x->y1 = min(y1, y2);
@@ -619,6 +620,7 @@ eventstrategy_t* onplayershield_new(int shield_type)
     e->init = onplayershield_init;
     e->release = onplayershield_release;
     e->should_trigger_event = onplayershield_should_trigger_event;
+    e->think = NULL;
     x->shield_type = shield_type;
 
     return e;
@@ -652,6 +654,7 @@ eventstrategy_t* onbrickcollision_new()
     e->init = onbrickcollision_init;
     e->release = onbrickcollision_release;
     e->should_trigger_event = onbrickcollision_should_trigger_event;
+    e->think = brickcollision_think;
 
     return e;
 }
@@ -695,6 +698,7 @@ eventstrategy_t* onfloorcollision_new()
     e->init = onfloorcollision_init;
     e->release = onfloorcollision_release;
     e->should_trigger_event = onfloorcollision_should_trigger_event;
+    e->think = brickcollision_think;
 
     return e;
 }
@@ -733,6 +737,7 @@ eventstrategy_t* onceilingcollision_new()
     e->init = onceilingcollision_init;
     e->release = onceilingcollision_release;
     e->should_trigger_event = onceilingcollision_should_trigger_event;
+    e->think = brickcollision_think;
 
     return e;
 }
@@ -771,6 +776,7 @@ eventstrategy_t* onleftwallcollision_new()
     e->init = onleftwallcollision_init;
     e->release = onleftwallcollision_release;
     e->should_trigger_event = onleftwallcollision_should_trigger_event;
+    e->think = brickcollision_think;
 
     return e;
 }
@@ -808,6 +814,7 @@ eventstrategy_t* onrightwallcollision_new()
     e->init = onrightwallcollision_init;
     e->release = onrightwallcollision_release;
     e->should_trigger_event = onrightwallcollision_should_trigger_event;
+    e->think = brickcollision_think;
 
     return e;
 }
@@ -836,3 +843,12 @@ int onrightwallcollision_should_trigger_event(eventstrategy_t *event, object_t *
     ;
 }
 
+/* shared by the brick/floor/ceiling/wall strategies */
+void brickcollision_think(eventstrategy_t *event, object_t *object, brick_list_t *brick_list)
+{
+    const float sqrsize=1, diff=0;
+    actor_t *act = object->actor;
+    brick_t *up, *upright, *right, *downright, *down, *downleft, *left, *upleft;
+
+    actor_corners(act, sqrsize, diff, brick_list, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+}
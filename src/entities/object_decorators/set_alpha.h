@@ -1,29 +0,0 @@
-/*
- * set_alpha.h - Sets the alpha value of the object (translucency)
- * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
- *
- * This program is free software; you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation; either version 2 of the License, or
- * (at your option) any later version.
- *
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License along
- * with this program; if not, write to the Free Software Foundation, Inc.,
- * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
- */
-
-#ifndef _OD_SETALPHA_H
-#define _OD_SETALPHA_H
-
-#include "base/objectdecorator.h"
-
-/* 0.0f (transparent) <= alpha <= 1.0 (opaque) */
-objectmachine_t* objectdecorator_setalpha_new(objectmachine_t *decorated_machine, float alpha);
-
-#endif
-
@@ -17,33 +17,46 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <math.h>
+#include <string.h>
 #include "object_vm.h"
+#include "actor.h"
 #include "../core/util.h"
 #include "../core/stringutil.h"
+#include "../core/timer.h"
+#include "../core/soundfactory.h"
+#include "../scenes/level.h"
 #include "object_decorators/base/objectmachine.h"
 #include "object_decorators/base/objectbasicmachine.h"
 
 /* private stuff */
-typedef struct objectmachine_list_t objectmachine_list_t;
+typedef struct objectstate_list_t objectstate_list_t;
 
 /* objectvm_t class */
 struct objectvm_t
 {
     enemy_t* owner;
-    objectmachine_list_t* state_list;
-    objectmachine_t** reference_to_current_state;
+    objectstate_list_t* state_list;
+    objectstate_list_t* current_state;
 };
 
-/* linked list of enemy machines */
-struct objectmachine_list_t {
+/* linked list of states */
+struct objectstate_list_t {
     char *name;
-    objectmachine_t *data;
-    objectmachine_list_t *next;
+    objectmachine_t *base; /* the basic machine: renders the actor */
+    objectop_t *op; /* the program */
+    int op_count, op_capacity;
+    objectstate_list_t *next;
 };
 
-static objectmachine_list_t* objectmachine_list_new(objectmachine_list_t* list, const char *name, enemy_t* owner);
-static objectmachine_list_t* objectmachine_list_delete(objectmachine_list_t* list);
-static objectmachine_list_t* objectmachine_list_find(objectmachine_list_t* list, const char *name);
+static objectstate_list_t* objectstate_list_new(objectstate_list_t* list, const char *name, enemy_t* owner);
+static objectstate_list_t* objectstate_list_delete(objectstate_list_t* list);
+static objectstate_list_t* objectstate_list_find(objectstate_list_t* list, const char *name);
+static void walk(objectop_t *op, object_t *object, brick_list_t *brick_list);
+static void jump(objectop_t *op, object_t *object, brick_list_t *brick_list);
+static void elliptical_trajectory(objectop_t *op, object_t *object, brick_list_t *brick_list);
+static void mosquito_movement(objectop_t *op, object_t *object);
+static void enemy(objectop_t *op, object_t *object, player_t **team, int team_size);
 
 
 
@@ -54,14 +67,14 @@ objectvm_t* objectvm_create(enemy_t* owner)
     objectvm_t *vm = mallocx(sizeof *vm);
     vm->owner = owner;
     vm->state_list = NULL;
-    vm->reference_to_current_state = NULL;
+    vm->current_state = NULL;
     return vm;
 }
 
 objectvm_t* objectvm_destroy(objectvm_t* vm)
 {
-    vm->state_list = objectmachine_list_delete(vm->state_list);
-    vm->reference_to_current_state = NULL;
+    vm->state_list = objectstate_list_delete(vm->state_list);
+    vm->current_state = NULL;
     vm->owner = NULL;
     free(vm);
     return NULL;
@@ -69,57 +82,251 @@ objectvm_t* objectvm_destroy(objectvm_t* vm)
 
 void objectvm_set_current_state(objectvm_t* vm, const char *name)
 {
-    objectmachine_list_t *m = objectmachine_list_find(vm->state_list, name);
+    objectstate_list_t *m = objectstate_list_find(vm->state_list, name);
     if(m != NULL)
-        vm->reference_to_current_state = &(m->data);
+        vm->current_state = m;
     else
         fatal_error("Object script error: can't find state \"%s\".", name);
 }
 
-objectmachine_t** objectvm_get_reference_to_current_state(objectvm_t* vm)
-{
-    return vm->reference_to_current_state;
-}
-
 void objectvm_create_state(objectvm_t* vm, const char *name)
 {
-    if(objectmachine_list_find(vm->state_list, name) == NULL)
-        vm->state_list = objectmachine_list_new(vm->state_list, name, vm->owner);
+    if(objectstate_list_find(vm->state_list, name) == NULL)
+        vm->state_list = objectstate_list_new(vm->state_list, name, vm->owner);
     else
         fatal_error("Object script error: can't redefine state \"%s\".", name);
 }
 
+objectop_t* objectvm_emit(objectvm_t* vm, objectopcode_t opcode)
+{
+    objectstate_list_t *state = vm->current_state;
+    objectop_t *op;
+
+    if(state->op_count >= state->op_capacity) {
+        state->op_capacity = max(8, 2 * state->op_capacity);
+        state->op = reallocx(state->op, state->op_capacity * sizeof *(state->op));
+    }
+
+    op = &(state->op[state->op_count++]);
+    memset(op, 0, sizeof *op);
+    op->opcode = opcode;
+    return op;
+}
+
+void objectvm_emit_machine(objectvm_t* vm, objectmachine_t *machine)
+{
+    objectvm_emit(vm, OP_MACHINE)->arg.machine = machine;
+}
+
+objectmachine_t* objectvm_get_base_machine(objectvm_t* vm)
+{
+    return vm->current_state->base;
+}
+
+void objectvm_init_current_state(objectvm_t* vm)
+{
+    objectstate_list_t *state = vm->current_state;
+    object_t *object = vm->owner;
+    objectop_t *op;
+    int i;
+
+    for(i=0; i<state->op_count; i++) {
+        op = &(state->op[i]);
+        switch(op->opcode) {
+            case OP_MACHINE:
+                op->arg.machine->init(op->arg.machine);
+                break;
+
+            case OP_SET_ANIMATION:
+                actor_change_animation(object->actor, op->arg.anim);
+                break;
+
+            case OP_WALK:
+                op->arg.walk.direction = (random(2) == 0) ? -1.0f : 1.0f;
+                break;
+
+            case OP_LOOK_AT_WALKING_DIRECTION:
+                op->arg.old_x = 0.0f;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    state->base->init(state->base);
+}
+
+void objectvm_update(objectvm_t* vm, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list)
+{
+    objectstate_list_t *state = vm->current_state;
+    object_t *object = vm->owner;
+    actor_t *act = object->actor;
+    objectop_t *op = state->op, *end = state->op + state->op_count;
+    player_t *player;
+
+    /* the state may change along the way, but we
+     * finish this one (or stop at a triggered event) */
+    for(; op != end; op++) {
+        switch(op->opcode) {
+            case OP_MACHINE:
+                if(!op->arg.machine->update(op->arg.machine, team, team_size, brick_list, item_list, object_list))
+                    return;
+                break;
+
+            case OP_SET_ANIMATION:
+                actor_change_animation(act, op->arg.anim);
+                break;
+
+            case OP_SET_OBSTACLE:
+                object->obstacle = op->arg.obstacle.is_obstacle;
+                object->obstacle_angle = op->arg.obstacle.angle;
+                break;
+
+            case OP_SET_ALPHA:
+                act->alpha = op->arg.alpha;
+                break;
+
+            case OP_ENEMY:
+                enemy(op, object, team, team_size);
+                break;
+
+            case OP_DESTROY:
+                object->state = ES_DEAD;
+                break;
+
+            case OP_WALK:
+                walk(op, object, brick_list);
+                break;
+
+            case OP_GRAVITY:
+                actor_move(act, actor_platform_movement(act, brick_list, level_gravity()));
+                break;
+
+            case OP_JUMP:
+                jump(op, object, brick_list);
+                break;
+
+            case OP_BULLET_TRAJECTORY:
+                act->position = v2d_add(act->position, v2d_multiply(op->arg.speed, timer_get_delta()));
+                break;
+
+            case OP_ELLIPTICAL_TRAJECTORY:
+                elliptical_trajectory(op, object, brick_list);
+                break;
+
+            case OP_MOSQUITO_MOVEMENT:
+                mosquito_movement(op, object);
+                break;
+
+            case OP_LOOK_LEFT:
+                act->mirror &= ~IF_HFLIP;
+                break;
+
+            case OP_LOOK_RIGHT:
+                act->mirror |= IF_HFLIP;
+                break;
+
+            case OP_LOOK_AT_PLAYER:
+                player = enemy_get_observed_player(object);
+                if(act->position.x < player->actor->position.x)
+                    act->mirror &= ~IF_HFLIP;
+                else
+                    act->mirror |= IF_HFLIP;
+                break;
+
+            case OP_LOOK_AT_WALKING_DIRECTION:
+                if(act->position.x > op->arg.old_x)
+                    act->mirror &= ~IF_HFLIP;
+                else
+                    act->mirror |= IF_HFLIP;
+                op->arg.old_x = act->position.x;
+                break;
+        }
+    }
+}
+
+void objectvm_think(objectvm_t* vm, brick_list_t *brick_list)
+{
+    objectstate_list_t *state = vm->current_state;
+    actor_t *act = vm->owner->actor;
+    objectop_t *op = state->op, *end = state->op + state->op_count;
+    brick_t *down;
+
+    for(; op != end; op++) {
+        switch(op->opcode) {
+            case OP_MACHINE:
+                if(op->arg.machine->think != NULL)
+                    op->arg.machine->think(op->arg.machine, brick_list);
+                break;
+
+            case OP_GRAVITY:
+                actor_prefetch_platform_movement(act, brick_list);
+                break;
+
+            case OP_JUMP:
+                actor_corners(act, 2, -4, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void objectvm_render(objectvm_t* vm, v2d_t camera_position)
+{
+    objectstate_list_t *state = vm->current_state;
+    objectop_t *op = state->op, *end = state->op + state->op_count;
+
+    for(; op != end; op++) {
+        if(op->opcode == OP_MACHINE)
+            op->arg.machine->render(op->arg.machine, camera_position);
+    }
+
+    state->base->render(state->base, camera_position);
+}
+
 
 
 /* private methods */
 
-objectmachine_list_t* objectmachine_list_new(objectmachine_list_t* list, const char *name, enemy_t *owner)
+objectstate_list_t* objectstate_list_new(objectstate_list_t* list, const char *name, enemy_t *owner)
 {
-    objectmachine_list_t *l = mallocx(sizeof *l);
+    objectstate_list_t *l = mallocx(sizeof *l);
     l->name = str_dup(name);
-    l->data = objectbasicmachine_new(owner);
+    l->base = objectbasicmachine_new(owner);
+    l->op = NULL;
+    l->op_count = l->op_capacity = 0;
     l->next = list;
     return l;
 }
 
-objectmachine_list_t* objectmachine_list_delete(objectmachine_list_t* list)
+objectstate_list_t* objectstate_list_delete(objectstate_list_t* list)
 {
+    int i;
+
     if(list != NULL) {
-        objectmachine_t *machine = list->data;
-        objectmachine_list_delete(list->next);
+        objectstate_list_delete(list->next);
+        for(i=0; i<list->op_count; i++) {
+            if(list->op[i].opcode == OP_MACHINE)
+                list->op[i].arg.machine->release(list->op[i].arg.machine);
+        }
+        if(list->op != NULL)
+            free(list->op);
+        list->base->release(list->base);
         free(list->name);
-        machine->release(machine);
         free(list);
     }
 
     return NULL;
 }
 
-objectmachine_list_t* objectmachine_list_find(objectmachine_list_t* list, const char *name)
+objectstate_list_t* objectstate_list_find(objectstate_list_t* list, const char *name)
 {
     if(list != NULL) {
         if(str_icmp(list->name, name) != 0)
-            return objectmachine_list_find(list->next, name);
+            return objectstate_list_find(list->next, name);
         else
             return list;
     }
@@ -127,3 +334,155 @@ objectmachine_list_t* objectmachine_list_find(objectmachine_list_t* list, const
     return NULL;
 }
 
+/* walks, turning back at the walls and at the edges of the platforms */
+void walk(objectop_t *op, object_t *object, brick_list_t *brick_list)
+{
+    actor_t *act = object->actor;
+    float dt = timer_get_delta();
+    brick_t *up = NULL, *upright = NULL, *right = NULL, *downright = NULL;
+    brick_t *down = NULL, *downleft = NULL, *left = NULL, *upleft = NULL;
+    float sqrsize = 2, diff = -2;
+
+    /* move! */
+    act->position.x += (op->arg.walk.direction * op->arg.walk.speed) * dt;
+
+    /* sensors */
+    actor_corners(act, sqrsize, diff, brick_list, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+    actor_handle_clouds(act, diff, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+
+    /* swap direction when a wall is touched */
+    if(right != NULL) {
+        if(op->arg.walk.direction > 0.0f) {
+            act->position.x = act->hot_spot.x - actor_image(act)->w + right->x;
+            op->arg.walk.direction = -1.0f;
+        }
+    }
+
+    if(left != NULL) {
+        if(op->arg.walk.direction < 0.0f) {
+            act->position.x = act->hot_spot.x + left->x + brick_image(left)->w;
+            op->arg.walk.direction = 1.0f;
+        }
+    }
+
+    /* I don't want to fall from the platforms! */
+    if(down != NULL) {
+        if(downright == NULL && downleft != NULL)
+            op->arg.walk.direction = -1.0f;
+        else if(downleft == NULL && downright != NULL)
+            op->arg.walk.direction = 1.0f;
+    }
+}
+
+/* jumps, if the object is on the ground */
+void jump(objectop_t *op, object_t *object, brick_list_t *brick_list)
+{
+    actor_t *act = object->actor;
+    brick_t *down = NULL;
+    float sqrsize = 2, diff = -4;
+
+    /* sensors */
+    actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
+    actor_handle_clouds(act, diff, NULL, NULL, NULL, NULL, &down, NULL, NULL, NULL);
+
+    /* jump! */
+    if(down != NULL)
+        act->speed.y = -(op->arg.jump_strength);
+}
+
+/* moves along an ellipse centered at the spawn point */
+void elliptical_trajectory(objectop_t *op, object_t *object, brick_list_t *brick_list)
+{
+    actor_t *act = object->actor;
+    float dt = timer_get_delta();
+    brick_t *up = NULL, *upright = NULL, *right = NULL, *downright = NULL;
+    brick_t *down = NULL, *downleft = NULL, *left = NULL, *upleft = NULL;
+    float sqrsize = 0, diff = 0;
+    float elapsed_time = timer_get_ticks() * 0.001f;
+    v2d_t old_position = act->position;
+
+    /*
+        let C: R -> R^2 be such that:
+            C(t) = (
+                Ax * cos( Ix + Sx*t ) + Px,
+                Ay * sin( Iy + Sy*t ) + Py
+            )
+
+        where t is the elapsed time (in seconds), A the amplitude,
+        S the angular speed, I the initial phase and P the spawn
+        point. Then:
+            C'(t) = (
+                -Ax * Sx * sin( Ix + Sx*t ),
+                 Ay * Sy * cos( Iy + Sy*t )
+            )
+    */
+    act->position.x += (-op->arg.ellipse.amplitude_x * op->arg.ellipse.angularspeed_x * sin( op->arg.ellipse.initialphase_x + op->arg.ellipse.angularspeed_x * elapsed_time)) * dt;
+    act->position.y += ( op->arg.ellipse.amplitude_y * op->arg.ellipse.angularspeed_y * cos( op->arg.ellipse.initialphase_y + op->arg.ellipse.angularspeed_y * elapsed_time)) * dt;
+
+    /* sensors */
+    actor_corners(act, sqrsize, diff, brick_list, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+    actor_handle_clouds(act, diff, &up, &upright, &right, &downright, &down, &downleft, &left, &upleft);
+
+    /* I don't want to get stuck into walls */
+    if(right != NULL) {
+        if(act->position.x > old_position.x)
+            act->position.x = act->hot_spot.x - actor_image(act)->w + right->x;
+    }
+
+    if(left != NULL) {
+        if(act->position.x < old_position.x)
+            act->position.x = act->hot_spot.x + left->x + brick_image(left)->w;
+    }
+
+    if(down != NULL) {
+        if(act->position.y > old_position.y)
+            act->position.y = act->hot_spot.y - actor_image(act)->h + down->y;
+    }
+
+    if(up != NULL) {
+        if(act->position.y < old_position.y)
+            act->position.y = act->hot_spot.y + up->y + brick_image(up)->h;
+    }
+}
+
+/* flies towards the observed player */
+void mosquito_movement(objectop_t *op, object_t *object)
+{
+    player_t *player = enemy_get_observed_player(object);
+    v2d_t diff = v2d_subtract(player->actor->position, object->actor->position);
+    v2d_t direction, ds;
+
+    if(v2d_magnitude(diff) >= 5.0f) {
+        direction = v2d_normalize(diff);
+        ds = v2d_multiply(direction, op->arg.mosquito_speed * timer_get_delta());
+        object->actor->position = v2d_add(object->actor->position, ds);
+    }
+}
+
+/* hits the players, or gets defeated by them */
+void enemy(objectop_t *op, object_t *object, player_t **team, int team_size)
+{
+    player_t *player;
+    int i;
+
+    /* player x object collision */
+    for(i=0; i<team_size; i++) {
+        player = team[i];
+        if(actor_pixelperfect_collision(object->actor, player->actor)) {
+            if(player_attacking(player) || player->invincible) {
+                /* I've been defeated */
+                if(player->actor->is_jumping)
+                    player_bounce(player);
+                level_add_to_score(op->arg.score);
+                level_create_item(IT_EXPLOSION, v2d_add(object->actor->position, v2d_new(0,-15)));
+                level_create_animal(object->actor->position);
+                sound_play( soundfactory_get("destroy") );
+                object->state = ES_DEAD;
+            }
+            else {
+                /* The player has been hit by me */
+                player_hit(player);
+            }
+        }
+    }
+}
@@ -21,20 +21,76 @@
 #define _OBJECT_VM_H
 
 #include "enemy.h"
+#include "../core/sprite.h"
 #include "object_decorators/base/objectmachine.h"
 
 /* an objectvm_t is a finite state machine.
-   Every state has a name an can be decorated
-   (in terms of the Decorator Design Pattern) */
+   Every state has a name and a program: an array of
+   op records (an opcode and its operands), which
+   objectvm_update() and objectvm_render() run in
+   order, through a switch.
+
+   The commands that don't have an opcode of their own
+   are decorators of the basic machine of the state
+   (see object_decorators/), run through OP_MACHINE */
 
 typedef struct objectvm_t objectvm_t;
 
+/* opcodes */
+typedef enum {
+    OP_MACHINE,                     /* runs a decorator */
+    OP_SET_ANIMATION,
+    OP_SET_OBSTACLE,
+    OP_SET_ALPHA,
+    OP_ENEMY,
+    OP_DESTROY,
+    OP_WALK,
+    OP_GRAVITY,
+    OP_JUMP,
+    OP_BULLET_TRAJECTORY,
+    OP_ELLIPTICAL_TRAJECTORY,
+    OP_MOSQUITO_MOVEMENT,
+    OP_LOOK_LEFT,
+    OP_LOOK_RIGHT,
+    OP_LOOK_AT_PLAYER,
+    OP_LOOK_AT_WALKING_DIRECTION
+} objectopcode_t;
+
+/* an op record: the operands are stored inline */
+typedef struct objectop_t objectop_t;
+struct objectop_t {
+    objectopcode_t opcode;
+    union {
+        objectmachine_t *machine; /* OP_MACHINE */
+        animation_t *anim; /* OP_SET_ANIMATION */
+        struct { int is_obstacle, angle; } obstacle; /* OP_SET_OBSTACLE */
+        float alpha; /* OP_SET_ALPHA */
+        int score; /* OP_ENEMY */
+        struct { float speed, direction; } walk; /* OP_WALK */
+        float jump_strength; /* OP_JUMP */
+        v2d_t speed; /* OP_BULLET_TRAJECTORY */
+        struct {
+            float amplitude_x, amplitude_y; /* in pixels */
+            float angularspeed_x, angularspeed_y; /* in radians per second */
+            float initialphase_x, initialphase_y; /* in radians */
+        } ellipse; /* OP_ELLIPTICAL_TRAJECTORY */
+        float mosquito_speed; /* OP_MOSQUITO_MOVEMENT */
+        float old_x; /* OP_LOOK_AT_WALKING_DIRECTION */
+    } arg;
+};
+
 /* public methods */
 
 objectvm_t* objectvm_create(enemy_t* owner); /* creates a new virtual machine */
 objectvm_t* objectvm_destroy(objectvm_t* vm); /* destroys an existing VM */
-objectmachine_t** objectvm_get_reference_to_current_state(objectvm_t* vm); /* returns a reference to the current state */
 void objectvm_create_state(objectvm_t* vm, const char *name); /* you have to create a state before you can use it */
 void objectvm_set_current_state(objectvm_t* vm, const char *name); /* sets the current state */
+void objectvm_init_current_state(objectvm_t* vm); /* initializes the program of the current state, once it's complete */
+objectop_t* objectvm_emit(objectvm_t* vm, objectopcode_t opcode); /* appends an op to the current state; fill in its operands */
+void objectvm_emit_machine(objectvm_t* vm, objectmachine_t *machine); /* appends an OP_MACHINE to the current state */
+objectmachine_t* objectvm_get_base_machine(objectvm_t* vm); /* the basic machine of the current state (decorate this one) */
+void objectvm_update(objectvm_t* vm, player_t **team, int team_size, brick_list_t *brick_list, item_list_t *item_list, object_list_t *object_list); /* runs the current state */
+void objectvm_render(objectvm_t* vm, v2d_t camera_position); /* renders the current state */
+void objectvm_think(objectvm_t* vm, brick_list_t *brick_list); /* prefetches the sensors of the current state (thread-safe among different VMs) */
 
 #endif
@@ -20,6 +20,7 @@
 #include <math.h>
 #include "actor.h"
 #include "player.h"
+#include "sensor.h"
 #include "brick.h"
 #include "enemy.h"
 #include "item.h"
@@ -34,6 +35,7 @@
 #include "../core/input.h"
 #include "../core/sprite.h"
 #include "../core/soundfactory.h"
+#include "../core/trig.h"
 #include "../scenes/level.h"
 
 
@@ -57,6 +59,8 @@ static int inside_loop(player_t *p);
 static int got_crushed(player_t *p, brick_t *brick_up, brick_t *brick_right, brick_t *brick_down, brick_t *brick_left);
 static void stickyphysics_hack(player_t *player, brick_list_t *brick_list, brick_t **brick_downleft, brick_t **brick_down, brick_t **brick_downright);
 
+static void sensor_factors(int type, int slope, float *top, float *middle, float *lateral);
+
 
 /*
  * player_create()
@@ -215,7 +219,7 @@ void player_render(player_t *player, v2d_t camera_position)
             invangle[i] = (180*4) * timer_get_ticks()*0.001 + (i+1)*(360/PLAYER_MAX_INVSTAR);
             starpos.x = 30*cos(invangle[i]*PI/180);
             starpos.y = ((timer_get_ticks()+i*400)%2000)/40;
-            starpos = v2d_rotate(starpos,ang);
+            starpos = trig_rotate(starpos,ang);
             player->invstar[i]->position.x = act->position.x + starpos.x;
             player->invstar[i]->position.y = act->position.y - starpos.y + 5;
             actor_change_animation_frame(player->invstar[i], random(maxf));
@@ -270,7 +274,7 @@ void player_render(player_t *player, v2d_t camera_position)
                 if(player->shield_type != SH_NONE) {
                     v2d_t voff;
                     if(rotate)
-                        voff = v2d_rotate(v2d_new(left?-13:13,-13), -act->angle);
+                        voff = trig_rotate(v2d_new(left?-13:13,-13), -act->angle);
                     else if(act->mirror & IF_HFLIP)
                         voff = v2d_new((act->speed.y>0) ? -13 : 13, -15);
                     else
@@ -357,14 +361,14 @@ void player_render(player_t *player, v2d_t camera_position)
     float offx=camera_position.x-VIDEO_SCREEN_W/2;
     float offy=camera_position.y-VIDEO_SCREEN_H/2;
     v2d_t feet      = act->position;
-    v2d_t up        = v2d_add ( feet , v2d_rotate( v2d_new(0, -frame_height*top+diff), -act->angle) );
-    v2d_t down      = v2d_add ( feet , v2d_rotate( v2d_new(0, -diff), -act->angle) ); 
-    v2d_t left      = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*middle), -act->angle) );
-    v2d_t right     = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*middle), -act->angle) );
-    v2d_t upleft    = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*top+diff), -act->angle) );
-    v2d_t upright   = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*top+diff), -act->angle) );
-    v2d_t downleft  = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -diff), -act->angle) );
-    v2d_t downright = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -diff), -act->angle) );
+    v2d_t up        = v2d_add ( feet , trig_rotate( v2d_new(0, -frame_height*top+diff), -act->angle) );
+    v2d_t down      = v2d_add ( feet , trig_rotate( v2d_new(0, -diff), -act->angle) ); 
+    v2d_t left      = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*middle), -act->angle) );
+    v2d_t right     = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -frame_height*middle), -act->angle) );
+    v2d_t upleft    = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*top+diff), -act->angle) );
+    v2d_t upright   = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -frame_height*top+diff), -act->angle) );
+    v2d_t downleft  = v2d_add ( feet , trig_rotate( v2d_new(-frame_width*lateral+diff, -diff), -act->angle) );
+    v2d_t downright = v2d_add ( feet , trig_rotate( v2d_new(frame_width*lateral-diff, -diff), -act->angle) );
     if(player->type == PL_TAILS && act->carrying && fabs(act->angle)<EPSILON) { float h=actor_image(act->carrying)->h, k=act->speed.y>5?h*0.7:0; downleft.y += k; downright.y += k; down.y += k; left.y += h*middle+random(h)-h*0.5; right.y = left.y; }
     float cd_up[4] = { up.x-sqrsize-offx , up.y-sqrsize-offy , up.x+sqrsize-offx , up.y+sqrsize-offy };
     float cd_down[4] = { down.x-sqrsize-offx , down.y-sqrsize-offy , down.x+sqrsize-offx , down.y+sqrsize-offy };
@@ -374,14 +378,14 @@ void player_render(player_t *player, v2d_t camera_position)
     float cd_downright[4] = { downright.x-sqrsize-offx , downright.y-sqrsize-offy , downright.x+sqrsize-offx , downright.y+sqrsize-offy };
     float cd_upright[4] = { upright.x-sqrsize-offx , upright.y-sqrsize-offy , upright.x+sqrsize-offx , upright.y+sqrsize-offy };
     float cd_upleft[4] = { upleft.x-sqrsize-offx , upleft.y-sqrsize-offy , upleft.x+sqrsize-offx , upleft.y+sqrsize-offy };
-    rectfill(video_get_backbuffer()->data, cd_up[0], cd_up[1], cd_up[2], cd_up[3], 0xFFFFFF);
-    rectfill(video_get_backbuffer()->data, cd_down[0], cd_down[1], cd_down[2], cd_down[3], 0xFFFFFF);
-    rectfill(video_get_backbuffer()->data, cd_left[0], cd_left[1], cd_left[2], cd_left[3], 0xFFFFFF);
-    rectfill(video_get_backbuffer()->data, cd_right[0], cd_right[1], cd_right[2], cd_right[3], 0xFFFFFF);
-    rectfill(video_get_backbuffer()->data, cd_downleft[0], cd_downleft[1], cd_downleft[2], cd_downleft[3], random(0xFFFFFF));
-    rectfill(video_get_backbuffer()->data, cd_downright[0], cd_downright[1], cd_downright[2], cd_downright[3], random(0xFFFFFF));
-    rectfill(video_get_backbuffer()->data, cd_upright[0], cd_upright[1], cd_upright[2], cd_upright[3], random(0xFFFFFF));
-    rectfill(video_get_backbuffer()->data, cd_upleft[0], cd_upleft[1], cd_upleft[2], cd_upleft[3], random(0xFFFFFF));
+    image_rectfill(video_get_backbuffer(), cd_up[0], cd_up[1], cd_up[2], cd_up[3], 0xFFFFFF);
+    image_rectfill(video_get_backbuffer(), cd_down[0], cd_down[1], cd_down[2], cd_down[3], 0xFFFFFF);
+    image_rectfill(video_get_backbuffer(), cd_left[0], cd_left[1], cd_left[2], cd_left[3], 0xFFFFFF);
+    image_rectfill(video_get_backbuffer(), cd_right[0], cd_right[1], cd_right[2], cd_right[3], 0xFFFFFF);
+    image_rectfill(video_get_backbuffer(), cd_downleft[0], cd_downleft[1], cd_downleft[2], cd_downleft[3], random(0xFFFFFF));
+    image_rectfill(video_get_backbuffer(), cd_downright[0], cd_downright[1], cd_downright[2], cd_downright[3], random(0xFFFFFF));
+    image_rectfill(video_get_backbuffer(), cd_upright[0], cd_upright[1], cd_upright[2], cd_upright[3], random(0xFFFFFF));
+    image_rectfill(video_get_backbuffer(), cd_upleft[0], cd_upleft[1], cd_upleft[2], cd_upleft[3], random(0xFFFFFF));
     }
     }
 #endif
@@ -417,41 +421,33 @@ v2d_t player_platform_movement(player_t *player, player_t *team[3], brick_list_t
     /* actor's collision detectors */
     int frame_width = actor_image(act)->w, frame_height = actor_image(act)->h;
     int slope = !((fabs(act->angle)<EPSILON)||(fabs(act->angle-PI/2)<EPSILON)||(fabs(act->angle-PI)<EPSILON)||(fabs(act->angle-3*PI/2)<EPSILON));
+    int degrees = trig_degrees(act->angle);
     float diff = -2, sqrsize = 2, top=0, middle=0, lateral=0;
     brick_t *brick_up, *brick_down, *brick_right, *brick_left;
     brick_t *brick_upright, *brick_downright, *brick_downleft, *brick_upleft;
     brick_t *brick_tmp;
     v2d_t up, upright, right, downright, down, downleft, left, upleft;
     v2d_t feet = act->position;
-    switch(player->type) {
-        case PL_SONIC:
-            if(!slope) { top = 0.7; middle = 0.5; lateral = 0.4; }
-            else       { top = 1.0; middle = 0.8; lateral = 0.5; }
-            break;
-
-        case PL_TAILS:
-            if(!slope) { top = 0.7; middle = 0.5; lateral = 0.25; }
-            else       { top = 1.0; middle = 0.7; lateral = 0.25; }
-            break;
-
-        case PL_KNUCKLES:
-            if(!slope) { top = 0.7; middle = 0.5; lateral = 0.25; }
-            else       { top = 1.0; middle = 0.7; lateral = 0.25; }
-            break;
-    }
-    up        = v2d_add ( feet , v2d_rotate( v2d_new(0, -frame_height*top+diff), -act->angle) );
-    down      = v2d_add ( feet , v2d_rotate( v2d_new(0, -diff), -act->angle) ); 
-    left      = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*middle), -act->angle) );
-    right     = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*middle), -act->angle) );
-    upleft    = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -frame_height*top+diff), -act->angle) );
-    upright   = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -frame_height*top+diff), -act->angle) );
-    downleft  = v2d_add ( feet , v2d_rotate( v2d_new(-frame_width*lateral+diff, -diff), -act->angle) );
-    downright = v2d_add ( feet , v2d_rotate( v2d_new(frame_width*lateral-diff, -diff), -act->angle) );
+    v2d_t layout[8];
+    const v2d_t *offset = layout;
+    sensor_factors(player->type, slope, &top, &middle, &lateral);
+    if(degrees >= 0)
+        offset = sensor_template(frame_width, frame_height, degrees, top, middle, lateral);
+    else
+        sensor_layout(frame_width, frame_height, top, middle, lateral, act->angle, layout);
+    up        = v2d_add ( feet , offset[0] );
+    upright   = v2d_add ( feet , offset[1] );
+    right     = v2d_add ( feet , offset[2] );
+    downright = v2d_add ( feet , offset[3] );
+    down      = v2d_add ( feet , offset[4] );
+    downleft  = v2d_add ( feet , offset[5] );
+    left      = v2d_add ( feet , offset[6] );
+    upleft    = v2d_add ( feet , offset[7] );
     if(player->type == PL_TAILS && act->carrying && fabs(act->angle)<EPSILON) { float h=actor_image(act->carrying)->h, k=act->speed.y>5?h*0.7:0; downleft.y += k; downright.y += k; down.y += k; left.y += h*middle+random(h)-h*0.5; right.y = left.y; }
-    actor_corners_disable_detection(player->disable_wall & PLAYER_WALL_LEFT, player->disable_wall & PLAYER_WALL_RIGHT, player->disable_wall & PLAYER_WALL_BOTTOM, player->disable_wall & PLAYER_WALL_TOP);
-    actor_corners_set_floor_priority( (player->disable_wall & PLAYER_WALL_BOTTOM) ? FALSE : TRUE );
+    actor_corners_disable_detection(act, player->disable_wall & PLAYER_WALL_LEFT, player->disable_wall & PLAYER_WALL_RIGHT, player->disable_wall & PLAYER_WALL_BOTTOM, player->disable_wall & PLAYER_WALL_TOP);
+    actor_corners_set_floor_priority(act, (player->disable_wall & PLAYER_WALL_BOTTOM) ? FALSE : TRUE );
     actor_corners_ex(act, sqrsize, up, upright, right, downright, down, downleft, left, upleft, brick_list, &brick_up, &brick_upright, &brick_right, &brick_downright, &brick_down, &brick_downleft, &brick_left, &brick_upleft);
-    actor_corners_restore_floor_priority();
+    actor_corners_restore_floor_priority(act);
 
     /* is the player dying? */
     if(player->dying) {
@@ -678,8 +674,8 @@ v2d_t player_platform_movement(player_t *player, player_t *team[3], brick_list_t
                     else if(!inside_loop(player)) {
                         /* stopped / ledge */
                         brick_t *minileft, *miniright;
-                        v2d_t vminileft  = v2d_add ( feet , v2d_rotate( v2d_new(-8, 0), -act->angle) );
-                        v2d_t vminiright = v2d_add ( feet , v2d_rotate( v2d_new(5, 0), -act->angle) );
+                        v2d_t vminileft  = v2d_add ( feet , trig_rotate( v2d_new(-8, 0), -act->angle) );
+                        v2d_t vminiright = v2d_add ( feet , trig_rotate( v2d_new(5, 0), -act->angle) );
                         v2d_t v = v2d_new(0,0);
                         actor_corners_ex(act, sqrsize, v, v, v, vminiright, v, vminileft, v, v, brick_list, NULL, NULL, NULL, &miniright, NULL, &minileft, NULL, NULL);
                         if(((!miniright && !(act->mirror&IF_HFLIP)) || (!minileft && (act->mirror&IF_HFLIP))) && !player->on_moveable_platform)
@@ -852,7 +848,7 @@ v2d_t player_platform_movement(player_t *player, player_t *team[3], brick_list_t
             if(!act->is_jumping) {
                 float mytan, super = 1.2, push = 25.0;
                 if(ang > 0 && ang < 90) {
-                    mytan = min(1, tan( ang*PI/180.0 ))*0.8;
+                    mytan = min(1, trig_tan(ang))*0.8;
                     if(fabs(act->speed.y) > EPSILON)
                         act->speed.x = (was_jumping && ang<=45) ? act->speed.x : max(-super*maxspeed, -1*mytan*act->speed.y);
                     else {
@@ -860,14 +856,14 @@ v2d_t player_platform_movement(player_t *player, player_t *team[3], brick_list_t
                         if(player->braking && ang<45)
                             factor *= 8.0 * (act->speed.x<0 ? -1.0/2.0 : 1.0/1.0);
                         else if(fabs(act->speed.x)<5) {
-                            factor *= sin(ang*PI/180.0)*push;
+                            factor *= trig_sin(ang)*push;
                             player->lock_accel = LOCKACCEL_RIGHT;
                         }
                         act->speed.x = max(act->speed.x - factor*700*dt, -super*maxspeed);
                     }
                 }
                 else if(ang > 270 && ang < 360) {
-                    mytan = min(1, -tan( ang*PI/180.0 ))*0.8;
+                    mytan = min(1, -trig_tan(ang))*0.8;
                     if(fabs(act->speed.y) > EPSILON)
                         act->speed.x = (was_jumping && ang>=315) ? act->speed.x : min(super*maxspeed, 1*mytan*act->speed.y);
                     else {
@@ -875,7 +871,7 @@ v2d_t player_platform_movement(player_t *player, player_t *team[3], brick_list_t
                         if(player->braking && ang>315)
                             factor *= 8.0 * (act->speed.x>0 ? -1.0/2.0 : 1.0/1.0);
                         else if(fabs(act->speed.x)<5) {
-                            factor *= -sin(ang*PI/180.0)*push;
+                            factor *= -trig_sin(ang)*push;
                             player->lock_accel = LOCKACCEL_LEFT;
                         }
                         act->speed.x = min(act->speed.x + factor*700*dt, super*maxspeed);
@@ -1620,7 +1616,7 @@ void update_glasses(player_t *p)
     int visible = TRUE;
     float ang = old_school_angle(p->actor->angle);
     v2d_t gpos = v2d_new(0,0);
-    v2d_t top = v2d_subtract(p->actor->position,v2d_rotate(v2d_new(0,p->actor->hot_spot.y),-ang));
+    v2d_t top = v2d_subtract(p->actor->position,trig_rotate(v2d_new(0,p->actor->hot_spot.y),-ang));
     animation_t *anim = p->actor->animation;
 
 
@@ -1982,7 +1978,7 @@ void update_glasses(player_t *p)
 
     gpos.x *= hflip ? -1 : 1;
     actor_change_animation(p->glasses, sprite_get_animation("SD_GLASSES", frame_id));
-    p->glasses->position = v2d_add(top, v2d_rotate(gpos, -ang));
+    p->glasses->position = v2d_add(top, trig_rotate(gpos, -ang));
     p->glasses->angle = ang;
     p->glasses->mirror = p->actor->mirror;
     p->glasses->visible = visible && p->actor->visible;
@@ -2011,37 +2007,37 @@ void update_shield(player_t *p)
 
         case SH_SHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_SHIELD", 0));
             break;
 
         case SH_FIRESHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_FIRESHIELD", 0));
             break;
 
         case SH_THUNDERSHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_THUNDERSHIELD", 0));
             break;
 
         case SH_WATERSHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_WATERSHIELD", 0));
             break;
 
         case SH_ACIDSHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_ACIDSHIELD", 0));
             break;
 
         case SH_WINDSHIELD:
             off = v2d_new(0,-22);
-            sh->position = v2d_add(act->position, v2d_rotate(off, -old_school_angle(act->angle)));
+            sh->position = v2d_add(act->position, trig_rotate(off, -old_school_angle(act->angle)));
             actor_change_animation(sh, sprite_get_animation("SD_WINDSHIELD", 0));
             break;
     }
@@ -2062,9 +2058,15 @@ void stickyphysics_hack(player_t *player, brick_list_t *brick_list, brick_t **br
 
     if(NULL == *brick_down && !act->is_jumping && !player->is_fire_jumping && !player->flying && !player->climbing && !player->landing && !player->spring && !player->getting_hit && !player->dead && !player->dying) {
         int i;
-        float sqrsize=2, diff=-2;
+        float sqrsize=2, diff=-2, distance;
         brick_t *downleft, *down, *downright;
-        for(i=0; i<8; i++) {
+
+        /* is there any ground up to 8 pixels below? */
+        if(NULL == actor_corners_sweep_down(act, sqrsize, diff, brick_list, v2d_new(0, 8), &distance))
+            return;
+
+        /* the sweep tells where to start looking */
+        for(i=max(0, (int)(distance - 0.01f)); i<8; i++) {
             act->position.y = oldy + (float)(1+i);
             actor_corners(act, sqrsize, diff, brick_list, NULL, NULL, NULL, &downright, &down, &downleft, NULL, NULL);
             if(NULL != down) {
@@ -2120,3 +2122,28 @@ int got_crushed(player_t *p, brick_t *brick_up, brick_t *brick_right, brick_t *b
     /* I'm not being crushed */
     return FALSE;
 }
+
+/* where the collision detectors are (in proportion to the size of the frame) */
+void sensor_factors(int type, int slope, float *top, float *middle, float *lateral)
+{
+    switch(type) {
+        case PL_SONIC:
+            if(!slope) { *top = 0.7; *middle = 0.5; *lateral = 0.4; }
+            else       { *top = 1.0; *middle = 0.8; *lateral = 0.5; }
+            break;
+
+        case PL_TAILS:
+            if(!slope) { *top = 0.7; *middle = 0.5; *lateral = 0.25; }
+            else       { *top = 1.0; *middle = 0.7; *lateral = 0.25; }
+            break;
+
+        case PL_KNUCKLES:
+            if(!slope) { *top = 0.7; *middle = 0.5; *lateral = 0.25; }
+            else       { *top = 1.0; *middle = 0.7; *lateral = 0.25; }
+            break;
+
+        default:
+            *top = *middle = *lateral = 0;
+            break;
+    }
+}
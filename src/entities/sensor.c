@@ -0,0 +1,77 @@
+/*
+ * sensor.c - collision detectors of the characters routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "sensor.h"
+#include "../core/global.h"
+#include "../core/trig.h"
+
+/* sensor templates */
+#define SENSORTEMPLATE_CACHESIZE    64
+typedef struct {
+    int used;
+    int width, height, degrees;
+    float top, middle, lateral;
+    v2d_t offset[8];
+} sensortemplate_t;
+static sensortemplate_t sensortemplate[SENSORTEMPLATE_CACHESIZE];
+
+
+
+/*
+ * sensor_layout()
+ * The offsets of the collision detectors (relative to the feet)
+ */
+void sensor_layout(float width, float height, float top, float middle, float lateral, float angle, v2d_t offset[8])
+{
+    const float diff = -2;
+
+    offset[0] = trig_rotate( v2d_new(0, -height*top+diff), -angle ); /* up */
+    offset[1] = trig_rotate( v2d_new(width*lateral-diff, -height*top+diff), -angle ); /* upright */
+    offset[2] = trig_rotate( v2d_new(width*lateral-diff, -height*middle), -angle ); /* right */
+    offset[3] = trig_rotate( v2d_new(width*lateral-diff, -diff), -angle ); /* downright */
+    offset[4] = trig_rotate( v2d_new(0, -diff), -angle ); /* down */
+    offset[5] = trig_rotate( v2d_new(-width*lateral+diff, -diff), -angle ); /* downleft */
+    offset[6] = trig_rotate( v2d_new(-width*lateral+diff, -height*middle), -angle ); /* left */
+    offset[7] = trig_rotate( v2d_new(-width*lateral+diff, -height*top+diff), -angle ); /* upleft */
+}
+
+
+/*
+ * sensor_template()
+ * The same as sensor_layout(), but the angle is a whole
+ * number of degrees in [0,360) and the result is cached
+ */
+const v2d_t* sensor_template(int width, int height, int degrees, float top, float middle, float lateral)
+{
+    unsigned key = (((unsigned)width * 31 + height) * 31 + degrees) * 31 + (unsigned)(100 * (top + middle + lateral));
+    sensortemplate_t *t = &sensortemplate[key % SENSORTEMPLATE_CACHESIZE];
+
+    if(!t->used || t->width != width || t->height != height || t->degrees != degrees || t->top != top || t->middle != middle || t->lateral != lateral) {
+        sensor_layout(width, height, top, middle, lateral, degrees * PI / 180.0, t->offset);
+        t->used = TRUE;
+        t->width = width;
+        t->height = height;
+        t->degrees = degrees;
+        t->top = top;
+        t->middle = middle;
+        t->lateral = lateral;
+    }
+
+    return t->offset;
+}
@@ -0,0 +1,42 @@
+/*
+ * sensor.h - collision detectors of the characters routines
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SENSOR_H
+#define _SENSOR_H
+
+#include "../core/v2d.h"
+
+/*
+   The collision detectors of a character are 8 points
+   relative to its feet: up, upright, right, downright,
+   down, downleft, left, upleft. Their layout depends on
+   the size of the current frame, on some factors (in
+   proportion to that size) and on the angle.
+
+   As the angles come from the bricks, they are usually
+   whole numbers of degrees: these layouts are cached.
+*/
+
+/* the layout at any angle (in radians) */
+void sensor_layout(float width, float height, float top, float middle, float lateral, float angle, v2d_t offset[8]);
+
+/* the layout at a whole number of degrees in [0,360), cached */
+const v2d_t* sensor_template(int width, int height, int degrees, float top, float middle, float lateral);
+
+#endif
@@ -221,26 +221,17 @@ void save_preferences(const char *filepath)
 /* reads the language list from the languages/ folder */
 void load_lang_list()
 {
-    int i, j, deny_flags = FA_DIREC | FA_LABEL, c = 0;
-    int max_paths;
+    int i, c = 0;
     char path[] = "languages/*.lng";
-    char abs_path[2][1024];
 
     logfile_message("load_lang_list()");
 
-    /* official and $HOME files */
-    absolute_filepath(abs_path[0], path, sizeof(abs_path[0]));
-    home_filepath(abs_path[1], path, sizeof(abs_path[1]));
-    max_paths = (strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2;
-
-    /* loading language data */
+    /* loading language data (official and $HOME files) */
     lngcount = 0;
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dircount, NULL);
+    for_each_resource(path, dircount, NULL);
 
     lngdata = mallocx(lngcount * sizeof(lngdata_t));
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dirfill, (void*)&c);
+    for_each_resource(path, dirfill, (void*)&c);
     qsort(lngdata, lngcount, sizeof(lngdata_t), sort_cmp);
 
     /* fatal error */
@@ -42,6 +42,13 @@
 #include "../core/logfile.h"
 #include "../core/lang.h"
 #include "../core/soundfactory.h"
+#include "../core/spatialindex.h"
+#include "../core/broadphase.h"
+#include "../core/drawlist.h"
+#include "../core/thread.h"
+#include "../core/loadgraph.h"
+#include "../core/scriptcache.h"
+#include "../core/image.h"
 #include "../core/nanoparser/nanoparser.h"
 #include "../entities/brick.h"
 #include "../entities/player.h"
@@ -53,6 +60,9 @@
 #include "../entities/background.h"
 #include "../entities/items/flyingtext.h"
 #include "util/editorgrp.h"
+#include "util/brickcache.h"
+#include "util/sectorstream.h"
+#include "util/levelprefetch.h"
 
 
 
@@ -107,6 +117,35 @@ static void update_dialogregions();
 
 
 
+/* ------------------------
+ * Think phase
+ *
+ * Before the items and the
+ * objects are updated, their
+ * collision queries run in
+ * parallel (see item_think())
+ * ------------------------ */
+/* constants */
+#define THINK_CHUNK 8 /* entities per job */
+
+/* structure */
+typedef struct {
+    item_t *item; /* either an item... */
+    enemy_t *object; /* ...or an object */
+} thinker_t;
+
+/* internal data */
+static thinker_t *thinker;
+static int thinker_count, thinker_capacity;
+
+/* internal methods */
+static void think_add(item_t *item, enemy_t *object);
+static void think_all(brick_list_t *brick_list);
+static void think_job(int index, void *brick_list);
+static void think_release();
+
+
+
 /* ------------------------
  * Level
  * ------------------------ */
@@ -115,6 +154,11 @@ static void update_dialogregions();
 #define ACTCLEAR_BONUSMAX       3 /* ring bonus, secret bonus, total */
 #define MAX_POWERUPS            10
 #define DLGBOX_MAXTIME          7000
+#define BROADPHASE_MARGIN       32 /* objects may move this much without a new sweep */
+#define LOADING_RENDER_INTERVAL 33 /* ms between two frames of the progress bar */
+
+/* the brickset of the previous act, if this one uses it too */
+static char kept_theme[1024] = "";
 
 /* level attributes */
 static char file[1024];
@@ -138,6 +182,10 @@ static brick_list_t *brick_list;
 static item_list_t *item_list;
 static enemy_list_t *enemy_list;
 static particle_list_t *particle_list;
+static spatialindex_t *item_index; /* items by type */
+static spatialindex_t *object_index; /* objects by name */
+static broadphase_t *object_broadphase; /* collisions between objects, by name_id */
+static unsigned int item_generation; /* incremented whenever an item is created or destroyed */
 static v2d_t spawn_point;
 static music_t *music;
 static sound_t *override_music;
@@ -186,10 +234,19 @@ static void level_load(const char *filepath);
 static void level_unload();
 static void level_save(const char *filepath);
 static int traverse_level(const parsetree_statement_t* stmt);
+static void build_level(loadgraph_t *graph, int job, void *param);
+static void render_loading_progress(const char *phase, float done, void *param);
 
 /* internal methods */
 static void render_entities(); /* render bricks, items, enemies, players, etc. */
+static void render_bricks(enum brickcache_layer layer, brick_list_t *major_bricks); /* render a layer of bricks */
 static void render_hud(); /* renders the hud */
+static void render_background_stats(); /* profiling */
+static void render_drawlist_stats(); /* profiling */
+static void render_sensor_stats(); /* profiling */
+static void render_broadphase_stats(); /* profiling */
+static void render_pool_stats(); /* profiling */
+static void render_sectorstream_stats(); /* profiling */
 static int got_boss(); /* does this level have a boss? */
 static void brick_move(brick_t *brick); /* moveable platforms */
 static int inside_screen(int x, int y, int w, int h, int margin);
@@ -203,13 +260,19 @@ static void insert_brick_sorted(brick_list_t *b);
 static brick_t *create_fake_brick(int width, int height, v2d_t position, int angle);
 static void destroy_fake_brick(brick_t *b);
 static void update_level_size();
+static void reserve_pools();
 static void restart();
 static void render_players(int bring_to_back);
 static void update_music();
 static void spawn_players();
 static void remove_dead_bricks();
+static void invalidate_brick(brick_t *brick);
 static void remove_dead_items();
 static void remove_dead_objects();
+static void update_spatial_indexes();
+static int object_key(const char *name);
+static int object_has_name(void *object, void *name);
+static int object_collision(const void *object, const void *other);
 static void render_powerups(); /* gui / hud related */
 static void update_dlgbox(); /* dialog boxes */
 static void render_dlgbox(); /* dialog boxes */
@@ -312,6 +375,26 @@ int editor_enemy_name2key(const char *name);
 const char* editor_enemy_key2name(int key);
 
 
+/* palette thumbnails: the preview of each object is built once */
+#define EDITOR_THUMB_WARMUP   1 /* thumbnails built in advance per frame */
+typedef struct {
+    int ready; /* has it been built? */
+    image_t *image; /* preview (NULL if there's none) */
+    int own_image; /* was the image created here? (groups) */
+    v2d_t hot_spot;
+    int obstacle, bring_to_back; /* items only */
+} editor_thumb_t;
+static editor_thumb_t *editor_thumb[4]; /* indexed by editor_object_type and object id */
+static int editor_thumb_count[4];
+static int editor_thumb_warmup_type, editor_thumb_warmup_id;
+
+static void editor_thumb_init();
+static void editor_thumb_release();
+static editor_thumb_t* editor_thumb_get(enum editor_object_type obj_type, int obj_id);
+static void editor_thumb_warmup(int count);
+static void editor_thumb_build(editor_thumb_t *thumb, enum editor_object_type obj_type, int obj_id);
+
+
 /* grid */
 #define EDITOR_GRID_W         (int)(editor_grid_size().x)
 #define EDITOR_GRID_H         (int)(editor_grid_size().y)
@@ -395,7 +478,9 @@ static editor_action_list_t* editor_action_delete_list(editor_action_list_t *lis
 void level_load(const char *filepath)
 {
     char abs_path[1024];
-    parsetree_program_t *prog;
+    loadgraph_t *graph;
+    levelprefetch_t *prefetch;
+    int build;
 
     setlocale(LC_NUMERIC, "C"); /* bugfix */
     logfile_message("level_load(\"%s\")", filepath);
@@ -418,11 +503,42 @@ void level_load(const char *filepath)
     requires[1] = GAME_SUB_VERSION;
     requires[2] = GAME_WIP_VERSION;
     readonly = FALSE;
+    sectorstream_init(abs_path);
+
+    /* the files are read in parallel, then the level is built */
+    graph = loadgraph_create();
+    prefetch = levelprefetch_create(graph, filepath);
+    build = loadgraph_add(graph, -1, "level", TRUE, build_level, NULL);
+    loadgraph_depend(graph, build, levelprefetch_job(prefetch));
+    loadgraph_run(graph, render_loading_progress, NULL);
+    prefetch = levelprefetch_destroy(prefetch);
+    graph = loadgraph_destroy(graph);
+
+    /* whatever has been read, but not used */
+    scriptcache_discard();
+    image_prefetch_discard();
+
+    /* success! */
+    logfile_message("level_load() ok");
+}
+
+/*
+ * build_level()
+ * Builds the level out of the files that have been
+ * read (this is the last job of level_load())
+ */
+void build_level(loadgraph_t *graph, int job, void *param)
+{
+    parsetree_program_t *prog;
 
     /* traversing the level file */
-    prog = nanoparser_construct_tree(abs_path);
+    prog = scriptcache_take(file);
     nanoparser_traverse_program(prog, traverse_level);
     prog = nanoparser_deconstruct_tree(prog);
+    level_release_kept_brickset();
+
+    /* creating the bricks, items and objects (or streaming them) */
+    sectorstream_start(spawn_point);
 
     /* load the music */
     block_music = FALSE;
@@ -430,9 +546,40 @@ void level_load(const char *filepath)
 
     /* misc */
     update_level_size();
+    reserve_pools();
+}
 
-    /* success! */
-    logfile_message("level_load() ok");
+/*
+ * render_loading_progress()
+ * Draws a progress bar while the level is being loaded
+ */
+void render_loading_progress(const char *phase, float done, void *param)
+{
+    static uint32 last_time = 0;
+    uint32 t = timer_get_ticks();
+    int w = (int)(done * (VIDEO_SCREEN_W - 20));
+
+    if(done < 1.0f && t < last_time + LOADING_RENDER_INTERVAL)
+        return;
+
+    last_time = t;
+    image_rectfill(video_get_backbuffer(), 10, VIDEO_SCREEN_H-6, VIDEO_SCREEN_W-10, VIDEO_SCREEN_H-4, image_rgb(0,0,0));
+    image_rectfill(video_get_backbuffer(), 10, VIDEO_SCREEN_H-6, 10+w, VIDEO_SCREEN_H-4, image_rgb(255,255,255));
+    video_render();
+}
+
+/*
+ * level_release_kept_brickset()
+ * Unloads the brickset of the previous act, if
+ * it's been kept for the next one but not used
+ */
+void level_release_kept_brickset()
+{
+    if(*kept_theme) {
+        logfile_message("unloading the brickset of the previous act...");
+        brickdata_unload();
+        strcpy(kept_theme, "");
+    }
 }
 
 /*
@@ -447,6 +594,7 @@ void level_unload()
     enemy_list_t *enode, *enext;
 
     logfile_message("level_unload()");
+    sectorstream_release();
     music_stop();
     music_unref(musicfile);
     music_unref("musics/invincible.ogg");
@@ -460,6 +608,7 @@ void level_unload()
         free(node);
     }
     brick_list = NULL;
+    brickcache_invalidate_all();
 
     /* clears the item list */
     logfile_message("releasing item list...");
@@ -479,6 +628,12 @@ void level_unload()
     }
     enemy_list = NULL;
 
+    /* clears the spatial indexes */
+    spatialindex_clear(item_index);
+    spatialindex_clear(object_index);
+    broadphase_clear(object_broadphase);
+    item_generation++;
+
     /* releasing the boss */
     if(got_boss()) {
         logfile_message("releasing the boss...");
@@ -486,9 +641,19 @@ void level_unload()
         boss = NULL;
     }
 
-    /* unloading the brickset */
-    logfile_message("unloading the brickset...");
-    brickdata_unload();
+    /* releasing the pools */
+    item_pool_release();
+    actor_pool_release();
+
+    /* unloading the brickset (unless the next act uses it too) */
+    if(level_cleared && quest_next_level_uses(theme)) {
+        logfile_message("keeping the brickset for the next act...");
+        str_cpy(kept_theme, theme, sizeof(kept_theme));
+    }
+    else {
+        logfile_message("unloading the brickset...");
+        brickdata_unload();
+    }
 
     /* unloading the background */
     logfile_message("unloading the background...");
@@ -610,9 +775,16 @@ int traverse_level(const parsetree_statement_t* stmt)
     /* interpreting the command */
     if(str_icmp(identifier, "theme") == 0) {
         if(param_count == 1) {
-            if(brickdata_size() == 0) {
+            if(*theme == '\0') {
                 str_cpy(theme, param[0], sizeof(theme));
-                brickdata_load(theme);
+                if(str_icmp(kept_theme, theme) != 0) {
+                    level_release_kept_brickset();
+                    brickdata_load(theme);
+                }
+                else {
+                    logfile_message("Level loader - reusing the brickset of the previous act");
+                    strcpy(kept_theme, "");
+                }
             }
         }
         else
@@ -742,7 +914,7 @@ int traverse_level(const parsetree_statement_t* stmt)
                 y = atoi(param[2]);
 
                 if(brickdata_get(type) != NULL)
-                    level_create_brick(type, v2d_new(x,y));
+                    sectorstream_add_brick(type, v2d_new(x,y));
                 else
                     logfile_message("Level loader - invalid brick: %d", type);
             }
@@ -761,7 +933,7 @@ int traverse_level(const parsetree_statement_t* stmt)
             x = atoi(param[1]);
             y = atoi(param[2]);
 
-            level_create_item(type, v2d_new(x,y));
+            sectorstream_add_item(type, v2d_new(x,y));
         }
         else
             logfile_message("Level loader - command 'item' expects three parameters: type, xpos, ypos");
@@ -775,7 +947,7 @@ int traverse_level(const parsetree_statement_t* stmt)
             x = atoi(param[1]);
             y = atoi(param[2]);
 
-            level_create_enemy(name, v2d_new(x,y));
+            sectorstream_add_object(name, v2d_new(x,y));
         }
         else
             logfile_message("Level loader - command '%s' expects three parameters: enemy_name, xpos, ypos", identifier);
@@ -819,6 +991,11 @@ void level_init()
     /* helpers */
     particle_init();
     editor_init();
+    brickcache_init();
+    item_index = spatialindex_create();
+    object_index = spatialindex_create();
+    object_broadphase = broadphase_create(BROADPHASE_MARGIN);
+    item_generation = 1;
 
     /* level init */
     level_load(file);
@@ -902,9 +1079,18 @@ void level_update()
     item_list_t *major_items, *inode;
     enemy_list_t *enode;
 
+    actor_corners_new_frame();
+    if(!editor_is_enabled()) {
+        v2d_t focus[4];
+        focus[0] = camera_get_position();
+        for(i=0; i<3; i++)
+            focus[1+i] = team[i]->actor->position;
+        sectorstream_update(focus, 4);
+    }
     remove_dead_bricks();
     remove_dead_items();
     remove_dead_objects();
+    update_spatial_indexes();
 
     if(!editor_is_enabled()) {
 
@@ -1012,6 +1198,9 @@ void level_update()
             sound_t *cash = soundfactory_get("cash");
             sound_t *glasses = soundfactory_get("glasses");
 
+            /* reading the next act */
+            quest_prefetch_update();
+
             /* level music fadeout */
             if(music_is_playing())
                 music_set_volume(1.0 - (float)(tmr-actclear_starttime)/2000.0);
@@ -1100,6 +1289,24 @@ void level_update()
         major_bricks = brick_list_clip();
         fake_bricks = NULL;
 
+        /* think phase: the entities that are about to be updated
+         * fill their sensor caches in parallel. Then they're updated
+         * one by one, as usual (that's when things actually change) */
+        thinker_count = 0;
+        for(inode = item_list; inode; inode=inode->next) {
+            actor_t *a = inode->data->actor;
+            if(inode->data->think != NULL && inside_screen(a->position.x, a->position.y, actor_image(a)->w, actor_image(a)->h, DEFAULT_MARGIN))
+                think_add(inode->data, NULL);
+        }
+        if(!input_is_ignored(player->actor->input) && !got_dying_player && !level_cleared) {
+            for(enode = enemy_list; enode; enode=enode->next) {
+                actor_t *a = enode->data->actor;
+                if(inside_screen(a->position.x, a->position.y, actor_image(a)->w, actor_image(a)->h, DEFAULT_MARGIN) || enode->data->always_active)
+                    think_add(NULL, enode->data);
+            }
+        }
+        think_all(major_bricks);
+
         /* update background */
         background_update(backgroundtheme);
 
@@ -1154,8 +1361,12 @@ void level_update()
             if(inside_screen(x, y, w, h, DEFAULT_MARGIN) || enode->data->always_active) {
                 /* update this object */
                 if(!input_is_ignored(player->actor->input)) {
-                    if(!got_dying_player && !level_cleared)
+                    if(!got_dying_player && !level_cleared) {
+                        float box[4];
                         enemy_update(enode->data, team, 3, major_bricks, major_items, enemy_list);
+                        actor_bounding_box(enode->data->actor, box);
+                        broadphase_move(object_broadphase, enode->data, box);
+                    }
                 }
 
                 /* is this object an obstacle? */
@@ -1480,17 +1691,36 @@ void level_render()
         return;
     }
 
+    /* the drawings are recorded and then executed in parallel */
+    drawlist_begin(video_get_backbuffer());
+
     /* background */
+    drawlist_set_layer(DRAWLAYER_BACKGROUND);
     background_render_bg(backgroundtheme, camera_get_position());
 
     /* entities */
+    drawlist_set_layer(DRAWLAYER_ENTITIES);
     render_entities();
 
     /* foreground */
+    drawlist_set_layer(DRAWLAYER_FOREGROUND);
     background_render_fg(backgroundtheme, camera_get_position());
 
     /* hud */
+    drawlist_set_layer(DRAWLAYER_HUD);
     render_hud();
+
+    drawlist_end();
+
+    /* profiling */
+    if(video_is_fps_visible()) {
+        render_background_stats();
+        render_drawlist_stats();
+        render_sensor_stats();
+        render_broadphase_stats();
+        render_pool_stats();
+        render_sectorstream_stats();
+    }
 }
 
 
@@ -1507,7 +1737,12 @@ void level_release()
 
     image_destroy(quit_level_img);
     particle_release();
+    think_release();
     level_unload();
+    item_index = spatialindex_destroy(item_index);
+    object_index = spatialindex_destroy(object_index);
+    object_broadphase = broadphase_destroy(object_broadphase);
+    brickcache_release();
     for(i=0; i<3; i++)
         player_destroy(team[i]);
     camera_release();
@@ -1627,8 +1862,12 @@ brick_t* level_create_brick(int type, v2d_t position)
     node->data->state = BRS_IDLE;
     for(i=0; i<BRICK_MAXVALUES; i++)
         node->data->value[i] = 0;
+    node->data->motion_time = -1;
 
     insert_brick_sorted(node);
+    if(brickcache_is_static(node->data))
+        brickcache_invalidate(node->data->x, node->data->y, brick_image(node->data)->w, brick_image(node->data)->h);
+
     return node->data;
 }
 
@@ -1650,6 +1889,9 @@ item_t* level_create_item(int type, v2d_t position)
     node->next = item_list;
     item_list = node;
 
+    spatialindex_insert(item_index, node->data->type, position, node->data);
+    item_generation++;
+
     return node->data;
 }
 
@@ -1663,6 +1905,7 @@ item_t* level_create_item(int type, v2d_t position)
 enemy_t* level_create_enemy(const char *name, v2d_t position)
 {
     enemy_list_t *node;
+    float box[4];
 
     node = mallocx(sizeof *node);
     node->data = enemy_create(name);
@@ -1671,6 +1914,10 @@ enemy_t* level_create_enemy(const char *name, v2d_t position)
     node->next = enemy_list;
     enemy_list = node;
 
+    spatialindex_insert(object_index, object_key(node->data->name), position, node->data);
+    actor_bounding_box(node->data->actor, box);
+    broadphase_insert(object_broadphase, node->data->name_id, box, node->data);
+
     return node->data;
 }
 
@@ -1697,6 +1944,61 @@ enemy_list_t* level_enemy_list()
 
 
 
+/*
+ * level_closest_item()
+ * Finds the closest item of a given type relative
+ * to position. Returns NULL if there's no such item.
+ */
+item_t* level_closest_item(v2d_t position, int type, float *distance)
+{
+    return (item_t*)spatialindex_nearest(item_index, type, position, NULL, NULL, distance);
+}
+
+
+
+/*
+ * level_closest_object()
+ * Finds the closest object called name relative
+ * to position. Returns NULL if there's no such object.
+ */
+enemy_t* level_closest_object(v2d_t position, const char *name, float *distance)
+{
+    return (enemy_t*)spatialindex_nearest(object_index, object_key(name), position, object_has_name, (void*)name, distance);
+}
+
+
+
+/*
+ * level_object_collision()
+ * Finds an object whose name_id is the given one that
+ * collides (pixel perfect) with the given object.
+ * Returns NULL if there's no such object.
+ */
+enemy_t* level_object_collision(const enemy_t *object, int name_id)
+{
+    /* an object is always tested against itself, too
+     * (that's how on_collision has always worked) */
+    if(object->name_id == name_id && object_collision(object, object))
+        return (enemy_t*)object;
+
+    return (enemy_t*)broadphase_find(object_broadphase, object, name_id, object_collision);
+}
+
+
+
+/*
+ * level_item_generation()
+ * This number changes whenever an item is created
+ * or destroyed. Items may cache the results of
+ * level_closest_item() while it stays the same.
+ */
+unsigned int level_item_generation()
+{
+    return item_generation;
+}
+
+
+
 /*
  * level_gravity()
  * Returns the gravity of the level
@@ -1820,6 +2122,9 @@ void level_clear(actor_t *end_sign)
     level_cleared = TRUE;
     actclear_starttime = timer_get_ticks();
 
+    /* the next act is read meanwhile */
+    quest_prefetch_next_level();
+
     /* bonus */
     actclear_ringbonus = player_get_rings()*10;
     actclear_totalbonus += actclear_ringbonus;
@@ -1938,7 +2243,7 @@ void level_kill_all_baddies()
  * enemies, items, players, etc. */
 void render_entities()
 {
-    brick_list_t *major_bricks, *p;
+    brick_list_t *major_bricks;
     item_list_t *inode;
     enemy_list_t *enode;
 
@@ -1946,25 +2251,13 @@ void render_entities()
     major_bricks = brick_list_clip();
 
     /* render bricks - background */
-    for(p=major_bricks; p; p=p->next) {
-        brickdata_t *ref = p->data->brick_ref;
-        if(ref->zindex < 0.5) {
-            brick_animate(p->data);
-            image_draw(brick_image(p->data), video_get_backbuffer(), p->data->x-((int)camera_get_position().x-VIDEO_SCREEN_W/2), p->data->y-((int)camera_get_position().y-VIDEO_SCREEN_H/2), IF_NONE);
-        }
-    }
+    render_bricks(BRICKLAYER_BACKGROUND, major_bricks);
 
     /* render players (bring to back?) */
     render_players(TRUE);
 
     /* render bricks - platform level (back) */
-    for(p=major_bricks; p; p=p->next) {
-        brickdata_t *ref = p->data->brick_ref;
-        if(fabs(ref->zindex-0.5) < EPSILON && ref->property != BRK_OBSTACLE) {
-            brick_animate(p->data);
-            image_draw(brick_image(p->data), video_get_backbuffer(), p->data->x-((int)camera_get_position().x-VIDEO_SCREEN_W/2), p->data->y-((int)camera_get_position().y-VIDEO_SCREEN_H/2), IF_NONE);
-        }
-    }
+    render_bricks(BRICKLAYER_PLATFORM_BACK, major_bricks);
 
     /* render items (bring to back) */
     for(inode=item_list; inode; inode=inode->next) {
@@ -1973,13 +2266,7 @@ void render_entities()
     }
 
     /* render bricks - platform level (front) */
-    for(p=major_bricks; p; p=p->next) {
-        brickdata_t *ref = p->data->brick_ref;
-        if(fabs(ref->zindex-0.5) < EPSILON && ref->property == BRK_OBSTACLE) {
-            brick_animate(p->data);
-            image_draw(brick_image(p->data), video_get_backbuffer(), p->data->x-((int)camera_get_position().x-VIDEO_SCREEN_W/2), p->data->y-((int)camera_get_position().y-VIDEO_SCREEN_H/2), IF_NONE);
-        }
-    }
+    render_bricks(BRICKLAYER_PLATFORM_FRONT, major_bricks);
 
     /* render boss (bring to back) */
     if(got_boss() && !boss->bring_to_front)
@@ -2006,16 +2293,93 @@ void render_entities()
     particle_render_all();
 
     /* render bricks - foreground */
+    render_bricks(BRICKLAYER_FOREGROUND, major_bricks);
+
+    /* releasing major_bricks */
+    brick_list_unclip(major_bricks);
+}
+
+/* renders a layer of bricks. The pre-rendered chunks
+ * are interleaved with the other bricks in zindex order
+ * (major_bricks is sorted by brick_sort_cmp()) */
+void render_bricks(enum brickcache_layer layer, brick_list_t *major_bricks)
+{
+    brick_list_t *p;
+    float zindex = -INFINITY_FLT;
+    v2d_t camera = camera_get_position();
+
     for(p=major_bricks; p; p=p->next) {
-        brickdata_t *ref = p->data->brick_ref;
-        if(ref->zindex > 0.5) {
+        if(brickcache_layer_of(p->data) == layer && !brickcache_is_static(p->data)) {
+            /* static bricks below this one */
+            brickcache_render(layer, zindex, p->data->brick_ref->zindex, brick_list, camera);
+            zindex = max(zindex, p->data->brick_ref->zindex);
+
             brick_animate(p->data);
-            image_draw(brick_image(p->data), video_get_backbuffer(), p->data->x-((int)camera_get_position().x-VIDEO_SCREEN_W/2), p->data->y-((int)camera_get_position().y-VIDEO_SCREEN_H/2), IF_NONE);
+            image_draw(brick_image(p->data), video_get_backbuffer(), p->data->x-((int)camera.x-VIDEO_SCREEN_W/2), p->data->y-((int)camera.y-VIDEO_SCREEN_H/2), IF_NONE);
         }
     }
 
-    /* releasing major_bricks */
-    brick_list_unclip(major_bricks);
+    brickcache_render(layer, zindex, INFINITY_FLT, brick_list, camera);
+}
+
+/* shows how many tiles each background
+ * layer has drawn (below the fps counter) */
+void render_background_stats()
+{
+    char buf[256] = "BG:";
+    int i, n = background_layer_count(backgroundtheme);
+
+    for(i=0; i<n && strlen(buf) < sizeof(buf)-16; i++)
+        sprintf(buf+strlen(buf), " %d", background_draw_count(backgroundtheme, i));
+
+    textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, text_height(font), makecol(255,255,255), makecol(0,0,0), "%s", buf);
+}
+
+/* broad phase of the objects: entries, overlapping
+ * pairs, narrow phase tests and sweeps */
+void render_broadphase_stats()
+{
+    broadphasestats_t st = broadphase_stats(object_broadphase);
+    textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, 4 * text_height(font), makecol(255,255,255), makecol(0,0,0), "BP: %d %d %d %d", st.entries, st.pairs, st.tests, st.sweeps);
+}
+
+/* item pools: live/peak items, free blocks, reuses and
+ * allocations; then the same for the actor pool */
+void render_pool_stats()
+{
+    itempoolstats_t st = item_pool_stats(-1);
+    int reuses, allocations, free_count;
+
+    actor_pool_stats(&reuses, &allocations, &free_count);
+    textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, 5 * text_height(font), makecol(255,255,255), makecol(0,0,0), "IP: %d/%d %d %d %d AP: %d %d %d", st.live, st.peak, st.free_count, st.reuses, st.allocations, free_count, reuses, allocations);
+}
+
+/* streamed levels: resident sectors, sectors read
+ * from the sector file, evictions and destroyed entities */
+void render_sectorstream_stats()
+{
+    sectorstreamstats_t st = sectorstream_stats();
+
+    if(sectorstream_is_enabled())
+        textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, 6 * text_height(font), makecol(255,255,255), makecol(0,0,0), "SS: %d/%d %d %d %d", st.resident, st.sectors, st.loads, st.evictions, st.destroyed);
+}
+
+/* draw commands of the last frame: executed, culled,
+ * batched and overdraw (in screens) */
+void render_drawlist_stats()
+{
+    drawliststats_t st = drawlist_stats();
+    float overdraw = (float)st.overdraw / (float)(VIDEO_SCREEN_W * VIDEO_SCREEN_H);
+    textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, 2 * text_height(font), makecol(255,255,255), makecol(0,0,0), "DL: %d %d %d %.1fx", st.commands, st.culled, st.batched, overdraw);
+}
+
+/* sensor queries of the last frame: memoized (hits),
+ * computed (misses) and the hit rate */
+void render_sensor_stats()
+{
+    int hits, misses;
+    actor_corners_stats(&hits, &misses);
+    textprintf_right_ex(video_get_backbuffer()->data, font, VIDEO_SCREEN_W, 3 * text_height(font), makecol(255,255,255), makecol(0,0,0), "SN: %d %d %d%%", hits, misses, (hits + misses > 0) ? (100 * hits) / (hits + misses) : 0);
 }
 
 /* returns TRUE if a given region is
@@ -2117,7 +2481,8 @@ void update_level_size()
     int max_x, max_y;
     brick_list_t *p;
 
-    max_x = max_y = -INFINITY;
+    /* the bricks that aren't resident count, too */
+    sectorstream_level_size(&max_x, &max_y);
 
     for(p=brick_list; p; p=p->next) {
         if(p->data->brick_ref->property != BRK_NONE) {
@@ -2130,6 +2495,37 @@ void update_level_size()
     level_height = max(max_y, VIDEO_SCREEN_H);
 }
 
+/* sizes the item & actor pools after the contents of
+ * the level: the rings a player may drop when hit, the
+ * explosions, animals and score texts of the badniks,
+ * the shots of the boss... */
+void reserve_pools()
+{
+    int rings = 0, enemies = 0, shots = 0, effects;
+    item_list_t *i;
+    enemy_list_t *e;
+
+    for(i=item_list; i; i=i->next)
+        rings += (i->data->type == IT_RING) ? 1 : 0;
+    for(e=enemy_list; e; e=e->next)
+        enemies++;
+    if(got_boss())
+        shots = 32;
+
+    rings = min(rings, 30); /* see player_hit() */
+    effects = enemies + shots;
+
+    item_pool_reserve(IT_RING, rings);
+    item_pool_reserve(IT_EXPLOSION, effects);
+    item_pool_reserve(IT_ANIMAL, enemies);
+    item_pool_reserve(IT_FLYINGTEXT, enemies);
+    item_pool_reserve(IT_DANGPOWER, shots);
+    item_pool_reserve(IT_FIREBALL, shots);
+    actor_pool_reserve(rings + effects + 2 * enemies + 2 * shots);
+
+    logfile_message("reserve_pools(): %d ring(s), %d enemies, %d shots", rings, enemies, shots);
+}
+
 /* returns the ID of a given brick,
  * or -1 if it was not found */
 int get_brick_id(brick_t *b)
@@ -2253,6 +2649,7 @@ brick_t *create_fake_brick(int width, int height, v2d_t position, int angle)
     b->y = b->sy = (int)position.y;
     for(i=0; i<BRICK_MAXVALUES; i++)
         b->value[i] = 0;
+    b->motion_time = -1;
 
     return b;
 }
@@ -2368,6 +2765,8 @@ void remove_dead_bricks()
     /* first element (assumed to exist) */
     if(brick_list->data->state == BRS_DEAD) {
         next = brick_list->next;
+        sectorstream_forget(brick_list->data);
+        invalidate_brick(brick_list->data);
         free(brick_list->data);
         free(brick_list);
         brick_list = next;
@@ -2378,12 +2777,21 @@ void remove_dead_bricks()
         if(p->next->data->state == BRS_DEAD) {
             next = p->next;
             p->next = next->next;
+            sectorstream_forget(next->data);
+            invalidate_brick(next->data);
             free(next->data);
             free(next);
         }
     }
 }
 
+/* discards the pre-rendered chunks of a (removed) brick */
+void invalidate_brick(brick_t *brick)
+{
+    if(brickcache_is_static(brick))
+        brickcache_invalidate(brick->x, brick->y, brick_image(brick)->w, brick_image(brick)->h);
+}
+
 /* removes the dead items */
 void remove_dead_items()
 {
@@ -2395,9 +2803,11 @@ void remove_dead_items()
     /* first element (assumed to exist) */
     if(item_list->data->state == IS_DEAD) {
         next = item_list->next;
+        sectorstream_forget(item_list->data);
         item_destroy(item_list->data);
         free(item_list);
         item_list = next;
+        item_generation++;
     }
 
     /* others */
@@ -2405,8 +2815,10 @@ void remove_dead_items()
         if(p->next->data->state == IS_DEAD) {
             next = p->next;
             p->next = next->next;
+            sectorstream_forget(next->data);
             item_destroy(next->data);
             free(next);
+            item_generation++;
         }
     }
 }
@@ -2422,6 +2834,7 @@ void remove_dead_objects()
     /* first element (assumed to exist) */
     if(enemy_list->data->state == ES_DEAD) {
         next = enemy_list->next;
+        sectorstream_forget(enemy_list->data);
         enemy_destroy(enemy_list->data);
         free(enemy_list);
         enemy_list = next;
@@ -2432,12 +2845,57 @@ void remove_dead_objects()
         if(p->next->data->state == ES_DEAD) {
             next = p->next;
             p->next = next->next;
+            sectorstream_forget(next->data);
             enemy_destroy(next->data);
             free(next);
         }
     }
 }
 
+/* refills the spatial indexes with the current positions of the entities */
+void update_spatial_indexes()
+{
+    item_list_t *it;
+    enemy_list_t *en;
+
+    spatialindex_clear(item_index);
+    for(it=item_list; it; it=it->next)
+        spatialindex_insert(item_index, it->data->type, it->data->actor->position, it->data);
+
+    spatialindex_clear(object_index);
+    broadphase_clear(object_broadphase);
+    for(en=enemy_list; en; en=en->next) {
+        float box[4];
+        spatialindex_insert(object_index, object_key(en->data->name), en->data->actor->position, en->data);
+        actor_bounding_box(en->data->actor, box);
+        broadphase_insert(object_broadphase, en->data->name_id, box, en->data);
+    }
+}
+
+/* case-insensitive hash of an object name */
+int object_key(const char *name)
+{
+    int hash = 0;
+    const char *p;
+
+    for(p=name; *p; p++)
+        hash = (int)tolower((unsigned char)*p) + (hash << 6) + (hash << 16) - hash;
+
+    return hash;
+}
+
+/* is this object called name? (two names may have the same key) */
+int object_has_name(void *object, void *name)
+{
+    return str_icmp(((enemy_t*)object)->name, (const char*)name) == 0;
+}
+
+/* narrow phase of object_broadphase */
+int object_collision(const void *object, const void *other)
+{
+    return actor_pixelperfect_collision(((const enemy_t*)object)->actor, ((const enemy_t*)other)->actor);
+}
+
 /* updates the dialog box */
 void update_dlgbox()
 {
@@ -2606,6 +3064,58 @@ void particle_render_all()
 
 
 
+/* think phase */
+
+/* think_add(): an item or an object will think in the next think_all() */
+void think_add(item_t *item, enemy_t *object)
+{
+    if(thinker_count >= thinker_capacity) {
+        thinker_capacity = max(32, 2 * thinker_capacity);
+        thinker = reallocx(thinker, thinker_capacity * sizeof *thinker);
+    }
+
+    thinker[thinker_count].item = item;
+    thinker[thinker_count].object = object;
+    thinker_count++;
+}
+
+
+/* think_all(): runs the think phase of the entities added with think_add() */
+void think_all(brick_list_t *brick_list)
+{
+    int jobs = (thinker_count + THINK_CHUNK - 1) / THINK_CHUNK;
+    thread_parallel_for(jobs, think_job, brick_list);
+}
+
+
+/* think_job(): a chunk of the think phase (it runs on a worker thread) */
+void think_job(int index, void *brick_list)
+{
+    int i, n = min(thinker_count, (index + 1) * THINK_CHUNK);
+
+    for(i = index * THINK_CHUNK; i < n; i++) {
+        if(thinker[i].item != NULL)
+            item_think(thinker[i].item, (brick_list_t*)brick_list);
+        else
+            enemy_think(thinker[i].object, (brick_list_t*)brick_list);
+    }
+}
+
+
+/* think_release(): releases the think phase */
+void think_release()
+{
+    if(thinker != NULL)
+        free(thinker);
+
+    thinker = NULL;
+    thinker_count = thinker_capacity = 0;
+}
+
+
+
+
+
 /* dialog regions */
 
 
@@ -2662,6 +3172,10 @@ v2d_t level_brick_move_actor(brick_t *brick, actor_t *act)
     t = brick->value[0]; /* time elapsed ONLY FOR THIS brick */
     switch(brick->brick_ref->behavior) {
         case BRB_CIRCULAR:
+            /* several actors may ask in the same frame */
+            if(brick->motion_time == t)
+                return brick->motion;
+
             rx = brick->brick_ref->behavior_arg[0];             /* x-dist */
             ry = brick->brick_ref->behavior_arg[1];             /* y-dist */
             sx = brick->brick_ref->behavior_arg[2] * (2*PI);    /* x-speed */
@@ -2670,7 +3184,9 @@ v2d_t level_brick_move_actor(brick_t *brick, actor_t *act)
 
             /* take the derivative. e.g.,
                d[ sx + A*cos(PI*t) ]/dt = -A*PI*sin(PI*t) */
-            return v2d_new( (-rx*sx)*sin(sx*t+ph), (ry*sy)*cos(sy*t+ph) );
+            brick->motion = v2d_new( (-rx*sx)*sin(sx*t+ph), (ry*sy)*cos(sy*t+ph) );
+            brick->motion_time = t;
+            return brick->motion;
 
         default:
             return v2d_new(0,0);
@@ -2818,6 +3334,8 @@ void render_powerups()
  */
 void editor_init()
 {
+    int i;
+
     logfile_message("editor_init()");
 
     /* intializing... */
@@ -2841,6 +3359,12 @@ void editor_init()
     /* groups */
     editorgrp_init();
 
+    /* palette thumbnails */
+    for(i=0; i<4; i++) {
+        editor_thumb[i] = NULL;
+        editor_thumb_count[i] = 0;
+    }
+
     /* grid */
     editor_grid_init();
 
@@ -2860,6 +3384,9 @@ void editor_release()
     /* grid */
     editor_grid_release();
 
+    /* palette thumbnails */
+    editor_thumb_release();
+
     /* groups */
     editorgrp_release();
 
@@ -2894,6 +3421,9 @@ void editor_update()
     int pick_object, delete_object = FALSE;
     v2d_t topleft = v2d_subtract(editor_camera, v2d_new(VIDEO_SCREEN_W/2, VIDEO_SCREEN_H/2));
 
+    /* build the palette thumbnails in advance, a few at a time */
+    editor_thumb_warmup(EDITOR_THUMB_WARMUP);
+
     /* update items */
     major_items = item_list_clip();
     major_bricks = brick_list_clip();
@@ -3115,8 +3645,12 @@ void editor_enable()
 {
     logfile_message("editor_enable()");
 
+    /* the editor works on the whole level */
+    sectorstream_load_all();
+
     /* activating the editor */
     editor_action_init();
+    editor_thumb_init();
     editor_enabled = TRUE;
     editor_camera.x = (int)camera_get_position().x;
     editor_camera.y = (int)camera_get_position().y;
@@ -3277,9 +3811,9 @@ const char *editor_object_info(enum editor_object_type objtype, int objid)
         }
 
         case EDT_ITEM: {
-            item_t *x = item_create(objid);
-            sprintf(buf, "obstacle: %s\nbring_to_back: %s", x->obstacle ? "TRUE" : "FALSE", x->bring_to_back ? "TRUE" : "FALSE");
-            item_destroy(x);
+            editor_thumb_t *x = editor_thumb_get(EDT_ITEM, objid);
+            if(x != NULL)
+                sprintf(buf, "obstacle: %s\nbring_to_back: %s", x->obstacle ? "TRUE" : "FALSE", x->bring_to_back ? "TRUE" : "FALSE");
             break;
         }
 
@@ -3448,71 +3982,196 @@ int editor_is_valid_item(int item_id)
 /* draws the given object at [position] */
 void editor_draw_object(enum editor_object_type obj_type, int obj_id, v2d_t position)
 {
-    image_t *cursor = NULL;
-    v2d_t offset = v2d_new(0, 0);
+    editor_thumb_t *thumb = editor_thumb_get(obj_type, obj_id);
+
+    if(thumb != NULL && thumb->image != NULL)
+        image_draw_trans(thumb->image, video_get_backbuffer(), (int)(position.x-thumb->hot_spot.x), (int)(position.y-thumb->hot_spot.y), image_rgb(255,255,255), 0.5, IF_NONE);
+}
+
+
+/* level editor: enemy name list */
+int editor_enemy_name2key(const char *name)
+{
+    int i;
+
+    for(i=0; i<editor_enemy_name_length; i++) {
+        if(strcmp(name, editor_enemy_name[i]) == 0)
+            return i;
+    }
+
+    return -1; /* not found */
+}
+
+const char* editor_enemy_key2name(int key)
+{
+    key = clip(key, 0, editor_enemy_name_length-1);
+    return editor_enemy_name[key];
+}
+
+
+
+
+/* level editor: palette thumbnails */
+
+/* prepares the thumbnail cache (the thumbnails
+ * are built on demand, and in advance by
+ * editor_thumb_warmup()) */
+void editor_thumb_init()
+{
+    int i, n[4];
+
+    n[EDT_BRICK] = brickdata_size();
+    n[EDT_ITEM] = 0;
+    for(i=0; i<editor_item_list_size; i++)
+        n[EDT_ITEM] = max(n[EDT_ITEM], editor_item_list[i] + 1);
+    n[EDT_ENEMY] = editor_enemy_name_length;
+    n[EDT_GROUP] = editorgrp_group_count();
+
+    /* already done? (the thumbnails are kept while the level lasts) */
+    for(i=0; i<4; i++) {
+        if(editor_thumb[i] == NULL || editor_thumb_count[i] != n[i])
+            break;
+    }
+    if(i == 4)
+        return;
+
+    editor_thumb_release();
+    for(i=0; i<4; i++) {
+        editor_thumb_count[i] = n[i];
+        editor_thumb[i] = mallocx(max(1, n[i]) * sizeof *(editor_thumb[i]));
+        memset(editor_thumb[i], 0, max(1, n[i]) * sizeof *(editor_thumb[i]));
+    }
+
+    editor_thumb_warmup_type = 0;
+    editor_thumb_warmup_id = 0;
+}
+
+/* releases the thumbnail cache */
+void editor_thumb_release()
+{
+    int i, j;
+
+    for(i=0; i<4; i++) {
+        if(editor_thumb[i] != NULL) {
+            for(j=0; j<editor_thumb_count[i]; j++) {
+                if(editor_thumb[i][j].own_image)
+                    image_destroy(editor_thumb[i][j].image);
+            }
+            free(editor_thumb[i]);
+        }
+        editor_thumb[i] = NULL;
+        editor_thumb_count[i] = 0;
+    }
+}
+
+/* the thumbnail of an object (NULL if the id is invalid) */
+editor_thumb_t* editor_thumb_get(enum editor_object_type obj_type, int obj_id)
+{
+    editor_thumb_t *thumb;
+
+    if(editor_thumb[obj_type] == NULL || obj_id < 0 || obj_id >= editor_thumb_count[obj_type])
+        return NULL;
+
+    thumb = &(editor_thumb[obj_type][obj_id]);
+    if(!thumb->ready)
+        editor_thumb_build(thumb, obj_type, obj_id);
+
+    return thumb;
+}
+
+/* builds up to count thumbnails that haven't been built yet */
+void editor_thumb_warmup(int count)
+{
+    while(count > 0 && editor_thumb_warmup_type < 4) {
+        if(editor_thumb_warmup_id >= editor_thumb_count[editor_thumb_warmup_type]) {
+            editor_thumb_warmup_type++;
+            editor_thumb_warmup_id = 0;
+        }
+        else if(!editor_thumb[editor_thumb_warmup_type][editor_thumb_warmup_id].ready) {
+            editor_thumb_get(editor_thumb_warmup_type, editor_thumb_warmup_id++);
+            count--;
+        }
+        else
+            editor_thumb_warmup_id++;
+    }
+}
+
+/* builds a thumbnail */
+void editor_thumb_build(editor_thumb_t *thumb, enum editor_object_type obj_type, int obj_id)
+{
+    thumb->ready = TRUE;
+    thumb->image = NULL;
+    thumb->own_image = FALSE;
+    thumb->hot_spot = v2d_new(0, 0);
+    thumb->obstacle = thumb->bring_to_back = FALSE;
 
-    /* getting the image of the current object */
     switch(obj_type) {
         case EDT_BRICK: {
-            if(brickdata_get(obj_id) != NULL) {
-                cursor = brickdata_get(obj_id)->image;
-            }
+            if(brickdata_get(obj_id) != NULL)
+                thumb->image = brickdata_get(obj_id)->image;
             break;
         }
+
         case EDT_ITEM: {
-            item_t *item = item_create(obj_id);
-            if(item != NULL) {
-                cursor = actor_image(item->actor);
-                offset = item->actor->hot_spot;
-                offset.y -= 2;
+            item_t *item;
+            if(editor_item_list_get_index(obj_id) < 0)
+                break;
+            if(NULL != (item = item_create(obj_id))) {
+                thumb->image = actor_image(item->actor);
+                thumb->hot_spot = item->actor->hot_spot;
+                thumb->hot_spot.y -= 2;
+                thumb->obstacle = item->obstacle;
+                thumb->bring_to_back = item->bring_to_back;
                 item_destroy(item);
             }
             break;
         }
+
         case EDT_ENEMY: {
             enemy_t *enemy = enemy_create(editor_enemy_key2name(obj_id));
             if(enemy != NULL) {
-                cursor = actor_image(enemy->actor);
-                offset = enemy->actor->hot_spot;
-                offset.y -= 2;
+                thumb->image = actor_image(enemy->actor);
+                thumb->hot_spot = enemy->actor->hot_spot;
+                thumb->hot_spot.y -= 2;
                 enemy_destroy(enemy);
             }
             break;
         }
+
         case EDT_GROUP: {
+            /* the entities are drawn together onto a single image */
             editorgrp_entity_list_t *list, *it;
+            enum editor_object_type my_type;
+            editor_thumb_t *t;
+            int x1 = INT_MAX, y1 = INT_MAX, x2 = INT_MIN, y2 = INT_MIN;
+
             list = editorgrp_get_group(obj_id);
             for(it=list; it; it=it->next) {
-                enum editor_object_type my_type = EDITORGRP_ENTITY_TO_EDT(it->entity.type);
-                editor_draw_object(my_type, it->entity.id, v2d_add(position, it->entity.position));
+                my_type = EDITORGRP_ENTITY_TO_EDT(it->entity.type);
+                t = editor_thumb_get(my_type, it->entity.id);
+                if(t != NULL && t->image != NULL) {
+                    x1 = min(x1, (int)(it->entity.position.x - t->hot_spot.x));
+                    y1 = min(y1, (int)(it->entity.position.y - t->hot_spot.y));
+                    x2 = max(x2, (int)(it->entity.position.x - t->hot_spot.x) + t->image->w);
+                    y2 = max(y2, (int)(it->entity.position.y - t->hot_spot.y) + t->image->h);
+                }
+            }
+
+            if(x1 < x2 && y1 < y2) {
+                thumb->image = image_create(x2 - x1, y2 - y1);
+                thumb->own_image = TRUE;
+                thumb->hot_spot = v2d_new(-x1, -y1);
+                image_clear(thumb->image, video_get_maskcolor());
+                for(it=list; it; it=it->next) {
+                    my_type = EDITORGRP_ENTITY_TO_EDT(it->entity.type);
+                    t = editor_thumb_get(my_type, it->entity.id);
+                    if(t != NULL && t->image != NULL)
+                        image_draw(t->image, thumb->image, (int)(it->entity.position.x - t->hot_spot.x) - x1, (int)(it->entity.position.y - t->hot_spot.y) - y1, IF_NONE);
+                }
             }
             break;
         }
     }
-
-    /* drawing the object */
-    if(cursor != NULL)
-        image_draw_trans(cursor, video_get_backbuffer(), (int)(position.x-offset.x), (int)(position.y-offset.y), image_rgb(255,255,255), 0.5, IF_NONE);
-}
-
-
-/* level editor: enemy name list */
-int editor_enemy_name2key(const char *name)
-{
-    int i;
-
-    for(i=0; i<editor_enemy_name_length; i++) {
-        if(strcmp(name, editor_enemy_name[i]) == 0)
-            return i;
-    }
-
-    return -1; /* not found */
-}
-
-const char* editor_enemy_key2name(int key)
-{
-    key = clip(key, 0, editor_enemy_name_length-1);
-    return editor_enemy_name[key];
 }
 
 
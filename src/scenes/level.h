@@ -48,6 +48,10 @@ item_t* level_create_item(int type, v2d_t position);
 enemy_t* level_create_enemy(const char *name, v2d_t position);
 item_list_t* level_item_list();
 enemy_list_t* level_enemy_list();
+item_t* level_closest_item(v2d_t position, int type, float *distance);
+enemy_t* level_closest_object(v2d_t position, const char *name, float *distance);
+enemy_t* level_object_collision(const enemy_t *object, int name_id);
+unsigned int level_item_generation();
 v2d_t level_brick_move_actor(brick_t *brick, actor_t *act);
 void level_add_to_score(int score);
 item_t* level_create_animal(v2d_t position);
@@ -65,5 +69,6 @@ void level_kill_all_baddies();
 void level_lock_camera(int x1, int y1, int x2, int y2);
 void level_unlock_camera();
 void level_restore_music();
+void level_release_kept_brickset(); /* the next act won't be played: unloads the brickset kept for it */
 
 #endif
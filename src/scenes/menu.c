@@ -349,7 +349,7 @@ void menu_render()
         case MENU_QUEST:
         {
             /* quest details */
-            image_t *thumb = qstdata[qstmenuopt]->image;
+            image_t *thumb = quest_thumbnail(qstdata[qstmenuopt]);
             font_render(qstdetail, camera);
             image_blit(thumb, video_get_backbuffer(), 0, 0, VIDEO_SCREEN_W - thumb->w - 5, (int)qstfnt[0]->position.y, thumb->w, thumb->h);
 
@@ -456,26 +456,17 @@ void select_option(int opt)
 /* reads the quest list from the quest/ folder */
 void load_quest_list()
 {
-    int i, j, deny_flags = FA_DIREC | FA_LABEL, c = 0;
-    int max_paths;
+    int i, c = 0;
     char path[] = "quests/*.qst";
-    char abs_path[2][1024];
 
     logfile_message("load_quest_list()");
 
-    /* official and $HOME quests */
-    absolute_filepath(abs_path[0], path, sizeof(abs_path[0]));
-    home_filepath(abs_path[1], path, sizeof(abs_path[1]));
-    max_paths = (strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2;
-
-    /* loading quest data */
+    /* loading quest data (official and $HOME quests) */
     qstcount = 0;
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dircount, NULL);
+    for_each_resource(path, dircount, NULL);
 
     qstdata = mallocx(qstcount * sizeof(quest_t*));
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dirfill, (void*)&c);
+    for_each_resource(path, dirfill, (void*)&c);
     qsort(qstdata, qstcount, sizeof(quest_t*), sort_cmp);
 
     /* fatal error */
@@ -495,7 +486,7 @@ void load_quest_list()
 int dirfill(const char *filename, int attrib, void *param)
 {
     int *c = (int*)param;
-    qstdata[ (*c)++ ] = load_quest((char*)filename);
+    qstdata[ (*c)++ ] = load_quest_info((char*)filename);
     return 0;
 }
 
@@ -23,6 +23,10 @@
 #include "../core/util.h"
 #include "../core/logfile.h"
 #include "../core/storyboard.h"
+#include "../core/loadgraph.h"
+#include "../core/scriptcache.h"
+#include "../core/image.h"
+#include "util/levelprefetch.h"
 
 /* private data */
 #define QUESTVALUE_MAX              3
@@ -33,6 +37,14 @@ static int go_back_to_menu;
 static float questvalue[QUESTVALUE_MAX];
 static char lastname[512] = "NO_QUEST_NAME";
 
+/* the next level is read in the background */
+#define PREFETCH_BUDGET             (16 * 1024 * 1024) /* memory taken by its images, in bytes */
+#define PREFETCH_FRAMETIME          4 /* ms per frame spent decoding its images on the main thread */
+static loadgraph_t *prefetch_graph = NULL;
+static levelprefetch_t *prefetch = NULL;
+static void finish_prefetch();
+static void discard_prefetch();
+
 
 
 
@@ -59,7 +71,9 @@ void quest_init()
  */
 void quest_release()
 {
+    discard_prefetch();
     unload_quest(current_quest);
+    current_quest = NULL;
 }
 
 
@@ -88,12 +102,14 @@ void quest_update()
     /* quest manager */
     if(current_level < current_quest->level_count && !abort_quest) {
         /* next level... */
+        finish_prefetch();
         level_setfile(current_quest->level_path[current_level]);
         scenestack_push(storyboard_get_scene(SCENE_LEVEL));
         current_level++;
     }
     else {
         /* the user has cleared the quest! */
+        discard_prefetch();
         scenestack_pop();
         if(go_back_to_menu) { /* if it's not a standalone quest */
             if(abort_quest)
@@ -155,6 +171,60 @@ const char *quest_getname()
 
 
 
+/*
+ * quest_prefetch_next_level()
+ * The current level has been cleared: the next one
+ * (if any) starts being read in the background, so
+ * that it loads quickly once the scores are shown
+ */
+void quest_prefetch_next_level()
+{
+    const char *path;
+
+    if(current_quest == NULL || prefetch_graph != NULL || abort_quest)
+        return;
+
+    if(current_level >= current_quest->level_count)
+        return;
+
+    path = current_quest->level_path[current_level];
+    logfile_message("Reading the next level ahead of time: '%s'", path);
+
+    prefetch_graph = loadgraph_create();
+    prefetch = levelprefetch_create(prefetch_graph, path);
+    levelprefetch_set_budget(prefetch, PREFETCH_BUDGET);
+    loadgraph_start(prefetch_graph);
+}
+
+
+/*
+ * quest_prefetch_update()
+ * Runs the jobs of the main thread (if the next
+ * level is being read), such as decoding its images,
+ * a few milliseconds at a time. Call it every frame.
+ */
+void quest_prefetch_update()
+{
+    if(prefetch_graph != NULL)
+        loadgraph_poll(prefetch_graph, PREFETCH_FRAMETIME);
+}
+
+
+/*
+ * quest_next_level_uses()
+ * Will the next level use this brickset (or background,
+ * or groups file)? FALSE if we don't know (yet).
+ */
+int quest_next_level_uses(const char *path)
+{
+    if(prefetch == NULL || abort_quest)
+        return FALSE;
+
+    return levelprefetch_uses(prefetch, path);
+}
+
+
+
 
 /* quest values */
 
@@ -182,3 +252,30 @@ float quest_getvalue(questvalue_t key)
     return questvalue[k];
 }
 
+
+
+
+/* private stuff */
+
+/* waits until the next level has been read */
+void finish_prefetch()
+{
+    if(prefetch_graph != NULL) {
+        loadgraph_finish(prefetch_graph, NULL, NULL);
+        prefetch = levelprefetch_destroy(prefetch);
+        prefetch_graph = loadgraph_destroy(prefetch_graph);
+    }
+}
+
+/* the next level won't be played: forget what has been read
+ * (and the brickset that has been kept for it, if any) */
+void discard_prefetch()
+{
+    if(prefetch_graph != NULL) {
+        finish_prefetch();
+        scriptcache_discard();
+        image_prefetch_discard();
+    }
+
+    level_release_kept_brickset();
+}
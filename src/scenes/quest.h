@@ -49,6 +49,11 @@ void quest_setlevel(int lev); /* jumps to the given level (0..n-1) */
 void quest_abort(); /* aborts the current quest */
 const char *quest_getname(); /* returns the name of the current quest */
 
+/* reading the next level in the background */
+void quest_prefetch_next_level(); /* call it when the current level is cleared */
+void quest_prefetch_update(); /* call it every frame */
+int quest_next_level_uses(const char *path); /* will the next level use this brickset / background? */
+
 /* quest values */
 typedef enum questvalue_t {
     QUESTVALUE_TOTALTIME,   /* total quest time, in seconds */
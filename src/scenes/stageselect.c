@@ -27,6 +27,7 @@
 #include "../core/storyboard.h"
 #include "../core/v2d.h"
 #include "../core/osspec.h"
+#include "../core/metaindex.h"
 #include "../core/stringutil.h"
 #include "../core/logfile.h"
 #include "../core/video.h"
@@ -36,6 +37,7 @@
 #include "../core/timer.h"
 #include "../core/soundfactory.h"
 #include "../core/nanoparser/nanoparser.h"
+#include "../core/scriptcache.h"
 #include "../entities/font.h"
 #include "../entities/actor.h"
 #include "../entities/background.h"
@@ -276,26 +278,17 @@ void stageselect_render()
 /* loads the stage list from the level/ folder */
 void load_stage_list()
 {
-    int i, j, deny_flags = FA_DIREC | FA_LABEL, c = 0;
-    int max_paths;
+    int i, c = 0;
     char path[] = "levels/*.lev";
-    char abs_path[2][1024];
 
     logfile_message("load_stage_list()");
 
-    /* official and $HOME files */
-    absolute_filepath(abs_path[0], path, sizeof(abs_path[0]));
-    home_filepath(abs_path[1], path, sizeof(abs_path[1]));
-    max_paths = (strcmp(abs_path[0], abs_path[1]) == 0) ? 1 : 2;
-
-    /* loading data */
+    /* loading data (official and $HOME files) */
     stage_count = 0;
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dircount, NULL);
+    for_each_resource(path, dircount, NULL);
 
     stage_data = mallocx(stage_count * sizeof(stagedata_t*));
-    for(j=0; j<max_paths; j++)
-        for_each_file_ex(abs_path[j], 0, deny_flags, dirfill, (void*)&c);
+    for_each_resource(path, dirfill, (void*)&c);
     qsort(stage_data, stage_count, sizeof(stagedata_t*), sort_cmp);
 
     /* fatal error */
@@ -402,9 +395,33 @@ stagedata_t* stagedata_load(const char *filename)
     s->requires[1] = 0;
     s->requires[2] = 0;
 
-    prog = nanoparser_construct_tree(s->filepath);
-    nanoparser_traverse_program_ex(prog, (void*)s, traverse);
-    prog = nanoparser_deconstruct_tree(prog);
+    if(metaindex_lookup(s->filepath)) {
+        /* we've seen this level before */
+        const char *val;
+        if(NULL != (val = metaindex_get(s->filepath, "name")))
+            str_cpy(s->name, val, sizeof(s->name));
+        if(NULL != (val = metaindex_get(s->filepath, "act")))
+            s->act = clip(atoi(val), 1, 3);
+        if(NULL != (val = metaindex_get(s->filepath, "requires")))
+            sscanf(val, "%d.%d.%d", &(s->requires[0]), &(s->requires[1]), &(s->requires[2]));
+        if(NULL != (val = metaindex_get(s->filepath, "bgtheme")))
+            str_cpy(s->bgtheme, val, sizeof(s->bgtheme));
+    }
+    else {
+        /* reading the header of the level */
+        char buf[32];
+
+        prog = scriptcache_construct_tree(s->filepath);
+        nanoparser_traverse_program_ex(prog, (void*)s, traverse);
+        prog = nanoparser_deconstruct_tree(prog);
+
+        sprintf(buf, "%d", s->act);
+        metaindex_set(s->filepath, "name", s->name);
+        metaindex_set(s->filepath, "act", buf);
+        sprintf(buf, "%d.%d.%d", s->requires[0], s->requires[1], s->requires[2]);
+        metaindex_set(s->filepath, "requires", buf);
+        metaindex_set(s->filepath, "bgtheme", s->bgtheme);
+    }
 
     /* invalid level! */
     if(s->requires[0] <= 0 && s->requires[1] <= 0 && s->requires[2] <= 0) {
@@ -0,0 +1,403 @@
+/*
+ * brickcache.c - level: pre-rendered chunks of static bricks
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "brickcache.h"
+#include "../../core/global.h"
+#include "../../core/util.h"
+#include "../../core/video.h"
+#include "../../core/logfile.h"
+#include "../../core/image.h"
+#include "../../core/sprite.h"
+#include "../../core/spatialindex.h"
+
+/* internal data: the number of chunks is given by the memory
+ * budget, the size of the screen and the color depth. Define
+ * these at compile time to tune them for a platform */
+#if defined(__3DS__) || defined(_3DS)
+#ifndef BRICKCACHE_CHUNKSIZE
+#define BRICKCACHE_CHUNKSIZE        128 /* in pixels */
+#endif
+#ifndef BRICKCACHE_MEMORY
+#define BRICKCACHE_MEMORY           (2 * 1024 * 1024) /* in bytes */
+#endif
+#else
+#ifndef BRICKCACHE_CHUNKSIZE
+#define BRICKCACHE_CHUNKSIZE        256
+#endif
+#ifndef BRICKCACHE_MEMORY
+#define BRICKCACHE_MEMORY           (12 * 1024 * 1024)
+#endif
+#endif
+#define BRICKCACHE_MAXCHUNKS        256
+
+/* the static bricks of a layer that share a zindex */
+typedef struct {
+    enum brickcache_layer layer;
+    float zindex;
+    int max_w, max_h; /* size of the largest brick */
+} brickgroup_t;
+
+/* a static brick */
+typedef struct {
+    brick_t *brick;
+    int order; /* position in the brick list */
+} brickentry_t;
+
+typedef struct {
+    int in_use; /* is this slot holding a chunk? */
+    int group; /* index of its group */
+    int cx, cy; /* chunk coordinates */
+    int empty; /* no static bricks here? */
+    image_t *image; /* pre-rendered bricks (reused across chunks) */
+    uint32 last_used; /* LRU */
+} brickchunk_t;
+
+static brickchunk_t *chunk;
+static int chunk_count;
+static uint32 clock_ticks; /* one tick per chunk lookup */
+static brickgroup_t *group; /* indexes never change until brickcache_invalidate_all() */
+static int *sorted_group; /* indexes of the groups, sorted by zindex */
+static int group_count, group_capacity;
+static brickentry_t *entry; /* the static bricks, in list order */
+static int entry_count, entry_capacity;
+static spatialindex_t *entry_index; /* the static bricks by group */
+static int dirty; /* must entry_index be rebuilt? */
+static brickentry_t **stack; /* bricks of a chunk */
+static int stack_count, stack_capacity;
+
+static brickchunk_t* get_chunk(int g, int cx, int cy);
+static void build_chunk(brickchunk_t *c);
+static void stack_push(void *data, void *param);
+static int stack_cmp(const void *a, const void *b);
+static void rebuild_index(brick_list_t *brick_list);
+static int find_group(enum brickcache_layer layer, float zindex);
+static int chunk_coord(int pixel);
+static int max_chunks();
+
+
+
+/* public methods */
+
+/* initializes this module */
+void brickcache_init()
+{
+    int i;
+
+    chunk_count = max_chunks();
+    chunk = mallocx(chunk_count * sizeof *chunk);
+    for(i=0; i<chunk_count; i++) {
+        chunk[i].in_use = FALSE;
+        chunk[i].image = NULL;
+        chunk[i].last_used = 0;
+    }
+
+    clock_ticks = 0;
+    group = NULL;
+    sorted_group = NULL;
+    group_count = group_capacity = 0;
+    entry = NULL;
+    entry_count = entry_capacity = 0;
+    entry_index = spatialindex_create();
+    dirty = TRUE;
+    stack = NULL;
+    stack_count = stack_capacity = 0;
+}
+
+/* releases this module */
+void brickcache_release()
+{
+    int i;
+
+    for(i=0; i<chunk_count; i++) {
+        if(chunk[i].image != NULL)
+            image_destroy(chunk[i].image);
+    }
+
+    free(chunk);
+    chunk = NULL;
+    chunk_count = 0;
+
+    if(group != NULL)
+        free(group);
+    if(sorted_group != NULL)
+        free(sorted_group);
+    if(entry != NULL)
+        free(entry);
+    if(stack != NULL)
+        free(stack);
+    entry_index = spatialindex_destroy(entry_index);
+
+    group = NULL;
+    sorted_group = NULL;
+    group_count = group_capacity = 0;
+    entry = NULL;
+    entry_count = entry_capacity = 0;
+    stack = NULL;
+    stack_count = stack_capacity = 0;
+}
+
+/* discards every chunk (the surfaces are kept for reuse) */
+void brickcache_invalidate_all()
+{
+    int i;
+
+    for(i=0; i<chunk_count; i++)
+        chunk[i].in_use = FALSE;
+
+    group_count = 0;
+    dirty = TRUE;
+}
+
+/* discards the chunks touching the given rectangle.
+ * Call it whenever a static brick is added or removed. */
+void brickcache_invalidate(int x, int y, int w, int h)
+{
+    int i;
+    int cx1 = chunk_coord(x), cx2 = chunk_coord(x + w - 1);
+    int cy1 = chunk_coord(y), cy2 = chunk_coord(y + h - 1);
+
+    for(i=0; i<chunk_count; i++) {
+        if(chunk[i].in_use && chunk[i].cx >= cx1 && chunk[i].cx <= cx2 && chunk[i].cy >= cy1 && chunk[i].cy <= cy2)
+            chunk[i].in_use = FALSE;
+    }
+
+    dirty = TRUE;
+}
+
+/* renders the visible chunks of the static bricks of a layer
+ * whose zindex is in ]min_zindex, max_zindex], in zindex order */
+void brickcache_render(enum brickcache_layer layer, float min_zindex, float max_zindex, brick_list_t *brick_list, v2d_t camera_position)
+{
+    int i, g, cx, cy;
+    int left = (int)camera_position.x - VIDEO_SCREEN_W/2;
+    int top = (int)camera_position.y - VIDEO_SCREEN_H/2;
+    brickchunk_t *c;
+
+    if(dirty)
+        rebuild_index(brick_list);
+
+    for(i=0; i<group_count; i++) {
+        g = sorted_group[i];
+        if(group[g].layer != layer || group[g].zindex <= min_zindex || group[g].zindex > max_zindex)
+            continue;
+
+        for(cy=chunk_coord(top); cy<=chunk_coord(top + VIDEO_SCREEN_H - 1); cy++) {
+            for(cx=chunk_coord(left); cx<=chunk_coord(left + VIDEO_SCREEN_W - 1); cx++) {
+                c = get_chunk(g, cx, cy);
+                if(!c->empty)
+                    image_draw(c->image, video_get_backbuffer(), cx * BRICKCACHE_CHUNKSIZE - left, cy * BRICKCACHE_CHUNKSIZE - top, IF_NONE);
+            }
+        }
+    }
+}
+
+/* is this brick pre-rendered? */
+int brickcache_is_static(const brick_t *brick)
+{
+    const brickdata_t *ref = brick->brick_ref;
+    return (ref->data != NULL && ref->behavior == BRB_DEFAULT && ref->data->animation_data[0]->frame_count == 1);
+}
+
+/* the layer of a brick */
+enum brickcache_layer brickcache_layer_of(const brick_t *brick)
+{
+    const brickdata_t *ref = brick->brick_ref;
+
+    if(ref->zindex < 0.5)
+        return BRICKLAYER_BACKGROUND;
+    else if(fabs(ref->zindex-0.5) < EPSILON)
+        return (ref->property != BRK_OBSTACLE) ? BRICKLAYER_PLATFORM_BACK : BRICKLAYER_PLATFORM_FRONT;
+    else
+        return BRICKLAYER_FOREGROUND;
+}
+
+
+
+/* private methods */
+
+/* finds a chunk of a group, building it if necessary */
+brickchunk_t* get_chunk(int g, int cx, int cy)
+{
+    int i;
+    brickchunk_t *c = NULL;
+
+    clock_ticks++;
+
+    /* cache hit? */
+    for(i=0; i<chunk_count; i++) {
+        if(chunk[i].in_use && chunk[i].group == g && chunk[i].cx == cx && chunk[i].cy == cy) {
+            chunk[i].last_used = clock_ticks;
+            return &chunk[i];
+        }
+    }
+
+    /* pick a free slot, or the least recently used one */
+    for(i=0; i<chunk_count; i++) {
+        if(!chunk[i].in_use) {
+            c = &chunk[i];
+            break;
+        }
+        else if(c == NULL || chunk[i].last_used < c->last_used)
+            c = &chunk[i];
+    }
+
+    c->in_use = TRUE;
+    c->group = g;
+    c->cx = cx;
+    c->cy = cy;
+    c->last_used = clock_ticks;
+    build_chunk(c);
+
+    return c;
+}
+
+/* pre-renders the static bricks of a chunk */
+void build_chunk(brickchunk_t *c)
+{
+    int x = c->cx * BRICKCACHE_CHUNKSIZE, y = c->cy * BRICKCACHE_CHUNKSIZE;
+    const brickgroup_t *g = &group[c->group];
+    brick_t *b;
+
+    /* which bricks touch this chunk? (they're indexed by their top-left corner) */
+    stack_count = 0;
+    spatialindex_query(entry_index, c->group, x - g->max_w, y - g->max_h, x + BRICKCACHE_CHUNKSIZE - 1, y + BRICKCACHE_CHUNKSIZE - 1, stack_push, c);
+
+    c->empty = (stack_count == 0);
+    if(c->empty)
+        return;
+
+    if(c->image == NULL)
+        c->image = image_create(BRICKCACHE_CHUNKSIZE, BRICKCACHE_CHUNKSIZE);
+    image_clear(c->image, video_get_maskcolor());
+
+    /* render_entities() draws the bricks in reverse list order */
+    qsort(stack, stack_count, sizeof *stack, stack_cmp);
+    while(stack_count-- > 0) {
+        b = stack[stack_count]->brick;
+        brick_animate(b);
+        image_draw(brick_image(b), c->image, b->x - x, b->y - y, IF_NONE);
+    }
+}
+
+/* adds a brick to the stack if it touches the chunk */
+void stack_push(void *data, void *param)
+{
+    const brickchunk_t *c = (const brickchunk_t*)param;
+    brickentry_t *e = (brickentry_t*)data;
+    int x = c->cx * BRICKCACHE_CHUNKSIZE, y = c->cy * BRICKCACHE_CHUNKSIZE;
+    image_t *img = brick_image(e->brick);
+
+    if(e->brick->x + img->w > x && e->brick->y + img->h > y) {
+        if(stack_count >= stack_capacity) {
+            stack_capacity = max(64, 2 * stack_capacity);
+            stack = reallocx(stack, stack_capacity * sizeof *stack);
+        }
+        stack[stack_count++] = e;
+    }
+}
+
+/* sorts the stack in list order */
+int stack_cmp(const void *a, const void *b)
+{
+    return (*(brickentry_t* const*)a)->order - (*(brickentry_t* const*)b)->order;
+}
+
+/* lists the static bricks again (they have changed) */
+void rebuild_index(brick_list_t *brick_list)
+{
+    int i, g, n;
+    brick_list_t *p;
+    brick_t *b;
+
+    entry_count = 0;
+    for(p=brick_list, n=0; p; p=p->next, n++) {
+        if(brickcache_is_static(p->data)) {
+            if(entry_count >= entry_capacity) {
+                entry_capacity = max(256, 2 * entry_capacity);
+                entry = reallocx(entry, entry_capacity * sizeof *entry);
+            }
+            entry[entry_count].brick = p->data;
+            entry[entry_count].order = n;
+            entry_count++;
+        }
+    }
+
+    /* entry[] won't move anymore */
+    spatialindex_clear(entry_index);
+    for(i=0; i<entry_count; i++) {
+        b = entry[i].brick;
+        g = find_group(brickcache_layer_of(b), b->brick_ref->zindex);
+        group[g].max_w = max(group[g].max_w, brick_image(b)->w);
+        group[g].max_h = max(group[g].max_h, brick_image(b)->h);
+        spatialindex_insert(entry_index, g, v2d_new(b->x, b->y), &entry[i]);
+    }
+
+    dirty = FALSE;
+}
+
+/* the index of a group, which is created if it doesn't exist */
+int find_group(enum brickcache_layer layer, float zindex)
+{
+    int i, g;
+
+    for(g=0; g<group_count; g++) {
+        if(group[g].layer == layer && group[g].zindex == zindex)
+            return g;
+    }
+
+    if(group_count >= group_capacity) {
+        group_capacity = max(8, 2 * group_capacity);
+        group = reallocx(group, group_capacity * sizeof *group);
+        sorted_group = reallocx(sorted_group, group_capacity * sizeof *sorted_group);
+    }
+
+    g = group_count++;
+    group[g].layer = layer;
+    group[g].zindex = zindex;
+    group[g].max_w = group[g].max_h = 0;
+
+    /* keep sorted_group sorted by zindex */
+    for(i=g; i>0 && group[sorted_group[i-1]].zindex > zindex; i--)
+        sorted_group[i] = sorted_group[i-1];
+    sorted_group[i] = g;
+
+    return g;
+}
+
+/* how many chunks fit in BRICKCACHE_MEMORY? At least the
+ * chunks that a layer may have on the screen (otherwise
+ * they'd be rebuilt every frame) */
+int max_chunks()
+{
+    int bytes = BRICKCACHE_CHUNKSIZE * BRICKCACHE_CHUNKSIZE * ((video_get_color_depth() + 7) / 8);
+    int cols = (VIDEO_SCREEN_W + BRICKCACHE_CHUNKSIZE - 2) / BRICKCACHE_CHUNKSIZE + 1;
+    int rows = (VIDEO_SCREEN_H + BRICKCACHE_CHUNKSIZE - 2) / BRICKCACHE_CHUNKSIZE + 1;
+    int n = clip(BRICKCACHE_MEMORY / bytes, cols * rows, BRICKCACHE_MAXCHUNKS);
+
+    logfile_message("brickcache: %d chunks of %dx%d pixels (%d KB)", n, BRICKCACHE_CHUNKSIZE, BRICKCACHE_CHUNKSIZE, n * (bytes / 1024));
+    return n;
+}
+
+/* chunk coordinate of a pixel (rounds towards -infinity) */
+int chunk_coord(int pixel)
+{
+    return (pixel >= 0) ? (pixel / BRICKCACHE_CHUNKSIZE) : -((-pixel + BRICKCACHE_CHUNKSIZE - 1) / BRICKCACHE_CHUNKSIZE);
+}
@@ -0,0 +1,58 @@
+/*
+ * brickcache.h - level: pre-rendered chunks of static bricks
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _BRICKCACHE_H
+#define _BRICKCACHE_H
+
+#include "../../core/v2d.h"
+#include "../../entities/brick.h"
+
+/*
+   Static bricks (default behavior, a single frame) never
+   change, so each brick layer is pre-rendered into square
+   chunks. Chunks are built lazily, when they first become
+   visible, and the least recently used ones are recycled.
+   The number of chunks depends on a memory budget (smaller
+   on the 3DS), on the screen and on the color depth.
+
+   Every other brick (animated, moving, breakable, falling)
+   must still be drawn individually. The static bricks of a
+   layer that share a zindex are baked into their own
+   chunks, so that the caller can interleave them with the
+   other bricks of the layer in zindex order.
+*/
+
+/* brick layers, in rendering order */
+enum brickcache_layer {
+    BRICKLAYER_BACKGROUND,      /* zindex < 0.5 */
+    BRICKLAYER_PLATFORM_BACK,   /* zindex == 0.5, not an obstacle */
+    BRICKLAYER_PLATFORM_FRONT,  /* zindex == 0.5, obstacle */
+    BRICKLAYER_FOREGROUND       /* zindex > 0.5 */
+};
+
+/* public methods */
+void brickcache_init(); /* initializes this module */
+void brickcache_release(); /* releases this module */
+void brickcache_invalidate_all(); /* discards every chunk */
+void brickcache_invalidate(int x, int y, int w, int h); /* discards the chunks touching the given rectangle (call it whenever a static brick is added or removed) */
+void brickcache_render(enum brickcache_layer layer, float min_zindex, float max_zindex, brick_list_t *brick_list, v2d_t camera_position); /* renders the visible chunks of a layer whose zindex is in ]min_zindex, max_zindex] */
+int brickcache_is_static(const brick_t *brick); /* is this brick pre-rendered? */
+enum brickcache_layer brickcache_layer_of(const brick_t *brick); /* the layer of a brick */
+
+#endif
@@ -27,6 +27,7 @@
 #include "../../core/osspec.h"
 #include "../../core/util.h"
 #include "../../core/stringutil.h"
+#include "../../core/scriptcache.h"
 #include "../../core/nanoparser/nanoparser.h"
 
 /* internal data */
@@ -84,7 +85,7 @@ void editorgrp_load_from_file(const char *filename)
     resource_filepath(abs_path, filename, sizeof(abs_path), RESFP_READ);
     logfile_message("editorgrp_load_from_file('%s')", filename);
 
-    prog = nanoparser_construct_tree(abs_path);
+    prog = scriptcache_take(abs_path);
     nanoparser_traverse_program(prog, traverse);
     prog = nanoparser_deconstruct_tree(prog);
 
@@ -0,0 +1,379 @@
+/*
+ * levelprefetch.c - level: reads the files of a level ahead of time
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "levelprefetch.h"
+#include "../../core/global.h"
+#include "../../core/util.h"
+#include "../../core/thread.h"
+#include "../../core/osspec.h"
+#include "../../core/stringutil.h"
+#include "../../core/logfile.h"
+#include "../../core/image.h"
+#include "../../core/audio.h"
+#include "../../core/scriptcache.h"
+#include "../../core/nanoparser/nanoparser.h"
+
+/* an image mentioned by a script */
+typedef struct prefetchimage_t {
+    char path[1024];
+    char abs_path[1024];
+    int file_size; /* bytes read by read_image() */
+    struct levelprefetch_t *owner;
+} prefetchimage_t;
+
+/* a script */
+typedef struct prefetchscript_t {
+    struct levelprefetch_t *owner;
+    char path[1024];
+    char abs_path[1024];
+    prefetchimage_t *image; /* image[0 .. image_count-1] */
+    int image_count, image_capacity;
+} prefetchscript_t;
+
+/* level prefetch */
+struct levelprefetch_t {
+    int job; /* the root job */
+    prefetchscript_t level, brickset, background, groups;
+    char music[1024];
+    int header_known; /* have the paths above been read? */
+    int budget; /* max. memory taken by the decoded images, in bytes (0 = no limit) */
+    volatile int used; /* memory taken by the decoded images */
+    volatile int skipped; /* images left for later, because of the budget */
+};
+
+/* load jobs */
+static void parse_level(loadgraph_t *graph, int job, void *param);
+static void resolve_level_files(loadgraph_t *graph, int job, void *param);
+static void parse_script(loadgraph_t *graph, int job, void *param);
+static void resolve_images(loadgraph_t *graph, int job, void *param);
+static void read_image(loadgraph_t *graph, int job, void *param);
+static void decode_image(loadgraph_t *graph, int job, void *param);
+static void open_music(loadgraph_t *graph, int job, void *param);
+
+/* private stuff */
+static void init_script(prefetchscript_t *script, levelprefetch_t *owner, const char *path);
+static void add_script_job(loadgraph_t *graph, int parent, prefetchscript_t *script);
+static int traverse_header(const parsetree_statement_t *stmt, void *lp);
+static int traverse_images(const parsetree_statement_t *stmt, void *script);
+static void add_image(prefetchscript_t *script, const char *path);
+static int is_image(const char *path);
+
+
+
+/*
+ * levelprefetch_create()
+ * Adds to graph the jobs that read the
+ * files of the level stored in filepath
+ */
+levelprefetch_t* levelprefetch_create(loadgraph_t *graph, const char *filepath)
+{
+    levelprefetch_t *lp = mallocx(sizeof *lp);
+
+    init_script(&(lp->level), lp, filepath);
+    init_script(&(lp->brickset), lp, "");
+    init_script(&(lp->background), lp, "");
+    init_script(&(lp->groups), lp, "");
+    strcpy(lp->music, "");
+    lp->header_known = FALSE;
+    lp->budget = 0;
+    lp->used = 0;
+    lp->skipped = 0;
+
+    lp->job = loadgraph_add(graph, -1, "scripts", FALSE, parse_level, lp);
+    return lp;
+}
+
+
+/*
+ * levelprefetch_destroy()
+ * Destroys a level prefetch. The parsed scripts and
+ * the decoded images that haven't been used are kept
+ * until scriptcache_discard() / image_prefetch_discard().
+ */
+levelprefetch_t* levelprefetch_destroy(levelprefetch_t *lp)
+{
+    logfile_message("levelprefetch: %d KB of images decoded ahead of time, %d image(s) left for later", atomic_get(&(lp->used)) / 1024, atomic_get(&(lp->skipped)));
+
+    free(lp->level.image);
+    free(lp->brickset.image);
+    free(lp->background.image);
+    free(lp->groups.image);
+    free(lp);
+    return NULL;
+}
+
+
+/*
+ * levelprefetch_set_budget()
+ * The images won't take more than about this much
+ * memory, in bytes (0 means no limit). The images
+ * that don't fit will be loaded the usual way.
+ */
+void levelprefetch_set_budget(levelprefetch_t *lp, int bytes)
+{
+    lp->budget = max(0, bytes);
+}
+
+
+/*
+ * levelprefetch_uses()
+ * Does the level use this brickset, background or
+ * groups file? FALSE if the level header hasn't
+ * been read yet. Call this from the main thread.
+ */
+int levelprefetch_uses(const levelprefetch_t *lp, const char *path)
+{
+    if(!lp->header_known || !*path)
+        return FALSE;
+
+    return (
+        str_icmp(lp->brickset.path, path) == 0 ||
+        str_icmp(lp->background.path, path) == 0 ||
+        str_icmp(lp->groups.path, path) == 0
+    );
+}
+
+
+/*
+ * levelprefetch_job()
+ * The id of the job that's done when all the
+ * files of the level have been read
+ */
+int levelprefetch_job(const levelprefetch_t *lp)
+{
+    return lp->job;
+}
+
+
+
+/* load jobs */
+
+/* parses the .lev and reads its header (worker thread) */
+void parse_level(loadgraph_t *graph, int job, void *param)
+{
+    levelprefetch_t *lp = (levelprefetch_t*)param;
+    const parsetree_program_t *tree;
+
+    tree = scriptcache_parse(lp->level.abs_path);
+    nanoparser_traverse_program_ex(tree, (void*)lp, traverse_header);
+    loadgraph_add(graph, job, "scripts", TRUE, resolve_level_files, lp);
+}
+
+/* finds the files mentioned in the header of the .lev (main thread) */
+void resolve_level_files(loadgraph_t *graph, int job, void *param)
+{
+    levelprefetch_t *lp = (levelprefetch_t*)param;
+
+    lp->header_known = TRUE;
+    add_script_job(graph, job, &(lp->brickset));
+    add_script_job(graph, job, &(lp->background));
+    add_script_job(graph, job, &(lp->groups));
+
+    if(*(lp->music))
+        loadgraph_add(graph, job, "music", TRUE, open_music, lp->music);
+}
+
+/* parses a script and lists its images (worker thread) */
+void parse_script(loadgraph_t *graph, int job, void *param)
+{
+    prefetchscript_t *script = (prefetchscript_t*)param;
+    const parsetree_program_t *tree;
+
+    tree = scriptcache_parse(script->abs_path);
+    nanoparser_traverse_program_ex(tree, (void*)script, traverse_images);
+    if(script->image_count > 0)
+        loadgraph_add(graph, job, "images", TRUE, resolve_images, script);
+}
+
+/* finds the images that aren't in the memory yet (main thread) */
+void resolve_images(loadgraph_t *graph, int job, void *param)
+{
+    prefetchscript_t *script = (prefetchscript_t*)param;
+    prefetchimage_t *img;
+    int i;
+
+    for(i=0; i<script->image_count; i++) {
+        img = &(script->image[i]);
+        if(!image_is_loaded(img->path) && !image_is_prefetched(img->path)) {
+            resource_filepath(img->abs_path, img->path, sizeof(img->abs_path), RESFP_READ);
+            loadgraph_add(graph, job, "images", FALSE, read_image, img);
+        }
+    }
+}
+
+/* reads the file of an image (worker thread) */
+void read_image(loadgraph_t *graph, int job, void *param)
+{
+    prefetchimage_t *img = (prefetchimage_t*)param;
+    levelprefetch_t *lp = img->owner;
+
+    /* the budget is checked before reading: it may be
+       exceeded by (at most) one image per thread */
+    if(lp->budget > 0 && atomic_get(&(lp->used)) >= lp->budget) {
+        atomic_add(&(lp->skipped), 1);
+        return;
+    }
+
+    /* the file takes memory until it's decoded */
+    img->file_size = image_prefetch_read(img->path, img->abs_path);
+    atomic_add(&(lp->used), img->file_size);
+    loadgraph_add(graph, job, "images", TRUE, decode_image, img);
+}
+
+/* decodes an image that has been read (main thread: Allegro isn't thread-safe) */
+void decode_image(loadgraph_t *graph, int job, void *param)
+{
+    prefetchimage_t *img = (prefetchimage_t*)param;
+
+    atomic_add(&(img->owner->used), image_prefetch_decode(img->path) - img->file_size);
+}
+
+/* opens the music, which will stay in the resource manager (main thread) */
+void open_music(loadgraph_t *graph, int job, void *param)
+{
+    const char *path = (const char*)param;
+
+    if(music_load(path) != NULL)
+        music_unref(path);
+}
+
+
+
+/* private stuff */
+
+/* initializes a script */
+void init_script(prefetchscript_t *script, levelprefetch_t *owner, const char *path)
+{
+    script->owner = owner;
+    str_cpy(script->path, path, sizeof(script->path));
+    if(*path)
+        resource_filepath(script->abs_path, path, sizeof(script->abs_path), RESFP_READ);
+    else
+        strcpy(script->abs_path, "");
+
+    script->image = NULL;
+    script->image_count = script->image_capacity = 0;
+}
+
+/* adds a job that parses a script mentioned by the .lev (main thread) */
+void add_script_job(loadgraph_t *graph, int parent, prefetchscript_t *script)
+{
+    if(*(script->path)) {
+        resource_filepath(script->abs_path, script->path, sizeof(script->abs_path), RESFP_READ);
+        loadgraph_add(graph, parent, "scripts", FALSE, parse_script, script);
+    }
+}
+
+/* reads the header of a level, the way traverse_level() does.
+ * This mustn't report errors: we're not on the main thread. */
+int traverse_header(const parsetree_statement_t *stmt, void *lp)
+{
+    levelprefetch_t *l = (levelprefetch_t*)lp;
+    const char *identifier = nanoparser_get_identifier(stmt);
+    const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
+    const parsetree_parameter_t *p;
+    char *dest = NULL;
+    size_t dest_size = 0;
+
+    if(nanoparser_get_number_of_parameters(param_list) != 1)
+        return 0;
+
+    if(str_icmp(identifier, "theme") == 0) {
+        dest = l->brickset.path;
+        dest_size = sizeof(l->brickset.path);
+    }
+    else if(str_icmp(identifier, "bgtheme") == 0) {
+        dest = l->background.path;
+        dest_size = sizeof(l->background.path);
+    }
+    else if(str_icmp(identifier, "grouptheme") == 0) {
+        dest = l->groups.path;
+        dest_size = sizeof(l->groups.path);
+    }
+    else if(str_icmp(identifier, "music") == 0) {
+        dest = l->music;
+        dest_size = sizeof(l->music);
+    }
+
+    /* the first brickset, background and groups are the ones that count */
+    p = nanoparser_get_nth_parameter(param_list, 1);
+    if(dest != NULL && nanoparser_get_program(p) == NULL && (dest == l->music || !*dest))
+        str_cpy(dest, nanoparser_get_string(p), dest_size);
+
+    return 0;
+}
+
+/* lists the images mentioned by a script (recursively) */
+int traverse_images(const parsetree_statement_t *stmt, void *script)
+{
+    const parsetree_parameter_t *param_list = nanoparser_get_parameter_list(stmt);
+    const parsetree_parameter_t *p;
+    const parsetree_program_t *block;
+    int i, n = nanoparser_get_number_of_parameters(param_list);
+
+    for(i=1; i<=n; i++) {
+        p = nanoparser_get_nth_parameter(param_list, i);
+        if(NULL != (block = nanoparser_get_program(p)))
+            nanoparser_traverse_program_ex(block, script, traverse_images);
+        else if(is_image(nanoparser_get_string(p)))
+            add_image((prefetchscript_t*)script, nanoparser_get_string(p));
+    }
+
+    return 0;
+}
+
+/* adds an image to the list of a script (unless it's there already) */
+void add_image(prefetchscript_t *script, const char *path)
+{
+    int i;
+
+    for(i=0; i<script->image_count; i++) {
+        if(str_icmp(script->image[i].path, path) == 0)
+            return;
+    }
+
+    if(script->image_count >= script->image_capacity) {
+        script->image_capacity = max(16, 2 * script->image_capacity);
+        script->image = reallocx(script->image, script->image_capacity * sizeof *(script->image));
+    }
+
+    str_cpy(script->image[script->image_count].path, path, sizeof(script->image[0].path));
+    strcpy(script->image[script->image_count].abs_path, "");
+    script->image[script->image_count].file_size = 0;
+    script->image[script->image_count].owner = script->owner;
+    script->image_count++;
+}
+
+/* does this look like the path of an image? */
+int is_image(const char *path)
+{
+    static const char *extension[] = { ".png", ".jpg", ".bmp", ".pcx", ".tga" };
+    int i, len = strlen(path);
+
+    if(len > 4) {
+        for(i=0; i<5; i++) {
+            if(str_icmp(path + len - 4, extension[i]) == 0)
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
@@ -0,0 +1,48 @@
+/*
+ * levelprefetch.h - level: reads the files of a level ahead of time
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LEVELPREFETCH_H
+#define _LEVELPREFETCH_H
+
+#include "../../core/loadgraph.h"
+
+/*
+   Adds to a load graph the jobs that read the files of a
+   level: the .lev itself, its brickset, background and
+   groups are parsed (scriptcache), the files of the images
+   they mention are read by the worker threads and decoded
+   on the main thread (image_prefetch_read/decode), and the
+   music is opened (on the main thread, too: Allegro isn't
+   thread-safe).
+
+   Nothing is created: the level loader will find the parsed
+   scripts and the decoded images when it asks for them.
+   The graph may run in the background while another level
+   is being played (see loadgraph_start()).
+*/
+
+typedef struct levelprefetch_t levelprefetch_t;
+
+levelprefetch_t* levelprefetch_create(loadgraph_t *graph, const char *filepath); /* adds the jobs */
+levelprefetch_t* levelprefetch_destroy(levelprefetch_t *lp); /* call after the graph has run */
+int levelprefetch_job(const levelprefetch_t *lp); /* this job is done when everything has been read */
+void levelprefetch_set_budget(levelprefetch_t *lp, int bytes); /* max. memory taken by the decoded images (0 = no limit) */
+int levelprefetch_uses(const levelprefetch_t *lp, const char *path); /* does the level use this brickset / background / groups file? */
+
+#endif
@@ -0,0 +1,1102 @@
+/*
+ * sectorstream.c - level: streaming of large levels, sector by sector
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro.h>
+#include "sectorstream.h"
+#include "../level.h"
+#include "../../core/global.h"
+#include "../../core/util.h"
+#include "../../core/video.h"
+#include "../../core/thread.h"
+#include "../../core/logfile.h"
+#include "../../core/stringutil.h"
+#include "../../core/osspec.h"
+#include "../../entities/brick.h"
+#include "../../entities/item.h"
+#include "../../entities/enemy.h"
+
+/* internal data */
+#define SECTORSTREAM_MINRECORDS     8192    /* smaller levels are not streamed */
+#define SECTORSTREAM_MAXSECTORS     65536
+#define SECTORSTREAM_SECTORSIZE     1024    /* in pixels */
+#define SECTORSTREAM_NEEDMARGIN     64      /* sectors this close to the screen must be resident right now */
+#define SECTORSTREAM_LOADMARGIN     512     /* sectors this close are loaded in the background */
+#define SECTORSTREAM_KEEPMARGIN     1536    /* sectors farther than this are evicted */
+#define SECTORFILE_DIRECTORY        "cache"
+#define SECTORFILE_EXTENSION        "sec"
+#define SECTORFILE_SIGNATURE        "OSSECTR"
+#define SECTORFILE_VERSION          1
+
+enum { SR_BRICK, SR_ITEM, SR_OBJECT }; /* kinds of records */
+enum { RS_ABSENT, RS_LIVE, RS_DESTROYED }; /* states of the records */
+enum { SS_ABSENT, SS_QUEUED, SS_LOADED, SS_RESIDENT }; /* states of the sectors */
+
+typedef struct {
+    int kind; /* SR_* */
+    int type; /* brick type, item type or index of the object name */
+    int x, y; /* spawn point */
+} sectorrecord_t;
+
+/* header of the sector file. Then come the object names
+ * (each one '\0'-terminated), the record count of every
+ * sector and the records, sorted by sector */
+typedef struct {
+    char signature[8]; /* SECTORFILE_SIGNATURE */
+    uint32 version; /* SECTORFILE_VERSION */
+    uint32 source_size, source_mtime; /* of the .lev */
+    int32 record_count, objname_count;
+    int32 origin_x, origin_y, sector_cols, sector_rows;
+    int32 max_x, max_y;
+} sectorfile_header_t;
+
+typedef struct {
+    int first, count; /* its records in the sector file: first .. first+count-1 */
+    int state; /* SS_*. The loader thread changes it, too: use the mutex */
+    sectorrecord_t *buffer; /* records read by the loader thread */
+} sector_t;
+
+/* the level being read */
+static char source_path[1024]; /* the .lev */
+static int cached; /* is there an up-to-date sector file? Then the records aren't kept */
+static sectorrecord_t *record;
+static int record_count, record_capacity;
+static char **objname;
+static int objname_count, objname_capacity;
+static int max_x, max_y;
+
+/* streaming */
+static int enabled;
+static FILE *file; /* the sector file (only the loader thread reads it, once streaming) */
+static long records_offset; /* position of the first record in the file */
+static int file_records; /* number of records in the file */
+static sector_t *sector;
+static int sector_cols, sector_rows, sector_count;
+static int origin_x, origin_y; /* top-left corner of the first sector */
+static unsigned char *record_state, *record_kind; /* RS_*, SR_* (record of the sector file) */
+static void **record_entity; /* the entity of each live record */
+static int *slot; /* hash table: entity -> record+1 (0 = free slot) */
+static int slot_count; /* a power of two */
+static int live_count;
+static int *resident, resident_count;
+static int *queue, queue_head, queue_length; /* sectors waiting for the loader thread */
+static int *done, done_head, done_length; /* sectors read by the loader thread */
+static thread_t *loader;
+static mutex_t *mutex;
+static event_t *wakeup;
+static event_t *loaded; /* the loader thread has read a sector */
+static volatile int quit_loader;
+static sectorstreamstats_t stats;
+
+static void add_record(int kind, int type, v2d_t position);
+static void create_all(const sectorrecord_t *list, int count);
+static void* create_entity(const sectorrecord_t *r);
+static void reset();
+static int build_sector_file();
+static int write_sector_file(FILE *fp, const sectorrecord_t *sorted);
+static int open_sector_file();
+static int read_sector_table(FILE *fp, const sectorfile_header_t *h);
+static void start_streaming(v2d_t focus);
+static void sectorfile_path(char *dest, size_t dest_size);
+static void stop_streaming();
+static int get_state(int s);
+static void set_state(int s, int state);
+static void request(int s);
+static void wait_for(int s);
+static void receive(const v2d_t *focus, int focus_count);
+static void materialize(int s, const sectorrecord_t *buffer);
+static void evict(int s, const v2d_t *focus, int focus_count);
+static int can_evict(int r, const v2d_t *focus, int focus_count);
+static int is_stateless_item(int type);
+static int sector_range(v2d_t focus, int margin, int range[4]);
+static int is_near(int s, const v2d_t *focus, int focus_count, int margin);
+static void loader_routine(void *arg);
+static sectorrecord_t* read_sector(int s);
+static int floor_div(int a, int b);
+static unsigned hash(const void *data);
+static void hash_insert(int r);
+static int hash_find(const void *entity);
+static void hash_remove(int s);
+
+
+
+/* public methods */
+
+/* call before reading a level. If there's an up-to-date
+ * sector file of this .lev, the records that the reader
+ * hands over are dropped: the file has them already */
+void sectorstream_init(const char *abs_path)
+{
+    reset();
+    str_cpy(source_path, abs_path, sizeof(source_path));
+    if((cached = open_sector_file()))
+        logfile_message("sectorstream_init(): reusing the sector file of \"%s\"", abs_path);
+}
+
+/* stops the streaming & discards everything */
+void sectorstream_release()
+{
+    int i;
+
+    stop_streaming();
+
+    if(record != NULL)
+        free(record);
+    for(i=0; i<objname_count; i++)
+        free(objname[i]);
+    if(objname != NULL)
+        free(objname);
+
+    reset();
+}
+
+/* level reader: a brick */
+void sectorstream_add_brick(int type, v2d_t position)
+{
+    brickdata_t *ref = brickdata_get(type);
+
+    if(cached)
+        return;
+
+    if(ref->property != BRK_NONE) {
+        max_x = max(max_x, (int)position.x + ref->image->w);
+        max_y = max(max_y, (int)position.y + ref->image->h);
+    }
+
+    add_record(SR_BRICK, type, position);
+}
+
+/* level reader: an item */
+void sectorstream_add_item(int type, v2d_t position)
+{
+    if(!cached)
+        add_record(SR_ITEM, type, position);
+}
+
+/* level reader: an object */
+void sectorstream_add_object(const char *name, v2d_t position)
+{
+    int i;
+
+    if(cached)
+        return;
+
+    for(i=objname_count-1; i>=0; i--) {
+        if(strcmp(objname[i], name) == 0)
+            break;
+    }
+
+    if(i < 0) {
+        if(objname_count >= objname_capacity) {
+            objname_capacity = max(16, 2 * objname_capacity);
+            objname = reallocx(objname, objname_capacity * sizeof *objname);
+        }
+        objname[i = objname_count++] = str_dup(name);
+    }
+
+    add_record(SR_OBJECT, i, position);
+}
+
+/* the level has been read: creates it, or
+ * only the sectors near focus if it's large */
+void sectorstream_start(v2d_t focus)
+{
+    if(cached || (record_count >= SECTORSTREAM_MINRECORDS && build_sector_file())) {
+        logfile_message("sectorstream_start(): %d records in %d sectors", file_records, sector_count);
+        start_streaming(focus);
+    }
+    else
+        create_all(record, record_count);
+
+    if(record != NULL)
+        free(record);
+    record = NULL;
+    record_count = record_capacity = 0;
+}
+
+/* loads the sectors that are near the focus points
+ * and evicts the ones that are far from all of them */
+void sectorstream_update(const v2d_t *focus, int focus_count)
+{
+    int i, x, y, range[4];
+
+    if(!enabled)
+        return;
+
+    /* sectors that will be needed soon */
+    for(i=0; i<focus_count; i++) {
+        if(sector_range(focus[i], SECTORSTREAM_LOADMARGIN, range)) {
+            for(y=range[1]; y<=range[3]; y++) {
+                for(x=range[0]; x<=range[2]; x++)
+                    request(y * sector_cols + x);
+            }
+        }
+    }
+    event_signal(wakeup);
+
+    /* sectors that are needed right now: wait for them */
+    for(i=0; i<focus_count; i++) {
+        if(sector_range(focus[i], SECTORSTREAM_NEEDMARGIN, range)) {
+            for(y=range[1]; y<=range[3]; y++) {
+                for(x=range[0]; x<=range[2]; x++)
+                    wait_for(y * sector_cols + x);
+            }
+        }
+    }
+
+    /* create the sectors that have been read */
+    receive(focus, focus_count);
+
+    /* evict the sectors that are far away */
+    for(i=resident_count-1; i>=0; i--) {
+        if(!is_near(resident[i], focus, focus_count, SECTORSTREAM_KEEPMARGIN)) {
+            evict(resident[i], focus, focus_count);
+            resident[i] = resident[--resident_count];
+        }
+    }
+
+    stats.resident = resident_count;
+}
+
+/* creates everything that's left & stops the streaming */
+void sectorstream_load_all()
+{
+    int s;
+
+    if(!enabled)
+        return;
+
+    logfile_message("sectorstream_load_all()");
+
+    for(s=0; s<sector_count; s++)
+        request(s);
+    event_signal(wakeup);
+
+    for(s=0; s<sector_count; s++)
+        wait_for(s);
+
+    receive(NULL, -1);
+    stop_streaming();
+}
+
+/* an entity is about to be destroyed. If it has
+ * come from a sector, it won't be created again */
+void sectorstream_forget(const void *entity)
+{
+    int s;
+
+    if(enabled && (s = hash_find(entity)) >= 0) {
+        record_state[slot[s] - 1] = RS_DESTROYED;
+        hash_remove(s);
+        stats.destroyed++;
+    }
+}
+
+/* is this level being streamed? */
+int sectorstream_is_enabled()
+{
+    return enabled;
+}
+
+/* bounds of the (solid) bricks of the level, resident or not */
+void sectorstream_level_size(int *width, int *height)
+{
+    *width = max_x;
+    *height = max_y;
+}
+
+/* statistics */
+sectorstreamstats_t sectorstream_stats()
+{
+    return stats;
+}
+
+
+
+/* private stuff */
+
+/* resets the state of this module */
+void reset()
+{
+    source_path[0] = 0;
+    cached = FALSE;
+    record = NULL;
+    record_count = record_capacity = 0;
+    objname = NULL;
+    objname_count = objname_capacity = 0;
+    max_x = max_y = 0;
+
+    enabled = FALSE;
+    file = NULL;
+    records_offset = 0;
+    file_records = 0;
+    sector = NULL;
+    sector_cols = sector_rows = sector_count = 0;
+    record_state = record_kind = NULL;
+    record_entity = NULL;
+    slot = NULL;
+    slot_count = live_count = 0;
+    resident = queue = done = NULL;
+    resident_count = queue_head = queue_length = done_head = done_length = 0;
+    loader = NULL;
+    mutex = NULL;
+    wakeup = NULL;
+    loaded = NULL;
+
+    stats.sectors = stats.resident = 0;
+    stats.loads = stats.evictions = stats.destroyed = 0;
+}
+
+/* adds a record to the level being read */
+void add_record(int kind, int type, v2d_t position)
+{
+    sectorrecord_t *r;
+
+    if(record_count >= record_capacity) {
+        record_capacity = max(256, 2 * record_capacity);
+        record = reallocx(record, record_capacity * sizeof *record);
+    }
+
+    r = &record[record_count++];
+    r->kind = kind;
+    r->type = type;
+    r->x = (int)position.x;
+    r->y = (int)position.y;
+}
+
+/* creates all the given records at once */
+void create_all(const sectorrecord_t *list, int count)
+{
+    int i;
+
+    for(i=0; i<count; i++)
+        create_entity(&list[i]);
+}
+
+/* creates the entity of a record */
+void* create_entity(const sectorrecord_t *r)
+{
+    v2d_t position = v2d_new(r->x, r->y);
+
+    switch(r->kind) {
+        case SR_BRICK:
+            /* the brickset may have changed since the sector file was written */
+            if(r->type < 0 || r->type >= brickdata_size() || brickdata_get(r->type) == NULL)
+                return NULL;
+            return level_create_brick(r->type, position);
+
+        case SR_ITEM:
+            return level_create_item(r->type, position);
+
+        case SR_OBJECT:
+            if(r->type < 0 || r->type >= objname_count)
+                return NULL;
+            return level_create_enemy(objname[r->type], position);
+    }
+
+    return NULL;
+}
+
+/* sorts the records by sector and writes them to the sector
+ * file, which is kept (see open_sector_file()). Returns FALSE
+ * if the level can't be streamed. */
+int build_sector_file()
+{
+    char path[1024], tmp_path[1024];
+    int i, s, x1, y1, x2, y2, ok, *cursor;
+    sectorrecord_t *sorted;
+    FILE *fp;
+
+    /* the grid of sectors */
+    x1 = x2 = record[0].x;
+    y1 = y2 = record[0].y;
+    for(i=1; i<record_count; i++) {
+        x1 = min(x1, record[i].x);
+        y1 = min(y1, record[i].y);
+        x2 = max(x2, record[i].x);
+        y2 = max(y2, record[i].y);
+    }
+
+    origin_x = floor_div(x1, SECTORSTREAM_SECTORSIZE) * SECTORSTREAM_SECTORSIZE;
+    origin_y = floor_div(y1, SECTORSTREAM_SECTORSIZE) * SECTORSTREAM_SECTORSIZE;
+    sector_cols = (x2 - origin_x) / SECTORSTREAM_SECTORSIZE + 1;
+    sector_rows = (y2 - origin_y) / SECTORSTREAM_SECTORSIZE + 1;
+    if(sector_cols > SECTORSTREAM_MAXSECTORS / sector_rows) {
+        logfile_message("sectorstream: the level is too sparse to be streamed (%d x %d sectors)", sector_cols, sector_rows);
+        return FALSE;
+    }
+
+    /* sorting by sector (counting sort: the order of the records of a sector is kept) */
+    sector_count = sector_cols * sector_rows;
+    sector = mallocx(sector_count * sizeof *sector);
+    cursor = mallocx(sector_count * sizeof *cursor);
+    for(s=0; s<sector_count; s++) {
+        sector[s].count = 0;
+        sector[s].state = SS_ABSENT;
+        sector[s].buffer = NULL;
+    }
+
+    for(i=0; i<record_count; i++) {
+        s = ((record[i].y - origin_y) / SECTORSTREAM_SECTORSIZE) * sector_cols + (record[i].x - origin_x) / SECTORSTREAM_SECTORSIZE;
+        sector[s].count++;
+    }
+    for(s=i=0; s<sector_count; s++) {
+        sector[s].first = cursor[s] = i;
+        i += sector[s].count;
+    }
+
+    sorted = mallocx(record_count * sizeof *sorted);
+    for(i=0; i<record_count; i++) {
+        s = ((record[i].y - origin_y) / SECTORSTREAM_SECTORSIZE) * sector_cols + (record[i].x - origin_x) / SECTORSTREAM_SECTORSIZE;
+        sorted[cursor[s]++] = record[i];
+    }
+    free(cursor);
+    file_records = record_count;
+
+    /* writing the sector file: a crash midway leaves
+     * the temporary file behind, never a truncated one */
+    sectorfile_path(path, sizeof(path));
+    sprintf(tmp_path, "%.1000s.tmp", path);
+    ok = FALSE;
+    if(NULL != (fp = fopen(tmp_path, "wb"))) {
+        ok = write_sector_file(fp, sorted);
+        ok = (fclose(fp) == 0) && ok;
+#ifdef __WIN32__
+        if(ok)
+            remove(path); /* rename() doesn't replace files on Windows */
+#endif
+        ok = ok && (rename(tmp_path, path) == 0);
+        if(!ok)
+            remove(tmp_path);
+    }
+    file = ok ? fopen(path, "rb") : NULL;
+
+    /* no luck? (read-only home directory, for example) */
+    if(file == NULL) {
+        logfile_message("sectorstream: couldn't write \"%s\". Using a temporary file.", path);
+        if(NULL == (file = tmpfile()) || !write_sector_file(file, sorted) || fflush(file) != 0) {
+            logfile_message("sectorstream: couldn't write the sector file");
+            free(sorted);
+            stop_streaming();
+            return FALSE;
+        }
+    }
+
+    free(sorted);
+    return TRUE;
+}
+
+/* writes the sector file (the sector table must be ready).
+ * Returns FALSE on error */
+int write_sector_file(FILE *fp, const sectorrecord_t *sorted)
+{
+    sectorfile_header_t h;
+    int32 count;
+    int i, ok;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.signature, SECTORFILE_SIGNATURE, sizeof(SECTORFILE_SIGNATURE));
+    h.version = SECTORFILE_VERSION;
+    h.source_size = (uint32)file_size_ex(source_path);
+    h.source_mtime = (uint32)file_time(source_path);
+    h.record_count = file_records;
+    h.objname_count = objname_count;
+    h.origin_x = origin_x;
+    h.origin_y = origin_y;
+    h.sector_cols = sector_cols;
+    h.sector_rows = sector_rows;
+    h.max_x = max_x;
+    h.max_y = max_y;
+
+    ok = (fwrite(&h, sizeof h, 1, fp) == 1);
+    for(i=0; i<objname_count && ok; i++)
+        ok = (fwrite(objname[i], 1, strlen(objname[i]) + 1, fp) == strlen(objname[i]) + 1);
+    for(i=0; i<sector_count && ok; i++) {
+        count = sector[i].count;
+        ok = (fwrite(&count, sizeof count, 1, fp) == 1);
+    }
+
+    records_offset = ok ? ftell(fp) : -1;
+    ok = ok && (records_offset >= 0);
+    ok = ok && (fwrite(sorted, sizeof *sorted, file_records, fp) == (size_t)file_records);
+    return ok;
+}
+
+/* opens the sector file of the .lev and reads its
+ * table, if the file is up-to-date. Returns FALSE
+ * if it isn't (or if there's none) */
+int open_sector_file()
+{
+    char path[1024], path_copy[1024];
+    sectorfile_header_t h;
+    FILE *fp;
+
+    str_cpy(path_copy, source_path, sizeof(path_copy));
+    sectorfile_path(path, sizeof(path));
+    if(NULL == (fp = fopen(path, "rb")))
+        return FALSE;
+
+    if(fread(&h, sizeof h, 1, fp) == 1 &&
+       memcmp(h.signature, SECTORFILE_SIGNATURE, sizeof(SECTORFILE_SIGNATURE)) == 0 &&
+       h.version == SECTORFILE_VERSION &&
+       h.source_size == (uint32)file_size_ex(source_path) &&
+       h.source_mtime == (uint32)file_time(source_path) &&
+       read_sector_table(fp, &h)) {
+        file = fp;
+        return TRUE;
+    }
+
+    /* out of date or damaged: it will be written again */
+    fclose(fp);
+    sectorstream_release();
+    str_cpy(source_path, path_copy, sizeof(source_path));
+    return FALSE;
+}
+
+/* reads the object names and the sector table of the
+ * sector file whose header is h. Returns FALSE on error */
+int read_sector_table(FILE *fp, const sectorfile_header_t *h)
+{
+    char name[1024];
+    int32 count;
+    int i, j, c, total;
+
+    if(h->record_count <= 0 || h->objname_count < 0 || h->sector_cols <= 0 || h->sector_rows <= 0 || h->sector_cols > SECTORSTREAM_MAXSECTORS / h->sector_rows)
+        return FALSE;
+
+    /* object names */
+    objname_count = objname_capacity = 0;
+    objname = mallocx(max(1, h->objname_count) * sizeof *objname);
+    for(i=0; i<h->objname_count; i++) {
+        for(j=0; (c = fgetc(fp)) != EOF && c != 0 && j < (int)sizeof(name) - 1; j++)
+            name[j] = (char)c;
+        name[j] = 0;
+        if(c != 0)
+            return FALSE; /* sectorstream_release() frees the names */
+        objname[objname_count++] = str_dup(name);
+    }
+    objname_capacity = objname_count;
+
+    /* sector table */
+    sector_count = h->sector_cols * h->sector_rows;
+    sector = mallocx(sector_count * sizeof *sector);
+    for(i=total=0; i<sector_count; i++) {
+        if(fread(&count, sizeof count, 1, fp) != 1 || count < 0 || count > h->record_count - total) {
+            free(sector);
+            sector = NULL;
+            sector_count = 0;
+            return FALSE;
+        }
+        sector[i].first = total;
+        sector[i].count = count;
+        sector[i].state = SS_ABSENT;
+        sector[i].buffer = NULL;
+        total += count;
+    }
+
+    records_offset = ftell(fp);
+    file_records = h->record_count;
+    origin_x = h->origin_x;
+    origin_y = h->origin_y;
+    sector_cols = h->sector_cols;
+    sector_rows = h->sector_rows;
+    max_x = h->max_x;
+    max_y = h->max_y;
+    return (total == file_records) && (records_offset >= 0);
+}
+
+/* the sector file is ready: starts the loader thread
+ * and creates the sectors near focus */
+void start_streaming(v2d_t focus)
+{
+    int i;
+
+    record_state = mallocx(file_records * sizeof *record_state);
+    record_kind = mallocx(file_records * sizeof *record_kind);
+    record_entity = mallocx(file_records * sizeof *record_entity);
+    for(i=0; i<file_records; i++) {
+        record_state[i] = RS_ABSENT;
+        record_kind[i] = SR_BRICK; /* set when the record is read */
+        record_entity[i] = NULL;
+    }
+
+    slot_count = 1024;
+    slot = mallocx(slot_count * sizeof *slot);
+    for(i=0; i<slot_count; i++)
+        slot[i] = 0;
+    live_count = 0;
+
+    resident = mallocx(sector_count * sizeof *resident);
+    queue = mallocx(sector_count * sizeof *queue);
+    done = mallocx(sector_count * sizeof *done);
+    resident_count = queue_head = queue_length = done_head = done_length = 0;
+
+    mutex = mutex_create();
+    wakeup = event_create();
+    loaded = event_create();
+    atomic_set(&quit_loader, FALSE);
+    loader = thread_create(loader_routine, NULL);
+
+    enabled = TRUE;
+    stats.sectors = sector_count;
+    sectorstream_update(&focus, 1);
+}
+
+/* the path of the sector file of the .lev */
+void sectorfile_path(char *dest, size_t dest_size)
+{
+    char relativefp[1024];
+    sprintf(relativefp, "%s/%.900s.%08x.%s", SECTORFILE_DIRECTORY, basename(source_path), (unsigned int)str_to_hash(source_path), SECTORFILE_EXTENSION);
+    home_filepath(dest, relativefp, dest_size);
+}
+
+/* stops the loader thread & discards the streaming data.
+ * The entities that exist are kept. */
+void stop_streaming()
+{
+    int s;
+
+    if(loader != NULL) {
+        atomic_set(&quit_loader, TRUE);
+        event_signal(wakeup);
+        thread_join(loader);
+        loader = NULL;
+    }
+
+    if(wakeup != NULL)
+        wakeup = event_destroy(wakeup);
+    if(loaded != NULL)
+        loaded = event_destroy(loaded);
+    if(mutex != NULL)
+        mutex = mutex_destroy(mutex);
+
+    if(file != NULL)
+        fclose(file);
+    file = NULL;
+
+    for(s=0; s<sector_count; s++) {
+        if(sector[s].buffer != NULL)
+            free(sector[s].buffer);
+    }
+
+    if(sector != NULL) free(sector);
+    if(record_state != NULL) free(record_state);
+    if(record_kind != NULL) free(record_kind);
+    if(record_entity != NULL) free(record_entity);
+    if(slot != NULL) free(slot);
+    if(resident != NULL) free(resident);
+    if(queue != NULL) free(queue);
+    if(done != NULL) free(done);
+
+    sector = NULL;
+    sector_count = 0;
+    record_state = record_kind = NULL;
+    record_entity = NULL;
+    slot = NULL;
+    slot_count = live_count = 0;
+    resident = queue = done = NULL;
+    resident_count = queue_length = done_length = 0;
+    enabled = FALSE;
+    stats.resident = 0;
+}
+
+/* the state of a sector */
+int get_state(int s)
+{
+    int state;
+
+    mutex_lock(mutex);
+    state = sector[s].state;
+    mutex_unlock(mutex);
+
+    return state;
+}
+
+/* changes the state of a sector */
+void set_state(int s, int state)
+{
+    mutex_lock(mutex);
+    sector[s].state = state;
+    mutex_unlock(mutex);
+}
+
+/* asks the loader thread to read a sector, if needed */
+void request(int s)
+{
+    mutex_lock(mutex);
+    if(sector[s].state == SS_ABSENT) {
+        sector[s].state = SS_QUEUED;
+        queue[(queue_head + queue_length++) % sector_count] = s;
+    }
+    mutex_unlock(mutex);
+}
+
+/* blocks until the loader thread has read sector s
+ * (if it's queued) */
+void wait_for(int s)
+{
+    /* loaded is signaled after every sector: a signal
+     * may belong to another one, so check again */
+    while(get_state(s) == SS_QUEUED)
+        event_wait(loaded);
+}
+
+/* creates the sectors that have been read and that are
+ * still near some focus point (all of them if focus_count < 0) */
+void receive(const v2d_t *focus, int focus_count)
+{
+    sectorrecord_t *buffer;
+    int s;
+
+    for(;;) {
+        mutex_lock(mutex);
+        if(done_length == 0) {
+            mutex_unlock(mutex);
+            break;
+        }
+        s = done[done_head];
+        done_head = (done_head + 1) % sector_count;
+        done_length--;
+        buffer = sector[s].buffer;
+        sector[s].buffer = NULL;
+        mutex_unlock(mutex);
+
+        stats.loads++;
+        if(sector[s].count > 0 && buffer == NULL)
+            fatal_error("sectorstream: couldn't read the sector file");
+
+        /* once its state changes, the loader thread may read it again */
+        if(focus_count < 0 || is_near(s, focus, focus_count, SECTORSTREAM_KEEPMARGIN)) {
+            materialize(s, buffer);
+            resident[resident_count++] = s;
+        }
+        else
+            set_state(s, SS_ABSENT);
+
+        if(buffer != NULL)
+            free(buffer);
+    }
+}
+
+/* creates the entities of a sector that has been read */
+void materialize(int s, const sectorrecord_t *buffer)
+{
+    int i, r;
+    void *entity;
+
+    for(i=0; i<sector[s].count; i++) {
+        r = sector[s].first + i;
+        if(record_state[r] == RS_ABSENT && NULL != (entity = create_entity(&buffer[i]))) {
+            record_kind[r] = (unsigned char)buffer[i].kind;
+            record_state[r] = RS_LIVE;
+            record_entity[r] = entity;
+            hash_insert(r);
+        }
+    }
+
+    set_state(s, SS_RESIDENT);
+}
+
+/* destroys the entities of a sector. The ones that
+ * have died already won't be created again, and the
+ * ones that can't be recreated as they are stay alive
+ * (their records are kept live, so they aren't created
+ * twice when the sector comes back). */
+void evict(int s, const v2d_t *focus, int focus_count)
+{
+    int i, r, k;
+    void *entity;
+
+    for(i=0; i<sector[s].count; i++) {
+        r = sector[s].first + i;
+        if(record_state[r] != RS_LIVE || !can_evict(r, focus, focus_count))
+            continue; /* it stays */
+
+        entity = record_entity[r];
+
+        if((k = hash_find(entity)) >= 0)
+            hash_remove(k);
+        record_state[r] = RS_ABSENT;
+
+        /* the level will remove it */
+        switch(record_kind[r]) {
+            case SR_BRICK:
+                ((brick_t*)entity)->state = BRS_DEAD;
+                break;
+
+            case SR_ITEM:
+                ((item_t*)entity)->state = IS_DEAD;
+                break;
+
+            case SR_OBJECT:
+                ((enemy_t*)entity)->state = ES_DEAD;
+                break;
+        }
+    }
+
+    set_state(s, SS_ABSENT);
+    stats.evictions++;
+}
+
+/* can the (live) entity of record r be destroyed and later
+ * created again at its spawn point, in its initial state? */
+int can_evict(int r, const v2d_t *focus, int focus_count)
+{
+    int x, y, sx, sy;
+    brick_t *brick;
+    item_t *item;
+    enemy_t *object;
+
+    switch(record_kind[r]) {
+        case SR_BRICK:
+            brick = (brick_t*)record_entity[r];
+            x = brick->x;
+            y = brick->y;
+            break;
+
+        case SR_ITEM:
+            /* preserved items that change (doors, switches,
+             * checkpoints...) are never destroyed off-screen */
+            item = (item_t*)record_entity[r];
+            if(item->preserve && !is_stateless_item(item->type))
+                return FALSE;
+            x = (int)item->actor->position.x;
+            y = (int)item->actor->position.y;
+            break;
+
+        case SR_OBJECT:
+            /* preserved objects keep their state (and their
+             * script variables) when they're far away */
+            object = (enemy_t*)record_entity[r];
+            if(object->always_active || object->preserve)
+                return FALSE;
+            x = (int)object->actor->position.x;
+            y = (int)object->actor->position.y;
+            break;
+
+        default:
+            return FALSE;
+    }
+
+    /* has it travelled to a sector that is kept? */
+    sx = floor_div(x - origin_x, SECTORSTREAM_SECTORSIZE);
+    sy = floor_div(y - origin_y, SECTORSTREAM_SECTORSIZE);
+    if(sx >= 0 && sx < sector_cols && sy >= 0 && sy < sector_rows)
+        return !is_near(sy * sector_cols + sx, focus, focus_count, SECTORSTREAM_KEEPMARGIN);
+
+    return TRUE;
+}
+
+/* items that have nothing to remember but being alive:
+ * once collected or broken, they die (and they are
+ * never created again) */
+int is_stateless_item(int type)
+{
+    switch(type) {
+        case IT_RING: case IT_BLUERING:
+        case IT_LIFEBOX: case IT_RINGBOX: case IT_STARBOX: case IT_SPEEDBOX:
+        case IT_GLASSESBOX: case IT_SHIELDBOX: case IT_TRAPBOX: case IT_EMPTYBOX:
+        case IT_FIRESHIELDBOX: case IT_THUNDERSHIELDBOX: case IT_WATERSHIELDBOX:
+        case IT_CRUSHEDBOX:
+        case IT_LOOPRIGHT: case IT_LOOPMIDDLE: case IT_LOOPLEFT: case IT_LOOPNONE:
+        case IT_LOOPFLOOR: case IT_LOOPFLOORNONE: case IT_LOOPFLOORTOP:
+        case IT_YELLOWSPRING: case IT_RYELLOWSPRING: case IT_LYELLOWSPRING: case IT_TRYELLOWSPRING:
+        case IT_TLYELLOWSPRING: case IT_BRYELLOWSPRING: case IT_BLYELLOWSPRING: case IT_BYELLOWSPRING:
+        case IT_REDSPRING: case IT_RREDSPRING: case IT_LREDSPRING: case IT_TRREDSPRING:
+        case IT_TLREDSPRING: case IT_BRREDSPRING: case IT_BLREDSPRING: case IT_BREDSPRING:
+        case IT_BLUESPRING: case IT_RBLUESPRING: case IT_LBLUESPRING: case IT_TRBLUESPRING:
+        case IT_TLBLUESPRING: case IT_BRBLUESPRING: case IT_BLBLUESPRING: case IT_BBLUESPRING:
+        case IT_BUMPER:
+        case IT_DANGER: case IT_VDANGER: case IT_FIREDANGER: case IT_VFIREDANGER:
+        case IT_SPIKES: case IT_CEILSPIKES: case IT_LWSPIKES: case IT_RWSPIKES:
+            return TRUE;
+
+        default:
+            return FALSE;
+    }
+}
+
+/* the sectors near focus: range = x1, y1, x2, y2.
+ * Returns FALSE if there are none. */
+int sector_range(v2d_t focus, int margin, int range[4])
+{
+    range[0] = floor_div((int)focus.x - VIDEO_SCREEN_W/2 - margin - origin_x, SECTORSTREAM_SECTORSIZE);
+    range[1] = floor_div((int)focus.y - VIDEO_SCREEN_H/2 - margin - origin_y, SECTORSTREAM_SECTORSIZE);
+    range[2] = floor_div((int)focus.x + VIDEO_SCREEN_W/2 + margin - origin_x, SECTORSTREAM_SECTORSIZE);
+    range[3] = floor_div((int)focus.y + VIDEO_SCREEN_H/2 + margin - origin_y, SECTORSTREAM_SECTORSIZE);
+
+    if(range[2] < 0 || range[3] < 0 || range[0] >= sector_cols || range[1] >= sector_rows)
+        return FALSE;
+
+    range[0] = max(range[0], 0);
+    range[1] = max(range[1], 0);
+    range[2] = min(range[2], sector_cols - 1);
+    range[3] = min(range[3], sector_rows - 1);
+    return TRUE;
+}
+
+/* is sector s near some focus point? */
+int is_near(int s, const v2d_t *focus, int focus_count, int margin)
+{
+    int i, range[4], sx = s % sector_cols, sy = s / sector_cols;
+
+    for(i=0; i<focus_count; i++) {
+        if(sector_range(focus[i], margin, range) && sx >= range[0] && sx <= range[2] && sy >= range[1] && sy <= range[3])
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* the loader thread: reads the requested sectors */
+void loader_routine(void *arg)
+{
+    sectorrecord_t *buffer;
+    int s;
+
+    while(!atomic_get(&quit_loader)) {
+        event_wait(wakeup);
+
+        for(;;) {
+            mutex_lock(mutex);
+            if(queue_length == 0 || atomic_get(&quit_loader)) {
+                mutex_unlock(mutex);
+                break;
+            }
+            s = queue[queue_head];
+            queue_head = (queue_head + 1) % sector_count;
+            queue_length--;
+            mutex_unlock(mutex);
+
+            buffer = read_sector(s);
+
+            mutex_lock(mutex);
+            sector[s].buffer = buffer;
+            sector[s].state = SS_LOADED;
+            done[(done_head + done_length++) % sector_count] = s;
+            mutex_unlock(mutex);
+            event_signal(loaded);
+        }
+    }
+}
+
+/* reads the records of a sector (loader thread).
+ * Returns NULL if there are none, or on error. */
+sectorrecord_t* read_sector(int s)
+{
+    sectorrecord_t *buffer;
+    int count = sector[s].count;
+
+    if(count == 0)
+        return NULL;
+
+    buffer = mallocx(count * sizeof *buffer);
+    if(fseek(file, records_offset + (long)sector[s].first * (long)(sizeof *buffer), SEEK_SET) != 0 || fread(buffer, sizeof *buffer, count, file) != (size_t)count) {
+        free(buffer);
+        return NULL;
+    }
+
+    return buffer;
+}
+
+/* a / b, rounded down (b > 0) */
+int floor_div(int a, int b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/* hash function of a pointer */
+unsigned hash(const void *data)
+{
+    unsigned long x = (unsigned long)data;
+    return (unsigned)((x >> 4) * 2654435761UL);
+}
+
+/* adds a live record to the hash table */
+void hash_insert(int r)
+{
+    int i, s, old_count, *old_slot;
+    unsigned mask;
+
+    /* keep it at most half full */
+    if(2 * (live_count + 1) > slot_count) {
+        old_slot = slot;
+        old_count = slot_count;
+        slot_count *= 2;
+        slot = mallocx(slot_count * sizeof *slot);
+        for(i=0; i<slot_count; i++)
+            slot[i] = 0;
+
+        mask = (unsigned)(slot_count - 1);
+        for(i=0; i<old_count; i++) {
+            if(old_slot[i] != 0) {
+                for(s = (int)(hash(record_entity[old_slot[i] - 1]) & mask); slot[s] != 0; s = (int)((s + 1) & mask));
+                slot[s] = old_slot[i];
+            }
+        }
+        free(old_slot);
+    }
+
+    mask = (unsigned)(slot_count - 1);
+    for(s = (int)(hash(record_entity[r]) & mask); slot[s] != 0; s = (int)((s + 1) & mask));
+    slot[s] = r + 1;
+    live_count++;
+}
+
+/* the slot of an entity, or -1 */
+int hash_find(const void *entity)
+{
+    unsigned mask = (unsigned)(slot_count - 1);
+    int s;
+
+    for(s = (int)(hash(entity) & mask); slot[s] != 0; s = (int)((s + 1) & mask)) {
+        if(record_entity[slot[s] - 1] == entity)
+            return s;
+    }
+
+    return -1;
+}
+
+/* removes slot s from the hash table (the entries
+ * after it are shifted back: no tombstones) */
+void hash_remove(int s)
+{
+    unsigned mask = (unsigned)(slot_count - 1);
+    int j = s, k;
+
+    slot[s] = 0;
+    live_count--;
+
+    for(;;) {
+        j = (int)((j + 1) & mask);
+        if(slot[j] == 0)
+            break;
+
+        /* the entry at j may stay if its home k is cyclically in (s, j] */
+        k = (int)(hash(record_entity[slot[j] - 1]) & mask);
+        if((s <= j) ? (s < k && k <= j) : (s < k || k <= j))
+            continue;
+
+        slot[s] = slot[j];
+        slot[j] = 0;
+        s = j;
+    }
+}
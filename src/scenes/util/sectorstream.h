@@ -0,0 +1,74 @@
+/*
+ * sectorstream.h - level: streaming of large levels, sector by sector
+ * Copyright (C) 2010  Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SECTORSTREAM_H
+#define _SECTORSTREAM_H
+
+#include "../../core/v2d.h"
+
+/*
+   The level loader hands the bricks, items and objects of
+   the .lev to this module instead of creating them. Small
+   levels are then created at once, as usual.
+
+   Large levels are split into square sectors, which are
+   written to a binary sector file, which is kept in the
+   cache directory and reused while the .lev doesn't change
+   (the records the loader hands over are then dropped:
+   the .lev is still parsed). Only the sectors near
+   the camera (and the players) are resident: the others are
+   read from the file by a loader thread when they come near,
+   and their entities are destroyed when they go away.
+
+   An entity that dies while its sector is resident (a ring
+   that has been collected, a badnik that has been destroyed,
+   an object that isn't preserved and went off-screen) is
+   never created again. An evicted entity comes back at its
+   spawn point in its initial state, so these are never
+   evicted: objects that are always active or preserved,
+   preserved items that have a state of their own (doors,
+   switches, checkpoints...) and entities that have moved
+   to a sector that is kept (a platform that carried the
+   player, for instance).
+*/
+
+/* statistics */
+typedef struct {
+    int sectors; /* number of sectors (0 if the level isn't streamed) */
+    int resident; /* sectors whose entities exist */
+    int loads; /* sectors read from the sector file */
+    int evictions; /* sectors whose entities have been destroyed */
+    int destroyed; /* entities that won't be created again */
+} sectorstreamstats_t;
+
+/* public methods */
+void sectorstream_init(const char *abs_path); /* call before reading the .lev at abs_path */
+void sectorstream_release(); /* stops the streaming & discards everything */
+void sectorstream_add_brick(int type, v2d_t position); /* level reader */
+void sectorstream_add_item(int type, v2d_t position); /* level reader */
+void sectorstream_add_object(const char *name, v2d_t position); /* level reader */
+void sectorstream_start(v2d_t focus); /* the level has been read: creates it (or the sectors near focus, if it's large) */
+void sectorstream_update(const v2d_t *focus, int focus_count); /* loads & evicts sectors around the focus points */
+void sectorstream_load_all(); /* creates everything that's left and stops the streaming (level editor) */
+void sectorstream_forget(const void *entity); /* call when an entity is about to be destroyed */
+int sectorstream_is_enabled(); /* is this level being streamed? */
+void sectorstream_level_size(int *width, int *height); /* bounds of the bricks of the level, resident or not */
+sectorstreamstats_t sectorstream_stats();
+
+#endif